@@ -7,8 +7,16 @@
  * Endpoints:
  * - GET /ping - Health check
  * - POST /data - Store sensor data
+ * - POST /data/batch - Store readings of many devices in one D1 batch
  */
 
+// Largest accepted batch (the hub sends one reading per visible sensor)
+const MAX_BATCH_READINGS = 500;
+
+// Tables known to exist in this isolate, so CREATE TABLE/INDEX runs once per
+// device table instead of on every insert
+const knownTables = new Set();
+
 export default {
 	async fetch(request, env, ctx) {
 		const url = new URL(request.url);
@@ -60,33 +68,11 @@ export default {
 				
 				// Create table for this device if it doesn't exist
 				const tableName = createTableName(data.mac);
-				await ensureTable(env.DB, tableName);
+				await ensureTables(env.DB, [tableName]);
 				
 				// Insert data
 				const timestamp = Math.floor(Date.now() / 1000);
-				const deviceData = data.data;
-				
-				const insertQuery = `
-					INSERT INTO ${tableName} (
-						timestamp, 
-						device_name,
-						temperature, 
-						humidity, 
-						battery_mv, 
-						rssi
-					) VALUES (?, ?, ?, ?, ?, ?)
-				`;
-				
-				await env.DB.prepare(insertQuery)
-					.bind(
-						timestamp,
-						data.name || 'Unknown',
-						deviceData.temperature || null,
-						deviceData.humidity || null,
-						deviceData.battery_mv || null,
-						deviceData.rssi || null
-					)
-					.run();
+				await insertStatement(env.DB, tableName, timestamp, data).run();
 				
 				return new Response(JSON.stringify({ 
 					ok: true, 
@@ -97,6 +83,37 @@ export default {
 				});
 			}
 			
+			// Batch ingestion endpoint: { "readings": [ { mac, name, data }, ... ] }
+			if (url.pathname === '/data/batch' && request.method === 'POST') {
+				const body = await request.json();
+				const readings = Array.isArray(body.readings) ? body.readings : null;
+				
+				if (!readings || readings.length === 0 || readings.length > MAX_BATCH_READINGS
+					|| readings.some(r => !r || !isValidMac(r.mac) || !r.data)) {
+					return new Response(JSON.stringify({ error: 'Invalid readings array' }), {
+						status: 400,
+						headers: { ...corsHeaders, 'Content-Type': 'application/json' },
+					});
+				}
+				
+				const tableNames = readings.map(r => createTableName(r.mac));
+				await ensureTables(env.DB, tableNames);
+				
+				// One D1 batch: a single round trip, applied as one transaction.
+				// Readings replayed from the hub's queue carry their own time (ts).
+				const now = Math.floor(Date.now() / 1000);
+				await env.DB.batch(readings.map((r, i) =>
+					insertStatement(env.DB, tableNames[i], readingTime(r, now), r)));
+				
+				return new Response(JSON.stringify({ 
+					ok: true, 
+					stored: readings.length,
+					tables: new Set(tableNames).size
+				}), {
+					headers: { ...corsHeaders, 'Content-Type': 'application/json' },
+				});
+			}
+			
 			// 404 for unknown endpoints
 			return new Response(JSON.stringify({ error: 'Not found' }), {
 				status: 404,
@@ -116,6 +133,13 @@ export default {
 	},
 };
 
+/**
+ * MAC addresses become table names, so only accept hex with optional colons
+ */
+function isValidMac(mac) {
+	return typeof mac === 'string' && /^[0-9A-Fa-f]{2}(:?[0-9A-Fa-f]{2}){5}$/.test(mac);
+}
+
 /**
  * Create a safe table name from MAC address
  * Example: C0:47:C1:A4:3E:42 -> device_c047c1a43e42
@@ -126,9 +150,56 @@ function createTableName(mac) {
 }
 
 /**
- * Ensure table exists for this device
+ * Ensure the tables exist, creating the ones not seen before in one batch
+ */
+async function ensureTables(db, tableNames) {
+	const missing = [...new Set(tableNames)].filter(name => !knownTables.has(name));
+	if (missing.length === 0) {
+		return;
+	}
+	await db.batch(missing.flatMap(name => createTableStatements(db, name)));
+	missing.forEach(name => knownTables.add(name));
+}
+
+/**
+ * Unix time of a reading: its own ts if plausible, otherwise the arrival time
  */
-async function ensureTable(db, tableName) {
+function readingTime(reading, now) {
+	const ts = reading.ts;
+	return (Number.isInteger(ts) && ts > 1700000000 && ts <= now + 300) ? ts : now;
+}
+
+/**
+ * Prepared INSERT of one reading ({ name, data: { temperature, ... } })
+ */
+function insertStatement(db, tableName, timestamp, reading) {
+	const deviceData = reading.data;
+	const insertQuery = `
+		INSERT INTO ${tableName} (
+			timestamp, 
+			device_name,
+			temperature, 
+			humidity, 
+			battery_mv, 
+			rssi
+		) VALUES (?, ?, ?, ?, ?, ?)
+	`;
+	
+	return db.prepare(insertQuery)
+		.bind(
+			timestamp,
+			reading.name || 'Unknown',
+			deviceData.temperature ?? null,
+			deviceData.humidity ?? null,
+			deviceData.battery_mv ?? null,
+			deviceData.rssi ?? null
+		);
+}
+
+/**
+ * Table and index creation for one device table
+ */
+function createTableStatements(db, tableName) {
 	const createTableSQL = `
 		CREATE TABLE IF NOT EXISTS ${tableName} (
 			id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -141,13 +212,11 @@ async function ensureTable(db, tableName) {
 		)
 	`;
 	
-	await db.prepare(createTableSQL).run();
-	
 	// Create index on timestamp for faster queries
 	const createIndexSQL = `
 		CREATE INDEX IF NOT EXISTS idx_${tableName}_timestamp 
 		ON ${tableName}(timestamp DESC)
 	`;
 	
-	await db.prepare(createIndexSQL).run();
+	return [db.prepare(createTableSQL), db.prepare(createIndexSQL)];
 }
@@ -0,0 +1,217 @@
+/**
+ * Offline tests for worker.js: node --test cloudflare/
+ *
+ * FakeD1 stands in for the D1 binding. It keeps rows per table, rejects an
+ * INSERT into a table that was never created, and applies a batch() as one
+ * transaction (all statements or none), like D1. No Cloudflare account,
+ * wrangler or network is needed.
+ */
+
+import { test } from 'node:test';
+import assert from 'node:assert/strict';
+
+const TOKEN = 'test-token';
+
+class FakeD1 {
+	constructor() {
+		this.tables = new Map();   // name -> rows
+		this.log = [];             // 'batch:<n>' / 'run' per call
+		this.failInsertAt = -1;    // Make the n-th INSERT of the next batch throw
+	}
+
+	prepare(sql) {
+		const db = this;
+		const statement = {
+			sql,
+			args: [],
+			bind(...args) {
+				return { ...statement, args };
+			},
+			async run() {
+				db.log.push('run');
+				const tables = new Map([...db.tables].map(([k, v]) => [k, [...v]]));
+				db.apply(tables, this);
+				db.tables = tables;
+				return { success: true };
+			},
+		};
+		return statement;
+	}
+
+	async batch(statements) {
+		this.log.push(`batch:${statements.length}`);
+		const tables = new Map([...this.tables].map(([k, v]) => [k, [...v]]));
+		let inserts = 0;
+		for (const s of statements) {
+			if (/^\s*INSERT/.test(s.sql) && inserts++ === this.failInsertAt) {
+				this.failInsertAt = -1;
+				throw new Error('D1_ERROR: simulated failure');
+			}
+			this.apply(tables, s);
+		}
+		this.tables = tables;  // Commit
+		return statements.map(() => ({ success: true }));
+	}
+
+	apply(tables, s) {
+		let m;
+		if ((m = s.sql.match(/CREATE TABLE IF NOT EXISTS (\w+)/))) {
+			if (!tables.has(m[1])) {
+				tables.set(m[1], []);
+			}
+		} else if ((m = s.sql.match(/INSERT INTO (\w+)/))) {
+			if (!tables.has(m[1])) {
+				throw new Error(`D1_ERROR: no such table: ${m[1]}`);
+			}
+			const [timestamp, device_name, temperature, humidity, battery_mv, rssi] = s.args;
+			tables.get(m[1]).push({ timestamp, device_name, temperature, humidity, battery_mv, rssi });
+		} else if (!/CREATE INDEX/.test(s.sql)) {
+			throw new Error(`unexpected SQL: ${s.sql}`);
+		}
+	}
+
+	rows(mac) {
+		return this.tables.get(`device_${mac.replace(/:/g, '').toLowerCase()}`) ?? [];
+	}
+}
+
+// Fresh module per test: the worker caches created tables per isolate
+let instance = 0;
+async function loadWorker() {
+	return (await import(`./worker.js?instance=${instance++}`)).default;
+}
+
+function post(path, body, token = TOKEN) {
+	return new Request(`http://worker${path}`, {
+		method: 'POST',
+		headers: { Authorization: token, 'Content-Type': 'application/json' },
+		body: typeof body === 'string' ? body : JSON.stringify(body),
+	});
+}
+
+const reading = (mac, data, extra = {}) => ({ mac, name: `Sensor ${mac.slice(-2)}`, data, ...extra });
+
+test('batch stores every reading in one D1 batch', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const res = await worker.fetch(post('/data/batch', { readings: [
+		reading('AA:BB:CC:DD:EE:FF', { temperature: 22.5, humidity: 45, battery_mv: 3000, rssi: -65 }),
+		reading('11:22:33:44:55:66', { temperature: 0, humidity: 50 }),
+		reading('AA:BB:CC:DD:EE:FF', { temperature: 22.6 }),
+	] }), env);
+	assert.equal(res.status, 200);
+	assert.deepEqual(await res.json(), { ok: true, stored: 3, tables: 2 });
+	// Table creation for both devices, then the inserts in one batch
+	assert.deepEqual(env.DB.log, ['batch:4', 'batch:3']);
+	assert.equal(env.DB.rows('AA:BB:CC:DD:EE:FF').length, 2);
+	const [row] = env.DB.rows('11:22:33:44:55:66');
+	assert.equal(row.temperature, 0);  // 0 is a reading, not a missing value
+	assert.equal(row.battery_mv, null);
+	assert.equal(row.device_name, 'Sensor 66');
+});
+
+test('tables are created once per worker instance', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const body = { readings: [reading('AA:BB:CC:DD:EE:01', { temperature: 20 })] };
+	await worker.fetch(post('/data/batch', body), env);
+	await worker.fetch(post('/data/batch', body), env);
+	assert.deepEqual(env.DB.log, ['batch:2', 'batch:1', 'batch:1']);
+	assert.equal(env.DB.rows('AA:BB:CC:DD:EE:01').length, 2);
+});
+
+test('a plausible ts is kept, others get the arrival time', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const now = Math.floor(Date.now() / 1000);
+	const res = await worker.fetch(post('/data/batch', { readings: [
+		reading('AA:BB:CC:DD:EE:02', { temperature: 1 }, { ts: 1760000000 }),
+		reading('AA:BB:CC:DD:EE:02', { temperature: 2 }, { ts: 1000 }),
+		reading('AA:BB:CC:DD:EE:02', { temperature: 3 }, { ts: now + 3600 }),
+		reading('AA:BB:CC:DD:EE:02', { temperature: 4 }, { ts: '1760000000' }),
+	] }), env);
+	assert.equal(res.status, 200);
+	const times = env.DB.rows('AA:BB:CC:DD:EE:02').map(r => r.timestamp);
+	assert.equal(times[0], 1760000000);
+	for (const t of times.slice(1)) {
+		assert.ok(t >= now && t <= now + 5, `arrival time expected, got ${t}`);
+	}
+});
+
+test('invalid batches are rejected without touching D1', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const bodies = [
+		{},
+		{ readings: [] },
+		{ readings: 'x' },
+		{ readings: [reading('AA:BB:CC:DD:EE:FF', { temperature: 1 }), reading('x); DROP TABLE y; --', { temperature: 1 })] },
+		{ readings: [{ mac: 'AA:BB:CC:DD:EE:FF' }] },
+		{ readings: [null] },
+		{ readings: Array.from({ length: 501 }, () => reading('AA:BB:CC:DD:EE:FF', { temperature: 1 })) },
+	];
+	for (const body of bodies) {
+		const res = await worker.fetch(post('/data/batch', body), env);
+		assert.equal(res.status, 400, JSON.stringify(body).slice(0, 80));
+	}
+	assert.deepEqual(env.DB.log, []);
+});
+
+test('500 readings are accepted', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const readings = Array.from({ length: 500 }, (_, i) =>
+		reading(`A4:C1:38:00:${(i >> 8).toString(16).padStart(2, '0')}:${(i & 0xff).toString(16).padStart(2, '0')}`,
+			{ temperature: i / 10 }));
+	const res = await worker.fetch(post('/data/batch', { readings }), env);
+	assert.equal(res.status, 200);
+	assert.deepEqual(await res.json(), { ok: true, stored: 500, tables: 500 });
+	assert.deepEqual(env.DB.log, ['batch:1000', 'batch:500']);
+});
+
+test('a failing batch stores nothing and answers 500', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const body = { readings: [
+		reading('AA:BB:CC:DD:EE:03', { temperature: 1 }),
+		reading('AA:BB:CC:DD:EE:04', { temperature: 2 }),
+	] };
+	await worker.fetch(post('/data/batch', { readings: [body.readings[0]] }), env);
+	env.DB.failInsertAt = 1;
+	const res = await worker.fetch(post('/data/batch', body), env);
+	assert.equal(res.status, 500);
+	// The first insert of the failed batch was rolled back with it
+	assert.equal(env.DB.rows('AA:BB:CC:DD:EE:03').length, 1);
+	assert.equal(env.DB.rows('AA:BB:CC:DD:EE:04').length, 0);
+	// The hub retries the same batch, which then goes through
+	const retry = await worker.fetch(post('/data/batch', body), env);
+	assert.equal(retry.status, 200);
+	assert.equal(env.DB.rows('AA:BB:CC:DD:EE:04').length, 1);
+});
+
+test('malformed JSON answers 500, not 404', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const res = await worker.fetch(post('/data/batch', '{"readings":['), env);
+	assert.equal(res.status, 500);
+});
+
+test('authorization is required', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const res = await worker.fetch(post('/data/batch', { readings: [reading('AA:BB:CC:DD:EE:FF', {})] }, 'wrong'), env);
+	assert.equal(res.status, 401);
+	assert.deepEqual(env.DB.log, []);
+});
+
+test('single-reading /data still works, unknown paths are 404', async () => {
+	const worker = await loadWorker();
+	const env = { DB: new FakeD1(), API_TOKEN: TOKEN };
+	const res = await worker.fetch(post('/data', reading('AA:BB:CC:DD:EE:05', { temperature: 21.5 })), env);
+	assert.equal(res.status, 200);
+	assert.equal((await res.json()).table, 'device_aabbccddee05');
+	assert.equal(env.DB.rows('AA:BB:CC:DD:EE:05')[0].temperature, 21.5);
+	// The hub falls back to /data on 404 from an older worker
+	const missing = await worker.fetch(post('/data/bulk', {}), env);
+	assert.equal(missing.status, 404);
+});
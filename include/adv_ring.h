@@ -0,0 +1,96 @@
+#ifndef ADV_RING_H
+#define ADV_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// Room for advertising data + scan response (2 x 31) plus an appended name
+#ifndef ADV_RING_DATA_MAX
+#define ADV_RING_DATA_MAX 96
+#endif
+
+// One raw observation, copied out of the scan callback as-is
+typedef struct {
+    uint32_t timestamp_ms;  // Tick time when the packet was received
+    uint8_t addr[6];
+    int8_t rssi;
+    uint8_t source_id;      // Interned receiver id ("local", "satellite-<ip>")
+    uint8_t len;
+    uint8_t data[ADV_RING_DATA_MAX];
+} adv_ring_entry_t;
+
+// Lock-free single-producer / single-consumer ring of observations.
+// head is written only by the producer, tail only by the consumer, so
+// neither side ever waits for the other; a full ring drops the new entry.
+typedef struct {
+    adv_ring_entry_t *entries;
+    uint32_t mask;                // Entry count - 1 (entry count is a power of two)
+    atomic_uint_least32_t head;   // Next slot to write (producer)
+    atomic_uint_least32_t tail;   // Next slot to read (consumer)
+    atomic_uint_least32_t dropped;     // Entries rejected because the ring was full
+    atomic_uint_least32_t high_water;  // Largest fill level seen by the producer
+} adv_ring_t;
+
+/**
+ * Initialize a ring on caller-provided entry storage
+ *
+ * @param ring Ring to initialize
+ * @param entries Entry storage
+ * @param entry_count Number of entries, must be a power of two (>= 2)
+ * @return true on success, false if entry_count is invalid
+ */
+bool adv_ring_init(adv_ring_t *ring, adv_ring_entry_t *entries, uint32_t entry_count);
+
+/**
+ * Reserve the next free slot (producer only)
+ *
+ * The slot is filled in place and becomes visible to the consumer after
+ * adv_ring_commit(). If the ring is full, the drop counter is incremented.
+ *
+ * @param ring Ring
+ * @return Slot to fill, or NULL if the ring is full
+ */
+adv_ring_entry_t *adv_ring_reserve(adv_ring_t *ring);
+
+/**
+ * Publish the slot returned by adv_ring_reserve() (producer only)
+ *
+ * @param ring Ring
+ */
+void adv_ring_commit(adv_ring_t *ring);
+
+/**
+ * Get the oldest unread entry (consumer only)
+ *
+ * @param ring Ring
+ * @return Entry, or NULL if the ring is empty. Valid until adv_ring_release().
+ */
+const adv_ring_entry_t *adv_ring_peek(adv_ring_t *ring);
+
+/**
+ * Release the entry returned by adv_ring_peek() (consumer only)
+ *
+ * @param ring Ring
+ */
+void adv_ring_release(adv_ring_t *ring);
+
+/**
+ * Number of entries waiting (approximate when called from a third task)
+ *
+ * @param ring Ring
+ * @return Fill level
+ */
+uint32_t adv_ring_count(adv_ring_t *ring);
+
+/**
+ * Ring capacity
+ *
+ * @param ring Ring
+ * @return Number of entries
+ */
+static inline uint32_t adv_ring_capacity(const adv_ring_t *ring) {
+    return ring->mask + 1;
+}
+
+#endif // ADV_RING_H
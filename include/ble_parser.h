@@ -11,20 +11,60 @@ typedef struct {
     uint8_t humidity;
     uint8_t battery_pct;
     uint16_t battery_mv;
-    char device_type[32];
+    const char *device_type;  // Static string: "pvvx", "ATC", "MiBeacon", "BTHome", "Unknown"
+    bool has_packet_id;       // The format carries a frame/packet counter
+    uint8_t packet_id;        // Same in every repeat of one measurement
 } ble_sensor_data_t;
 
+// Format parser for 16-bit UUID service data (payload includes the UUID)
+typedef bool (*ble_svc_parser_fn)(const uint8_t *svc_data, uint8_t svc_len,
+                                  ble_sensor_data_t *sensor_data);
+
+// Entry of the service data dispatch table
+typedef struct {
+    uint16_t uuid;      // 16-bit service UUID
+    uint8_t min_len;    // Minimum service data length (including UUID) for this parser
+    ble_svc_parser_fn parse;
+} ble_svc_parser_entry_t;
+
+// AD structure types handled by the raw walker
+#define BLE_AD_TYPE_NAME_SHORT      0x08
+#define BLE_AD_TYPE_NAME_COMPLETE   0x09
+#define BLE_AD_TYPE_SVC_DATA_UUID16 0x16
+#define BLE_AD_TYPE_MFG_DATA        0xFF
+
+// Company ID value when no manufacturer data is present
+#define BLE_COMPANY_ID_NONE 0xFFFF
+
+// Zero-copy view of the non-sensor parts of an advertisement.
+// Pointers refer into the caller's buffer and are valid only as long as it is.
+typedef struct {
+    const char *name;           // Local name (not NUL-terminated), NULL if absent
+    uint8_t name_len;
+    bool name_complete;         // Complete (0x09) rather than shortened (0x08) name
+    const uint8_t *mfg_data;    // Manufacturer data incl. company ID, NULL if absent
+    uint8_t mfg_len;
+    uint16_t company_id;        // BLE_COMPANY_ID_NONE if absent
+} ble_adv_view_t;
+
 /**
  * Parse BLE advertisement data and extract sensor information
  * 
+ * Walks the raw AD structures once without copying. Service data is
+ * dispatched to the format parsers (see ble_parse_service_data); the local
+ * name and manufacturer data are returned as pointers into adv_data.
+ * Only the readings present in the packet are written to sensor_data, so a
+ * caller may prefill it with the previous values. A truncated AD structure
+ * ends the walk; everything before it is still used.
+ * 
  * @param adv_data Pointer to advertisement data
  * @param adv_len Length of advertisement data
- * @param company_id Manufacturer company ID
+ * @param view Output view of name/manufacturer data, or NULL if not needed
  * @param sensor_data Output structure for parsed sensor data
  * @return true if sensor data was successfully parsed, false otherwise
  */
 bool ble_parse_sensor_data(const uint8_t *adv_data, uint8_t adv_len, 
-                           uint16_t company_id, ble_sensor_data_t *sensor_data);
+                           ble_adv_view_t *view, ble_sensor_data_t *sensor_data);
 
 /**
  * Parse ATC (Xiaomi Thermometer Custom Format) data
@@ -51,7 +91,7 @@ bool ble_parse_pvvx_format(const uint8_t *svc_data, uint8_t svc_len,
 /**
  * Parse MiBeacon (Xiaomi Original Firmware) data
  * 
- * @param svc_data Service data payload (from UUID 0xFE95)
+ * @param svc_data Service data payload, starting with the UUID 0xFE95
  * @param svc_len Service data length
  * @param sensor_data Output structure for parsed sensor data
  * @return true if successfully parsed
@@ -70,6 +110,20 @@ bool ble_parse_mibeacon_format(const uint8_t *svc_data, uint8_t svc_len,
 bool ble_parse_bthome_v2_format(const uint8_t *svc_data, uint8_t svc_len, 
                                 ble_sensor_data_t *sensor_data);
 
+/**
+ * Parse 16-bit UUID service data using the dispatch table
+ *
+ * The first table entry whose UUID matches and whose minimum length is met
+ * handles the payload (e.g. 0x181A is tried as pvvx first, then ATC).
+ *
+ * @param svc_data Service data payload, starting with the little-endian UUID
+ * @param svc_len Service data length
+ * @param sensor_data Output structure for parsed sensor data
+ * @return true if a parser recognized the payload
+ */
+bool ble_parse_service_data(const uint8_t *svc_data, uint8_t svc_len,
+                            ble_sensor_data_t *sensor_data);
+
 /**
  * Get device type string based on company ID
  * 
@@ -0,0 +1,53 @@
+#ifndef DEVICE_CURSOR_H
+#define DEVICE_CURSOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DEVICE_CURSOR_LEN 24  // Buffer for a cursor, "%08lx.%lu" of epoch and version
+#define DEVICE_ETAG_LEN 32    // Buffer for an ETag, the quoted cursor plus ".all"
+
+// Delta sync cursors of /api/devices and /ws. A cursor is the per-boot
+// epoch and the store version the reply was taken at: a client that sends
+// it back gets only the devices changed after that version, unless the
+// list shrank since then or the hub rebooted.
+
+/**
+ * Format a cursor
+ *
+ * @param buf Output, DEVICE_CURSOR_LEN bytes
+ * @param size Size of buf
+ * @param epoch Random per boot
+ * @param version Store version
+ */
+void device_cursor_format(char *buf, size_t size, uint32_t epoch, uint32_t version);
+
+/**
+ * Format the ETag of a device list: the quoted cursor, with ".all" for
+ * the list including hidden devices
+ *
+ * @param buf Output, DEVICE_ETAG_LEN bytes
+ * @param size Size of buf
+ * @param epoch Random per boot
+ * @param version Store version
+ * @param show_all List includes hidden devices
+ */
+void device_etag_format(char *buf, size_t size, uint32_t epoch, uint32_t version, bool show_all);
+
+/**
+ * Version a client can resume from
+ *
+ * @param cursor Cursor the client sent
+ * @param epoch Current epoch
+ * @param removed_version Version of the last removal or hide
+ * @param version Current store version
+ * @param since_version Set to the cursor's version if it can resume
+ * @return true if the client can get a delta, false if it needs the full
+ *         list (malformed cursor, other boot, list shrank since, or a
+ *         version not reached yet)
+ */
+bool device_cursor_resume(const char *cursor, uint32_t epoch, uint32_t removed_version, uint32_t version,
+                          uint32_t *since_version);
+
+#endif // DEVICE_CURSOR_H
@@ -0,0 +1,72 @@
+#ifndef DEVICE_REGISTRY_H
+#define DEVICE_REGISTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Marks an unused slot (also the largest index that can never be stored)
+#define DEVICE_REGISTRY_EMPTY 0xFFFF
+
+// One slot of the open-addressing table. The MAC is stored inline so a
+// lookup never has to touch the device table itself.
+typedef struct {
+    uint8_t addr[6];
+    uint16_t idx;  // Index into the caller's device table, or DEVICE_REGISTRY_EMPTY
+} device_registry_slot_t;
+
+// MAC -> device index hash table (linear probing, backward-shift delete)
+typedef struct {
+    device_registry_slot_t *slots;
+    uint16_t mask;   // Slot count - 1 (slot count is a power of two)
+    uint16_t count;  // Occupied slots
+} device_registry_t;
+
+/**
+ * Initialize a registry on caller-provided slot storage
+ *
+ * @param reg Registry to initialize
+ * @param slots Slot storage
+ * @param slot_count Number of slots, must be a power of two (2..32768).
+ *                   Keep it at least twice the device table size so probe
+ *                   sequences stay short.
+ * @return true on success, false if slot_count is invalid
+ */
+bool device_registry_init(device_registry_t *reg, device_registry_slot_t *slots,
+                          uint16_t slot_count);
+
+/**
+ * Remove all entries
+ *
+ * @param reg Registry
+ */
+void device_registry_clear(device_registry_t *reg);
+
+/**
+ * Look up a device by MAC address
+ *
+ * @param reg Registry
+ * @param addr 6-byte MAC address (same byte order it was inserted with)
+ * @return Device index, or -1 if not present
+ */
+int device_registry_find(const device_registry_t *reg, const uint8_t *addr);
+
+/**
+ * Insert a MAC -> index mapping, or update the index if the MAC exists
+ *
+ * @param reg Registry
+ * @param addr 6-byte MAC address
+ * @param idx Device index (0..DEVICE_REGISTRY_EMPTY-1)
+ * @return true on success, false if the table is full or idx is out of range
+ */
+bool device_registry_insert(device_registry_t *reg, const uint8_t *addr, int idx);
+
+/**
+ * Remove a MAC from the registry
+ *
+ * @param reg Registry
+ * @param addr 6-byte MAC address
+ * @return true if the MAC was present and removed
+ */
+bool device_registry_remove(device_registry_t *reg, const uint8_t *addr);
+
+#endif // DEVICE_REGISTRY_H
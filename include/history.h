@@ -0,0 +1,96 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Marks a slot with no reading (device not heard during that interval)
+#define HISTORY_GAP INT8_MIN
+
+// One fixed-interval slot, stored as deltas from the previous reading:
+// temperature in 0.1 °C, humidity in 1 %. Deltas saturate at +-127; the
+// encoder tracks the reconstructed value, so a clamped step is caught up
+// over the following slots instead of drifting.
+typedef struct {
+    int8_t temp;  // HISTORY_GAP if the slot is empty
+    int8_t hum;
+} history_delta_t;
+
+// Delta-encoded ring of readings at fixed resolution for one sensor.
+// Only the newest value is stored in full; older values are decoded by
+// walking the deltas backward from it, so overwriting the oldest slot
+// needs no re-basing.
+typedef struct {
+    history_delta_t *slots;
+    uint16_t capacity;
+    uint16_t head;        // Ring position of the newest slot
+    uint16_t count;       // Slots in use
+    uint32_t last_slot;   // Slot time (interval number) of the newest slot
+    int16_t last_temp;    // Newest temperature, 0.1 °C
+    int16_t last_hum;     // Newest humidity, %
+} history_series_t;
+
+// Decoded reading
+typedef struct {
+    uint32_t slot;   // Slot time (interval number)
+    bool valid;      // false for gap slots
+    int16_t temp;    // 0.1 °C
+    int16_t hum;     // %
+} history_sample_t;
+
+// Forward iterator over a series (oldest to newest)
+typedef struct {
+    uint16_t pos;        // Ring position of the next slot
+    uint16_t remaining;
+    uint32_t slot;
+    int16_t temp;
+    int16_t hum;
+    bool first;
+} history_cursor_t;
+
+/**
+ * Initialize an empty series on caller-provided slot storage
+ *
+ * @param series Series to initialize
+ * @param slots Slot storage
+ * @param capacity Number of slots (e.g. 1440 for 24 h at 1 min)
+ */
+void history_series_init(history_series_t *series, history_delta_t *slots, uint16_t capacity);
+
+/**
+ * Record a reading
+ *
+ * A reading in the same slot as the newest one replaces it (latest value
+ * wins). Skipped slots are filled with gaps. Slot times older than the
+ * newest slot are treated as the newest slot.
+ *
+ * @param series Series
+ * @param slot Slot time (e.g. uptime minutes)
+ * @param temp Temperature, 0.1 °C
+ * @param hum Humidity, %
+ */
+void history_series_record(history_series_t *series, uint32_t slot, int16_t temp, int16_t hum);
+
+/**
+ * Start iterating over the newest slots of a series, oldest first
+ *
+ * @param series Series
+ * @param max_slots Number of newest slots wanted
+ * @param cursor Cursor to initialize
+ * @return Number of slots the cursor will return
+ */
+uint16_t history_series_begin(const history_series_t *series, uint16_t max_slots,
+                              history_cursor_t *cursor);
+
+/**
+ * Get the next slot
+ *
+ * @param series Series (must not change while iterating)
+ * @param cursor Cursor from history_series_begin()
+ * @param out Decoded reading
+ * @return true if a slot was returned, false at the end
+ */
+bool history_series_next(const history_series_t *series, history_cursor_t *cursor,
+                         history_sample_t *out);
+
+#endif // HISTORY_H
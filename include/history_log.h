@@ -0,0 +1,148 @@
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "history.h"
+
+// Flash erase unit; the log is a ring of sectors
+#define HISTORY_LOG_SECTOR_SIZE 4096
+
+// Largest encoded block payload (a 60-sample block is typically 20-60 bytes)
+#define HISTORY_LOG_MAX_PAYLOAD 512
+
+// Flash access used by the log, so it can run on a partition or a host buffer.
+// Each function returns true on success.
+typedef struct {
+    void *ctx;
+    bool (*read)(void *ctx, uint32_t offset, void *buf, uint32_t len);
+    bool (*write)(void *ctx, uint32_t offset, const void *buf, uint32_t len);
+    bool (*erase_sector)(void *ctx, uint32_t offset);
+} history_log_flash_t;
+
+// Per-sector time index, rebuilt from flash at mount
+typedef struct {
+    uint32_t seq;       // Sector generation, 0 if the sector holds no valid header
+    uint32_t t_min;     // Oldest block start time in the sector (unix s)
+    uint32_t t_max;     // Newest block end time in the sector (unix s)
+} history_log_sector_t;
+
+// Block payload kinds
+#define HISTORY_LOG_KIND_SAMPLES 0xFF   // history_log_encode samples (the erased value, so older blocks read as samples)
+#define HISTORY_LOG_KIND_ROLLUP  0x02   // Array of rollup_bucket_t, one per interval_s
+
+// Block metadata as stored in front of each encoded payload
+typedef struct {
+    uint8_t addr[6];
+    uint8_t battery_pct;    // Battery level when the block was written
+    uint8_t kind;           // HISTORY_LOG_KIND_*
+    uint32_t start_time;    // Unix time of the first sample
+    uint16_t interval_s;    // Seconds between samples (or bucket width)
+    uint16_t count;         // Number of samples or buckets (including gaps)
+} history_log_block_t;
+
+// Append-only log of compressed sample blocks in a ring of flash sectors.
+// Sectors are filled and erased strictly in turn, so wear is spread evenly,
+// and the oldest sector is recycled when the log is full (retention by size).
+typedef struct {
+    history_log_flash_t flash;
+    history_log_sector_t *index;
+    uint16_t sector_count;
+    uint16_t head;          // Sector currently appended to
+    uint32_t head_offset;   // Next free byte within the head sector
+    uint32_t seq;           // Generation of the head sector
+    uint32_t blocks;        // Valid blocks found at mount + appended since
+} history_log_t;
+
+// Called for each matching block; return false to stop the query
+typedef bool (*history_log_visit_fn)(void *ctx, const history_log_block_t *block,
+                                     const uint8_t *payload, uint16_t len);
+
+// Called for each decoded sample of a block
+typedef void (*history_sample_fn)(void *ctx, uint32_t time, const history_sample_t *sample);
+
+/**
+ * Mount the log, scanning sector headers and blocks to rebuild the time index
+ *
+ * A block with a bad CRC (torn write) closes its sector; the next append
+ * starts a new sector. An unformatted area is used as an empty log.
+ *
+ * @param log Log to mount
+ * @param flash Flash access
+ * @param index Index storage, one entry per sector
+ * @param sector_count Number of HISTORY_LOG_SECTOR_SIZE sectors (>= 2)
+ * @return true on success, false on flash errors or invalid size
+ */
+bool history_log_mount(history_log_t *log, const history_log_flash_t *flash,
+                       history_log_sector_t *index, uint16_t sector_count);
+
+/**
+ * Append one encoded block
+ *
+ * @param log Log
+ * @param block Block metadata
+ * @param payload Encoded samples (history_log_encode)
+ * @param len Payload length (<= HISTORY_LOG_MAX_PAYLOAD)
+ * @return true if written
+ */
+bool history_log_append(history_log_t *log, const history_log_block_t *block,
+                        const uint8_t *payload, uint16_t len);
+
+/**
+ * Visit the blocks of one device that overlap a time range, oldest first
+ *
+ * Sectors outside the range are skipped using the time index.
+ *
+ * @param log Log
+ * @param addr Device address, or NULL for all devices
+ * @param t_from Range start (unix s, inclusive)
+ * @param t_to Range end (unix s, inclusive)
+ * @param visit Callback
+ * @param ctx Callback context
+ * @return Number of blocks visited
+ */
+int history_log_query(const history_log_t *log, const uint8_t *addr, uint32_t t_from, uint32_t t_to,
+                      history_log_visit_fn visit, void *ctx);
+
+/**
+ * Erase the whole log
+ *
+ * @param log Mounted log
+ * @return true on success
+ */
+bool history_log_format(history_log_t *log);
+
+/**
+ * Oldest time still stored in the log
+ *
+ * @param log Log
+ * @return Unix time, or 0 if the log is empty
+ */
+uint32_t history_log_oldest(const history_log_t *log);
+
+/**
+ * Compress samples (Gorilla-style: delta-of-delta temperature, delta
+ * humidity, variable-length bit codes, 1 bit per gap)
+ *
+ * @param samples Samples, one per interval
+ * @param count Number of samples
+ * @param out Output buffer
+ * @param cap Output buffer size
+ * @return Encoded length, or 0 if it doesn't fit
+ */
+uint16_t history_log_encode(const history_sample_t *samples, uint16_t count, uint8_t *out, uint16_t cap);
+
+/**
+ * Decompress a block and report each valid sample with its time
+ *
+ * @param block Block metadata
+ * @param payload Encoded samples
+ * @param len Payload length
+ * @param fn Callback for each valid sample
+ * @param ctx Callback context
+ * @return true if the whole block decoded
+ */
+bool history_log_decode(const history_log_block_t *block, const uint8_t *payload, uint16_t len,
+                        history_sample_fn fn, void *ctx);
+
+#endif // HISTORY_LOG_H
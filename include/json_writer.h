@@ -0,0 +1,102 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define JSON_WRITER_MAX_DEPTH 16
+
+/**
+ * Output callback: receives each full buffer and the remainder on finish
+ *
+ * @return true on success; after a failure the writer drops all output
+ */
+typedef bool (*json_writer_flush_t)(void *ctx, const char *data, size_t len);
+
+// Streaming JSON encoder over a small caller-provided buffer. Commas and
+// string escaping are handled by the writer; the output size is unbounded.
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    json_writer_flush_t flush;
+    void *ctx;
+    uint32_t has_items;  // Bit per nesting level: a value was already written
+    uint8_t depth;
+    bool after_key;      // Next value belongs to a key (no comma)
+    bool failed;
+} json_writer_t;
+
+/**
+ * Initialize a writer
+ *
+ * @param w Writer
+ * @param buf Output buffer (at least 64 bytes; longer formatted values are cut)
+ * @param size Buffer size
+ * @param flush Output callback
+ * @param ctx Callback context
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_writer_flush_t flush, void *ctx);
+
+/**
+ * Flush what is buffered
+ *
+ * @param w Writer
+ * @return false if any output failed
+ */
+bool json_writer_finish(json_writer_t *w);
+
+void json_object_begin(json_writer_t *w);
+void json_object_end(json_writer_t *w);
+void json_array_begin(json_writer_t *w);
+void json_array_end(json_writer_t *w);
+
+/**
+ * Write an object key; the next value or container belongs to it
+ *
+ * @param w Writer
+ * @param key Key (not escaped, use plain identifiers)
+ */
+void json_key(json_writer_t *w, const char *key);
+
+void json_string(json_writer_t *w, const char *s);
+void json_int(json_writer_t *w, int32_t v);
+void json_uint(json_writer_t *w, uint32_t v);
+void json_bool(json_writer_t *w, bool v);
+void json_null(json_writer_t *w);
+
+/**
+ * Write a number with a fixed number of decimals (NaN/inf become null)
+ *
+ * @param w Writer
+ * @param v Value
+ * @param decimals Digits after the decimal point
+ */
+void json_float(json_writer_t *w, double v, int decimals);
+
+/**
+ * Write a printf-formatted string value (quoted, not escaped: use for
+ * formats that can't produce quotes or backslashes, e.g. MAC addresses)
+ *
+ * @param w Writer
+ * @param fmt printf format
+ */
+void json_stringf(json_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Write a pre-encoded JSON value as is
+ *
+ * @param w Writer
+ * @param json Valid JSON text
+ */
+void json_raw(json_writer_t *w, const char *json);
+
+// key + value in one call
+void json_field_string(json_writer_t *w, const char *key, const char *s);
+void json_field_int(json_writer_t *w, const char *key, int32_t v);
+void json_field_uint(json_writer_t *w, const char *key, uint32_t v);
+void json_field_bool(json_writer_t *w, const char *key, bool v);
+void json_field_float(json_writer_t *w, const char *key, double v, int decimals);
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,74 @@
+#ifndef RECEIVER_SET_H
+#define RECEIVER_SET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RX_SET_SIZE 3        // Receivers tracked per device
+#define RX_RSSI_WINDOW 4     // Latest RSSI samples averaged per receiver
+#define RX_SOURCE_NONE 0     // source_id of an empty slot
+
+// One receiver (the hub's own scanner or a satellite) that hears a device
+typedef struct {
+    uint32_t last_ms;             // Last packet from this receiver
+    uint8_t source_id;            // RX_SOURCE_NONE = empty slot
+    uint8_t count;                // Samples in rssi[], up to RX_RSSI_WINDOW
+    uint8_t next;                 // Slot the next sample overwrites
+    int8_t rssi[RX_RSSI_WINDOW];
+} rx_receiver_t;
+
+// Receivers of one device and the one currently chosen. The choice only
+// moves to another receiver whose average RSSI is better by the hysteresis
+// margin, or when the chosen one has gone quiet, so a device heard by
+// several receivers doesn't flip with every packet. All zero = empty.
+typedef struct {
+    rx_receiver_t rx[RX_SET_SIZE];
+    uint8_t best;                 // Index into rx, valid if rx[best] isn't empty
+} rx_set_t;
+
+/**
+ * Add a packet's RSSI and re-evaluate the chosen receiver
+ *
+ * A receiver not yet in the set takes an empty slot, or the one heard
+ * least recently (never the chosen one). A challenger needs at least two
+ * samples before it can take over.
+ *
+ * @param set Receiver set of the device
+ * @param source_id Receiver that heard the packet (not RX_SOURCE_NONE)
+ * @param rssi Packet RSSI, dBm
+ * @param now_ms Packet time
+ * @param stale_ms A receiver not heard for this long can't stay or become chosen
+ * @param hysteresis_db Margin a challenger must beat the chosen receiver by
+ * @return source_id of the chosen receiver
+ */
+uint8_t rx_set_observe(rx_set_t *set, uint8_t source_id, int8_t rssi, uint32_t now_ms,
+                       uint32_t stale_ms, uint8_t hysteresis_db);
+
+/**
+ * Remove a receiver that no longer exists (e.g. a satellite slot given to
+ * another satellite). If it was the chosen one, the most recently heard
+ * of the others takes over.
+ *
+ * @param set Receiver set of the device
+ * @param source_id Receiver to remove
+ * @return source_id of the chosen receiver, RX_SOURCE_NONE if none is left
+ */
+uint8_t rx_set_forget(rx_set_t *set, uint8_t source_id);
+
+/**
+ * Average RSSI of the chosen receiver
+ *
+ * @param set Receiver set
+ * @return dBm, 0 if the set is empty
+ */
+int8_t rx_set_best_rssi(const rx_set_t *set);
+
+/**
+ * Average of a receiver's RSSI window
+ *
+ * @param rx Receiver (count > 0)
+ * @return dBm
+ */
+int8_t rx_receiver_rssi(const rx_receiver_t *rx);
+
+#endif // RECEIVER_SET_H
@@ -0,0 +1,84 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// A deadband of this value means "use the default policy's deadband"
+#define REPORT_DEADBAND_DEFAULT 0xFF
+
+// When a sensor reading is worth uploading. A reading is reported if it
+// moved out of the deadband around the last reported value, or if the
+// heartbeat interval has passed, but never sooner than min_interval_s
+// after the previous report.
+typedef struct {
+    uint16_t temp_deadband_centi;  // 0.01 °C, 0 = any change
+    uint8_t hum_deadband;          // %RH, 0 = any change
+    uint8_t battery_deadband;      // %, 0 = battery changes don't trigger a report
+    uint16_t min_interval_s;       // Rate limit per device
+    uint16_t max_interval_s;       // Heartbeat, 0 = none
+} report_policy_t;
+
+// Per-device state: the last reported values
+typedef struct {
+    uint32_t last_report_s;  // Monotonic seconds of the last report, 0 = never reported
+    int16_t temp_centi;
+    uint8_t humidity;
+    uint8_t battery_pct;
+} report_state_t;
+
+typedef enum {
+    REPORT_NONE = 0,
+    REPORT_FIRST,      // Nothing reported yet
+    REPORT_CHANGE,     // Out of the deadband
+    REPORT_HEARTBEAT,  // Unchanged, but max_interval_s has passed
+} report_reason_t;
+
+/**
+ * Decide whether a reading should be reported
+ *
+ * Does not modify the state; call report_policy_commit() once the reading
+ * has actually been handed on, so a reading that couldn't be queued is
+ * reconsidered on the next one.
+ *
+ * @param policy Policy to apply
+ * @param state Device state
+ * @param now_s Monotonic seconds, must be >= 1
+ * @param temp_centi Temperature in 0.01 °C
+ * @param humidity Humidity in %RH
+ * @param battery_pct Battery level in %
+ * @return Why the reading should be reported, or REPORT_NONE
+ */
+report_reason_t report_policy_evaluate(const report_policy_t *policy, const report_state_t *state,
+                                       uint32_t now_s, int16_t temp_centi, uint8_t humidity,
+                                       uint8_t battery_pct);
+
+/**
+ * Record a reported reading as the new reference
+ *
+ * @param state Device state
+ * @param now_s Monotonic seconds, must be >= 1
+ * @param temp_centi Temperature in 0.01 °C
+ * @param humidity Humidity in %RH
+ * @param battery_pct Battery level in %
+ */
+void report_policy_commit(report_state_t *state, uint32_t now_s, int16_t temp_centi,
+                          uint8_t humidity, uint8_t battery_pct);
+
+/**
+ * Policy with per-device deadbands applied over a default
+ *
+ * @param def Default policy
+ * @param temp_deadband_centi Device temperature deadband, or REPORT_DEADBAND_DEFAULT
+ * @param hum_deadband Device humidity deadband, or REPORT_DEADBAND_DEFAULT
+ * @return Effective policy
+ */
+report_policy_t report_policy_for_device(const report_policy_t *def, uint8_t temp_deadband_centi,
+                                         uint8_t hum_deadband);
+
+/**
+ * Short name of a reason ("first", "change", "heartbeat"), for logs
+ */
+const char *report_reason_str(report_reason_t reason);
+
+#endif // REPORT_POLICY_H
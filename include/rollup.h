@@ -0,0 +1,126 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Resolution tiers, finest first
+#define ROLLUP_TIER_COUNT 3
+extern const uint32_t rollup_tier_seconds[ROLLUP_TIER_COUNT];  // 60, 900, 3600
+
+// Open (accumulating) min/avg/max bucket. Temperature in 0.1 °C, humidity in %.
+typedef struct {
+    uint32_t start;     // Bucket start time (seconds, caller's time base)
+    int32_t t_sum;
+    int32_t h_sum;
+    int16_t t_min;
+    int16_t t_max;
+    uint8_t h_min;
+    uint8_t h_max;
+    uint16_t count;     // Readings (or merged weight)
+} rollup_acc_t;
+
+// Closed bucket as stored in RAM rings and flash blocks (9 bytes).
+// min/max are stored as distances from the average, saturating at 255.
+typedef struct __attribute__((packed)) {
+    int16_t t_avg;
+    uint8_t t_below;    // t_avg - t_min
+    uint8_t t_above;    // t_max - t_avg
+    uint8_t h_avg;
+    uint8_t h_below;
+    uint8_t h_above;
+    uint16_t count;     // Readings (or merged weight); 0 marks an empty bucket
+} rollup_bucket_t;
+
+// Ring of closed buckets at one resolution. Empty periods are stored as
+// count 0 buckets, so bucket times are implicit.
+typedef struct {
+    rollup_bucket_t *buckets;
+    uint16_t capacity;
+    uint16_t head;          // Position of the newest bucket
+    uint16_t count;
+    uint32_t interval;      // Bucket width in seconds
+    uint32_t last_start;    // Start time of the newest bucket
+} rollup_ring_t;
+
+/**
+ * Reset an accumulator to an empty bucket
+ *
+ * @param acc Accumulator
+ * @param start Bucket start time
+ */
+void rollup_acc_reset(rollup_acc_t *acc, uint32_t start);
+
+/**
+ * Add one reading
+ *
+ * @param acc Accumulator
+ * @param temp Temperature, 0.1 °C
+ * @param hum Humidity, %
+ */
+void rollup_acc_add(rollup_acc_t *acc, int16_t temp, uint8_t hum);
+
+/**
+ * Merge a closed bucket, weighted by its count
+ *
+ * The accumulator's count saturates at UINT16_MAX; a bucket merged past
+ * that adds only the remaining weight to the average.
+ *
+ * @param acc Accumulator
+ * @param bucket Bucket (ignored if empty)
+ */
+void rollup_acc_merge(rollup_acc_t *acc, const rollup_bucket_t *bucket);
+
+/**
+ * Pack an accumulator into a closed bucket
+ *
+ * @param acc Accumulator
+ * @param bucket Output bucket (count 0 if the accumulator is empty)
+ */
+void rollup_acc_pack(const rollup_acc_t *acc, rollup_bucket_t *bucket);
+
+/**
+ * Feed a reading into an open bucket, closing it into the ring first if
+ * the reading belongs to a later period
+ *
+ * @param ring Ring of closed buckets
+ * @param acc Open bucket for the same resolution
+ * @param time Reading time (seconds)
+ * @param temp Temperature, 0.1 °C
+ * @param hum Humidity, %
+ */
+void rollup_feed(rollup_ring_t *ring, rollup_acc_t *acc, uint32_t time, int16_t temp, uint8_t hum);
+
+/**
+ * Initialize an empty ring
+ *
+ * @param ring Ring
+ * @param buckets Bucket storage
+ * @param capacity Number of buckets
+ * @param interval Bucket width in seconds
+ */
+void rollup_ring_init(rollup_ring_t *ring, rollup_bucket_t *buckets, uint16_t capacity, uint32_t interval);
+
+/**
+ * Get a bucket by age
+ *
+ * @param ring Ring
+ * @param age 0 for the newest bucket, count-1 for the oldest
+ * @param start Output: bucket start time
+ * @return Bucket, or NULL if age is out of range
+ */
+const rollup_bucket_t *rollup_ring_get(const rollup_ring_t *ring, uint16_t age, uint32_t *start);
+
+/**
+ * Pick the resolution for a time range and point budget: the finest tier
+ * whose point count fits, and for ranges too long even for the coarsest
+ * tier, how many of its buckets to merge per point
+ *
+ * @param range_s Requested range in seconds
+ * @param max_points Point budget
+ * @param merge Output: buckets per point (>= 1)
+ * @return Tier index
+ */
+int rollup_pick_tier(uint32_t range_s, uint32_t max_points, uint32_t *merge);
+
+#endif // ROLLUP_H
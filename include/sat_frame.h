@@ -0,0 +1,121 @@
+#ifndef SAT_FRAME_H
+#define SAT_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Binary satellite uplink, version 1 (all integers little-endian):
+//
+//   header  'S' 'F' version flags            4 bytes, once per body
+//   record  len                              1 byte: bytes that follow (9..255)
+//           mac[6]                           as printed, AA first
+//           rssi                             int8, dBm
+//           age_ms                           uint16: time since the packet
+//                                            was heard (saturates at 65535)
+//           ad[len - 9]                      advertising data + scan response
+//                                            (AD structures, as received)
+//
+// Records repeat until the end of the body, so one POST can carry a batch.
+// A name the satellite learned elsewhere goes into ad as a Complete Local
+// Name structure.
+#define SAT_FRAME_MAGIC0 'S'
+#define SAT_FRAME_MAGIC1 'F'
+#define SAT_FRAME_VERSION 1
+#define SAT_FRAME_HEADER_LEN 4
+#define SAT_FRAME_RECORD_FIXED 9   // mac + rssi + age_ms
+#define SAT_FRAME_RECORD_MAX 256   // Including the length byte
+#define SAT_FRAME_CONTENT_TYPE "application/x-sat-frame"
+
+// One decoded observation. ad points into the decoder's input or its
+// record buffer and is only valid during the callback.
+typedef struct {
+    uint8_t mac[6];
+    int8_t rssi;
+    uint16_t age_ms;
+    const uint8_t *ad;
+    uint8_t ad_len;
+} sat_record_t;
+
+typedef enum {
+    SAT_FRAME_OK = 0,
+    SAT_FRAME_BAD_MAGIC,
+    SAT_FRAME_BAD_VERSION,
+    SAT_FRAME_BAD_RECORD,     // Record length below SAT_FRAME_RECORD_FIXED
+    SAT_FRAME_TRUNCATED,      // Body ended inside the header or a record
+} sat_frame_status_t;
+
+typedef void (*sat_record_cb_t)(void *ctx, const sat_record_t *rec);
+
+// Incremental decoder: the body may arrive in chunks of any size. Records
+// that lie within one chunk are decoded in place; only a record split
+// across chunks is copied (into rec_buf).
+typedef struct {
+    uint8_t header[SAT_FRAME_HEADER_LEN];
+    uint8_t header_got;
+    uint16_t rec_got;                       // Bytes of a split record in rec_buf
+    uint8_t rec_buf[SAT_FRAME_RECORD_MAX];
+    sat_frame_status_t status;              // First error; decoding stops there
+    uint32_t records;                       // Records delivered
+} sat_frame_decoder_t;
+
+/**
+ * Start decoding a new body
+ *
+ * @param d Decoder
+ */
+void sat_frame_decoder_init(sat_frame_decoder_t *d);
+
+/**
+ * Start decoding records that come without the body header (the records
+ * part of a UDP datagram, sat_udp.h)
+ *
+ * @param d Decoder
+ */
+void sat_frame_decoder_init_records(sat_frame_decoder_t *d);
+
+/**
+ * Decode the next chunk of a body
+ *
+ * @param d Decoder
+ * @param data Chunk
+ * @param len Chunk length
+ * @param cb Called for each complete record
+ * @param ctx Callback context
+ * @return SAT_FRAME_OK, or the error that stopped decoding
+ */
+sat_frame_status_t sat_frame_decode(sat_frame_decoder_t *d, const uint8_t *data, size_t len,
+                                    sat_record_cb_t cb, void *ctx);
+
+/**
+ * End of body: check it didn't stop inside the header or a record
+ *
+ * @param d Decoder
+ * @return SAT_FRAME_OK, SAT_FRAME_TRUNCATED, or an earlier error
+ */
+sat_frame_status_t sat_frame_decoder_finish(sat_frame_decoder_t *d);
+
+/**
+ * Write the body header
+ *
+ * @param buf At least SAT_FRAME_HEADER_LEN bytes
+ * @return SAT_FRAME_HEADER_LEN
+ */
+size_t sat_frame_write_header(uint8_t *buf);
+
+/**
+ * Append one record (for satellites and test tools)
+ *
+ * @param buf Output
+ * @param size Room in buf
+ * @param rec Observation (ad_len <= SAT_FRAME_RECORD_MAX - 1 - SAT_FRAME_RECORD_FIXED)
+ * @return Bytes written, or 0 if it doesn't fit
+ */
+size_t sat_frame_write_record(uint8_t *buf, size_t size, const sat_record_t *rec);
+
+/**
+ * Short description of a status, for logs and error replies
+ */
+const char *sat_frame_status_str(sat_frame_status_t status);
+
+#endif // SAT_FRAME_H
@@ -0,0 +1,85 @@
+#ifndef SAT_JSON_H
+#define SAT_JSON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sat_frame.h"
+
+// Advertising data + scan response, plus room for an appended name
+#define SAT_JSON_AD_MAX 96
+#define SAT_JSON_NAME_MAX 29
+#define SAT_JSON_TOKEN_MAX 24
+
+// Streaming decoder for a JSON array of satellite observations:
+//
+//   [{"mac":"AA:BB:CC:DD:EE:FF","rssi":-65,"data":"0201061AFF...",
+//     "name":"ATC_1234","age":120}, ...]
+//
+// mac and data are required, rssi, name and age (ms since the packet was
+// heard) optional; other keys are skipped. Values must be strings, numbers,
+// true, false or null (no nested objects or arrays). A name goes into the
+// record as a trailing Complete Local Name AD structure.
+//
+// The body may arrive in chunks of any size; memory use is fixed (this
+// struct), whatever the number of observations.
+typedef enum {
+    SAT_JSON_OK = 0,
+    SAT_JSON_SYNTAX,     // Not an array of flat objects
+    SAT_JSON_TRUNCATED,  // Body ended before the closing ]
+} sat_json_status_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t field;                    // Key the current value belongs to
+    bool escape;                      // Previous string character was a backslash
+    char token[SAT_JSON_TOKEN_MAX];   // Key, number, literal or MAC being read
+    uint8_t token_len;
+    int8_t hex_high;                  // First nibble of a data byte, -1 if none
+    // Observation being read
+    bool has_mac;
+    bool has_data;
+    bool bad;                         // mac or data malformed
+    sat_record_t rec;
+    uint8_t ad[SAT_JSON_AD_MAX];
+    char name[SAT_JSON_NAME_MAX];
+    uint8_t name_len;
+    sat_json_status_t status;         // First error; decoding stops there
+    uint32_t records;                 // Observations delivered
+    uint32_t invalid;                 // Objects skipped (no or bad mac/data)
+} sat_json_decoder_t;
+
+/**
+ * Start decoding a new body
+ *
+ * @param d Decoder
+ */
+void sat_json_decoder_init(sat_json_decoder_t *d);
+
+/**
+ * Decode the next chunk of a body
+ *
+ * @param d Decoder
+ * @param data Chunk
+ * @param len Chunk length
+ * @param cb Called for each complete observation
+ * @param ctx Callback context
+ * @return SAT_JSON_OK, or the error that stopped decoding
+ */
+sat_json_status_t sat_json_decode(sat_json_decoder_t *d, const uint8_t *data, size_t len,
+                                  sat_record_cb_t cb, void *ctx);
+
+/**
+ * End of body: check the array was closed
+ *
+ * @param d Decoder
+ * @return SAT_JSON_OK, SAT_JSON_TRUNCATED, or an earlier error
+ */
+sat_json_status_t sat_json_decoder_finish(sat_json_decoder_t *d);
+
+/**
+ * Short description of a status, for logs and error replies
+ */
+const char *sat_json_status_str(sat_json_status_t status);
+
+#endif // SAT_JSON_H
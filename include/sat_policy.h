@@ -0,0 +1,71 @@
+#ifndef SAT_POLICY_H
+#define SAT_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Edge filtering policy the hub publishes at /api/satellite/policy. The hub
+// only computes its ETag; the watch list matching and the per-device
+// filter below are what a satellite applies to each advertisement before
+// forwarding it.
+typedef struct {
+    bool dedupe;               // Drop repeats of an unchanged advertisement (same frame counter)
+    uint32_t min_interval_ms;  // Per device: forward at most this often
+    uint32_t refresh_ms;       // Per device: forward an unchanged one anyway after this long
+} sat_policy_t;
+
+// Satellite side, per device: what was forwarded last
+typedef struct {
+    bool forwarded;         // Anything forwarded yet
+    uint32_t last_ms;       // When
+    uint32_t payload_hash;  // FNV-1a of the advertisement
+    uint8_t payload_len;
+} sat_filter_state_t;
+
+/**
+ * ETag of a policy and its watch list
+ *
+ * FNV-1a over watch_all, the policy fields and the watch list, so the
+ * list must be sorted (memcmp order) for the same devices to give the
+ * same tag.
+ *
+ * @param policy Policy
+ * @param watch_all Discovery mode: everything is wanted
+ * @param watch Watch list, count MACs of 6 bytes each, sorted
+ * @param count Number of MACs
+ * @return Hash, sent as "%08lx" in quotes
+ */
+uint32_t sat_policy_etag(const sat_policy_t *policy, bool watch_all, const uint8_t *watch, int count);
+
+/**
+ * Whether a device is wanted by the hub
+ *
+ * @param watch_all Discovery mode: everything is wanted
+ * @param watch Watch list, count MACs of 6 bytes each, sorted
+ * @param count Number of MACs
+ * @param mac Device MAC, in the order of the watch list
+ * @return true to forward the device's advertisements
+ */
+bool sat_policy_watches(bool watch_all, const uint8_t *watch, int count, const uint8_t *mac);
+
+/**
+ * Whether to forward an advertisement of a watched device
+ *
+ * The first advertisement is always forwarded; after that none sooner
+ * than min_interval_ms. With dedupe, an advertisement equal to the last
+ * forwarded one (the whole payload, which includes the frame counter) is
+ * dropped until refresh_ms has passed; refresh_ms 0 drops it for good.
+ * The state is updated when the advertisement is forwarded.
+ *
+ * @param policy Policy
+ * @param state Device state
+ * @param ad Advertisement payload
+ * @param len Payload length
+ * @param now_ms Current time in ms (may wrap)
+ * @return true to forward
+ */
+bool sat_policy_forward(const sat_policy_t *policy, sat_filter_state_t *state, const uint8_t *ad,
+                        size_t len, uint32_t now_ms);
+
+#endif // SAT_POLICY_H
@@ -0,0 +1,120 @@
+#ifndef SAT_REGISTRY_H
+#define SAT_REGISTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SAT_LATENCY_BUCKETS 10  // Upload latency histogram: < 1, 2, 4 ... 256 ms, rest
+
+// One satellite, keyed on its IPv4 address (the socket peer, not a header
+// the client could set)
+typedef struct {
+    uint32_t ip;              // IPv4, network byte order, 0 = free slot
+    uint32_t active_ms;       // Last accepted upload or datagram, for reuse
+    uint32_t last_seen_ms;    // Last observation that reached ingest, 0 = none yet
+    uint32_t received;        // Observations that reached ingest (HTTP and UDP)
+    uint32_t sensors;         // ... of which carried sensor data
+    uint32_t parse_failures;  // Bad bodies, objects, records or datagram records
+    uint32_t rate_received;   // received and sensors at the last rate update
+    uint32_t rate_sensors;
+    float adv_rate;           // Per second, over the last rate interval
+    float sensor_rate;
+    uint32_t requests;        // HTTP uploads
+    uint32_t latency[SAT_LATENCY_BUCKETS];  // Upload handling time, bucket n: < 2^n ms
+    uint32_t forwarded;       // Reported by the satellite: sent since its boot
+    uint32_t filtered;        // Reported by the satellite: dropped by the policy since its boot
+    uint32_t policy_fetches;
+    uint32_t policy_ms;       // Last policy fetch, 0 = never
+    bool policy_current;      // Already held the current policy at that fetch
+} sat_entry_t;
+
+// Fixed set of satellite slots. A slot is claimed only by a sender whose
+// upload or datagram was accepted, and taken from another address only
+// once that one has been idle for reuse_idle_ms. Not thread-safe: the
+// caller serializes all access to one registry.
+typedef struct {
+    sat_entry_t *slots;
+    int count;
+    uint32_t reuse_idle_ms;
+} sat_registry_t;
+
+/**
+ * Initialize a registry on caller-provided slot storage (all slots free)
+ *
+ * @param reg Registry to initialize
+ * @param slots Slot storage
+ * @param count Number of slots
+ * @param reuse_idle_ms A slot active within this long is never given to
+ *                      another address
+ */
+void sat_registry_init(sat_registry_t *reg, sat_entry_t *slots, int count, uint32_t reuse_idle_ms);
+
+/**
+ * Look up a satellite without claiming a slot
+ *
+ * @param reg Registry
+ * @param ip IPv4 address, network byte order
+ * @return Slot index, or -1 if ip has no slot (or is 0)
+ */
+int sat_registry_find(const sat_registry_t *reg, uint32_t ip);
+
+/**
+ * Slot of a satellite that just sent something valid
+ *
+ * The address keeps its slot, or takes a free one, or else the slot idle
+ * longest if that has been idle for reuse_idle_ms. A slot taken from
+ * another address starts with zeroed counters, and the caller must drop
+ * what it still holds about the old one (its slot index).
+ *
+ * @param reg Registry
+ * @param ip IPv4 address, network byte order
+ * @param now_ms Current time, becomes the slot's active_ms
+ * @param reused Set to true if the slot belonged to another address
+ * @return Slot index, or -1 if ip is 0 or every slot is in recent use
+ */
+int sat_registry_claim(sat_registry_t *reg, uint32_t ip, uint32_t now_ms, bool *reused);
+
+/**
+ * Count an observation of a satellite that reached ingest
+ *
+ * @param reg Registry
+ * @param slot Slot index
+ * @param now_ms Observation time
+ */
+void sat_registry_observed(sat_registry_t *reg, int slot, uint32_t now_ms);
+
+/**
+ * Count an observation that carried sensor data (after sat_registry_observed)
+ *
+ * @param reg Registry
+ * @param slot Slot index
+ */
+void sat_registry_sensor(sat_registry_t *reg, int slot);
+
+/**
+ * Count one HTTP upload in the latency histogram
+ *
+ * @param reg Registry
+ * @param slot Slot index
+ * @param ms Handling time
+ */
+void sat_registry_request(sat_registry_t *reg, int slot, uint32_t ms);
+
+/**
+ * Update the per-second rates of every slot from the counters since the
+ * previous call
+ *
+ * @param reg Registry
+ * @param interval_s Time since the previous call
+ */
+void sat_registry_update_rates(sat_registry_t *reg, float interval_s);
+
+/**
+ * Latency histogram bucket of a handling time
+ *
+ * @param ms Handling time
+ * @return Bucket n (< 2^n ms), SAT_LATENCY_BUCKETS - 1 for the rest
+ */
+int sat_latency_bucket(uint32_t ms);
+
+#endif // SAT_REGISTRY_H
@@ -0,0 +1,107 @@
+#ifndef SAT_UDP_H
+#define SAT_UDP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Satellite observations over UDP, one datagram (all integers little-endian):
+//
+//   'S' 'U' version flags     4 bytes
+//   sat_id                    uint32: identifies the satellite (e.g. the low
+//                             4 bytes of its MAC), not its IP address
+//   epoch                     uint32: boot counter the satellite keeps in
+//                             flash and increments at every boot, before
+//                             its first datagram
+//   seq                       uint32: datagram counter, from 0 at boot
+//   records                   sat_frame.h records, as many as fit
+//   tag[8]                    HMAC-SHA256(shared key, everything before
+//                             the tag), first 8 bytes
+//
+// The receiver drops datagrams with a bad tag. Per sat_id it keeps the
+// newest epoch (in flash too), drops any datagram of an older epoch, and
+// within the current epoch drops repeats of a seq it has already
+// accepted; losses and reordering are counted. A random per-boot id would
+// not do: a replayed datagram of an earlier boot would look like a new boot.
+#define SAT_UDP_MAGIC0 'S'
+#define SAT_UDP_MAGIC1 'U'
+#define SAT_UDP_VERSION 2
+#define SAT_UDP_HEADER_LEN 16
+#define SAT_UDP_TAG_LEN 8
+#define SAT_UDP_MAX_DATAGRAM 1472  // One Ethernet MTU, no IP fragmentation
+#define SAT_UDP_SEQ_WINDOW 32      // Late datagrams accepted this far behind the newest
+
+typedef struct {
+    uint32_t sat_id;
+    uint32_t epoch;
+    uint32_t seq;
+    const uint8_t *records;  // Points into the datagram
+    size_t records_len;
+    const uint8_t *tag;      // Points into the datagram
+    size_t signed_len;       // Bytes covered by the tag
+} sat_udp_datagram_t;
+
+// Sequence tracking for one sender (one sat_id)
+typedef struct {
+    bool started;        // A datagram of epoch was accepted
+    uint32_t epoch;      // Current epoch; before started, the lowest one accepted
+    uint32_t highest;    // Newest seq accepted in epoch
+    uint32_t window;     // Bit n: highest - n was accepted
+    uint32_t received;   // Datagrams accepted
+    uint32_t lost;       // Skipped seqs that never arrived (so far)
+    uint32_t reordered;  // Accepted after a newer one
+    uint32_t duplicates; // Rejected repeats, or too late to tell
+    uint32_t stale;      // Rejected: epoch older than the current one (replays)
+    uint32_t restarts;   // Epoch increases (satellite reboots)
+} sat_seq_t;
+
+typedef enum {
+    SAT_SEQ_NEW = 0,     // Newest so far
+    SAT_SEQ_NEW_EPOCH,   // Newest so far, first of a newer epoch: store the epoch
+    SAT_SEQ_REORDERED,   // Late, but not seen before
+    SAT_SEQ_DUPLICATE,   // Seen before, or older than the window
+    SAT_SEQ_STALE,       // Epoch older than the current one
+} sat_seq_result_t;
+
+/**
+ * Split a datagram into its parts (the tag is not checked here)
+ *
+ * @param data Datagram
+ * @param len Datagram length
+ * @param out Parts
+ * @return false if it is too short or not a version 1 datagram
+ */
+bool sat_udp_parse(const uint8_t *data, size_t len, sat_udp_datagram_t *out);
+
+/**
+ * Write a datagram header
+ *
+ * @param buf At least SAT_UDP_HEADER_LEN bytes
+ * @param sat_id Sender id
+ * @param epoch Sender boot counter
+ * @param seq Datagram counter
+ * @return SAT_UDP_HEADER_LEN
+ */
+size_t sat_udp_write_header(uint8_t *buf, uint32_t sat_id, uint32_t epoch, uint32_t seq);
+
+/**
+ * Start tracking a sender
+ *
+ * @param s Tracker
+ * @param epoch Lowest epoch accepted: the newest one stored for this
+ *              sender, or 0 for a sender never seen
+ */
+void sat_seq_init(sat_seq_t *s, uint32_t epoch);
+
+/**
+ * Account for a datagram that passed the tag check
+ *
+ * @param s Tracker
+ * @param epoch Datagram epoch
+ * @param seq Datagram seq
+ * @return Whether to use the datagram (SAT_SEQ_DUPLICATE, SAT_SEQ_STALE:
+ *         drop it; SAT_SEQ_NEW_EPOCH: use it and store s->epoch)
+ */
+sat_seq_result_t sat_seq_accept(sat_seq_t *s, uint32_t epoch, uint32_t seq);
+
+#endif // SAT_UDP_H
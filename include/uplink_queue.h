@@ -0,0 +1,90 @@
+#ifndef UPLINK_QUEUE_H
+#define UPLINK_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Flash erase unit; the queue is a ring of sectors of fixed-size records
+#define UPLINK_QUEUE_SECTOR_SIZE 4096
+#define UPLINK_QUEUE_RECORD_SIZE 32
+#define UPLINK_QUEUE_RECORDS_PER_SECTOR (UPLINK_QUEUE_SECTOR_SIZE / UPLINK_QUEUE_RECORD_SIZE)
+
+// Flash access used by the queue, so it can run on a partition or a RAM
+// buffer. Each function returns true on success.
+typedef struct {
+    void *ctx;
+    bool (*read)(void *ctx, uint32_t offset, void *buf, uint32_t len);
+    bool (*write)(void *ctx, uint32_t offset, const void *buf, uint32_t len);
+    bool (*erase_sector)(void *ctx, uint32_t offset);
+} uplink_queue_flash_t;
+
+// One timestamped reading waiting for upload
+typedef struct {
+    uint32_t time;          // Unix time of the reading, 0 if the clock wasn't set
+    uint8_t addr[6];
+    uint8_t fields;         // Bitmask of the values present (caller-defined)
+    int8_t rssi;
+    int16_t temp_centi;     // 0.01 °C
+    uint16_t battery_mv;
+    uint8_t humidity;
+    uint8_t battery_pct;
+} uplink_reading_t;
+
+// Bounded FIFO of readings with sequence numbers. Record seq lives at slot
+// seq % capacity, so consumers keep their own cursor (next seq to deliver)
+// and drain independently. When full, the oldest sector is erased and its
+// records are lost; consumers behind oldest_seq skip forward.
+typedef struct {
+    uplink_queue_flash_t flash;
+    uint16_t sector_count;
+    uint32_t capacity;      // Record slots
+    uint32_t next_seq;      // Sequence number of the next append (>= 1)
+    uint32_t oldest_seq;    // Oldest record still stored
+} uplink_queue_t;
+
+/**
+ * Mount the queue, scanning records to find the head and tail
+ *
+ * An area without valid records is erased and used as an empty queue.
+ * Damaged records (torn writes) are skipped by reads.
+ *
+ * @param q Queue to mount
+ * @param flash Flash access
+ * @param sector_count Number of UPLINK_QUEUE_SECTOR_SIZE sectors (>= 2)
+ * @return true on success, false on flash errors or invalid size
+ */
+bool uplink_queue_mount(uplink_queue_t *q, const uplink_queue_flash_t *flash, uint16_t sector_count);
+
+/**
+ * Append a reading
+ *
+ * @param q Queue
+ * @param reading Reading
+ * @return Sequence number of the record, or 0 if the write failed
+ */
+uint32_t uplink_queue_append(uplink_queue_t *q, const uplink_reading_t *reading);
+
+/**
+ * Read consecutive records starting at a cursor
+ *
+ * @param q Queue
+ * @param from_seq First sequence number wanted (clamped to oldest_seq)
+ * @param out Output readings
+ * @param max Size of out
+ * @param end_seq Output: sequence number after the last record examined;
+ *                the new cursor once the returned readings are delivered
+ * @return Number of readings stored in out
+ */
+int uplink_queue_read(const uplink_queue_t *q, uint32_t from_seq, uplink_reading_t *out, int max,
+                      uint32_t *end_seq);
+
+/**
+ * Records waiting for a consumer
+ *
+ * @param q Queue
+ * @param cursor Consumer's next sequence number
+ * @return Number of stored records at or after cursor
+ */
+uint32_t uplink_queue_pending(const uplink_queue_t *q, uint32_t cursor);
+
+#endif // UPLINK_QUEUE_H
@@ -0,0 +1,20 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Web UI files (web/), minified and gzipped at build time by
+// tools/embed_web.py into a generated source
+typedef struct {
+    const char *path;          // URL path, e.g. "/app.js"
+    const char *content_type;
+    const uint8_t *data;       // gzip-compressed content
+    size_t len;
+    const char *etag;          // Quoted content hash
+} web_asset_t;
+
+extern const web_asset_t web_assets[];
+extern const size_t web_asset_count;
+
+#endif // WEB_ASSETS_H
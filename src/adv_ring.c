@@ -0,0 +1,62 @@
+#include "adv_ring.h"
+#include <stddef.h>
+
+// Only plain atomic loads and stores are used (no read-modify-write), so the
+// ring also works on cores without atomic instructions such as the ESP32-C3.
+
+bool adv_ring_init(adv_ring_t *ring, adv_ring_entry_t *entries, uint32_t entry_count) {
+    // Must be a power of two
+    if (entry_count < 2 || (entry_count & (entry_count - 1)) != 0) {
+        return false;
+    }
+    ring->entries = entries;
+    ring->mask = entry_count - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->high_water, 0);
+    return true;
+}
+
+adv_ring_entry_t *adv_ring_reserve(adv_ring_t *ring) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask) {
+        // Producer is the only writer of the drop counter
+        uint32_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        atomic_store_explicit(&ring->dropped, dropped + 1, memory_order_relaxed);
+        return NULL;
+    }
+    return &ring->entries[head & ring->mask];
+}
+
+void adv_ring_commit(adv_ring_t *ring) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (head - tail > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_water, head - tail, memory_order_relaxed);
+    }
+    // Release: the slot contents become visible before the new head
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+}
+
+const adv_ring_entry_t *adv_ring_peek(adv_ring_t *ring) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail) {
+        return NULL;
+    }
+    return &ring->entries[tail & ring->mask];
+}
+
+void adv_ring_release(adv_ring_t *ring) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    // Release: the consumer is done with the slot before the producer may reuse it
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+uint32_t adv_ring_count(adv_ring_t *ring) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
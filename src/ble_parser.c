@@ -8,7 +8,7 @@ bool ble_parse_pvvx_format(const uint8_t *svc_data, uint8_t svc_len,
     }
     
     // pvvx format: offset 8-9: temperature (int16_t), 10-11: humidity (uint16_t)
-    // 12-13: battery_mv (uint16_t), 14: battery_pct (uint8_t)
+    // 12-13: battery_mv (uint16_t), 14: battery_pct (uint8_t), 15: counter
     int16_t temp_raw = svc_data[8] | (svc_data[9] << 8);
     uint16_t humi_raw = svc_data[10] | (svc_data[11] << 8);
     
@@ -16,7 +16,9 @@ bool ble_parse_pvvx_format(const uint8_t *svc_data, uint8_t svc_len,
     sensor_data->humidity = humi_raw / 100;
     sensor_data->battery_mv = svc_data[12] | (svc_data[13] << 8);
     sensor_data->battery_pct = svc_data[14];
-    strcpy(sensor_data->device_type, "pvvx");
+    sensor_data->packet_id = svc_data[15];
+    sensor_data->has_packet_id = true;
+    sensor_data->device_type = "pvvx";
     sensor_data->has_data = true;
     
     return true;
@@ -29,14 +31,16 @@ bool ble_parse_atc_format(const uint8_t *svc_data, uint8_t svc_len,
     }
     
     // ATC format: offset 8-9: temperature (int16_t BE), 10: humidity (uint8_t)
-    // 11: battery_pct (uint8_t), 12-13: battery_mv (uint16_t BE)
+    // 11: battery_pct (uint8_t), 12-13: battery_mv (uint16_t BE), 14: counter
     int16_t temp_raw = (svc_data[8] << 8) | svc_data[9];
     
     sensor_data->temperature = temp_raw / 10.0f;
     sensor_data->humidity = svc_data[10];
     sensor_data->battery_pct = svc_data[11];
     sensor_data->battery_mv = (svc_data[12] << 8) | svc_data[13];
-    strcpy(sensor_data->device_type, "ATC");
+    sensor_data->packet_id = svc_data[14];
+    sensor_data->has_packet_id = true;
+    sensor_data->device_type = "ATC";
     sensor_data->has_data = true;
     
     return true;
@@ -44,11 +48,20 @@ bool ble_parse_atc_format(const uint8_t *svc_data, uint8_t svc_len,
 
 bool ble_parse_mibeacon_format(const uint8_t *svc_data, uint8_t svc_len, 
                                ble_sensor_data_t *sensor_data) {
-    // MiBeacon minimum packet size check
-    if (svc_len < 11) {
+    // MiBeacon minimum packet size check (UUID + 11-byte header)
+    if (svc_len < 13) {
         return false;
     }
     
+    // Verify UUID is 0xFE95, then skip it: offsets below are from the
+    // frame control field
+    uint16_t uuid = svc_data[0] | (svc_data[1] << 8);
+    if (uuid != 0xFE95) {
+        return false;
+    }
+    svc_data += 2;
+    svc_len -= 2;
+    
     // Check for encryption flag (bit 3 of flags byte at offset 0)
     uint8_t flags = svc_data[0];
     bool has_encryption = (flags & 0x08) != 0;
@@ -72,8 +85,8 @@ bool ble_parse_mibeacon_format(const uint8_t *svc_data, uint8_t svc_len,
         return false;  // Not LYWSD03MMC, could support other devices later
     }
     
-    // Frame counter at offset 4 (not used for parsing but good for debugging)
-    // uint8_t frame_count = svc_data[4];
+    // Frame counter at offset 4 (set below, once the packet is accepted)
+    uint8_t frame_count = svc_data[4];
     
     // Payload starts after header
     // Offset depends on capability flag
@@ -143,7 +156,9 @@ bool ble_parse_mibeacon_format(const uint8_t *svc_data, uint8_t svc_len,
     
     // Only consider successful if we got at least temperature or humidity
     if (found_temp || found_hum) {
-        strcpy(sensor_data->device_type, "MiBeacon");
+        sensor_data->device_type = "MiBeacon";
+        sensor_data->packet_id = frame_count;
+        sensor_data->has_packet_id = true;
         sensor_data->has_data = true;
         return true;
     }
@@ -179,10 +194,14 @@ bool ble_parse_bthome_v2_format(const uint8_t *svc_data, uint8_t svc_len,
         return false;  // Only support v2
     }
     
-    // Parse object data starting at offset 3
+    // Parse object data starting at offset 3. The packet id is only kept if
+    // the packet parses: a stale id would make ingest drop the next reading
+    // as a duplicate.
     uint8_t pos = 3;
     bool found_temp = false;
     bool found_hum = false;
+    bool has_packet_id = false;
+    uint8_t packet_id = 0;
     
     while (pos < svc_len) {
         uint8_t object_id = svc_data[pos];
@@ -194,7 +213,9 @@ bool ble_parse_bthome_v2_format(const uint8_t *svc_data, uint8_t svc_len,
         }
         
         switch (object_id) {
-            case 0x00:  // Packet ID (uint8, 1 byte) - skip
+            case 0x00:  // Packet ID (uint8, 1 byte)
+                packet_id = svc_data[pos];
+                has_packet_id = true;
                 pos += 1;
                 break;
                 
@@ -253,7 +274,11 @@ bool ble_parse_bthome_v2_format(const uint8_t *svc_data, uint8_t svc_len,
     
     // Success if we got at least temperature or humidity
     if (found_temp || found_hum) {
-        strcpy(sensor_data->device_type, "BTHome");
+        if (has_packet_id) {
+            sensor_data->packet_id = packet_id;
+            sensor_data->has_packet_id = true;
+        }
+        sensor_data->device_type = "BTHome";
         sensor_data->has_data = true;
         return true;
     }
@@ -261,18 +286,92 @@ bool ble_parse_bthome_v2_format(const uint8_t *svc_data, uint8_t svc_len,
     return false;
 }
 
+// Service data dispatch table, checked in order. Add new formats here.
+static const ble_svc_parser_entry_t svc_parsers[] = {
+    { 0x181A, 17, ble_parse_pvvx_format },       // pvvx custom firmware
+    { 0x181A, 15, ble_parse_atc_format },        // ATC custom firmware
+    { 0xFE95, 13, ble_parse_mibeacon_format },   // Xiaomi MiBeacon
+    { 0xFCD2, 6,  ble_parse_bthome_v2_format },  // BTHome v2
+};
+
+bool ble_parse_service_data(const uint8_t *svc_data, uint8_t svc_len,
+                            ble_sensor_data_t *sensor_data) {
+    if (svc_len < 2) {
+        return false;
+    }
+    uint16_t uuid = svc_data[0] | (svc_data[1] << 8);
+
+    for (size_t i = 0; i < sizeof(svc_parsers) / sizeof(svc_parsers[0]); i++) {
+        if (svc_parsers[i].uuid != uuid || svc_len < svc_parsers[i].min_len) {
+            continue;
+        }
+        return svc_parsers[i].parse(svc_data, svc_len, sensor_data);
+    }
+    return false;
+}
+
 bool ble_parse_sensor_data(const uint8_t *adv_data, uint8_t adv_len, 
-                           uint16_t company_id, ble_sensor_data_t *sensor_data) {
-    // Initialize sensor_data
-    memset(sensor_data, 0, sizeof(ble_sensor_data_t));
+                           ble_adv_view_t *view, ble_sensor_data_t *sensor_data) {
     sensor_data->has_data = false;
-    strcpy(sensor_data->device_type, "Unknown");
+    sensor_data->has_packet_id = false;
+    if (view) {
+        view->name = NULL;
+        view->name_len = 0;
+        view->name_complete = false;
+        view->mfg_data = NULL;
+        view->mfg_len = 0;
+        view->company_id = BLE_COMPANY_ID_NONE;
+    }
     
-    // For now, we don't parse from raw adv_data here
-    // This function serves as a placeholder for future expansion
-    // The actual parsing happens in main.c through NimBLE's field parsing
+    // AD structure: [length][type][data...], length covers type + data
+    uint8_t pos = 0;
+    while (pos < adv_len) {
+        uint8_t field_len = adv_data[pos];
+        if (field_len == 0) {
+            break;  // Early terminator / zero padding
+        }
+        if (field_len > adv_len - pos - 1) {
+            break;  // Truncated structure
+        }
+        
+        uint8_t type = adv_data[pos + 1];
+        const uint8_t *data = &adv_data[pos + 2];
+        uint8_t data_len = field_len - 1;
+        
+        switch (type) {
+            case BLE_AD_TYPE_SVC_DATA_UUID16:
+                // A packet may carry several service data entries; first hit wins
+                if (!sensor_data->has_data) {
+                    ble_parse_service_data(data, data_len, sensor_data);
+                }
+                break;
+                
+            case BLE_AD_TYPE_NAME_COMPLETE:
+            case BLE_AD_TYPE_NAME_SHORT:
+                // Prefer the complete name if both are present
+                if (view && data_len > 0 && (view->name == NULL || !view->name_complete)) {
+                    view->name = (const char *)data;
+                    view->name_len = data_len;
+                    view->name_complete = (type == BLE_AD_TYPE_NAME_COMPLETE);
+                }
+                break;
+                
+            case BLE_AD_TYPE_MFG_DATA:
+                if (view && view->mfg_data == NULL && data_len >= 2) {
+                    view->mfg_data = data;
+                    view->mfg_len = data_len;
+                    view->company_id = data[0] | (data[1] << 8);
+                }
+                break;
+                
+            default:
+                break;
+        }
+        
+        pos += field_len + 1;
+    }
     
-    return false;
+    return sensor_data->has_data;
 }
 
 const char* ble_get_device_type(uint16_t company_id) {
@@ -0,0 +1,26 @@
+#include "device_cursor.h"
+#include <stdio.h>
+
+void device_cursor_format(char *buf, size_t size, uint32_t epoch, uint32_t version) {
+    snprintf(buf, size, "%08lx.%lu", (unsigned long)epoch, (unsigned long)version);
+}
+
+void device_etag_format(char *buf, size_t size, uint32_t epoch, uint32_t version, bool show_all) {
+    char cursor[DEVICE_CURSOR_LEN];
+    device_cursor_format(cursor, sizeof(cursor), epoch, version);
+    snprintf(buf, size, "\"%s%s\"", cursor, show_all ? ".all" : "");
+}
+
+bool device_cursor_resume(const char *cursor, uint32_t epoch, uint32_t removed_version, uint32_t version,
+                          uint32_t *since_version) {
+    unsigned long e, v;
+    int end = 0;
+    if (sscanf(cursor, "%lx.%lu%n", &e, &v, &end) != 2 || cursor[end] != '\0') {
+        return false;
+    }
+    if (e != epoch || v < removed_version || v > version) {
+        return false;
+    }
+    *since_version = (uint32_t)v;
+    return true;
+}
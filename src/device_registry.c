@@ -0,0 +1,106 @@
+#include "device_registry.h"
+#include <string.h>
+
+// Mix all six MAC bytes. Public addresses share the vendor OUI and random
+// addresses share the top type bits, so no single byte range is usable alone.
+static inline uint32_t mac_hash(const uint8_t *addr) {
+    uint32_t lo = (uint32_t)addr[0] | ((uint32_t)addr[1] << 8) |
+                  ((uint32_t)addr[2] << 16) | ((uint32_t)addr[3] << 24);
+    uint32_t hi = (uint32_t)addr[4] | ((uint32_t)addr[5] << 8);
+    uint32_t h = lo ^ (hi * 0x9E3779B1u);
+    h ^= h >> 15;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static inline bool mac_equal(const uint8_t *a, const uint8_t *b) {
+    return memcmp(a, b, 6) == 0;
+}
+
+bool device_registry_init(device_registry_t *reg, device_registry_slot_t *slots,
+                          uint16_t slot_count) {
+    // Must be a power of two
+    if (slot_count < 2 || (slot_count & (slot_count - 1)) != 0) {
+        return false;
+    }
+    reg->slots = slots;
+    reg->mask = slot_count - 1;
+    device_registry_clear(reg);
+    return true;
+}
+
+void device_registry_clear(device_registry_t *reg) {
+    for (uint32_t i = 0; i <= reg->mask; i++) {
+        reg->slots[i].idx = DEVICE_REGISTRY_EMPTY;
+    }
+    reg->count = 0;
+}
+
+int device_registry_find(const device_registry_t *reg, const uint8_t *addr) {
+    uint32_t pos = mac_hash(addr) & reg->mask;
+
+    // Load factor is kept below 1, so an empty slot always ends the probe
+    while (reg->slots[pos].idx != DEVICE_REGISTRY_EMPTY) {
+        if (mac_equal(reg->slots[pos].addr, addr)) {
+            return reg->slots[pos].idx;
+        }
+        pos = (pos + 1) & reg->mask;
+    }
+    return -1;
+}
+
+bool device_registry_insert(device_registry_t *reg, const uint8_t *addr, int idx) {
+    if (idx < 0 || idx >= DEVICE_REGISTRY_EMPTY) {
+        return false;
+    }
+
+    uint32_t pos = mac_hash(addr) & reg->mask;
+    while (reg->slots[pos].idx != DEVICE_REGISTRY_EMPTY) {
+        if (mac_equal(reg->slots[pos].addr, addr)) {
+            reg->slots[pos].idx = (uint16_t)idx;
+            return true;
+        }
+        pos = (pos + 1) & reg->mask;
+    }
+
+    // Always leave one empty slot so lookups terminate
+    if (reg->count >= reg->mask) {
+        return false;
+    }
+
+    memcpy(reg->slots[pos].addr, addr, 6);
+    reg->slots[pos].idx = (uint16_t)idx;
+    reg->count++;
+    return true;
+}
+
+bool device_registry_remove(device_registry_t *reg, const uint8_t *addr) {
+    uint32_t pos = mac_hash(addr) & reg->mask;
+    while (reg->slots[pos].idx != DEVICE_REGISTRY_EMPTY) {
+        if (mac_equal(reg->slots[pos].addr, addr)) {
+            break;
+        }
+        pos = (pos + 1) & reg->mask;
+    }
+    if (reg->slots[pos].idx == DEVICE_REGISTRY_EMPTY) {
+        return false;
+    }
+
+    // Backward-shift deletion: pull later entries of the same cluster into
+    // the hole so no tombstones are needed and probe chains stay short.
+    uint32_t hole = pos;
+    uint32_t next = (hole + 1) & reg->mask;
+    while (reg->slots[next].idx != DEVICE_REGISTRY_EMPTY) {
+        uint32_t home = mac_hash(reg->slots[next].addr) & reg->mask;
+        // Entry may move into the hole only if its home slot is not in (hole, next]
+        if (((next - home) & reg->mask) >= ((next - hole) & reg->mask)) {
+            reg->slots[hole] = reg->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & reg->mask;
+    }
+    reg->slots[hole].idx = DEVICE_REGISTRY_EMPTY;
+    reg->count--;
+    return true;
+}
@@ -0,0 +1,134 @@
+#include "history.h"
+
+static inline int8_t clamp_delta(int32_t delta) {
+    if (delta > 127) {
+        return 127;
+    }
+    if (delta < -127) {
+        return -127;  // -128 is HISTORY_GAP
+    }
+    return (int8_t)delta;
+}
+
+static void push_slot(history_series_t *series, history_delta_t delta) {
+    if (series->count > 0) {
+        series->head = (series->head + 1) % series->capacity;
+    }
+    series->slots[series->head] = delta;
+    if (series->count < series->capacity) {
+        series->count++;
+    }
+}
+
+void history_series_init(history_series_t *series, history_delta_t *slots, uint16_t capacity) {
+    series->slots = slots;
+    series->capacity = capacity;
+    series->head = 0;
+    series->count = 0;
+    series->last_slot = 0;
+    series->last_temp = 0;
+    series->last_hum = 0;
+}
+
+void history_series_record(history_series_t *series, uint32_t slot, int16_t temp, int16_t hum) {
+    if (series->count == 0) {
+        // First reading: its delta is never applied
+        history_delta_t first = { 0, 0 };
+        push_slot(series, first);
+        series->last_slot = slot;
+        series->last_temp = temp;
+        series->last_hum = hum;
+        return;
+    }
+
+    // Base for the new delta: the last reading before the slot being written
+    int16_t base_temp = series->last_temp;
+    int16_t base_hum = series->last_hum;
+    if (slot <= series->last_slot) {
+        // Same interval: replace the newest slot
+        history_delta_t *newest = &series->slots[series->head];
+        if (series->count > 1) {
+            base_temp -= newest->temp;
+            base_hum -= newest->hum;
+        } else {
+            base_temp = temp;
+            base_hum = hum;
+        }
+        newest->temp = clamp_delta((int32_t)temp - base_temp);
+        newest->hum = clamp_delta((int32_t)hum - base_hum);
+        series->last_temp = base_temp + newest->temp;
+        series->last_hum = base_hum + newest->hum;
+        return;
+    }
+
+    // Fill skipped intervals (no need to write more than a full ring of gaps)
+    uint32_t skipped = slot - series->last_slot - 1;
+    if (skipped > series->capacity) {
+        skipped = series->capacity;
+    }
+    history_delta_t gap = { HISTORY_GAP, 0 };
+    for (uint32_t i = 0; i < skipped; i++) {
+        push_slot(series, gap);
+    }
+
+    history_delta_t delta = {
+        clamp_delta((int32_t)temp - base_temp),
+        clamp_delta((int32_t)hum - base_hum),
+    };
+    push_slot(series, delta);
+    series->last_slot = slot;
+    series->last_temp = base_temp + delta.temp;
+    series->last_hum = base_hum + delta.hum;
+}
+
+uint16_t history_series_begin(const history_series_t *series, uint16_t max_slots,
+                              history_cursor_t *cursor) {
+    uint16_t n = (max_slots < series->count) ? max_slots : series->count;
+
+    // Walk back from the newest value to the value carried into the first
+    // returned slot. Gaps carry the previous value unchanged.
+    int32_t temp = series->last_temp;
+    int32_t hum = series->last_hum;
+    uint16_t pos = series->head;
+    for (uint16_t i = 1; i < n; i++) {
+        const history_delta_t *d = &series->slots[pos];
+        if (d->temp != HISTORY_GAP) {
+            temp -= d->temp;
+            hum -= d->hum;
+        }
+        pos = (pos + series->capacity - 1) % series->capacity;
+    }
+
+    cursor->pos = pos;
+    cursor->remaining = n;
+    cursor->slot = series->last_slot - (n ? n - 1 : 0);
+    cursor->temp = (int16_t)temp;
+    cursor->hum = (int16_t)hum;
+    cursor->first = true;
+    return n;
+}
+
+bool history_series_next(const history_series_t *series, history_cursor_t *cursor,
+                         history_sample_t *out) {
+    if (cursor->remaining == 0) {
+        return false;
+    }
+    const history_delta_t *d = &series->slots[cursor->pos];
+    bool valid = (d->temp != HISTORY_GAP);
+    // The first slot already holds its value; later slots apply their delta
+    if (!cursor->first && valid) {
+        cursor->temp += d->temp;
+        cursor->hum += d->hum;
+    }
+    cursor->first = false;
+
+    out->slot = cursor->slot;
+    out->valid = valid;
+    out->temp = cursor->temp;
+    out->hum = cursor->hum;
+
+    cursor->slot++;
+    cursor->pos = (cursor->pos + 1) % series->capacity;
+    cursor->remaining--;
+    return true;
+}
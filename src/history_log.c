@@ -0,0 +1,437 @@
+#include "history_log.h"
+#include <stddef.h>
+#include <string.h>
+
+#define SECTOR_MAGIC 0x474F4C48u  // "HLOG"
+#define SECTOR_VERSION 1
+#define BLOCK_MAGIC 0xB10Cu
+#define BLOCK_ERASED 0xFFFFu
+
+// On-flash layouts (little-endian, packed)
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t crc;       // Over the fields above
+} sector_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint16_t len;       // Payload length
+    uint8_t addr[6];
+    uint8_t battery_pct;
+    uint8_t kind;
+    uint32_t start_time;
+    uint16_t interval_s;
+    uint16_t count;
+    uint32_t crc;       // Over the fields above and the payload
+} block_header_t;
+
+#define SECTOR_DATA_START sizeof(sector_header_t)
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t block_crc(const block_header_t *hdr, const uint8_t *payload) {
+    uint32_t crc = crc32_update(0, (const uint8_t *)hdr, offsetof(block_header_t, crc));
+    return crc32_update(crc, payload, hdr->len);
+}
+
+static inline uint32_t block_end_time(const block_header_t *hdr) {
+    return hdr->start_time + (hdr->count ? hdr->count - 1 : 0) * (uint32_t)hdr->interval_s;
+}
+
+static inline uint32_t sector_offset(uint16_t sector) {
+    return (uint32_t)sector * HISTORY_LOG_SECTOR_SIZE;
+}
+
+// Read the block at offset within a sector. Returns 1 for a valid block,
+// 0 for the end of written data, -1 for a damaged block (closes the sector).
+static int read_block(const history_log_t *log, uint16_t sector, uint32_t offset,
+                      block_header_t *hdr, uint8_t *payload) {
+    if (offset + sizeof(block_header_t) > HISTORY_LOG_SECTOR_SIZE) {
+        return 0;
+    }
+    if (!log->flash.read(log->flash.ctx, sector_offset(sector) + offset, hdr, sizeof(*hdr))) {
+        return -1;
+    }
+    if (hdr->magic == BLOCK_ERASED) {
+        return 0;
+    }
+    if (hdr->magic != BLOCK_MAGIC || hdr->len > HISTORY_LOG_MAX_PAYLOAD ||
+        offset + sizeof(*hdr) + hdr->len > HISTORY_LOG_SECTOR_SIZE) {
+        return -1;
+    }
+    if (!log->flash.read(log->flash.ctx, sector_offset(sector) + offset + sizeof(*hdr),
+                         payload, hdr->len)) {
+        return -1;
+    }
+    return (block_crc(hdr, payload) == hdr->crc) ? 1 : -1;
+}
+
+static bool read_sector_header(const history_log_t *log, uint16_t sector, uint32_t *seq) {
+    sector_header_t hdr;
+    if (!log->flash.read(log->flash.ctx, sector_offset(sector), &hdr, sizeof(hdr))) {
+        return false;
+    }
+    if (hdr.magic != SECTOR_MAGIC || hdr.version != SECTOR_VERSION || hdr.seq == 0 ||
+        crc32_update(0, (const uint8_t *)&hdr, offsetof(sector_header_t, crc)) != hdr.crc) {
+        return false;
+    }
+    *seq = hdr.seq;
+    return true;
+}
+
+// Erase the next sector and make it the head
+static bool open_next_sector(history_log_t *log) {
+    uint16_t next = (log->head + 1) % log->sector_count;
+    if (!log->flash.erase_sector(log->flash.ctx, sector_offset(next))) {
+        return false;
+    }
+    // The recycled sector's blocks are gone
+    log->index[next].seq = 0;
+
+    sector_header_t hdr = {
+        .magic = SECTOR_MAGIC,
+        .seq = log->seq + 1,
+        .version = SECTOR_VERSION,
+        .reserved = 0xFFFF,
+    };
+    hdr.crc = crc32_update(0, (const uint8_t *)&hdr, offsetof(sector_header_t, crc));
+    if (!log->flash.write(log->flash.ctx, sector_offset(next), &hdr, sizeof(hdr))) {
+        return false;
+    }
+    log->seq = hdr.seq;
+    log->head = next;
+    log->head_offset = SECTOR_DATA_START;
+    log->index[next].seq = hdr.seq;
+    log->index[next].t_min = 0;
+    log->index[next].t_max = 0;
+    return true;
+}
+
+bool history_log_mount(history_log_t *log, const history_log_flash_t *flash,
+                       history_log_sector_t *index, uint16_t sector_count) {
+    if (sector_count < 2) {
+        return false;
+    }
+    log->flash = *flash;
+    log->index = index;
+    log->sector_count = sector_count;
+    log->seq = 0;
+    log->blocks = 0;
+    // Until a valid sector is found: "full" last sector, so the first append opens sector 0
+    log->head = sector_count - 1;
+    log->head_offset = HISTORY_LOG_SECTOR_SIZE;
+
+    block_header_t hdr;
+    uint8_t payload[HISTORY_LOG_MAX_PAYLOAD];
+    for (uint16_t s = 0; s < sector_count; s++) {
+        history_log_sector_t *idx = &index[s];
+        idx->t_min = 0;
+        idx->t_max = 0;
+        if (!read_sector_header(log, s, &idx->seq)) {
+            idx->seq = 0;
+            continue;
+        }
+
+        uint32_t offset = SECTOR_DATA_START;
+        int rc;
+        while ((rc = read_block(log, s, offset, &hdr, payload)) == 1) {
+            if (idx->t_min == 0 || hdr.start_time < idx->t_min) {
+                idx->t_min = hdr.start_time;
+            }
+            if (block_end_time(&hdr) > idx->t_max) {
+                idx->t_max = block_end_time(&hdr);
+            }
+            log->blocks++;
+            offset += sizeof(hdr) + hdr.len;
+        }
+        if (rc < 0) {
+            offset = HISTORY_LOG_SECTOR_SIZE;  // Torn write: no more appends here
+        }
+
+        if (idx->seq > log->seq) {
+            log->seq = idx->seq;
+            log->head = s;
+            log->head_offset = offset;
+        }
+    }
+    return true;
+}
+
+bool history_log_append(history_log_t *log, const history_log_block_t *block,
+                        const uint8_t *payload, uint16_t len) {
+    if (len > HISTORY_LOG_MAX_PAYLOAD) {
+        return false;
+    }
+    uint32_t total = sizeof(block_header_t) + len;
+    if (log->head_offset + total > HISTORY_LOG_SECTOR_SIZE) {
+        if (!open_next_sector(log)) {
+            return false;
+        }
+    }
+
+    // Header and payload go out in one write; a torn write fails the CRC
+    uint8_t record[sizeof(block_header_t) + HISTORY_LOG_MAX_PAYLOAD];
+    block_header_t *hdr = (block_header_t *)record;
+    hdr->magic = BLOCK_MAGIC;
+    hdr->len = len;
+    memcpy(hdr->addr, block->addr, 6);
+    hdr->battery_pct = block->battery_pct;
+    hdr->kind = block->kind;
+    hdr->start_time = block->start_time;
+    hdr->interval_s = block->interval_s;
+    hdr->count = block->count;
+    memcpy(record + sizeof(block_header_t), payload, len);
+    hdr->crc = block_crc(hdr, payload);
+
+    if (!log->flash.write(log->flash.ctx, sector_offset(log->head) + log->head_offset, record, total)) {
+        log->head_offset = HISTORY_LOG_SECTOR_SIZE;  // Don't append after a failed write
+        return false;
+    }
+    log->head_offset += total;
+    log->blocks++;
+
+    history_log_sector_t *idx = &log->index[log->head];
+    if (idx->t_min == 0 || block->start_time < idx->t_min) {
+        idx->t_min = block->start_time;
+    }
+    if (block_end_time(hdr) > idx->t_max) {
+        idx->t_max = block_end_time(hdr);
+    }
+    return true;
+}
+
+int history_log_query(const history_log_t *log, const uint8_t *addr, uint32_t t_from, uint32_t t_to,
+                      history_log_visit_fn visit, void *ctx) {
+    int visited = 0;
+    block_header_t hdr;
+    uint8_t payload[HISTORY_LOG_MAX_PAYLOAD];
+
+    // Ring order from the sector after the head is oldest to newest
+    for (uint16_t i = 1; i <= log->sector_count; i++) {
+        uint16_t s = (log->head + i) % log->sector_count;
+        const history_log_sector_t *idx = &log->index[s];
+        if (idx->seq == 0 || idx->t_max < t_from || idx->t_min > t_to) {
+            continue;
+        }
+
+        uint32_t offset = SECTOR_DATA_START;
+        uint32_t end = (s == log->head) ? log->head_offset : HISTORY_LOG_SECTOR_SIZE;
+        while (offset < end && read_block(log, s, offset, &hdr, payload) == 1) {
+            offset += sizeof(hdr) + hdr.len;
+            if (addr && memcmp(hdr.addr, addr, 6) != 0) {
+                continue;
+            }
+            if (block_end_time(&hdr) < t_from || hdr.start_time > t_to) {
+                continue;
+            }
+            history_log_block_t block;
+            memcpy(block.addr, hdr.addr, 6);
+            block.battery_pct = hdr.battery_pct;
+            block.kind = hdr.kind;
+            block.start_time = hdr.start_time;
+            block.interval_s = hdr.interval_s;
+            block.count = hdr.count;
+            visited++;
+            if (!visit(ctx, &block, payload, hdr.len)) {
+                return visited;
+            }
+        }
+    }
+    return visited;
+}
+
+bool history_log_format(history_log_t *log) {
+    for (uint16_t s = 0; s < log->sector_count; s++) {
+        if (!log->flash.erase_sector(log->flash.ctx, sector_offset(s))) {
+            return false;
+        }
+        log->index[s].seq = 0;
+        log->index[s].t_min = 0;
+        log->index[s].t_max = 0;
+    }
+    log->head = log->sector_count - 1;
+    log->head_offset = HISTORY_LOG_SECTOR_SIZE;
+    log->blocks = 0;
+    return true;
+}
+
+uint32_t history_log_oldest(const history_log_t *log) {
+    for (uint16_t i = 1; i <= log->sector_count; i++) {
+        const history_log_sector_t *idx = &log->index[(log->head + i) % log->sector_count];
+        if (idx->seq != 0 && idx->t_min != 0) {
+            return idx->t_min;
+        }
+    }
+    return 0;
+}
+
+// ============================================
+// Sample codec
+// ============================================
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t cap_bits;
+    uint32_t pos;
+    bool overflow;
+} bit_writer_t;
+
+typedef struct {
+    const uint8_t *buf;
+    uint32_t len_bits;
+    uint32_t pos;
+    bool overrun;
+} bit_reader_t;
+
+static void put_bits(bit_writer_t *w, uint32_t value, uint8_t nbits) {
+    for (int i = nbits - 1; i >= 0; i--) {
+        if (w->pos >= w->cap_bits) {
+            w->overflow = true;
+            return;
+        }
+        uint8_t mask = 0x80 >> (w->pos & 7);
+        if (value & (1u << i)) {
+            w->buf[w->pos >> 3] |= mask;
+        } else {
+            w->buf[w->pos >> 3] &= ~mask;
+        }
+        w->pos++;
+    }
+}
+
+static uint32_t get_bits(bit_reader_t *r, uint8_t nbits) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < nbits; i++) {
+        if (r->pos >= r->len_bits) {
+            r->overrun = true;
+            return 0;
+        }
+        value = (value << 1) | ((r->buf[r->pos >> 3] >> (7 - (r->pos & 7))) & 1);
+        r->pos++;
+    }
+    return value;
+}
+
+static inline int32_t sign_extend(uint32_t value, uint8_t nbits) {
+    uint32_t sign = 1u << (nbits - 1);
+    return (int32_t)((value ^ sign) - sign);
+}
+
+// Per sample: '0' gap | '1' + temperature code + humidity code
+//   temperature (delta-of-delta, 0.1 °C): '0' same slope | '10' 7 bits |
+//                                         '110' 10 bits | '111' 16-bit absolute
+//   humidity (delta, %):                  '0' unchanged | '10' 4 bits | '11' 8-bit absolute
+uint16_t history_log_encode(const history_sample_t *samples, uint16_t count, uint8_t *out, uint16_t cap) {
+    bit_writer_t w = { out, (uint32_t)cap * 8, 0, false };
+    bool have_prev = false;
+    int32_t prev_t = 0, prev_d = 0, prev_h = 0;
+
+    for (uint16_t i = 0; i < count && !w.overflow; i++) {
+        const history_sample_t *s = &samples[i];
+        if (!s->valid) {
+            put_bits(&w, 0, 1);
+            prev_d = 0;
+            continue;
+        }
+        put_bits(&w, 1, 1);
+
+        int32_t t = s->temp;
+        int32_t d = have_prev ? t - prev_t : 0;
+        int32_t dod = d - prev_d;
+        if (!have_prev || dod < -512 || dod > 511) {
+            put_bits(&w, 0x7, 3);
+            put_bits(&w, (uint16_t)t, 16);
+        } else if (dod == 0) {
+            put_bits(&w, 0x0, 1);
+        } else if (dod >= -64 && dod <= 63) {
+            put_bits(&w, 0x2, 2);
+            put_bits(&w, (uint32_t)dod & 0x7F, 7);
+        } else {
+            put_bits(&w, 0x6, 3);
+            put_bits(&w, (uint32_t)dod & 0x3FF, 10);
+        }
+
+        int32_t h = s->hum;
+        int32_t dh = h - prev_h;
+        if (!have_prev || dh < -8 || dh > 7) {
+            put_bits(&w, 0x3, 2);
+            put_bits(&w, (uint8_t)h, 8);
+        } else if (dh == 0) {
+            put_bits(&w, 0x0, 1);
+        } else {
+            put_bits(&w, 0x2, 2);
+            put_bits(&w, (uint32_t)dh & 0xF, 4);
+        }
+
+        prev_d = d;
+        prev_t = t;
+        prev_h = h;
+        have_prev = true;
+    }
+    return w.overflow ? 0 : (uint16_t)((w.pos + 7) / 8);
+}
+
+bool history_log_decode(const history_log_block_t *block, const uint8_t *payload, uint16_t len,
+                        history_sample_fn fn, void *ctx) {
+    bit_reader_t r = { payload, (uint32_t)len * 8, 0, false };
+    bool have_prev = false;
+    int32_t prev_t = 0, prev_d = 0, prev_h = 0;
+
+    for (uint16_t i = 0; i < block->count; i++) {
+        uint32_t time = block->start_time + (uint32_t)i * block->interval_s;
+        history_sample_t s = { .slot = i, .valid = false, .temp = (int16_t)prev_t, .hum = (int16_t)prev_h };
+        if (get_bits(&r, 1) == 0) {
+            if (r.overrun) {
+                return false;
+            }
+            prev_d = 0;
+            continue;
+        }
+
+        int32_t t;
+        if (get_bits(&r, 1) == 0) {
+            t = prev_t + prev_d;
+        } else if (get_bits(&r, 1) == 0) {
+            t = prev_t + prev_d + sign_extend(get_bits(&r, 7), 7);
+        } else if (get_bits(&r, 1) == 0) {
+            t = prev_t + prev_d + sign_extend(get_bits(&r, 10), 10);
+        } else {
+            t = sign_extend(get_bits(&r, 16), 16);
+        }
+
+        int32_t h;
+        if (get_bits(&r, 1) == 0) {
+            h = prev_h;
+        } else if (get_bits(&r, 1) == 0) {
+            h = prev_h + sign_extend(get_bits(&r, 4), 4);
+        } else {
+            h = get_bits(&r, 8);
+        }
+        if (r.overrun) {
+            return false;
+        }
+
+        prev_d = have_prev ? t - prev_t : 0;
+        prev_t = t;
+        prev_h = h;
+        have_prev = true;
+
+        s.valid = true;
+        s.temp = (int16_t)t;
+        s.hum = (int16_t)h;
+        fn(ctx, time, &s);
+    }
+    return true;
+}
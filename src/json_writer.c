@@ -0,0 +1,221 @@
+#include "json_writer.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+static void json_flush(json_writer_t *w) {
+    if (w->len > 0 && !w->failed) {
+        w->failed = !w->flush(w->ctx, w->buf, w->len);
+    }
+    w->len = 0;
+}
+
+static void json_put(json_writer_t *w, const char *s, size_t n) {
+    while (n > 0) {
+        if (w->len == w->size) {
+            json_flush(w);
+        }
+        size_t room = w->size - w->len;
+        size_t take = (n < room) ? n : room;
+        memcpy(w->buf + w->len, s, take);
+        w->len += take;
+        s += take;
+        n -= take;
+    }
+}
+
+static inline void json_putc(json_writer_t *w, char c) {
+    if (w->len == w->size) {
+        json_flush(w);
+    }
+    w->buf[w->len++] = c;
+}
+
+// printf straight into the buffer, flushing first if it doesn't fit
+static void json_vprintf(json_writer_t *w, const char *fmt, va_list ap) {
+    va_list retry;
+    va_copy(retry, ap);
+    int n = vsnprintf(w->buf + w->len, w->size - w->len, fmt, ap);
+    if (n >= 0 && (size_t)n >= w->size - w->len) {
+        json_flush(w);
+        n = vsnprintf(w->buf, w->size, fmt, retry);
+        if ((size_t)n >= w->size) {
+            n = (int)w->size - 1;  // Cut: values are short, the buffer is not
+        }
+    }
+    va_end(retry);
+    if (n > 0) {
+        w->len += n;
+    }
+}
+
+static void json_printf(json_writer_t *w, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    json_vprintf(w, fmt, ap);
+    va_end(ap);
+}
+
+// Separator before a value or key at the current level
+static void json_begin_value(json_writer_t *w) {
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    uint32_t bit = 1u << w->depth;
+    if (w->has_items & bit) {
+        json_putc(w, ',');
+    }
+    w->has_items |= bit;
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_writer_flush_t flush, void *ctx) {
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->size = size;
+    w->flush = flush;
+    w->ctx = ctx;
+}
+
+bool json_writer_finish(json_writer_t *w) {
+    json_flush(w);
+    return !w->failed;
+}
+
+static void json_open(json_writer_t *w, char c) {
+    json_begin_value(w);
+    json_putc(w, c);
+    if (w->depth + 1 < JSON_WRITER_MAX_DEPTH) {
+        w->depth++;
+    }
+    w->has_items &= ~(1u << w->depth);
+}
+
+static void json_close(json_writer_t *w, char c) {
+    json_putc(w, c);
+    if (w->depth > 0) {
+        w->depth--;
+    }
+}
+
+void json_object_begin(json_writer_t *w) {
+    json_open(w, '{');
+}
+
+void json_object_end(json_writer_t *w) {
+    json_close(w, '}');
+}
+
+void json_array_begin(json_writer_t *w) {
+    json_open(w, '[');
+}
+
+void json_array_end(json_writer_t *w) {
+    json_close(w, ']');
+}
+
+void json_key(json_writer_t *w, const char *key) {
+    json_begin_value(w);
+    json_putc(w, '"');
+    json_put(w, key, strlen(key));
+    json_put(w, "\":", 2);
+    w->after_key = true;
+}
+
+void json_string(json_writer_t *w, const char *s) {
+    json_begin_value(w);
+    json_putc(w, '"');
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        json_put(w, run, s - run);
+        run = s + 1;
+        switch (c) {
+            case '"': json_put(w, "\\\"", 2); break;
+            case '\\': json_put(w, "\\\\", 2); break;
+            case '\n': json_put(w, "\\n", 2); break;
+            case '\r': json_put(w, "\\r", 2); break;
+            case '\t': json_put(w, "\\t", 2); break;
+            default: json_printf(w, "\\u%04x", c); break;
+        }
+    }
+    json_put(w, run, s - run);
+    json_putc(w, '"');
+}
+
+void json_int(json_writer_t *w, int32_t v) {
+    json_begin_value(w);
+    json_printf(w, "%ld", (long)v);
+}
+
+void json_uint(json_writer_t *w, uint32_t v) {
+    json_begin_value(w);
+    json_printf(w, "%lu", (unsigned long)v);
+}
+
+void json_bool(json_writer_t *w, bool v) {
+    json_begin_value(w);
+    if (v) {
+        json_put(w, "true", 4);
+    } else {
+        json_put(w, "false", 5);
+    }
+}
+
+void json_null(json_writer_t *w) {
+    json_begin_value(w);
+    json_put(w, "null", 4);
+}
+
+void json_float(json_writer_t *w, double v, int decimals) {
+    if (isnan(v) || isinf(v)) {
+        json_null(w);
+        return;
+    }
+    json_begin_value(w);
+    json_printf(w, "%.*f", decimals, v);
+}
+
+void json_stringf(json_writer_t *w, const char *fmt, ...) {
+    json_begin_value(w);
+    json_putc(w, '"');
+    va_list ap;
+    va_start(ap, fmt);
+    json_vprintf(w, fmt, ap);
+    va_end(ap);
+    json_putc(w, '"');
+}
+
+void json_raw(json_writer_t *w, const char *json) {
+    json_begin_value(w);
+    json_put(w, json, strlen(json));
+}
+
+void json_field_string(json_writer_t *w, const char *key, const char *s) {
+    json_key(w, key);
+    json_string(w, s);
+}
+
+void json_field_int(json_writer_t *w, const char *key, int32_t v) {
+    json_key(w, key);
+    json_int(w, v);
+}
+
+void json_field_uint(json_writer_t *w, const char *key, uint32_t v) {
+    json_key(w, key);
+    json_uint(w, v);
+}
+
+void json_field_bool(json_writer_t *w, const char *key, bool v) {
+    json_key(w, key);
+    json_bool(w, v);
+}
+
+void json_field_float(json_writer_t *w, const char *key, double v, int decimals) {
+    json_key(w, key);
+    json_float(w, v, decimals);
+}
@@ -1,5 +1,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -9,6 +11,11 @@
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_random.h"
+#include "esp_netif_sntp.h"
+#include "mbedtls/md.h"
 #include "driver/gpio.h"
 #include "driver/uart.h"
 #include "lwip/sockets.h"
@@ -25,49 +32,193 @@
 #include "host/ble_gap.h"
 #include "services/gap/ble_svc_gap.h"
 #include <string.h>
+#include <math.h>
+#include <time.h>
 #include "ble_parser.h"
-#include "webserver.h"
+#include "device_registry.h"
+#include "adv_ring.h"
+#include "history.h"
+#include "history_log.h"
+#include "rollup.h"
+#include "uplink_queue.h"
+#include "report_policy.h"
+#include "json_writer.h"
+#include "sat_frame.h"
+#include "sat_json.h"
+#include "sat_udp.h"
+#include "receiver_set.h"
+#include "sat_registry.h"
+#include "sat_policy.h"
+#include "device_cursor.h"
+#include "web_assets.h"
 #include "setup_page.h"
 #include <stdint.h>
+#include <stdatomic.h>
 
 static const char *TAG = "BLE_SCAN";
 static const char *WIFI_TAG = "WiFi";
 static const char *AIO_TAG = "AdafruitIO";
 
-#define MAX_DEVICES 50
+// Device table capacity, override with -DMAX_DEVICES=... / -DMAX_NAMED_DEVICES=...
+#ifndef MAX_DEVICES
+#define MAX_DEVICES 200
+#endif
+#ifndef MAX_NAMED_DEVICES
+#define MAX_NAMED_DEVICES 64  // Devices that can hold a name/adv name at once (max 254)
+#endif
 #define MAX_NAME_LEN 32
+#define MAX_INTERNED_STRINGS 32  // Distinct firmware type strings
+#ifndef MAX_SATELLITES
+#define MAX_SATELLITES 16  // Satellite registry slots
+#endif
+#define SAT_SLOT_REUSE_MS 600000  // A satellite slot idle this long may go to a new address
+#define SOURCE_ID_LOCAL 1      // Receiver id of the hub's own scanner (0 = RX_SOURCE_NONE)
+#define SOURCE_ID_SAT_FIRST 2  // Satellite slot n has source id SOURCE_ID_SAT_FIRST + n
+#define INTERNED_STRING_LEN 32
 #define NVS_NAMESPACE "devices"
 #define NVS_WIFI_NAMESPACE "wifi"
 #define NVS_AIO_NAMESPACE "aio"
 
 #define BOOT_BUTTON_GPIO 0
 #define BOOT_HOLD_TIME_MS 5000
-#define AIO_SEND_INTERVAL_MS (5 * 60 * 1000)  // 5 minutes
+#define AIO_RATE_LIMIT_PER_MIN 30              // Adafruit IO free tier
+// Reporting policy defaults: a sensor reading is queued for upload when it
+// leaves the deadband around the last reported value, or as a heartbeat
+#define REPORT_TEMP_DEADBAND_CENTI 20  // ±0.2 °C
+#define REPORT_HUM_DEADBAND 2          // ±2 %RH
+#define REPORT_BATTERY_DEADBAND 5      // ±5 %
+#define REPORT_MIN_INTERVAL_S 60       // At most one report per device per minute
+#define REPORT_MAX_INTERVAL_S 3600     // Heartbeat for unchanged readings
+#define REPORT_QUEUE_LEN 32            // Reports waiting for the uplink task
+// Store-and-forward upload queue ("uplink" data partition, 64 KB = 2048 readings)
+#define NVS_UPLINK_NAMESPACE "uplink"
+#define UPLINK_PARTITION_LABEL "uplink"
+#define UPLINK_PARTITION_SUBTYPE 0x41
+#define UPLINK_RAM_SECTORS 2        // RAM queue without the partition (256 readings)
+#define UPLINK_D1_BATCH 32          // Readings per D1 batch request
+#define D1_READING_MAX 384          // One D1 reading as JSON, room for a fully escaped name
+#define UPLINK_AIO_BATCH 8          // Readings read per AIO pass (one request each)
+#define UPLINK_BACKOFF_MIN_S 30     // Retry delay after the first failure, doubling per failure
+#define UPLINK_BACKOFF_MAX_S 1800
+#define UPLINK_IDLE_WAIT_MS 60000
+#define UPLINK_CURSOR_SAVE_BATCHES 8  // A sink's cursor goes to NVS every this many batches,
+#define UPLINK_CURSOR_SAVE_S 60       // or this often, and whenever the sink has caught up
+#define UPLINK_COALESCE_MS 5000     // Gather reports this long so they go out in one batch
 #define BLE_RATE_INTERVAL_MS 10000
 #define DISCOVERY_PORT 19798
 #define DISCOVERY_INTERVAL_MS 5000
+#define SAT_UDP_PORT 19799          // Satellite datagrams (sat_udp.h), only with a key set
+#define SAT_UDP_RING_SIZE 32        // UDP observations waiting for the ingest task
+#define SAT_UDP_MAX_PEERS 8         // Satellites tracked for loss/reorder statistics
+#define SAT_UDP_KEY_MAX 64
+#define NVS_SAT_UDP_NAMESPACE "sat_udp"     // UDP ingest enable flag and key
+#define NVS_SAT_EPOCH_NAMESPACE "sat_epoch" // Newest epoch per sat_id (replay protection)
+// Edge filtering policy for satellites (/api/satellite/policy)
+#define SAT_POLICY_MIN_INTERVAL_MS 1000  // Default: one packet per device per second
+#define SAT_POLICY_TTL_S 60              // Satellites re-fetch (with If-None-Match) this often
 #define MDNS_HOSTNAME "ble-master"
+#define LOCAL_ADV_RING_SIZE 64      // Local scan observations waiting for the ingest task
+#define SAT_ADV_RING_SIZE 32        // Satellite observations waiting for the ingest task
+#define INGEST_BATCH_MAX 32         // Entries drained per ring while holding the device lock
+#define INGEST_IDLE_WAIT_MS 1000
+#define SNAPSHOT_MAX_RETRIES 8      // Optimistic snapshot attempts before falling back to device_lock
+#define JSON_CHUNK_SIZE 1024        // Stack buffer of a streamed JSON response (one chunk or WS fragment)
+#define DEVICE_SYNC_REFRESH_MS 10000  // RSSI/last-seen-only updates are published this often
+// Receiver fusion: a device's receiver changes only for a clearly better one
+#define RX_STALE_MS 30000             // A receiver not heard for this long drops out of the choice
+#define RX_HYSTERESIS_DB 6            // Average RSSI margin needed to switch receivers
+#define SENSOR_DEDUP_WINDOW_MS 60000  // Same packet counter within this time = same measurement
+// Live push (/ws): device deltas go out at most once per interval per client
+#define PUSH_MAX_CLIENTS 4
+#define PUSH_INTERVAL_MS 100          // Default, a client may ask for ?interval=<ms>
+#define PUSH_INTERVAL_MIN_MS 50
+#define PUSH_INTERVAL_MAX_MS 60000
+#define PUSH_SEND_TIMEOUT_MS 250      // A live client that can't take a send this fast is dropped
+
+// In-RAM sensor history, override with -DHISTORY_MAX_SERIES=... etc.
+// Each series costs HISTORY_SLOTS * 2 bytes (2880 bytes for 24 h at 1 min) plus rollups.
+#ifndef HISTORY_INTERVAL_S
+#define HISTORY_INTERVAL_S 60
+#endif
+#ifndef HISTORY_SLOTS
+#define HISTORY_SLOTS 1440
+#endif
+#ifndef HISTORY_MAX_SERIES
+#define HISTORY_MAX_SERIES 12      // Visible sensors with history at once
+#endif
+// Min/avg/max rollups kept in RAM next to each series (9 bytes per bucket):
+// 24 h of 15-min and 1-h buckets, updated on every reading
+#define HISTORY_ROLLUP_QUARTERS 96
+#define HISTORY_ROLLUP_HOURS 24
+#define HISTORY_ROLLUP_FLUSH_BUCKETS 4  // Closed 15-min buckets per flash rollup block (at least)
+#define HISTORY_POINT_BUDGET 200        // Default /api/history point budget
+#define HISTORY_POINT_BUDGET_MAX 1500
+// Flash history log ("history" data partition): RAM history is written out
+// in compressed blocks of HISTORY_BLOCK_SLOTS samples
+#ifndef HISTORY_BLOCK_SLOTS
+#define HISTORY_BLOCK_SLOTS 60
+#endif
+#ifndef HISTORY_RETENTION_DAYS
+#define HISTORY_RETENTION_DAYS 30  // Older blocks are ignored (the log also recycles its oldest sector when full)
+#endif
+#define HISTORY_PARTITION_LABEL "history"
+#define HISTORY_PARTITION_SUBTYPE 0x40
+#define HISTORY_FLUSH_CHECK_MS 60000
+#define CLOCK_VALID_AFTER 1700000000  // Wall clock is set once SNTP has synced
+// Hot per-device record, touched on every advertisement. Strings live elsewhere:
+// names in the bounded device_names[] pool, firmware type and source interned.
 typedef struct {
     uint8_t addr[6];
     int8_t rssi;
+    uint8_t name_slot;  // Index into device_names[], NO_NAME_SLOT if the device has no name
     uint32_t last_seen;
     uint32_t last_sensor_seen; // When the last BLE sensor data was received
+    float temperature;
+    uint16_t battery_mv;
+    uint16_t field_mask;  // Bitmask: which fields to show (temp, hum, bat, batMv, rssi, age)
+    uint8_t humidity;
+    uint8_t battery_pct;
+    uint8_t firmware_id;  // Interned: "pvvx", "ATC", "MiBeacon", "BTHome"
+    uint8_t source_id;  // SOURCE_ID_LOCAL or a satellite slot, the chosen receiver
     bool visible;  // Is the device visible
-    char name[MAX_NAME_LEN];
-    char adv_name[MAX_NAME_LEN];  // Advertised name (BLE advertisement)
     bool user_named;  // Has the user set a custom name
     bool show_mac;  // Show MAC address
     bool show_ip;  // Show satellite IP
-    uint16_t field_mask;  // Bitmask: which fields to show (temp, hum, bat, batMv, rssi, age)
     bool has_sensor_data;
-    float temperature;
-    uint8_t humidity;
-    uint8_t battery_pct;
-    uint16_t battery_mv;
-    char firmware_type[16];  // "pvvx", "ATC", "MiBeacon", "BTHome", or "Unknown"
-    char source[32];  // "local" or "satellite-192.168.68.129"
+    bool persisted;  // Has settings/visibility stored in NVS (never evicted)
+    uint8_t report_temp_db;  // Deadband overrides (0.01 °C, %RH), REPORT_DEADBAND_DEFAULT = use the default
+    uint8_t report_hum_db;
+    report_state_t report;   // Last reading queued for upload
+    uint32_t version;        // device_version of the last change shown by /api/devices
+    uint32_t version_ms;     // When version was taken
+    rx_set_t receivers;      // Who hears the device, source_id is the chosen one
+    bool has_packet_id;      // Last applied measurement had a packet counter
+    uint8_t packet_id;
 } ble_device_t;
 
+// Cold per-device strings, only allocated for devices that actually have a name
+typedef struct {
+    char name[MAX_NAME_LEN];
+    char adv_name[MAX_NAME_LEN];  // Advertised name (BLE advertisement)
+} ble_device_names_t;
+
+#define NO_NAME_SLOT 0xFF
+_Static_assert(MAX_NAMED_DEVICES < NO_NAME_SLOT, "name_slot is a uint8_t and NO_NAME_SLOT is reserved");
+
+// Coherent copy of one device for readers (HTTP, cloud upload), names inlined
+typedef struct {
+    ble_device_t dev;
+    char name[MAX_NAME_LEN];
+    char adv_name[MAX_NAME_LEN];
+} device_snapshot_t;
+
+// A device's MAC, for walking the table in MAC order one device at a time
+typedef struct {
+    uint8_t addr[6];
+} device_key_t;
+_Static_assert(sizeof(device_key_t) == 6, "device_key_t arrays are passed as packed MACs");
+#define STR_ID_NONE 0  // Interned id of the empty string
+
 // Field mask bits
 #define FIELD_TEMP   (1 << 0)
 #define FIELD_HUM    (1 << 1)
@@ -77,8 +228,66 @@ typedef struct {
 #define FIELD_AGE    (1 << 5)
 #define FIELD_ALL    0xFFFF  // All fields by default
 
-static ble_device_t devices[MAX_DEVICES];
+static ble_device_t *devices = NULL;  // MAX_DEVICES entries, allocated in device_store_init()
 static int device_count = 0;
+static ble_device_names_t *device_names = NULL;  // MAX_NAMED_DEVICES entries
+static uint8_t device_name_used[(MAX_NAMED_DEVICES + 7) / 8];
+static device_registry_slot_t *device_index_slots = NULL;
+static device_registry_t device_index;
+static uint32_t device_evict_count = 0;
+// Change versions for /api/devices delta sync. Bumped by writers (under
+// device_lock); a device's version is the value at its last change.
+static atomic_uint_least32_t device_version;
+static atomic_uint_least32_t device_removed_version;  // Last removal or hide (list shrank)
+static uint32_t device_epoch;  // Random per boot: cursors of an earlier boot are not valid
+
+// Live push clients (WebSocket sessions of /ws); push_lock guards the table
+typedef struct {
+    int fd;
+    bool show_all;         // ?all=1: hidden devices too (discovery)
+    bool synced;           // Has received a full list
+    uint32_t version;      // Cursor: device_version of the last message sent
+    uint32_t interval_ms;  // Coalescing interval
+    uint32_t last_send_ms;
+} push_client_t;
+
+static push_client_t push_clients[PUSH_MAX_CLIENTS];
+static atomic_int push_client_count;
+static SemaphoreHandle_t push_lock = NULL;
+static TaskHandle_t push_task_handle = NULL;
+
+// UDP satellite ingest (sat_udp.h); sat_udp_lock guards the key and peer stats
+typedef struct {
+    uint32_t ip;             // Last sender address, network byte order, 0 = free slot
+    uint32_t sat_id;         // From the datagram header; identifies the peer
+    uint8_t source_id;       // Satellite registry slot of ip, as for HTTP uploads
+    sat_seq_t seq;           // Epoch and sequence state
+    uint32_t records;        // Observations queued for ingest
+    uint32_t dropped;        // Observations lost to a full ingest ring
+    uint32_t last_seen_ms;
+} sat_udp_peer_t;
+
+static bool sat_udp_enabled = false;
+static uint8_t sat_udp_key[SAT_UDP_KEY_MAX];
+static size_t sat_udp_key_len = 0;
+static sat_udp_peer_t sat_udp_peers[SAT_UDP_MAX_PEERS];
+static uint32_t sat_udp_bad_tag = 0;     // Wrong key or tampered datagram
+static uint32_t sat_udp_malformed = 0;   // Not a datagram, or bad records under a good tag
+static portMUX_TYPE sat_udp_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Edge filtering policy satellites fetch from /api/satellite/policy, along
+// with the watch list (visible devices). Read and written by the httpd task.
+static sat_policy_t sat_policy = { true, SAT_POLICY_MIN_INTERVAL_MS, DEVICE_SYNC_REFRESH_MS };
+
+// Satellite registry (sat_registry.h), one slot per sender address. Slot
+// n is source id SOURCE_ID_SAT_FIRST + n. Written by the httpd, UDP and
+// ingest tasks and the BLE rate timer, so every access holds satellite_lock.
+static sat_entry_t satellite_slots[MAX_SATELLITES];
+static sat_registry_t satellites;
+static portMUX_TYPE satellite_lock = portMUX_INITIALIZER_UNLOCKED;
+static char interned_strings[MAX_INTERNED_STRINGS][INTERNED_STRING_LEN];
+static uint8_t interned_count = 1;  // Id 0 is the empty string
+static portMUX_TYPE intern_lock = portMUX_INITIALIZER_UNLOCKED;
 static httpd_handle_t server = NULL;
 static bool setup_mode = false;
 static char wifi_ssid[64] = {0};
@@ -93,10 +302,65 @@ static char aio_username[64] = {0};
 static char aio_key[128] = {0};
 static bool aio_enabled = false;
 static uint8_t aio_feed_types = FIELD_TEMP | FIELD_HUM;  // Default temp + hum
-static esp_timer_handle_t aio_timer = NULL;
 static char d1_worker_url[256] = {0};
 static char d1_token[128] = {0};
 static bool d1_enabled = false;
+
+// Keep-alive connection to one cloud host, reused for every request of an
+// upload cycle and closed (keeping the TLS session ticket) between cycles
+typedef struct {
+    const char *label;
+    esp_http_client_handle_t client;
+    uint32_t requests;          // Totals since boot
+    uint32_t handshakes;        // New connections (full or resumed TLS handshakes)
+    uint32_t failures;
+    uint32_t cycle_requests;    // Last completed cycle
+    uint32_t cycle_handshakes;
+    uint32_t cycle_ms;
+    uint32_t cycles;
+    uint32_t open_requests;     // Counters of the cycle in progress
+    uint32_t open_handshakes;
+} cloud_conn_t;
+
+static cloud_conn_t aio_conn = { .label = "aio" };
+static cloud_conn_t d1_conn = { .label = "d1" };
+
+// Upload queue consumer. Each sink keeps its own cursor into the shared
+// queue (persisted in NVS), so AIO and D1 drain and back off independently.
+typedef struct {
+    const char *name;           // NVS key and API label
+    uint32_t cursor;            // Next sequence number to deliver
+    uint32_t sent;
+    uint32_t dropped;           // Overwritten in the queue before delivery
+    uint32_t rejected;          // Refused by the sink (4xx), skipped
+    uint32_t failures;          // Consecutive failed attempts
+    int64_t retry_at_us;        // Backoff: no attempt before this
+    int64_t last_ok_us;
+    uint32_t saved_cursor;      // Cursor as last stored in NVS
+    uint32_t unsaved_batches;   // Batches delivered since
+    int64_t saved_us;
+} uplink_sink_t;
+
+static uplink_queue_t uplink_queue;
+static uplink_sink_t aio_sink = { .name = "aio" };
+static uplink_sink_t d1_sink = { .name = "d1" };
+static bool uplink_persistent = false;        // Queue on flash (vs. RAM fallback)
+static TaskHandle_t uplink_task_handle = NULL;
+static atomic_bool uplink_capture_pending;
+static atomic_bool uplink_force;
+
+// Reporting policy: evaluated by the ingest task on every sensor reading,
+// which hands qualifying readings to the uplink task through report_queue
+static report_policy_t report_policy = {
+    .temp_deadband_centi = REPORT_TEMP_DEADBAND_CENTI,
+    .hum_deadband = REPORT_HUM_DEADBAND,
+    .battery_deadband = REPORT_BATTERY_DEADBAND,
+    .min_interval_s = REPORT_MIN_INTERVAL_S,
+    .max_interval_s = REPORT_MAX_INTERVAL_S,
+};
+static QueueHandle_t report_queue = NULL;
+static uint32_t report_counts[REPORT_HEARTBEAT + 1];  // Queued reports by reason
+static uint32_t report_deferred = 0;                  // report_queue was full
 static esp_timer_handle_t ble_rate_timer = NULL;
 
 // BLE packet counters
@@ -104,12 +368,496 @@ static uint32_t ble_adv_count = 0;
 static uint32_t ble_sensor_count = 0;
 static uint32_t sat_adv_count = 0;
 static uint32_t sat_sensor_count = 0;
+static uint32_t sensor_dup_count = 0;  // Measurements heard again (other receiver or repeat), not applied
+
+// Ingest pipeline: producers (NimBLE host task, httpd task, UDP task) only copy raw
+// packets into their own SPSC ring; ingest_task is the only consumer and
+// applies them to devices[] under device_lock.
+static adv_ring_t local_adv_ring;
+static adv_ring_t sat_adv_ring;
+static adv_ring_t udp_adv_ring;
+static TaskHandle_t ingest_task_handle = NULL;
+static SemaphoreHandle_t device_lock = NULL;  // Serializes writers of devices[]
+static atomic_uint_least32_t device_seq;      // Seqlock: odd while a writer is active
+
+// Sensor history: one delta-encoded ring per visible sensor, slot storage
+// allocated on first use. Written by the ingest task, copied out by readers.
+typedef struct {
+    uint8_t addr[6];
+    bool in_use;
+    uint8_t battery_pct;    // Latest battery level, stored with flash blocks
+    uint32_t flushed_slot;  // Slots before this one are in the flash log
+    history_series_t series;
+    rollup_acc_t minute;    // Readings of the newest slot; the series holds their average
+    rollup_acc_t open[2];   // Open 15-min and 1-h buckets (uptime seconds)
+    rollup_ring_t rollups[2];
+    uint32_t rollup_flushed;  // 15-min buckets starting before this are in the flash log
+} history_entry_t;
+
+static history_entry_t history_entries[HISTORY_MAX_SERIES];
+static SemaphoreHandle_t history_lock = NULL;
+
+// Flash history log; history_log_lock serializes appends and queries
+static const esp_partition_t *history_partition = NULL;
+static history_log_t history_log;
+static history_log_sector_t *history_log_index = NULL;
+static SemaphoreHandle_t history_log_lock = NULL;
+static bool history_log_ready = false;
+static bool sntp_started = false;
 
 // Scan control
 // NOTE: Scanning runs CONTINUOUSLY, but new devices are only added in discovery mode
 static bool allow_new_devices = false;  // Allow adding new devices (discovery mode)
 static bool master_ble_enabled = true;  // Is local BLE scanning enabled (or satellites only)
 
+// ============================================
+// DEVICE STORE (hot records, name pool, interned strings)
+// ============================================
+
+// Return a stable id for a short string (firmware type, source). Strings are
+// copied into a fixed table once and never freed, so ids can be read without locking.
+static uint8_t intern_string(const char *str) {
+    if (!str || str[0] == '\0') {
+        return STR_ID_NONE;
+    }
+    uint8_t id = STR_ID_NONE;
+    taskENTER_CRITICAL(&intern_lock);
+    for (uint8_t i = 1; i < interned_count; i++) {
+        if (strncmp(interned_strings[i], str, INTERNED_STRING_LEN - 1) == 0) {
+            id = i;
+            break;
+        }
+    }
+    if (id == STR_ID_NONE && interned_count < MAX_INTERNED_STRINGS) {
+        strncpy(interned_strings[interned_count], str, INTERNED_STRING_LEN - 1);
+        interned_strings[interned_count][INTERNED_STRING_LEN - 1] = '\0';
+        id = interned_count++;
+    }
+    taskEXIT_CRITICAL(&intern_lock);
+    return id;
+}
+
+static inline const char *interned_str(uint8_t id) {
+    return (id < interned_count) ? interned_strings[id] : "";
+}
+
+// Source id of a satellite's registry slot, or RX_SOURCE_NONE for -1
+static inline uint8_t satellite_source_id(int slot) {
+    return (slot >= 0) ? SOURCE_ID_SAT_FIRST + slot : RX_SOURCE_NONE;
+}
+
+static inline bool source_is_satellite(uint8_t source_id) {
+    return source_id >= SOURCE_ID_SAT_FIRST && source_id < SOURCE_ID_SAT_FIRST + MAX_SATELLITES;
+}
+
+// Receiver name for the API and logs: "local" or "satellite-<ip>"
+static void source_name(uint8_t source_id, char *out, size_t size) {
+    out[0] = '\0';
+    if (source_id == SOURCE_ID_LOCAL) {
+        snprintf(out, size, "local");
+    } else if (source_is_satellite(source_id)) {
+        taskENTER_CRITICAL(&satellite_lock);
+        struct in_addr addr = { .s_addr = satellites.slots[source_id - SOURCE_ID_SAT_FIRST].ip };
+        taskEXIT_CRITICAL(&satellite_lock);
+        char ip[16];
+        if (addr.s_addr != 0) {
+            inet_ntoa_r(addr, ip, sizeof(ip));
+            snprintf(out, size, "satellite-%s", ip);
+        }
+    }
+}
+
+static inline const char *device_name(const ble_device_t *dev) {
+    return (dev->name_slot != NO_NAME_SLOT) ? device_names[dev->name_slot].name : "";
+}
+
+static inline const char *device_adv_name(const ble_device_t *dev) {
+    return (dev->name_slot != NO_NAME_SLOT) ? device_names[dev->name_slot].adv_name : "";
+}
+
+// A discovery entry the user never kept: may be evicted under memory pressure
+static inline bool device_is_unsaved(const ble_device_t *dev) {
+    return !dev->visible && !dev->persisted && !dev->user_named;
+}
+
+static void device_names_release(ble_device_t *dev) {
+    if (dev->name_slot == NO_NAME_SLOT) {
+        return;
+    }
+    device_name_used[dev->name_slot / 8] &= ~(1 << (dev->name_slot % 8));
+    dev->name_slot = NO_NAME_SLOT;
+}
+
+// Get (allocating on demand) the name storage of a device. When the pool is
+// full, the least recently seen unsaved device gives up its names.
+static ble_device_names_t *device_names_get(ble_device_t *dev) {
+    if (dev->name_slot != NO_NAME_SLOT) {
+        return &device_names[dev->name_slot];
+    }
+    int slot = -1;
+    for (int i = 0; i < MAX_NAMED_DEVICES; i++) {
+        if (!(device_name_used[i / 8] & (1 << (i % 8)))) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        int victim = -1;
+        for (int i = 0; i < device_count; i++) {
+            if (&devices[i] == dev || devices[i].name_slot == NO_NAME_SLOT || !device_is_unsaved(&devices[i])) {
+                continue;
+            }
+            if (victim < 0 || devices[i].last_seen < devices[victim].last_seen) {
+                victim = i;
+            }
+        }
+        if (victim < 0) {
+            return NULL;  // Every name belongs to a saved device
+        }
+        slot = devices[victim].name_slot;
+        devices[victim].name_slot = NO_NAME_SLOT;
+    }
+    device_name_used[slot / 8] |= (1 << (slot % 8));
+    memset(&device_names[slot], 0, sizeof(ble_device_names_t));
+    dev->name_slot = (uint8_t)slot;
+    return &device_names[slot];
+}
+
+// Copy up to len bytes (-1 = NUL-terminated) into a name field, truncating to MAX_NAME_LEN
+static void copy_name(char *dst, const char *src, int len) {
+    if (len < 0) {
+        len = strlen(src);
+    }
+    if (len > MAX_NAME_LEN - 1) {
+        len = MAX_NAME_LEN - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void set_device_name(ble_device_t *dev, const char *name, int len) {
+    if (len == 0 || name[0] == '\0') {
+        if (dev->name_slot != NO_NAME_SLOT) {
+            device_names[dev->name_slot].name[0] = '\0';
+        }
+        return;
+    }
+    ble_device_names_t *names = device_names_get(dev);
+    if (names) {
+        copy_name(names->name, name, len);
+    }
+}
+
+static void set_device_adv_name(ble_device_t *dev, const char *adv_name, int len) {
+    if (len == 0 || adv_name[0] == '\0') {
+        if (dev->name_slot != NO_NAME_SLOT) {
+            device_names[dev->name_slot].adv_name[0] = '\0';
+        }
+        return;
+    }
+    ble_device_names_t *names = device_names_get(dev);
+    if (names) {
+        copy_name(names->adv_name, adv_name, len);
+    }
+}
+
+// Wake the push task if anyone is listening
+static void device_push_notify(void) {
+    if (push_task_handle != NULL && atomic_load(&push_client_count) > 0) {
+        xTaskNotifyGive(push_task_handle);
+    }
+}
+
+// Mark a device changed for delta sync. Call with device_lock held.
+static void device_touch(ble_device_t *dev) {
+    dev->version = atomic_fetch_add(&device_version, 1) + 1;
+    dev->version_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    device_push_notify();
+}
+
+// A device left the list (removed, hidden, or filtered out of the view):
+// delta clients must reload everything
+static void device_list_shrunk(void) {
+    atomic_store(&device_removed_version, atomic_fetch_add(&device_version, 1) + 1);
+    device_push_notify();
+}
+
+// Remove a device from the table: the last entry moves into its slot
+// (list order is not significant, /api/devices sorts by MAC)
+static void remove_device(int idx) {
+    device_registry_remove(&device_index, devices[idx].addr);
+    device_names_release(&devices[idx]);
+    int last = device_count - 1;
+    if (idx != last) {
+        memcpy(&devices[idx], &devices[last], sizeof(ble_device_t));
+        device_registry_insert(&device_index, devices[idx].addr, idx);
+    }
+    device_count--;
+    device_list_shrunk();
+}
+
+// Table full: drop the least recently seen unsaved discovery entry.
+// Returns true if a slot was freed.
+static bool evict_unsaved_device(void) {
+    int victim = -1;
+    for (int i = 0; i < device_count; i++) {
+        if (!device_is_unsaved(&devices[i])) {
+            continue;
+        }
+        if (victim < 0 || devices[i].last_seen < devices[victim].last_seen) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Device table full, evicting unsaved %02X:%02X:%02X:%02X:%02X:%02X",
+             devices[victim].addr[0], devices[victim].addr[1], devices[victim].addr[2],
+             devices[victim].addr[3], devices[victim].addr[4], devices[victim].addr[5]);
+    remove_device(victim);
+    device_evict_count++;
+    return true;
+}
+
+// Claim a fresh device slot for addr (evicting if needed). Returns the index or -1.
+static int add_device(const uint8_t *addr) {
+    if (device_count >= MAX_DEVICES && !evict_unsaved_device()) {
+        return -1;
+    }
+    int idx = device_count;
+    memset(&devices[idx], 0, sizeof(ble_device_t));
+    memcpy(devices[idx].addr, addr, 6);
+    devices[idx].name_slot = NO_NAME_SLOT;
+    devices[idx].show_mac = true;
+    devices[idx].field_mask = FIELD_ALL;
+    devices[idx].report_temp_db = REPORT_DEADBAND_DEFAULT;
+    devices[idx].report_hum_db = REPORT_DEADBAND_DEFAULT;
+    device_touch(&devices[idx]);
+    if (!device_registry_insert(&device_index, addr, idx)) {
+        return -1;
+    }
+    device_count++;
+    return idx;
+}
+
+// Allocate the device table (PSRAM if the board has it, internal RAM otherwise)
+static bool device_store_init(void) {
+    uint16_t slots = 2;
+    while (slots < 2 * MAX_DEVICES) {
+        slots <<= 1;
+    }
+    devices = heap_caps_calloc_prefer(MAX_DEVICES, sizeof(ble_device_t), 2,
+                                      MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+    device_names = heap_caps_calloc_prefer(MAX_NAMED_DEVICES, sizeof(ble_device_names_t), 2,
+                                           MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+    device_index_slots = heap_caps_calloc_prefer(slots, sizeof(device_registry_slot_t), 2,
+                                                 MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+    device_lock = xSemaphoreCreateMutex();
+    history_lock = xSemaphoreCreateMutex();
+    if (!devices || !device_names || !device_index_slots || !device_lock || !history_lock) {
+        ESP_LOGE(TAG, "Failed to allocate device table (%d devices)", MAX_DEVICES);
+        return false;
+    }
+    device_registry_init(&device_index, device_index_slots, slots);
+    sat_registry_init(&satellites, satellite_slots, MAX_SATELLITES, SAT_SLOT_REUSE_MS);
+    device_epoch = esp_random();
+
+    ESP_LOGI(TAG, "Device table: %d devices, %d names, %u index slots (%u bytes)",
+             MAX_DEVICES, MAX_NAMED_DEVICES, slots,
+             (unsigned)(MAX_DEVICES * sizeof(ble_device_t) +
+                        MAX_NAMED_DEVICES * sizeof(ble_device_names_t) +
+                        slots * sizeof(device_registry_slot_t)));
+    return true;
+}
+
+// Writers of devices[] / names wrap their changes in begin/end. Readers use
+// device_store_snapshot() and never take the lock in the common case.
+static void device_write_begin(void) {
+    xSemaphoreTake(device_lock, portMAX_DELAY);
+    // Only writers store device_seq and they are serialized, so load+store is enough
+    atomic_store_explicit(&device_seq, atomic_load_explicit(&device_seq, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void device_write_end(void) {
+    atomic_store_explicit(&device_seq, atomic_load_explicit(&device_seq, memory_order_relaxed) + 1,
+                          memory_order_release);
+    xSemaphoreGive(device_lock);
+}
+
+// Copy devices accepted by keep (NULL = all) into out, names included.
+// Returns the number copied; stops at cap.
+static void device_store_copy_one(device_snapshot_t *snap, int idx) {
+    memcpy(&snap->dev, &devices[idx], sizeof(ble_device_t));
+    // name_slot may be torn during an optimistic copy: bound it, validate later
+    uint8_t slot = snap->dev.name_slot;
+    if (slot < MAX_NAMED_DEVICES) {
+        memcpy(snap->name, device_names[slot].name, MAX_NAME_LEN);
+        memcpy(snap->adv_name, device_names[slot].adv_name, MAX_NAME_LEN);
+        snap->name[MAX_NAME_LEN - 1] = '\0';
+        snap->adv_name[MAX_NAME_LEN - 1] = '\0';
+    } else {
+        snap->name[0] = '\0';
+        snap->adv_name[0] = '\0';
+    }
+}
+
+static int device_store_copy(device_snapshot_t *out, int count, int cap,
+                             bool (*keep)(const ble_device_t *)) {
+    int n = 0;
+    for (int i = 0; i < count && n < cap; i++) {
+        if (keep && !keep(&devices[i])) {
+            continue;
+        }
+        device_store_copy_one(&out[n++], i);
+    }
+    return n;
+}
+
+// Take a consistent snapshot of the device table without blocking writers:
+// copy optimistically and retry if a writer was active (seqlock). Only after
+// SNAPSHOT_MAX_RETRIES failed attempts is device_lock taken for the copy.
+// *out is malloc'd and must be freed by the caller. Returns the count or -1.
+static int device_store_snapshot(device_snapshot_t **out, bool (*keep)(const ble_device_t *)) {
+    device_snapshot_t *snap = NULL;
+    int cap = 0;
+    int n = 0;
+    
+    for (int attempt = 0; ; attempt++) {
+        bool locked = (attempt >= SNAPSHOT_MAX_RETRIES);
+        if (locked) {
+            xSemaphoreTake(device_lock, portMAX_DELAY);
+        }
+        uint32_t seq = atomic_load_explicit(&device_seq, memory_order_acquire);
+        if (!locked && (seq & 1)) {
+            vTaskDelay(1);  // Writer active, let it finish
+            continue;
+        }
+        
+        int count = device_count;
+        if (count > MAX_DEVICES) {
+            count = MAX_DEVICES;  // Torn read of device_count
+        }
+        if (count > cap || !snap) {
+            if (locked) {
+                xSemaphoreGive(device_lock);
+            }
+            free(snap);
+            cap = (count + 16 < MAX_DEVICES) ? count + 16 : MAX_DEVICES;
+            snap = malloc(cap * sizeof(device_snapshot_t));
+            if (!snap) {
+                *out = NULL;
+                return -1;
+            }
+            continue;
+        }
+        
+        n = device_store_copy(snap, count, cap, keep);
+        
+        if (locked) {
+            xSemaphoreGive(device_lock);
+            break;
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&device_seq, memory_order_relaxed) == seq) {
+            break;
+        }
+    }
+    *out = snap;
+    return n;
+}
+
+// MACs of the devices accepted by keep (NULL = all), sorted, for streaming
+// the table without copying it: 6 bytes per device instead of a snapshot.
+// *out is malloc'd and must be freed by the caller. Returns the count or -1.
+static int compare_device_key(const void *a, const void *b) {
+    return memcmp(((const device_key_t *)a)->addr, ((const device_key_t *)b)->addr, 6);
+}
+
+static int device_store_keys(device_key_t **out, bool (*keep)(const ble_device_t *)) {
+    device_key_t *keys = malloc(MAX_DEVICES * sizeof(device_key_t));
+    if (!keys) {
+        *out = NULL;
+        return -1;
+    }
+    int n = 0;
+    for (int attempt = 0; ; attempt++) {
+        bool locked = (attempt >= SNAPSHOT_MAX_RETRIES);
+        if (locked) {
+            xSemaphoreTake(device_lock, portMAX_DELAY);
+        }
+        uint32_t seq = atomic_load_explicit(&device_seq, memory_order_acquire);
+        if (!locked && (seq & 1)) {
+            vTaskDelay(1);
+            continue;
+        }
+        int count = (device_count > MAX_DEVICES) ? MAX_DEVICES : device_count;
+        n = 0;
+        for (int i = 0; i < count; i++) {
+            if (!keep || keep(&devices[i])) {
+                memcpy(keys[n++].addr, devices[i].addr, 6);
+            }
+        }
+        if (locked) {
+            xSemaphoreGive(device_lock);
+            break;
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&device_seq, memory_order_relaxed) == seq) {
+            break;
+        }
+    }
+    qsort(keys, n, sizeof(device_key_t), compare_device_key);
+    *out = keys;
+    return n;
+}
+
+// Consistent copy of one device, found by MAC (it may have moved in the
+// table since its key was taken). Same seqlock scheme as
+// device_store_snapshot(). Returns false if the device is gone.
+static bool device_store_read(const uint8_t *addr, device_snapshot_t *out) {
+    for (int attempt = 0; ; attempt++) {
+        bool locked = (attempt >= SNAPSHOT_MAX_RETRIES);
+        if (locked) {
+            xSemaphoreTake(device_lock, portMAX_DELAY);
+        }
+        uint32_t seq = atomic_load_explicit(&device_seq, memory_order_acquire);
+        if (!locked && (seq & 1)) {
+            vTaskDelay(1);
+            continue;
+        }
+        // Probing ends at an empty slot even while a writer shifts entries
+        int idx = device_registry_find(&device_index, addr);
+        bool found = (idx >= 0 && idx < MAX_DEVICES);
+        if (found) {
+            device_store_copy_one(out, idx);
+        }
+        if (locked) {
+            xSemaphoreGive(device_lock);
+        } else {
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&device_seq, memory_order_relaxed) != seq) {
+                continue;
+            }
+        }
+        return found && memcmp(out->dev.addr, addr, 6) == 0;
+    }
+}
+
+static bool device_is_visible(const ble_device_t *dev) {
+    return dev->visible;
+}
+
+static bool device_is_visible_sensor(const ble_device_t *dev) {
+    return dev->visible && dev->has_sensor_data;
+}
+
+// qsort comparator: device snapshots by MAC address
+static int compare_device_addr(const void *a, const void *b) {
+    return memcmp(((const device_snapshot_t *)a)->dev.addr, ((const device_snapshot_t *)b)->dev.addr, 6);
+}
+
 // Save device settings to NVS
 static void save_device_settings(uint8_t *addr, const char *name, bool show_mac, bool show_ip, uint16_t field_mask, bool user_named) {
     nvs_handle_t nvs;
@@ -153,7 +901,7 @@ static void save_device_settings(uint8_t *addr, const char *name, bool show_mac,
 }
 
 // Load device settings from NVS
-static void load_device_settings(uint8_t *addr, char *name_out, bool *show_mac_out, bool *show_ip_out, uint16_t *field_mask_out, bool *user_named_out) {
+static void load_device_settings(const uint8_t *addr, char *name_out, bool *show_mac_out, bool *show_ip_out, uint16_t *field_mask_out, bool *user_named_out) {
     nvs_handle_t nvs;
     // Defaults
     name_out[0] = '\0';
@@ -223,7 +971,7 @@ static void save_visibility(uint8_t *addr, bool visible) {
         nvs_close(nvs);
     }
 }
-static bool load_visibility(uint8_t *addr) {
+static bool load_visibility(const uint8_t *addr) {
     nvs_handle_t nvs;
     uint8_t val = 0;  // Default HIDDEN (not yet selected for main view)
     if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
@@ -241,6 +989,58 @@ static bool load_visibility(uint8_t *addr) {
     return val ? true : false;
 }
 
+// Save a device's reporting deadbands (REPORT_DEADBAND_DEFAULT = follow the default policy)
+static void save_report_deadbands(const uint8_t *addr, uint8_t temp_db, uint8_t hum_db) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        char key[24];
+        snprintf(key, sizeof(key), "%02X%02X%02X%02X%02X%02X_d",
+            addr[5], addr[4], addr[3], addr[2], addr[1], addr[0]);
+        if (temp_db == REPORT_DEADBAND_DEFAULT && hum_db == REPORT_DEADBAND_DEFAULT) {
+            nvs_erase_key(nvs, key);
+        } else {
+            nvs_set_u16(nvs, key, temp_db | (hum_db << 8));
+        }
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+}
+
+static void load_report_deadbands(const uint8_t *addr, uint8_t *temp_db_out, uint8_t *hum_db_out) {
+    nvs_handle_t nvs;
+    *temp_db_out = REPORT_DEADBAND_DEFAULT;
+    *hum_db_out = REPORT_DEADBAND_DEFAULT;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        char key[24];
+        snprintf(key, sizeof(key), "%02X%02X%02X%02X%02X%02X_d",
+            addr[5], addr[4], addr[3], addr[2], addr[1], addr[0]);
+        uint16_t val;
+        if (nvs_get_u16(nvs, key, &val) == ESP_OK) {
+            *temp_db_out = val & 0xFF;
+            *hum_db_out = val >> 8;
+        }
+        nvs_close(nvs);
+    }
+}
+
+// Stored settings of one device, read from NVS before it is added
+typedef struct {
+    char name[MAX_NAME_LEN];
+    bool show_mac;
+    bool show_ip;
+    bool user_named;
+    bool visible;
+    uint16_t field_mask;
+    uint8_t report_temp_db;
+    uint8_t report_hum_db;
+} device_settings_t;
+
+static void device_settings_load(const uint8_t *addr, device_settings_t *out) {
+    load_device_settings(addr, out->name, &out->show_mac, &out->show_ip, &out->field_mask, &out->user_named);
+    load_report_deadbands(addr, &out->report_temp_db, &out->report_hum_db);
+    out->visible = load_visibility(addr);
+}
+
 // Load all devices stored in NVS at startup
 static void load_all_devices_from_nvs(void) {
     nvs_handle_t nvs;
@@ -279,27 +1079,27 @@ static void load_all_devices_from_nvs(void) {
                 }
                 
                 // Add device to list
-                memcpy(devices[device_count].addr, addr, 6);
-                devices[device_count].visible = load_visibility(addr);
-                devices[device_count].rssi = 0;
-                devices[device_count].last_seen = 0;
-                devices[device_count].last_sensor_seen = 0;
-                devices[device_count].has_sensor_data = false;
-                devices[device_count].adv_name[0] = '\0';
+                int idx = add_device(addr);
+                if (idx < 0) {
+                    break;
+                }
+                devices[idx].visible = load_visibility(addr);
+                devices[idx].persisted = true;
                 
                 // Load other settings
-                load_device_settings(addr, devices[device_count].name,
-                            &devices[device_count].show_mac,
-                            &devices[device_count].show_ip,
-                            &devices[device_count].field_mask,
-                            &devices[device_count].user_named);
+                char name[MAX_NAME_LEN];
+                load_device_settings(addr, name,
+                            &devices[idx].show_mac,
+                            &devices[idx].show_ip,
+                            &devices[idx].field_mask,
+                            &devices[idx].user_named);
+                set_device_name(&devices[idx], name, -1);
+                load_report_deadbands(addr, &devices[idx].report_temp_db, &devices[idx].report_hum_db);
                 
                 ESP_LOGI(TAG, "  Loaded device %d: %02X:%02X:%02X:%02X:%02X:%02X, name=%s",
-                        device_count,
+                        idx,
                         addr[0], addr[1], addr[2], addr[3], addr[4], addr[5],
-                        devices[device_count].name);
-                
-                device_count++;
+                        name);
             }
         }
         
@@ -313,166 +1113,753 @@ static void load_all_devices_from_nvs(void) {
 }
 
 
-static int find_or_add_device(uint8_t *addr, bool allow_adding_new) {
-    // Check if the device is already in the list
-    for (int i = 0; i < device_count; i++) {
-        if (memcmp(devices[i].addr, addr, 6) == 0) {
-            return i;
-        }
+// Look up a device by its "AA:BB:CC:DD:EE:FF" string (as shown in the API)
+static int find_device_by_mac_str(const char *mac_str) {
+    uint8_t addr[6];
+    if (sscanf(mac_str, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+               &addr[0], &addr[1], &addr[2], &addr[3], &addr[4], &addr[5]) != 6) {
+        return -1;
+    }
+    return device_registry_find(&device_index, addr);
+}
+
+// settings: the device's stored settings, loaded by the caller outside the
+// write section (NULL = don't add, e.g. discovery was switched on since)
+static int find_or_add_device(const uint8_t *addr, bool allow_adding_new, uint8_t source_id,
+                              const device_settings_t *settings) {
+    // Check if the device is already in the list (O(1) hash lookup)
+    int idx = device_registry_find(&device_index, addr);
+    if (idx >= 0) {
+        return idx;
     }
     
     // Add a new device only if allowed (discovery mode on)
-    if (!allow_adding_new) {
+    if (!allow_adding_new || !settings) {
         return -1;  // Do not add new devices in monitoring mode
     }
     
     // Add a new device - default HIDDEN (shown only in discovery popup)
-    if (device_count < MAX_DEVICES) {
-        memcpy(devices[device_count].addr, addr, 6);
-        devices[device_count].visible = false;  // Hidden until user adds to main view
-        devices[device_count].rssi = 0;
-        devices[device_count].last_seen = 0;
-        devices[device_count].last_sensor_seen = 0;
-        devices[device_count].has_sensor_data = false;
-        devices[device_count].adv_name[0] = '\0';
-        strcpy(devices[device_count].source, "local");  // Local device
-        
-        // Load stored settings (name, show_mac, field_mask)
-        load_device_settings(addr, devices[device_count].name, 
-               &devices[device_count].show_mac,
-               &devices[device_count].show_ip,
-               &devices[device_count].field_mask,
-               &devices[device_count].user_named);
-        
-        // Load visibility from NVS (if stored)
-        devices[device_count].visible = load_visibility(addr);
-        
-        ESP_LOGI(TAG, "New device found: %02X:%02X:%02X:%02X:%02X:%02X, name=%s, visible=%d",
-                 addr[0], addr[1], addr[2], addr[3], addr[4], addr[5],
-                 devices[device_count].name, devices[device_count].visible);
-        return device_count++;
+    idx = add_device(addr);
+    if (idx < 0) {
+        return -1;
     }
-    return -1;
+    devices[idx].source_id = source_id;
+    
+    // Apply stored settings (name, show_mac, field_mask, deadbands, visibility)
+    char name[MAX_NAME_LEN];
+    memcpy(name, settings->name, MAX_NAME_LEN);
+    if (name[0] == '\0' && source_id != SOURCE_ID_LOCAL) {
+        // Placeholder until the advertisement carries a name
+        snprintf(name, MAX_NAME_LEN, "Sat-%02X%02X", addr[4], addr[5]);
+    }
+    set_device_name(&devices[idx], name, -1);
+    devices[idx].show_mac = settings->show_mac;
+    devices[idx].show_ip = settings->show_ip;
+    devices[idx].field_mask = settings->field_mask;
+    devices[idx].user_named = settings->user_named;
+    devices[idx].report_temp_db = settings->report_temp_db;
+    devices[idx].report_hum_db = settings->report_hum_db;
+    devices[idx].visible = settings->visible;
+    
+    char source[32];
+    source_name(source_id, source, sizeof(source));
+    ESP_LOGI(TAG, "New device found: %02X:%02X:%02X:%02X:%02X:%02X, name=%s, visible=%d, source=%s",
+             addr[0], addr[1], addr[2], addr[3], addr[4], addr[5],
+             name, devices[idx].visible, source);
+    return idx;
 }
 
-static int ble_gap_event(struct ble_gap_event *event, void *arg) {
-    if (event->type == BLE_GAP_EVENT_DISC) {
-        // Check if master BLE is enabled
-        if (!master_ble_enabled) {
-            return 0;  // Skip local BLE observations
-        }
-        
-        ble_adv_count++;
-        // Discovery mode: add new + update all
-        // Monitoring mode: update only visible=true devices
-        int idx = find_or_add_device(event->disc.addr.val, allow_new_devices);
-        
-        // LOG: Local BLE observation
-        ESP_LOGI(TAG, "📡 LOCAL BLE: %02X:%02X:%02X:%02X:%02X:%02X, RSSI: %d dBm, data_len: %d",
-                 event->disc.addr.val[5], event->disc.addr.val[4], event->disc.addr.val[3],
-                 event->disc.addr.val[2], event->disc.addr.val[1], event->disc.addr.val[0],
-                 event->disc.rssi, event->disc.length_data);
-        
-        // If the device is not in the list, skip (new devices aren't added in monitoring mode)
-        if (idx < 0) {
-            return 0;
-        }
-        
-        if (idx >= 0) {
-            // Always update RSSI and timestamp
-            devices[idx].rssi = event->disc.rssi;
-            uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            devices[idx].last_seen = now_ms;
-            
-            // Source = local whenever a local observation arrives
-            strcpy(devices[idx].source, "local");
-            
-            // If the device is hidden and discovery mode is off, don't update adv name/sensor data
-            if (!allow_new_devices && !devices[idx].visible) {
-                return 0;
+// A name we generated ("Sat-XXXX"), an empty name or the MAC itself may be
+// replaced by the advertised name
+static bool device_name_is_placeholder(const ble_device_t *dev) {
+    const char *name = device_name(dev);
+    if (name[0] == '\0' || strncmp(name, "Sat-", 4) == 0) {
+        return true;
+    }
+    char mac_as_name[18];
+    snprintf(mac_as_name, sizeof(mac_as_name), "%02X:%02X:%02X:%02X:%02X:%02X",
+             dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
+    return strcmp(name, mac_as_name) == 0;
+}
+
+// Returns true if the advertised name changed
+static bool apply_adv_name(ble_device_t *dev, const char *name, int len) {
+    // adv_name updates only if the user hasn't set a custom name
+    if (dev->user_named) {
+        return false;
+    }
+    const char *old = device_adv_name(dev);
+    if ((int)strlen(old) == len && memcmp(old, name, len) == 0) {
+        return false;
+    }
+    set_device_adv_name(dev, name, len);
+    if (device_name_is_placeholder(dev)) {
+        set_device_name(dev, name, len);
+    }
+    return true;
+}
+
+// ============================================
+// SENSOR HISTORY (in RAM, HISTORY_INTERVAL_S resolution)
+// ============================================
+
+static inline uint32_t history_uptime_s(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+static inline uint32_t history_now_slot(void) {
+    return history_uptime_s() / HISTORY_INTERVAL_S;
+}
+
+// Find the history entry of a device; with create, take a free entry or one
+// whose device is no longer visible. Call with history_lock held.
+static history_entry_t *history_find(const uint8_t *addr, bool create) {
+    history_entry_t *reuse = NULL;
+    for (int i = 0; i < HISTORY_MAX_SERIES; i++) {
+        history_entry_t *e = &history_entries[i];
+        if (e->in_use && memcmp(e->addr, addr, 6) == 0) {
+            return e;
+        }
+        if (!create || reuse) {
+            continue;
+        }
+        if (!e->in_use) {
+            reuse = e;
+        } else {
+            int idx = device_registry_find(&device_index, e->addr);
+            if (idx < 0 || !devices[idx].visible) {
+                reuse = e;
             }
+        }
+    }
+    if (!reuse) {
+        return NULL;
+    }
+    if (!reuse->series.slots) {
+        // Delta slots and rollup buckets share one allocation
+        size_t size = HISTORY_SLOTS * sizeof(history_delta_t) +
+                      (HISTORY_ROLLUP_QUARTERS + HISTORY_ROLLUP_HOURS) * sizeof(rollup_bucket_t);
+        history_delta_t *slots = heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+        if (!slots) {
+            return NULL;
+        }
+        reuse->series.slots = slots;
+    }
+    rollup_bucket_t *buckets = (rollup_bucket_t *)(reuse->series.slots + HISTORY_SLOTS);
+    history_series_init(&reuse->series, reuse->series.slots, HISTORY_SLOTS);
+    rollup_ring_init(&reuse->rollups[0], buckets, HISTORY_ROLLUP_QUARTERS, rollup_tier_seconds[1]);
+    rollup_ring_init(&reuse->rollups[1], buckets + HISTORY_ROLLUP_QUARTERS, HISTORY_ROLLUP_HOURS,
+                     rollup_tier_seconds[2]);
+    uint32_t now = history_uptime_s();
+    rollup_acc_reset(&reuse->minute, 0);
+    rollup_acc_reset(&reuse->open[0], 0);
+    rollup_acc_reset(&reuse->open[1], 0);
+    memcpy(reuse->addr, addr, 6);
+    reuse->in_use = true;
+    reuse->flushed_slot = now / HISTORY_INTERVAL_S;
+    reuse->rollup_flushed = now - now % rollup_tier_seconds[1];
+    return reuse;
+}
 
-            // Parse advertisement data
-            struct ble_hs_adv_fields fields;
-            if (ble_hs_adv_parse_fields(&fields, event->disc.data, event->disc.length_data) == 0) {
-                
-                // adv_name updates only if the user hasn't set a custom name
-                if (!devices[idx].user_named && fields.name != NULL && fields.name_len > 0) {
-                    int copy_len = (fields.name_len < MAX_NAME_LEN - 1) ? fields.name_len : MAX_NAME_LEN - 1;
-                    memcpy(devices[idx].adv_name, fields.name, copy_len);
-                    devices[idx].adv_name[copy_len] = '\0';
-                    // Update name only if empty (user hasn't set a custom one)
-                    if (devices[idx].name[0] == '\0') {
-                        memcpy(devices[idx].name, fields.name, copy_len);
-                        devices[idx].name[copy_len] = '\0';
-                        ESP_LOGI(TAG, "BLE name copied: %s", devices[idx].name);
-                    }
-                } else if (devices[idx].name[0] == '\0') {
-                    ESP_LOGI(TAG, "No BLE name in advertisement for this device");
-                }
-                
-                // Sensor data (pvvx/ATC UUID 0x181A or MiBeacon UUID 0xFE95 or BTHome v2 UUID 0xFCD2)
-                if (fields.svc_data_uuid16 != NULL && fields.svc_data_uuid16_len >= 13) {
-                    uint16_t uuid = fields.svc_data_uuid16[0] | (fields.svc_data_uuid16[1] << 8);
-                    
-                    if (uuid == 0x181A) {
-                        // pvvx or ATC custom firmware
-                        ble_sensor_data_t sensor_data;
-                        bool parsed = false;
-                        
-                        if (fields.svc_data_uuid16_len >= 17) {
-                            parsed = ble_parse_pvvx_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                        } else if (fields.svc_data_uuid16_len >= 15) {
-                            parsed = ble_parse_atc_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                        }
-                        
-                        if (parsed) {
-                            ble_sensor_count++;
-                            devices[idx].temperature = sensor_data.temperature;
-                            devices[idx].humidity = sensor_data.humidity;
-                            devices[idx].battery_pct = sensor_data.battery_pct;
-                            devices[idx].battery_mv = sensor_data.battery_mv;
-                            strncpy(devices[idx].firmware_type, sensor_data.device_type, sizeof(devices[idx].firmware_type) - 1);
-                            devices[idx].firmware_type[sizeof(devices[idx].firmware_type) - 1] = '\0';
-                            devices[idx].has_sensor_data = true;
-                            devices[idx].last_sensor_seen = now_ms;
-                        }
-                    } else if (uuid == 0xFE95) {
-                        // MiBeacon - Xiaomi original firmware
-                        ble_sensor_data_t sensor_data;
-                        bool parsed = ble_parse_mibeacon_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                        
-                        if (parsed) {
-                            ble_sensor_count++;
-                            devices[idx].temperature = sensor_data.temperature;
-                            devices[idx].humidity = sensor_data.humidity;
-                            devices[idx].battery_pct = sensor_data.battery_pct;
-                            devices[idx].battery_mv = sensor_data.battery_mv;
-                            strncpy(devices[idx].firmware_type, sensor_data.device_type, sizeof(devices[idx].firmware_type) - 1);
-                            devices[idx].firmware_type[sizeof(devices[idx].firmware_type) - 1] = '\0';
-                            devices[idx].has_sensor_data = true;
-                            devices[idx].last_sensor_seen = now_ms;
-                        }
-                    } else if (uuid == 0xFCD2) {
-                        // BTHome v2 - common standard (pvvx supports this)
-                        ble_sensor_data_t sensor_data;
-                        bool parsed = ble_parse_bthome_v2_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                        
-                        if (parsed) {
-                            ble_sensor_count++;
-                            devices[idx].temperature = sensor_data.temperature;
-                            devices[idx].humidity = sensor_data.humidity;
-                            devices[idx].battery_pct = sensor_data.battery_pct;
-                            devices[idx].battery_mv = sensor_data.battery_mv;
-                            strncpy(devices[idx].firmware_type, sensor_data.device_type, sizeof(devices[idx].firmware_type) - 1);
-                            devices[idx].firmware_type[sizeof(devices[idx].firmware_type) - 1] = '\0';
-                            devices[idx].has_sensor_data = true;
-                            devices[idx].last_sensor_seen = now_ms;
-                        }
-                    }
-                }
+// Record the current reading of a visible sensor (ingest task). The slot
+// keeps the average of its readings; the rollups are updated incrementally.
+static void history_record(const ble_device_t *dev) {
+    if (!dev->visible || !history_lock) {
+        return;
+    }
+    int16_t temp = (int16_t)lroundf(dev->temperature * 10.0f);
+    uint32_t now = history_uptime_s();
+    uint32_t slot = now / HISTORY_INTERVAL_S;
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+    history_entry_t *e = history_find(dev->addr, true);
+    if (e) {
+        if (e->minute.count == 0 || e->minute.start != slot) {
+            rollup_acc_reset(&e->minute, slot);
+        }
+        rollup_acc_add(&e->minute, temp, dev->humidity);
+        rollup_bucket_t avg;
+        rollup_acc_pack(&e->minute, &avg);
+        history_series_record(&e->series, slot, avg.t_avg, avg.h_avg);
+        rollup_feed(&e->rollups[0], &e->open[0], now, temp, dev->humidity);
+        rollup_feed(&e->rollups[1], &e->open[1], now, temp, dev->humidity);
+        e->battery_pct = dev->battery_pct;
+    }
+    xSemaphoreGive(history_lock);
+}
+
+// ============================================
+// FLASH HISTORY LOG (survives reboots)
+// ============================================
+
+static inline bool clock_valid(void) {
+    return time(NULL) > CLOCK_VALID_AFTER;
+}
+
+static bool history_flash_read(void *ctx, uint32_t offset, void *buf, uint32_t len) {
+    return esp_partition_read(history_partition, offset, buf, len) == ESP_OK;
+}
+
+static bool history_flash_write(void *ctx, uint32_t offset, const void *buf, uint32_t len) {
+    return esp_partition_write(history_partition, offset, buf, len) == ESP_OK;
+}
+
+static bool history_flash_erase(void *ctx, uint32_t offset) {
+    return esp_partition_erase_range(history_partition, offset, HISTORY_LOG_SECTOR_SIZE) == ESP_OK;
+}
+
+// Write one block of completed slots of a history entry to flash. The series
+// is copied under history_lock; encoding and the flash write happen without it.
+// Returns true if a block was consumed (written or all gaps).
+static bool history_flush_entry(int i, history_delta_t *slots_copy, uint32_t now_slot, uint32_t unix_now) {
+    history_entry_t *e = &history_entries[i];
+    history_series_t series;
+    uint8_t addr[6];
+    uint8_t battery_pct;
+    uint32_t from;
+    
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+    bool ready = e->in_use && e->series.count > 0 && now_slot - e->flushed_slot >= HISTORY_BLOCK_SLOTS;
+    if (ready) {
+        series = e->series;
+        memcpy(slots_copy, e->series.slots, HISTORY_SLOTS * sizeof(history_delta_t));
+        series.slots = slots_copy;
+        memcpy(addr, e->addr, 6);
+        battery_pct = e->battery_pct;
+        from = e->flushed_slot;
+    }
+    xSemaphoreGive(history_lock);
+    if (!ready) {
+        return false;
+    }
+    
+    // Slots already overwritten in RAM are lost; start from the oldest kept
+    uint32_t oldest = series.last_slot - (series.count - 1);
+    if (from < oldest) {
+        from = oldest;
+    }
+    uint32_t to = from + HISTORY_BLOCK_SLOTS;
+    if (to > now_slot) {
+        to = now_slot;
+    }
+    
+    history_sample_t samples[HISTORY_BLOCK_SLOTS];
+    for (int k = 0; k < HISTORY_BLOCK_SLOTS; k++) {
+        samples[k].valid = false;
+    }
+    bool any = false;
+    history_cursor_t cursor;
+    history_sample_t sample;
+    history_series_begin(&series, series.count, &cursor);
+    while (history_series_next(&series, &cursor, &sample)) {
+        if (sample.slot >= from && sample.slot < to) {
+            samples[sample.slot - from] = sample;
+            any |= sample.valid;
+        }
+    }
+    
+    bool ok = true;
+    if (any) {
+        uint8_t payload[HISTORY_LOG_MAX_PAYLOAD];
+        uint16_t len = history_log_encode(samples, to - from, payload, sizeof(payload));
+        history_log_block_t block = {
+            .battery_pct = battery_pct,
+            .kind = HISTORY_LOG_KIND_SAMPLES,
+            .start_time = (unix_now / HISTORY_INTERVAL_S - (now_slot - from)) * HISTORY_INTERVAL_S,
+            .interval_s = HISTORY_INTERVAL_S,
+            .count = to - from,
+        };
+        memcpy(block.addr, addr, 6);
+        xSemaphoreTake(history_log_lock, portMAX_DELAY);
+        ok = (len > 0) && history_log_append(&history_log, &block, payload, len);
+        xSemaphoreGive(history_log_lock);
+        if (!ok) {
+            ESP_LOGW(TAG, "History log: write failed for %02X:%02X:%02X:%02X:%02X:%02X",
+                     addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
+        }
+    }
+    
+    // Advance even on failure so one bad block can't stall the series
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+    if (e->in_use && memcmp(e->addr, addr, 6) == 0) {
+        e->flushed_slot = to;
+    }
+    xSemaphoreGive(history_lock);
+    return true;
+}
+
+// Write closed 15-min rollup buckets of a history entry to flash, once at
+// least HISTORY_ROLLUP_FLUSH_BUCKETS are pending. Hour buckets are not stored:
+// reads rebuild them from the quarters. Returns true if buckets were consumed.
+static bool history_flush_rollups(int i, uint32_t uptime_now, uint32_t unix_now) {
+    history_entry_t *e = &history_entries[i];
+    rollup_bucket_t buckets[HISTORY_LOG_MAX_PAYLOAD / sizeof(rollup_bucket_t)];
+    uint8_t addr[6];
+    uint8_t battery_pct;
+    uint32_t from = 0;
+    int n = 0;
+    
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+    const rollup_ring_t *ring = &e->rollups[0];
+    if (e->in_use && ring->count > 0 && ring->last_start >= e->rollup_flushed) {
+        uint32_t oldest = ring->last_start - (ring->count - 1) * ring->interval;
+        from = (e->rollup_flushed > oldest) ? e->rollup_flushed : oldest;
+        uint32_t pending = (ring->last_start - from) / ring->interval + 1;
+        if (pending >= HISTORY_ROLLUP_FLUSH_BUCKETS) {
+            n = (pending < sizeof(buckets) / sizeof(buckets[0])) ? pending : sizeof(buckets) / sizeof(buckets[0]);
+            for (int k = 0; k < n; k++) {
+                uint32_t start;
+                buckets[k] = *rollup_ring_get(ring, (ring->last_start - from) / ring->interval - k, &start);
+            }
+            memcpy(addr, e->addr, 6);
+            battery_pct = e->battery_pct;
+        }
+    }
+    xSemaphoreGive(history_lock);
+    if (n == 0) {
+        return false;
+    }
+    
+    bool any = false;
+    for (int k = 0; k < n; k++) {
+        any |= buckets[k].count > 0;
+    }
+    if (any) {
+        history_log_block_t block = {
+            .battery_pct = battery_pct,
+            .kind = HISTORY_LOG_KIND_ROLLUP,
+            .start_time = from + (unix_now - uptime_now),
+            .interval_s = rollup_tier_seconds[1],
+            .count = n,
+        };
+        memcpy(block.addr, addr, 6);
+        xSemaphoreTake(history_log_lock, portMAX_DELAY);
+        bool ok = history_log_append(&history_log, &block, (const uint8_t *)buckets, n * sizeof(rollup_bucket_t));
+        xSemaphoreGive(history_log_lock);
+        if (!ok) {
+            ESP_LOGW(TAG, "History log: rollup write failed for %02X:%02X:%02X:%02X:%02X:%02X",
+                     addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
+        }
+    }
+    
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+    if (e->in_use && memcmp(e->addr, addr, 6) == 0) {
+        e->rollup_flushed = from + n * rollup_tier_seconds[1];
+    }
+    xSemaphoreGive(history_lock);
+    return true;
+}
+
+// Periodically move completed blocks of RAM history to flash. Needs the wall
+// clock: until SNTP has synced, RAM keeps up to HISTORY_SLOTS of backlog.
+static void history_log_task(void *param) {
+    history_delta_t *slots_copy = malloc(HISTORY_SLOTS * sizeof(history_delta_t));
+    if (!slots_copy) {
+        ESP_LOGE(TAG, "History log: out of memory, flushing disabled");
+        vTaskDelete(NULL);
+        return;
+    }
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(HISTORY_FLUSH_CHECK_MS));
+        if (!clock_valid()) {
+            continue;
+        }
+        uint32_t uptime_now = history_uptime_s();
+        uint32_t now_slot = uptime_now / HISTORY_INTERVAL_S;
+        uint32_t unix_now = (uint32_t)time(NULL);
+        int written = 0;
+        for (int i = 0; i < HISTORY_MAX_SERIES; i++) {
+            // Catch up a backlog block by block
+            while (history_flush_entry(i, slots_copy, now_slot, unix_now)) {
+                written++;
+            }
+            while (history_flush_rollups(i, uptime_now, unix_now)) {
+                written++;
+            }
+        }
+        if (written > 0) {
+            ESP_LOGI(TAG, "History log: %d blocks written (%lu total)",
+                     written, (unsigned long)history_log.blocks);
+        }
+    }
+}
+
+// Mount the history partition and start the flush task
+static bool history_log_init(void) {
+    history_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                 (esp_partition_subtype_t)HISTORY_PARTITION_SUBTYPE,
+                                                 HISTORY_PARTITION_LABEL);
+    if (!history_partition) {
+        ESP_LOGW(TAG, "No '%s' partition, history is kept in RAM only", HISTORY_PARTITION_LABEL);
+        return false;
+    }
+    uint16_t sectors = history_partition->size / HISTORY_LOG_SECTOR_SIZE;
+    history_log_index = calloc(sectors, sizeof(history_log_sector_t));
+    history_log_lock = xSemaphoreCreateMutex();
+    if (!history_log_index || !history_log_lock) {
+        ESP_LOGE(TAG, "History log: out of memory");
+        return false;
+    }
+    history_log_flash_t flash = {
+        .ctx = NULL,
+        .read = history_flash_read,
+        .write = history_flash_write,
+        .erase_sector = history_flash_erase,
+    };
+    if (!history_log_mount(&history_log, &flash, history_log_index, sectors)) {
+        ESP_LOGE(TAG, "History log: mount failed");
+        return false;
+    }
+    history_log_ready = true;
+    xTaskCreate(history_log_task, "history_log", 5120, NULL, 3, NULL);
+    ESP_LOGI(TAG, "History log: %u KB, %lu blocks, oldest %lu",
+             (unsigned)(history_partition->size / 1024), (unsigned long)history_log.blocks,
+             (unsigned long)history_log_oldest(&history_log));
+    return true;
+}
+
+// ============================================
+// REPORTING POLICY (which readings are uploaded)
+// ============================================
+
+// Upload record for a device's current values
+static void uplink_reading_from_device(const ble_device_t *dev, uint32_t time, uplink_reading_t *r) {
+    *r = (uplink_reading_t){
+        .time = time,
+        .fields = dev->field_mask & (FIELD_TEMP | FIELD_HUM | FIELD_BAT | FIELD_RSSI),
+        .rssi = dev->rssi,
+        .temp_centi = (int16_t)lroundf(dev->temperature * 100.0f),
+        .battery_mv = dev->battery_mv,
+        .humidity = dev->humidity,
+        .battery_pct = dev->battery_pct,
+    };
+    memcpy(r->addr, dev->addr, 6);
+}
+
+// Queue a new sensor reading for upload if the policy says it is worth
+// sending. Runs in ingest_task with device_lock held.
+static void report_evaluate(ble_device_t *dev) {
+    if (!dev->visible || (!aio_enabled && !d1_enabled) || !report_queue) {
+        return;
+    }
+    report_policy_t policy = report_policy_for_device(&report_policy, dev->report_temp_db, dev->report_hum_db);
+    int16_t temp_centi = (int16_t)lroundf(dev->temperature * 100.0f);
+    uint32_t now = history_uptime_s() + 1;  // 0 means "never reported"
+    report_reason_t reason = report_policy_evaluate(&policy, &dev->report, now, temp_centi,
+                                                    dev->humidity, dev->battery_pct);
+    if (reason == REPORT_NONE) {
+        return;
+    }
+    
+    uplink_reading_t r;
+    uplink_reading_from_device(dev, clock_valid() ? (uint32_t)time(NULL) : 0, &r);
+    if (xQueueSend(report_queue, &r, 0) != pdTRUE) {
+        // Uplink task is busy; the next reading is evaluated again
+        report_deferred++;
+        return;
+    }
+    report_policy_commit(&dev->report, now, temp_centi, dev->humidity, dev->battery_pct);
+    report_counts[reason]++;
+    ESP_LOGD(TAG, "Report %02X:%02X:%02X:%02X:%02X:%02X (%s)", dev->addr[0], dev->addr[1],
+             dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5], report_reason_str(reason));
+    if (uplink_task_handle) {
+        xTaskNotifyGive(uplink_task_handle);
+    }
+}
+
+// Publish an advertisement to delta sync: real changes (sensor data, name,
+// receiver) right away, RSSI and last-seen only every DEVICE_SYNC_REFRESH_MS
+static void device_sync_seen(ble_device_t *dev, bool changed, uint32_t now_ms) {
+    if (changed || now_ms - dev->version_ms >= DEVICE_SYNC_REFRESH_MS) {
+        device_touch(dev);
+    }
+}
+
+// Single ingest stage for one advertisement, shared by the local scanner and
+// satellites. Runs in ingest_task with device_lock held. settings is the
+// prefetched NVS state if the device is new (NULL otherwise). Returns the
+// device index or -1.
+static int ble_ingest_adv(const adv_ring_entry_t *adv, const device_settings_t *settings) {
+    const uint8_t *addr = adv->addr;
+    bool local = (adv->source_id == SOURCE_ID_LOCAL);
+    if (local) {
+        ble_adv_count++;
+    } else {
+        sat_adv_count++;
+        taskENTER_CRITICAL(&satellite_lock);
+        sat_registry_observed(&satellites, adv->source_id - SOURCE_ID_SAT_FIRST, adv->timestamp_ms);
+        taskEXIT_CRITICAL(&satellite_lock);
+    }
+    
+    ESP_LOGD(TAG, "ADV %02X:%02X:%02X:%02X:%02X:%02X, RSSI: %d dBm, len: %d, from: %u",
+             addr[0], addr[1], addr[2], addr[3], addr[4], addr[5], adv->rssi, adv->len,
+             adv->source_id);
+    
+    // Discovery mode: add new + update all
+    // Monitoring mode: update only known devices
+    int idx = find_or_add_device(addr, allow_new_devices, adv->source_id, settings);
+    if (idx < 0) {
+        return -1;
+    }
+    ble_device_t *dev = &devices[idx];
+    
+    // Always update RSSI and timestamp. The receiver shown is the one with
+    // the best recent RSSI, not whichever packet arrived last.
+    uint8_t source_id = rx_set_observe(&dev->receivers, adv->source_id, adv->rssi, adv->timestamp_ms,
+                                       RX_STALE_MS, RX_HYSTERESIS_DB);
+    bool changed = (dev->source_id != source_id);
+    if (changed && !master_ble_enabled && source_id == SOURCE_ID_LOCAL) {
+        device_list_shrunk();  // Now filtered out of /api/devices
+    }
+    dev->rssi = rx_set_best_rssi(&dev->receivers);
+    dev->last_seen = adv->timestamp_ms;
+    dev->source_id = source_id;
+    
+    // If the device is hidden and discovery mode is off, don't update adv name/sensor data
+    if (!allow_new_devices && !dev->visible) {
+        device_sync_seen(dev, changed, adv->timestamp_ms);
+        return idx;
+    }
+    
+    // One zero-copy pass over the raw AD structures. Start from the current
+    // values: formats like MiBeacon send one measurement per packet and must
+    // not reset the others.
+    ble_adv_view_t view;
+    ble_sensor_data_t sensor_data = {
+        .temperature = dev->temperature,
+        .humidity = dev->humidity,
+        .battery_pct = dev->battery_pct,
+        .battery_mv = dev->battery_mv,
+    };
+    bool has_sensor = ble_parse_sensor_data(adv->data, adv->len, &view, &sensor_data);
+    
+    if (view.name != NULL) {
+        changed |= apply_adv_name(dev, view.name, view.name_len);
+    }
+    
+    if (has_sensor) {
+        if (local) {
+            ble_sensor_count++;
+        } else {
+            sat_sensor_count++;
+            taskENTER_CRITICAL(&satellite_lock);
+            sat_registry_sensor(&satellites, adv->source_id - SOURCE_ID_SAT_FIRST);
+            taskEXIT_CRITICAL(&satellite_lock);
+        }
+    }
+    
+    // A measurement heard by several receivers, or repeated by the sensor,
+    // carries the same packet counter: apply (history, upload) it only once
+    if (has_sensor && sensor_data.has_packet_id && dev->has_packet_id &&
+        sensor_data.packet_id == dev->packet_id &&
+        (int32_t)(adv->timestamp_ms - dev->last_sensor_seen) < SENSOR_DEDUP_WINDOW_MS) {
+        sensor_dup_count++;
+        has_sensor = false;
+    }
+    
+    if (has_sensor) {
+        dev->has_packet_id = sensor_data.has_packet_id;
+        dev->packet_id = sensor_data.packet_id;
+        dev->temperature = sensor_data.temperature;
+        dev->humidity = sensor_data.humidity;
+        dev->battery_pct = sensor_data.battery_pct;
+        dev->battery_mv = sensor_data.battery_mv;
+        dev->firmware_id = intern_string(sensor_data.device_type);
+        dev->has_sensor_data = true;
+        dev->last_sensor_seen = adv->timestamp_ms;
+        history_record(dev);
+        report_evaluate(dev);
+        changed = true;
+    }
+    device_sync_seen(dev, changed, adv->timestamp_ms);
+    return idx;
+}
+
+// Copy one observation into a producer's ring. Never blocks: if the ring is
+// full the packet is dropped and counted.
+static bool ingest_enqueue(adv_ring_t *ring, const uint8_t *addr, int8_t rssi, uint8_t source_id,
+                           uint32_t age_ms, const uint8_t *data, uint8_t len) {
+    adv_ring_entry_t *slot = adv_ring_reserve(ring);
+    if (!slot) {
+        return false;
+    }
+    slot->timestamp_ms = xTaskGetTickCount() * portTICK_PERIOD_MS - age_ms;
+    memcpy(slot->addr, addr, 6);
+    slot->rssi = rssi;
+    slot->source_id = source_id;
+    slot->len = (len > ADV_RING_DATA_MAX) ? ADV_RING_DATA_MAX : len;
+    memcpy(slot->data, data, slot->len);
+    adv_ring_commit(ring);
+    if (ingest_task_handle) {
+        xTaskNotifyGive(ingest_task_handle);
+    }
+    return true;
+}
+
+// A satellite slot went to another address: drop the old satellite from
+// the receiver sets and the UDP peers, so none of its state is credited to
+// the new one. The slot was idle for SAT_SLOT_REUSE_MS, so no observation
+// of the old satellite is still queued.
+static void satellite_forget(uint8_t source_id, uint32_t new_ip) {
+    device_write_begin();
+    for (int i = 0; i < device_count; i++) {
+        ble_device_t *dev = &devices[i];
+        uint8_t chosen = rx_set_forget(&dev->receivers, source_id);
+        if (dev->source_id == source_id) {
+            if (!master_ble_enabled && (chosen == RX_SOURCE_NONE || chosen == SOURCE_ID_LOCAL)) {
+                device_list_shrunk();  // Now filtered out of /api/devices
             }
+            dev->source_id = chosen;
+            dev->rssi = rx_set_best_rssi(&dev->receivers);
+            device_touch(dev);
+        }
+    }
+    device_write_end();
+    
+    taskENTER_CRITICAL(&sat_udp_lock);
+    for (int i = 0; i < SAT_UDP_MAX_PEERS; i++) {
+        if (sat_udp_peers[i].source_id == source_id && sat_udp_peers[i].ip != new_ip) {
+            sat_udp_peers[i].source_id = RX_SOURCE_NONE;
+        }
+    }
+    taskEXIT_CRITICAL(&sat_udp_lock);
+}
+
+// Source id of a registered satellite, RX_SOURCE_NONE if ip has no slot
+static uint8_t satellite_find(uint32_t ip) {
+    taskENTER_CRITICAL(&satellite_lock);
+    int slot = sat_registry_find(&satellites, ip);
+    taskEXIT_CRITICAL(&satellite_lock);
+    return satellite_source_id(slot);
+}
+
+// Source id of a satellite whose upload or datagram was accepted, claiming
+// a slot for a new address. RX_SOURCE_NONE if every slot is in recent use.
+static uint8_t satellite_claim(uint32_t ip) {
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    bool reused;
+    taskENTER_CRITICAL(&satellite_lock);
+    int slot = sat_registry_claim(&satellites, ip, now_ms, &reused);
+    taskEXIT_CRITICAL(&satellite_lock);
+    if (slot < 0) {
+        ESP_LOGD(TAG, "Satellite registry full, upload not accepted");
+        return RX_SOURCE_NONE;
+    }
+    if (reused) {
+        ESP_LOGI(TAG, "Satellite registry slot %d reused", slot);
+        satellite_forget(satellite_source_id(slot), ip);
+    }
+    return satellite_source_id(slot);
+}
+
+// Add to the parse failures of a registered satellite (others are not tracked)
+static void satellite_count_failures(uint32_t ip, uint32_t n) {
+    taskENTER_CRITICAL(&satellite_lock);
+    int slot = sat_registry_find(&satellites, ip);
+    if (slot >= 0) {
+        satellites.slots[slot].parse_failures += n;
+    }
+    taskEXIT_CRITICAL(&satellite_lock);
+}
+
+// Satellite records (HTTP batch or UDP datagram) go straight into a ring.
+// The sender's registry slot is claimed with the first valid record.
+typedef struct {
+    adv_ring_t *ring;
+    uint32_t ip;
+    uint8_t source_id;  // RX_SOURCE_NONE until claimed
+    uint32_t accepted;
+    uint32_t dropped;
+} sat_frame_ingest_t;
+
+static void sat_frame_ingest_record(void *ctx, const sat_record_t *rec) {
+    sat_frame_ingest_t *in = ctx;
+    if (in->source_id == RX_SOURCE_NONE) {
+        in->source_id = satellite_claim(in->ip);
+    }
+    if (in->source_id != RX_SOURCE_NONE &&
+        ingest_enqueue(in->ring, rec->mac, rec->rssi, in->source_id, rec->age_ms, rec->ad, rec->ad_len)) {
+        in->accepted++;
+    } else {
+        in->dropped++;
+    }
+}
+
+// Drain up to INGEST_BATCH_MAX entries from a ring in one write section.
+// Returns the number processed.
+static int ingest_drain(adv_ring_t *ring) {
+    int n = 0;
+    const adv_ring_entry_t *adv;
+    device_write_begin();
+    while (n < INGEST_BATCH_MAX && (adv = adv_ring_peek(ring)) != NULL) {
+        if (allow_new_devices && device_registry_find(&device_index, adv->addr) < 0) {
+            // New device (cold path): close the section while NVS is read so
+            // readers and other writers don't wait on flash
+            device_write_end();
+            device_settings_t settings;
+            device_settings_load(adv->addr, &settings);
+            device_write_begin();
+            ble_ingest_adv(adv, &settings);
+        } else {
+            ble_ingest_adv(adv, NULL);
+        }
+        adv_ring_release(ring);
+        n++;
+    }
+    device_write_end();
+    return n;
+}
+
+// Single writer for scan results: applies queued observations in batches so
+// the BLE host task and the web server never wait on devices[] or NVS.
+static void ingest_task(void *param) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(INGEST_IDLE_WAIT_MS));
+        int n;
+        do {
+            // One write section per ring batch, not one for all three
+            n = ingest_drain(&local_adv_ring);
+            n += ingest_drain(&sat_adv_ring);
+            n += ingest_drain(&udp_adv_ring);
+        } while (n > 0);
+    }
+}
+
+// Allocate the ingest rings and start the ingest task
+static bool ingest_init(void) {
+    adv_ring_entry_t *local_entries = heap_caps_calloc_prefer(LOCAL_ADV_RING_SIZE, sizeof(adv_ring_entry_t), 2,
+                                                              MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+    adv_ring_entry_t *sat_entries = heap_caps_calloc_prefer(SAT_ADV_RING_SIZE, sizeof(adv_ring_entry_t), 2,
+                                                            MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+    adv_ring_entry_t *udp_entries = heap_caps_calloc_prefer(SAT_UDP_RING_SIZE, sizeof(adv_ring_entry_t), 2,
+                                                            MALLOC_CAP_SPIRAM, MALLOC_CAP_8BIT);
+    if (!local_entries || !sat_entries || !udp_entries) {
+        ESP_LOGE(TAG, "Failed to allocate ingest rings");
+        return false;
+    }
+    adv_ring_init(&local_adv_ring, local_entries, LOCAL_ADV_RING_SIZE);
+    adv_ring_init(&sat_adv_ring, sat_entries, SAT_ADV_RING_SIZE);
+    adv_ring_init(&udp_adv_ring, udp_entries, SAT_UDP_RING_SIZE);
+    
+    if (xTaskCreate(ingest_task, "ble_ingest", 4096, NULL, 5, &ingest_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start ingest task");
+        return false;
+    }
+    ESP_LOGI(TAG, "Ingest rings: local %d, satellite %d, UDP %d entries (%u bytes)",
+             LOCAL_ADV_RING_SIZE, SAT_ADV_RING_SIZE, SAT_UDP_RING_SIZE,
+             (unsigned)((LOCAL_ADV_RING_SIZE + SAT_ADV_RING_SIZE + SAT_UDP_RING_SIZE) * sizeof(adv_ring_entry_t)));
+    return true;
+}
+
+static int ble_gap_event(struct ble_gap_event *event, void *arg) {
+    if (event->type == BLE_GAP_EVENT_DISC) {
+        // Check if master BLE is enabled
+        if (!master_ble_enabled) {
+            return 0;  // Skip local BLE observations
         }
+        
+        // Only copy the packet here; ingest_task does the parsing
+        ingest_enqueue(&local_adv_ring, event->disc.addr.val, event->disc.rssi, SOURCE_ID_LOCAL, 0,
+                       event->disc.data, event->disc.length_data);
     }
     return 0;
 }
@@ -497,11 +1884,17 @@ static void ble_rate_timer_callback(void* arg) {
     last_ble_sensor = sensor;
     last_sat_adv = sat_adv;
     last_sat_sensor = sat_sensor;
-
+    
     float interval_s = BLE_RATE_INTERVAL_MS / 1000.0f;
-    ESP_LOGI(TAG, "BLE rate: adv=%.1f/s sensor=%.1f/s | sat adv=%.1f/s sensor=%.1f/s",
+    taskENTER_CRITICAL(&satellite_lock);
+    sat_registry_update_rates(&satellites, interval_s);
+    taskEXIT_CRITICAL(&satellite_lock);
+
+    ESP_LOGI(TAG, "BLE rate: adv=%.1f/s sensor=%.1f/s | sat adv=%.1f/s sensor=%.1f/s | dropped %lu/%lu, peak %lu/%lu",
              d_adv / interval_s, d_sensor / interval_s,
-             d_sat_adv / interval_s, d_sat_sensor / interval_s);
+             d_sat_adv / interval_s, d_sat_sensor / interval_s,
+             (unsigned long)atomic_load(&local_adv_ring.dropped), (unsigned long)atomic_load(&sat_adv_ring.dropped),
+             (unsigned long)atomic_load(&local_adv_ring.high_water), (unsigned long)atomic_load(&sat_adv_ring.high_water));
 }
 
 // BLE stack ready, start continuous scan
@@ -550,6 +1943,11 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
         ESP_LOGI(WIFI_TAG, "✓ Connected! IP address: " IPSTR, IP2STR(&event->ip_info.ip));
         ESP_LOGI(WIFI_TAG, "Open in browser: http://" IPSTR, IP2STR(&event->ip_info.ip));
         ESP_LOGI(WIFI_TAG, "Discovery broadcast ready (port %d, every 5 s)", DISCOVERY_PORT);
+        // Wall clock for the flash history log
+        if (!sntp_started) {
+            esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
+            sntp_started = (esp_netif_sntp_init(&sntp_config) == ESP_OK);
+        }
 #if HAVE_MDNS
         ESP_LOGI(WIFI_TAG, "mDNS available (HAVE_MDNS=1)");
         if (!mdns_started) {
@@ -575,6 +1973,15 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
     }
 }
 
+// UDP ingest is on and has a key. Snapshot under sat_udp_lock, since
+// the settings handler changes both.
+static bool sat_udp_listening(void) {
+    taskENTER_CRITICAL(&sat_udp_lock);
+    bool listening = sat_udp_enabled && sat_udp_key_len > 0;
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    return listening;
+}
+
 static void discovery_broadcast_task(void *param) {
     int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
     if (sock < 0) {
@@ -595,7 +2002,12 @@ static void discovery_broadcast_task(void *param) {
     while (1) {
         if (wifi_connected && master_ip[0] != '\0') {
             char msg[64];
-            snprintf(msg, sizeof(msg), "SATMASTER %s 80", master_ip);
+            // Satellites that speak UDP learn the port from the fourth field
+            if (sat_udp_listening()) {
+                snprintf(msg, sizeof(msg), "SATMASTER %s 80 %d", master_ip, SAT_UDP_PORT);
+            } else {
+                snprintf(msg, sizeof(msg), "SATMASTER %s 80", master_ip);
+            }
             int err = sendto(sock, msg, strlen(msg), 0, (struct sockaddr *)&dest, sizeof(dest));
             if (err < 0) {
                 ESP_LOGW(WIFI_TAG, "Discovery broadcast failed");
@@ -610,51 +2022,348 @@ static void discovery_broadcast_task(void *param) {
     }
 }
 
-// WiFi NVS -funktiot
-static bool load_wifi_config(void) {
-    nvs_handle_t nvs;
-    if (nvs_open(NVS_WIFI_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
-        ESP_LOGW(WIFI_TAG, "WiFi settings not found in NVS");
+// ============================================
+// SATELLITE UDP INGEST (sat_udp.h datagrams)
+// ============================================
+
+// Check a datagram's tag against the shared key (constant-time compare)
+static bool sat_udp_tag_ok(const uint8_t *data, const sat_udp_datagram_t *dg) {
+    uint8_t key[SAT_UDP_KEY_MAX];
+    size_t key_len;
+    taskENTER_CRITICAL(&sat_udp_lock);
+    key_len = sat_udp_key_len;
+    memcpy(key, sat_udp_key, key_len);
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    
+    uint8_t mac[32];
+    if (key_len == 0 ||
+        mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key, key_len,
+                        data, dg->signed_len, mac) != 0) {
         return false;
     }
-    
-    size_t ssid_len = sizeof(wifi_ssid);
-    size_t pass_len = sizeof(wifi_password);
-    
-    esp_err_t err_ssid = nvs_get_str(nvs, "ssid", wifi_ssid, &ssid_len);
-    esp_err_t err_pass = nvs_get_str(nvs, "password", wifi_password, &pass_len);
-    
-    nvs_close(nvs);
-    
-    if (err_ssid == ESP_OK && err_pass == ESP_OK && strlen(wifi_ssid) > 0) {
-        ESP_LOGI(WIFI_TAG, "WiFi-asetukset ladattu: %s", wifi_ssid);
-        return true;
+    uint8_t diff = 0;
+    for (int i = 0; i < SAT_UDP_TAG_LEN; i++) {
+        diff |= mac[i] ^ dg->tag[i];
     }
-    
-    return false;
+    return diff == 0;
 }
 
-static void load_ap_password(void) {
-    nvs_handle_t nvs;
-    if (nvs_open(NVS_WIFI_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
-        ESP_LOGI(WIFI_TAG, "AP password not set, using default: temperature");
-        strcpy(ap_password, "temperature");
-        return;
-    }
-    
-    size_t pass_len = sizeof(ap_password);
-    esp_err_t err = nvs_get_str(nvs, "ap_password", ap_password, &pass_len);
-    nvs_close(nvs);
-    
-    if (err != ESP_OK || strlen(ap_password) < 8) {
-        ESP_LOGI(WIFI_TAG, "AP password invalid or too short, using default");
-        strcpy(ap_password, "temperature");
-    } else {
-        ESP_LOGI(WIFI_TAG, "AP password loaded from NVS");
+// Peer slot of a satellite, or NULL. Call with sat_udp_lock held.
+static sat_udp_peer_t *sat_udp_peer_find(uint32_t sat_id) {
+    for (int i = 0; i < SAT_UDP_MAX_PEERS; i++) {
+        if (sat_udp_peers[i].ip != 0 && sat_udp_peers[i].sat_id == sat_id) {
+            return &sat_udp_peers[i];
+        }
     }
+    return NULL;
 }
 
-static void save_ap_password(const char* password) {
+// New peer slot, taking over the least recently seen one. Call with
+// sat_udp_lock held.
+static sat_udp_peer_t *sat_udp_peer_add(uint32_t sat_id, uint32_t epoch) {
+    sat_udp_peer_t *slot = &sat_udp_peers[0];
+    for (int i = 0; i < SAT_UDP_MAX_PEERS; i++) {
+        sat_udp_peer_t *p = &sat_udp_peers[i];
+        if (slot->ip != 0 && (p->ip == 0 || p->last_seen_ms < slot->last_seen_ms)) {
+            slot = p;
+        }
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->sat_id = sat_id;
+    sat_seq_init(&slot->seq, epoch);
+    return slot;
+}
+
+// Newest epoch accepted from a satellite, kept across hub reboots so a
+// replayed datagram of an earlier satellite boot stays rejected. 0 if none.
+static uint32_t sat_udp_epoch_load(uint32_t sat_id) {
+    uint32_t epoch = 0;
+    char key[9];
+    snprintf(key, sizeof(key), "%08lx", (unsigned long)sat_id);
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_SAT_EPOCH_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        nvs_get_u32(nvs, key, &epoch);
+        nvs_close(nvs);
+    }
+    return epoch;
+}
+
+// Written once per satellite boot (first datagram of a newer epoch)
+static void sat_udp_epoch_save(uint32_t sat_id, uint32_t epoch) {
+    char key[9];
+    snprintf(key, sizeof(key), "%08lx", (unsigned long)sat_id);
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_SAT_EPOCH_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_set_u32(nvs, key, epoch);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+}
+
+// One received datagram: authenticate, sequence, queue its records
+static void sat_udp_handle(const uint8_t *data, size_t len, struct in_addr from) {
+    sat_udp_datagram_t dg;
+    if (!sat_udp_parse(data, len, &dg)) {
+        taskENTER_CRITICAL(&sat_udp_lock);
+        sat_udp_malformed++;
+        taskEXIT_CRITICAL(&sat_udp_lock);
+        return;
+    }
+    if (!sat_udp_tag_ok(data, &dg)) {
+        taskENTER_CRITICAL(&sat_udp_lock);
+        sat_udp_bad_tag++;
+        taskEXIT_CRITICAL(&sat_udp_lock);
+        return;
+    }
+    
+    char ip[16];
+    inet_ntoa_r(from, ip, sizeof(ip));
+    
+    // Datagrams of an older epoch than the stored one are replays. A peer
+    // new to the table starts from its stored epoch (NVS read outside the
+    // lock; this task is the only one adding peers). After a hub reboot
+    // the seq window of the current epoch starts empty, so a datagram of
+    // that epoch captured before the reboot can still be replayed once.
+    taskENTER_CRITICAL(&sat_udp_lock);
+    bool known = (sat_udp_peer_find(dg.sat_id) != NULL);
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    uint32_t stored_epoch = known ? 0 : sat_udp_epoch_load(dg.sat_id);
+    
+    taskENTER_CRITICAL(&sat_udp_lock);
+    sat_udp_peer_t *peer = sat_udp_peer_find(dg.sat_id);
+    if (!peer) {
+        peer = sat_udp_peer_add(dg.sat_id, stored_epoch);
+    }
+    peer->ip = from.s_addr;
+    peer->last_seen_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    sat_seq_result_t result = sat_seq_accept(&peer->seq, dg.epoch, dg.seq);
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    if (result == SAT_SEQ_DUPLICATE || result == SAT_SEQ_STALE) {
+        return;
+    }
+    if (result == SAT_SEQ_NEW_EPOCH) {
+        sat_udp_epoch_save(dg.sat_id, dg.epoch);
+    }
+    
+    // Accepted: now the sender gets (or keeps) its registry slot
+    uint8_t source_id = satellite_claim(from.s_addr);
+    taskENTER_CRITICAL(&sat_udp_lock);
+    if (peer->sat_id == dg.sat_id) {
+        peer->source_id = source_id;
+    }
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    if (source_id == RX_SOURCE_NONE) {
+        return;
+    }
+    
+    sat_frame_ingest_t in = { .ring = &udp_adv_ring, .ip = from.s_addr, .source_id = source_id };
+    sat_frame_decoder_t dec;
+    sat_frame_decoder_init_records(&dec);
+    sat_frame_decode(&dec, dg.records, dg.records_len, sat_frame_ingest_record, &in);
+    sat_frame_status_t status = sat_frame_decoder_finish(&dec);
+    
+    taskENTER_CRITICAL(&sat_udp_lock);
+    if (peer->sat_id == dg.sat_id && peer->ip != 0) {  // Not taken over meanwhile
+        peer->records += in.accepted;
+        peer->dropped += in.dropped;
+    }
+    if (status != SAT_FRAME_OK) {
+        sat_udp_malformed++;
+    }
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    if (status != SAT_FRAME_OK) {
+        satellite_count_failures(from.s_addr, 1);
+        ESP_LOGD(TAG, "UDP datagram from %s: %s", ip, sat_frame_status_str(status));
+    }
+}
+
+// Receives satellite datagrams while UDP ingest is enabled and a key is set
+static void sat_udp_task(void *param) {
+    static uint8_t buf[SAT_UDP_MAX_DATAGRAM];  // Static: keeps the task stack small
+    int sock = -1;
+    
+    while (1) {
+        if (!sat_udp_listening()) {
+            if (sock >= 0) {
+                close(sock);
+                sock = -1;
+                ESP_LOGI(WIFI_TAG, "UDP satellite ingest stopped");
+            }
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+        
+        if (sock < 0) {
+            sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+            struct sockaddr_in addr = {
+                .sin_family = AF_INET,
+                .sin_port = htons(SAT_UDP_PORT),
+                .sin_addr.s_addr = htonl(INADDR_ANY),
+            };
+            if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+                ESP_LOGE(WIFI_TAG, "UDP satellite socket failed (port %d)", SAT_UDP_PORT);
+                if (sock >= 0) {
+                    close(sock);
+                    sock = -1;
+                }
+                vTaskDelay(pdMS_TO_TICKS(5000));
+                continue;
+            }
+            // Wake up once a second to notice when ingest is turned off
+            struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            ESP_LOGI(WIFI_TAG, "UDP satellite ingest listening on port %d", SAT_UDP_PORT);
+        }
+        
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+        if (len > 0) {
+            sat_udp_handle(buf, len, from.sin_addr);
+        }
+    }
+}
+
+// Set the enable flag and, if key is not NULL, the shared key ("" clears
+// it); both are saved to NVS. Returns false if the key is too long.
+static bool sat_udp_configure(bool enabled, const char *key) {
+    size_t key_len = key ? strlen(key) : 0;
+    if (key_len > SAT_UDP_KEY_MAX) {
+        return false;
+    }
+    taskENTER_CRITICAL(&sat_udp_lock);
+    if (key) {
+        memcpy(sat_udp_key, key, key_len);
+        sat_udp_key_len = key_len;
+    }
+    sat_udp_enabled = enabled;
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_SAT_UDP_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_set_u8(nvs, "enabled", enabled ? 1 : 0);
+        if (key) {
+            nvs_set_str(nvs, "key", key);
+        }
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    return true;
+}
+
+// Load the enable flag and key saved by sat_udp_configure
+static void sat_udp_load_config(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_SAT_UDP_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    uint8_t enabled = 0;
+    char key[SAT_UDP_KEY_MAX + 1];
+    size_t key_size = sizeof(key);
+    if (nvs_get_str(nvs, "key", key, &key_size) == ESP_OK) {
+        sat_udp_key_len = strlen(key);
+        memcpy(sat_udp_key, key, sat_udp_key_len);
+    }
+    if (nvs_get_u8(nvs, "enabled", &enabled) == ESP_OK) {
+        sat_udp_enabled = (enabled != 0);
+    }
+    nvs_close(nvs);
+    if (sat_udp_enabled) {
+        ESP_LOGI(TAG, "📂 Loaded setting: UDP satellite ingest on port %d%s", SAT_UDP_PORT,
+                 sat_udp_key_len > 0 ? "" : " (no key set, not listening)");
+    }
+}
+
+// Diagnostics: "satelliteUdp" object
+static void sat_udp_stats_write(json_writer_t *w) {
+    sat_udp_peer_t peers[SAT_UDP_MAX_PEERS];
+    taskENTER_CRITICAL(&sat_udp_lock);
+    memcpy(peers, sat_udp_peers, sizeof(peers));
+    uint32_t bad_tag = sat_udp_bad_tag;
+    uint32_t malformed = sat_udp_malformed;
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    json_key(w, "satelliteUdp");
+    json_object_begin(w);
+    json_field_bool(w, "enabled", sat_udp_listening());
+    json_field_int(w, "port", SAT_UDP_PORT);
+    json_field_uint(w, "badTag", bad_tag);
+    json_field_uint(w, "malformed", malformed);
+    json_key(w, "peers");
+    json_array_begin(w);
+    for (int i = 0; i < SAT_UDP_MAX_PEERS; i++) {
+        const sat_udp_peer_t *p = &peers[i];
+        if (p->ip == 0) {
+            continue;
+        }
+        char ip[16];
+        struct in_addr addr = { .s_addr = p->ip };
+        inet_ntoa_r(addr, ip, sizeof(ip));
+        json_object_begin(w);
+        json_field_string(w, "ip", ip);
+        json_field_uint(w, "satId", p->sat_id);
+        json_field_uint(w, "epoch", p->seq.epoch);
+        json_field_uint(w, "lastSeenSec", (now_ms - p->last_seen_ms) / 1000);
+        json_field_uint(w, "received", p->seq.received);
+        json_field_uint(w, "lost", p->seq.lost);
+        json_field_uint(w, "reordered", p->seq.reordered);
+        json_field_uint(w, "duplicates", p->seq.duplicates);
+        json_field_uint(w, "stale", p->seq.stale);
+        json_field_uint(w, "restarts", p->seq.restarts);
+        json_field_uint(w, "records", p->records);
+        json_field_uint(w, "dropped", p->dropped);
+        json_object_end(w);
+    }
+    json_array_end(w);
+    json_object_end(w);
+}
+
+// WiFi NVS -funktiot
+static bool load_wifi_config(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_WIFI_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        ESP_LOGW(WIFI_TAG, "WiFi settings not found in NVS");
+        return false;
+    }
+    
+    size_t ssid_len = sizeof(wifi_ssid);
+    size_t pass_len = sizeof(wifi_password);
+    
+    esp_err_t err_ssid = nvs_get_str(nvs, "ssid", wifi_ssid, &ssid_len);
+    esp_err_t err_pass = nvs_get_str(nvs, "password", wifi_password, &pass_len);
+    
+    nvs_close(nvs);
+    
+    if (err_ssid == ESP_OK && err_pass == ESP_OK && strlen(wifi_ssid) > 0) {
+        ESP_LOGI(WIFI_TAG, "WiFi-asetukset ladattu: %s", wifi_ssid);
+        return true;
+    }
+    
+    return false;
+}
+
+static void load_ap_password(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_WIFI_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        ESP_LOGI(WIFI_TAG, "AP password not set, using default: temperature");
+        strcpy(ap_password, "temperature");
+        return;
+    }
+    
+    size_t pass_len = sizeof(ap_password);
+    esp_err_t err = nvs_get_str(nvs, "ap_password", ap_password, &pass_len);
+    nvs_close(nvs);
+    
+    if (err != ESP_OK || strlen(ap_password) < 8) {
+        ESP_LOGI(WIFI_TAG, "AP password invalid or too short, using default");
+        strcpy(ap_password, "temperature");
+    } else {
+        ESP_LOGI(WIFI_TAG, "AP password loaded from NVS");
+    }
+}
+
+static void save_ap_password(const char* password) {
     if (strlen(password) < 8 || strlen(password) > 63) {
         ESP_LOGE(WIFI_TAG, "AP password must be 8-63 characters");
         return;
@@ -889,235 +2598,134 @@ static void wifi_init(void) {
 }
 
 // ============================================
-// ADAFRUIT IO DATA UPLOAD
+// JSON RESPONSES (streamed as HTTP chunks)
 // ============================================
 
-// Send device data to Cloudflare D1
-static void send_device_to_d1(const ble_device_t *dev) {
-    if (!d1_enabled || !dev->has_sensor_data) return;
-    
-    // Build JSON payload with all device data
-    char *payload = malloc(1024);
-    if (!payload) {
-        ESP_LOGE(TAG, "Failed to allocate memory for D1 payload");
-        return;
-    }
-    
-    char mac_str[18];
-    snprintf(mac_str, sizeof(mac_str), "%02X:%02X:%02X:%02X:%02X:%02X",
-             dev->addr[0], dev->addr[1], dev->addr[2], 
-             dev->addr[3], dev->addr[4], dev->addr[5]);
-    
-    int len = snprintf(payload, 1024, 
-        "{\"mac\":\"%s\",\"name\":\"%s\",\"data\":{",
-        mac_str,
-        dev->name[0] ? dev->name : "Unknown");
-    
-    bool first = true;
-    if (dev->field_mask & FIELD_TEMP) {
-        len += snprintf(payload + len, 1024 - len, "%s\"temperature\":%.2f", first ? "" : ",", dev->temperature);
-        first = false;
-    }
-    if (dev->field_mask & FIELD_HUM) {
-        len += snprintf(payload + len, 1024 - len, "%s\"humidity\":%d", first ? "" : ",", dev->humidity);
-        first = false;
-    }
-    if (dev->field_mask & FIELD_BAT) {
-        len += snprintf(payload + len, 1024 - len, "%s\"battery_mv\":%d", first ? "" : ",", dev->battery_mv);
-        first = false;
-    }
-    if (dev->field_mask & FIELD_RSSI) {
-        len += snprintf(payload + len, 1024 - len, "%s\"rssi\":%d", first ? "" : ",", dev->rssi);
-    }
-    
-    snprintf(payload + len, 1024 - len, "}}");
-    
-    // Send to D1 worker
-    char url[300];
-    snprintf(url, sizeof(url), "%s/data", d1_worker_url);
-    
-    esp_http_client_config_t config = {
-        .url = url,
-        .method = HTTP_METHOD_POST,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .timeout_ms = 10000,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_header(client, "Authorization", d1_token);
-    esp_http_client_set_post_field(client, payload, strlen(payload));
-    
-    esp_err_t err = esp_http_client_perform(client);
-    int status = esp_http_client_get_status_code(client);
-    
-    if (err == ESP_OK && status == 200) {
-        ESP_LOGI(TAG, "D1: Sent data for %s", dev->name[0] ? dev->name : mac_str);
-    } else {
-        ESP_LOGW(TAG, "D1: Failed to send %s (HTTP %d)", dev->name[0] ? dev->name : mac_str, status);
-    }
-    
-    esp_http_client_cleanup(client);
-    free(payload);
+static bool json_httpd_flush(void *ctx, const char *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK;
 }
 
-static void send_device_to_aio(const ble_device_t *dev) {
-    if (!aio_enabled || !dev->has_sensor_data) return;
-    
-    char url[256];
-    char payload[256];
-    
-    // Feed key: MAC only (never changes even if device renamed)
-    char feed_key[20];
-    snprintf(feed_key, sizeof(feed_key), "%02x%02x%02x%02x%02x%02x",
-             dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
-    
-    // Send temperature
-        if ((dev->field_mask & FIELD_TEMP) && (aio_feed_types & FIELD_TEMP)) {
-        char feed_name[80];
-        snprintf(feed_name, sizeof(feed_name), "%s-temp", feed_key);
-        ESP_LOGI(AIO_TAG, "📤 Sending to feed: %s (URL: /api/v2/%s/feeds/%s/data)", feed_name, aio_username, feed_name);
-        snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/feeds/%s/data", aio_username, feed_name);
-        
-        // Add metadata: device name and MAC
-        if (strlen(dev->name) > 0) {
-            snprintf(payload, sizeof(payload), "{\"value\":\"%.2f\",\"feed_key\":\"%s\",\"metadata\":\"%s (%02X:%02X:%02X:%02X:%02X:%02X)\"}",
-                     dev->temperature, feed_name, dev->name,
-                     dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
-        } else {
-            snprintf(payload, sizeof(payload), "{\"value\":\"%.2f\",\"feed_key\":\"%s\",\"metadata\":\"MAC: %02X:%02X:%02X:%02X:%02X:%02X\"}",
-                     dev->temperature, feed_name,
-                     dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
-        }
-        
-        esp_http_client_config_t config = {
-            .url = url,
-            .method = HTTP_METHOD_POST,
-            .crt_bundle_attach = esp_crt_bundle_attach,
-        };
-        esp_http_client_handle_t client = esp_http_client_init(&config);
-        
-        esp_http_client_set_header(client, "Content-Type", "application/json");
-        esp_http_client_set_header(client, "X-AIO-Key", aio_key);
-        esp_http_client_set_post_field(client, payload, strlen(payload));
-        
-        esp_err_t err = esp_http_client_perform(client);
-        int status = esp_http_client_get_status_code(client);
-        if (err == ESP_OK && status == 200) {
-            ESP_LOGI(AIO_TAG, "Temp sent: %s = %.2f", feed_key, dev->temperature);
-        } else {
-            ESP_LOGE(AIO_TAG, "Temp failed: %s, HTTP %d", esp_err_to_name(err), status);
-        }
-        esp_http_client_cleanup(client);
-        vTaskDelay(pdMS_TO_TICKS(100)); // Small delay between requests
+// Start a chunked JSON response written through buf (the caller's stack
+// buffer, JSON_CHUNK_SIZE), so no response is ever built in the heap
+static void json_response_begin(json_writer_t *w, httpd_req_t *req, char *buf, size_t size) {
+    httpd_resp_set_type(req, "application/json");
+    json_writer_init(w, buf, size, json_httpd_flush, req);
+}
+
+static esp_err_t json_response_end(json_writer_t *w, httpd_req_t *req) {
+    bool ok = json_writer_finish(w);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+// {"ok":false,"error":...}
+static esp_err_t json_send_error(httpd_req_t *req, const char *error) {
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", false);
+    json_field_string(&w, "error", error);
+    json_object_end(&w);
+    return json_response_end(&w, req);
+}
+
+// ============================================
+// CLOUD CONNECTIONS (keep-alive, one per host)
+// ============================================
+
+static esp_err_t cloud_conn_event(esp_http_client_event_t *evt) {
+    cloud_conn_t *conn = (cloud_conn_t *)evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED && conn) {
+        conn->open_handshakes++;
     }
-    
-    // Send humidity
-    if ((dev->field_mask & FIELD_HUM) && (aio_feed_types & FIELD_HUM)) {
-        snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/feeds/%s-hum/data", aio_username, feed_key);
-        
-        if (strlen(dev->name) > 0) {
-            snprintf(payload, sizeof(payload), "{\"value\":\"%d\",\"metadata\":\"%s (%02X:%02X:%02X:%02X:%02X:%02X)\"}",
-                     dev->humidity, dev->name,
-                     dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
-        } else {
-            snprintf(payload, sizeof(payload), "{\"value\":\"%d\",\"metadata\":\"MAC: %02X:%02X:%02X:%02X:%02X:%02X\"}",
-                     dev->humidity,
-                     dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
-        }
-        
+    return ESP_OK;
+}
+
+// Point the host's client at url, creating it on first use. Headers set on
+// the returned handle persist across requests. Upload task only.
+static esp_http_client_handle_t cloud_conn_prepare(cloud_conn_t *conn, const char *url,
+                                                   esp_http_client_method_t method) {
+    if (!conn->client) {
         esp_http_client_config_t config = {
             .url = url,
-            .method = HTTP_METHOD_POST,
+            .method = method,
             .crt_bundle_attach = esp_crt_bundle_attach,
+            .timeout_ms = 10000,
+            .keep_alive_enable = true,
+            .event_handler = cloud_conn_event,
+            .user_data = conn,
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            .save_client_session = true,  // Resume TLS when the connection is reopened
+#endif
         };
-        esp_http_client_handle_t client = esp_http_client_init(&config);
-        
-        esp_http_client_set_header(client, "Content-Type", "application/json");
-        esp_http_client_set_header(client, "X-AIO-Key", aio_key);
-        esp_http_client_set_post_field(client, payload, strlen(payload));
-        
-        esp_err_t err = esp_http_client_perform(client);
-        int status = esp_http_client_get_status_code(client);
-        if (err == ESP_OK && status == 200) {
-            ESP_LOGI(AIO_TAG, "Hum sent: %s = %d", feed_key, dev->humidity);
-        } else {
-            ESP_LOGE(AIO_TAG, "Hum failed: %s, HTTP %d", esp_err_to_name(err), status);
-        }
-        esp_http_client_cleanup(client);
-        vTaskDelay(pdMS_TO_TICKS(100));
+        conn->client = esp_http_client_init(&config);
+        return conn->client;
     }
-    
-    // Send battery level
-    if ((dev->field_mask & FIELD_BAT) && (aio_feed_types & FIELD_BAT)) {
-        snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/feeds/%s-bat/data", aio_username, feed_key);
-        
-        if (strlen(dev->name) > 0) {
-            snprintf(payload, sizeof(payload), "{\"value\":\"%d\",\"metadata\":\"%s (%02X:%02X:%02X:%02X:%02X:%02X)\"}",
-                     dev->battery_pct, dev->name,
-                     dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
-        } else {
-            snprintf(payload, sizeof(payload), "{\"value\":\"%d\",\"metadata\":\"MAC: %02X:%02X:%02X:%02X:%02X:%02X\"}",
-                     dev->battery_pct,
-                     dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
-        }
-        
-        esp_http_client_config_t config = {
-            .url = url,
-            .method = HTTP_METHOD_POST,
-            .crt_bundle_attach = esp_crt_bundle_attach,
-        };
-        esp_http_client_handle_t client = esp_http_client_init(&config);
-        
-        esp_http_client_set_header(client, "Content-Type", "application/json");
-        esp_http_client_set_header(client, "X-AIO-Key", aio_key);
-        esp_http_client_set_post_field(client, payload, strlen(payload));
-        
-        esp_err_t err = esp_http_client_perform(client);
-        if (err == ESP_OK) {
-            ESP_LOGI(AIO_TAG, "Bat sent: %s = %d", feed_key, dev->battery_pct);
-        }
-        esp_http_client_cleanup(client);
-        vTaskDelay(pdMS_TO_TICKS(100));
+    esp_http_client_set_url(conn->client, url);
+    esp_http_client_set_method(conn->client, method);
+    return conn->client;
+}
+
+// Perform the prepared request, reading the whole response so the
+// connection can be reused. Returns the HTTP status, or -1 on errors.
+static int cloud_conn_perform(cloud_conn_t *conn) {
+    conn->open_requests++;
+    esp_err_t err = esp_http_client_perform(conn->client);
+    if (err != ESP_OK) {
+        // Drop the connection; the next request reconnects
+        conn->failures++;
+        esp_http_client_close(conn->client);
+        return -1;
     }
+    return esp_http_client_get_status_code(conn->client);
 }
 
-static void aio_upload_task(void *arg) {
-    ESP_LOGI(AIO_TAG, "Starting data upload... (total devices: %d)", device_count);
-    
-    int sent_count = 0;
-    int visible_count = 0;
-    int has_data_count = 0;
-    
-    for (int i = 0; i < device_count; i++) {
-        if (devices[i].visible) visible_count++;
-        if (devices[i].has_sensor_data) has_data_count++;
-        
-        if (devices[i].visible && devices[i].has_sensor_data) {
-            ESP_LOGI(AIO_TAG, "Sending device %d: %s", i, devices[i].name);
-            if (aio_enabled) {
-                send_device_to_aio(&devices[i]);
-            }
-            if (d1_enabled) {
-                send_device_to_d1(&devices[i]);
-            }
-            sent_count++;
-        }
+// Fold the counters of a finished upload cycle into the stats and close the
+// socket: the host would time it out before the next cycle anyway. The client
+// and its TLS session stay, so the next cycle starts with a resumed handshake.
+static void cloud_conn_end_cycle(cloud_conn_t *conn, uint32_t cycle_ms) {
+    if (conn->open_requests == 0) {
+        return;
     }
-    
-    ESP_LOGI(TAG, "Upload complete: sent=%d, visible=%d, has_data=%d (AIO:%s, D1:%s)", 
-             sent_count, visible_count, has_data_count,
-             aio_enabled ? "✓" : "✗", 
-             d1_enabled ? "✓" : "✗");
-    vTaskDelete(NULL);
+    if (conn->client) {
+        esp_http_client_close(conn->client);
+    }
+    conn->requests += conn->open_requests;
+    conn->handshakes += conn->open_handshakes;
+    conn->cycle_requests = conn->open_requests;
+    conn->cycle_handshakes = conn->open_handshakes;
+    conn->cycle_ms = cycle_ms;
+    conn->cycles++;
+    conn->open_requests = 0;
+    conn->open_handshakes = 0;
+    ESP_LOGI(TAG, "Cloud %s: %lu requests over %lu connections in %lu ms",
+             conn->label, (unsigned long)conn->cycle_requests,
+             (unsigned long)conn->cycle_handshakes, (unsigned long)cycle_ms);
 }
 
-static void aio_timer_callback(void* arg) {
-    if (!aio_enabled) return;
-    
-    // Create a task that sends data (doesn't block the timer)
-    xTaskCreate(aio_upload_task, "aio_upload", 8192, NULL, 5, NULL);
+static void cloud_conn_stats_write(json_writer_t *w, const cloud_conn_t *conn) {
+    uint32_t saved = conn->requests > conn->handshakes ? conn->requests - conn->handshakes : 0;
+    json_key(w, conn->label);
+    json_object_begin(w);
+    json_field_uint(w, "cycles", conn->cycles);
+    json_field_uint(w, "requests", conn->requests);
+    json_field_uint(w, "handshakes", conn->handshakes);
+    json_field_uint(w, "handshakesSaved", saved);
+    json_field_uint(w, "failures", conn->failures);
+    json_key(w, "lastCycle");
+    json_object_begin(w);
+    json_field_uint(w, "ms", conn->cycle_ms);
+    json_field_uint(w, "requests", conn->cycle_requests);
+    json_field_uint(w, "handshakes", conn->cycle_handshakes);
+    json_object_end(w);
+    json_object_end(w);
 }
 
+// ============================================
+// ADAFRUIT IO DATA UPLOAD
+// ============================================
+
 static void sanitize_json_string(const char* src, char* dst, size_t dst_size) {
     if (!src || !dst || dst_size == 0) return;
     size_t j = 0;
@@ -1133,21 +2741,636 @@ static void sanitize_json_string(const char* src, char* dst, size_t dst_size) {
     dst[j] = '\0';
 }
 
-static bool aio_update_feed_name(const char* feed_key_full, const char* full_name) {
-    if (!feed_key_full || !full_name || strlen(aio_username) == 0 || strlen(aio_key) == 0) return false;
+// Writer output into a fixed buffer; fails once it would overflow
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} json_buf_sink_t;
 
-    char url[256];
-    char payload[256];
-    snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/feeds/%s", aio_username, feed_key_full);
-    snprintf(payload, sizeof(payload), "{\"feed\":{\"name\":\"%s\"}}", full_name);
+static bool json_buf_flush(void *ctx, const char *data, size_t len) {
+    json_buf_sink_t *sink = ctx;
+    if (len > sink->size - sink->len) {
+        return false;
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    return true;
+}
 
-    esp_http_client_config_t config = {
-        .url = url,
-        .method = HTTP_METHOD_PUT,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .timeout_ms = 10000,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+// Format one queued reading as a D1 JSON object (with its timestamp when
+// known). Returns the length, or 0 if it didn't fit.
+static int d1_format_reading(const uplink_reading_t *r, const char *name, char *buf, size_t size) {
+    char chunk[64];
+    json_buf_sink_t sink = { .buf = buf, .size = size };
+    json_writer_t w;
+    json_writer_init(&w, chunk, sizeof(chunk), json_buf_flush, &sink);
+    json_object_begin(&w);
+    json_key(&w, "mac");
+    json_stringf(&w, "%02X:%02X:%02X:%02X:%02X:%02X",
+                 r->addr[0], r->addr[1], r->addr[2], r->addr[3], r->addr[4], r->addr[5]);
+    json_field_string(&w, "name", name[0] ? name : "Unknown");
+    if (r->time != 0) {
+        json_field_uint(&w, "ts", r->time);
+    }
+    json_key(&w, "data");
+    json_object_begin(&w);
+    if (r->fields & FIELD_TEMP) {
+        json_field_float(&w, "temperature", r->temp_centi / 100.0f, 2);
+    }
+    if (r->fields & FIELD_HUM) {
+        json_field_int(&w, "humidity", r->humidity);
+    }
+    if (r->fields & FIELD_BAT) {
+        json_field_int(&w, "battery_mv", r->battery_mv);
+    }
+    if (r->fields & FIELD_RSSI) {
+        json_field_int(&w, "rssi", r->rssi);
+    }
+    json_object_end(&w);
+    json_object_end(&w);
+    return json_writer_finish(&w) ? (int)sink.len : 0;
+}
+
+static esp_http_client_handle_t d1_client_prepare(const char *path) {
+    char url[300];
+    snprintf(url, sizeof(url), "%s%s", d1_worker_url, path);
+    
+    esp_http_client_handle_t client = cloud_conn_prepare(&d1_conn, url, HTTP_METHOD_POST);
+    if (client) {
+        esp_http_client_set_header(client, "Content-Type", "application/json");
+        esp_http_client_set_header(client, "Authorization", d1_token);
+    }
+    return client;
+}
+
+// Send one reading to Cloudflare D1 (single-reading /data endpoint of older
+// workers, which store it with the arrival time). Returns the HTTP status.
+static int send_reading_to_d1(const uplink_reading_t *r, const char *name) {
+    char payload[D1_READING_MAX];
+    int len = d1_format_reading(r, name, payload, sizeof(payload));
+    esp_http_client_handle_t client = len > 0 ? d1_client_prepare("/data") : NULL;
+    if (!client) {
+        return -1;
+    }
+    esp_http_client_set_post_field(client, payload, len);
+    return cloud_conn_perform(&d1_conn);
+}
+
+// Send readings in one POST /data/batch. The body is streamed reading by
+// reading: a first pass sizes it for Content-Length, so only one reading is
+// ever formatted in memory. Returns the HTTP status (404 means the worker
+// predates the batch endpoint), or -1 on a network error.
+static int send_readings_to_d1_batch(const uplink_reading_t *readings, const char *const *names, int count) {
+    static const char head[] = "{\"readings\":[";
+    static const char tail[] = "]}";
+    char item[D1_READING_MAX];
+    
+    int total = sizeof(head) - 1 + sizeof(tail) - 1;
+    int formatted = 0;
+    for (int i = 0; i < count; i++) {
+        int len = d1_format_reading(&readings[i], names[i], item, sizeof(item));
+        if (len > 0) {
+            total += len + (formatted > 0);
+            formatted++;
+        }
+    }
+    if (formatted == 0) {
+        return 200;
+    }
+    
+    esp_http_client_handle_t client = d1_client_prepare("/data/batch");
+    if (!client) {
+        return -1;
+    }
+    int status = -1;
+    d1_conn.open_requests++;
+    if (esp_http_client_open(client, total) == ESP_OK) {
+        bool ok = esp_http_client_write(client, head, sizeof(head) - 1) >= 0;
+        int written = 0;
+        for (int i = 0; ok && i < count; i++) {
+            int len = d1_format_reading(&readings[i], names[i], item, sizeof(item));
+            if (len == 0) {
+                continue;
+            }
+            if (written++ > 0) {
+                ok = esp_http_client_write(client, ",", 1) == 1;
+            }
+            ok = ok && esp_http_client_write(client, item, len) == len;
+        }
+        ok = ok && esp_http_client_write(client, tail, sizeof(tail) - 1) >= 0;
+        if (ok && esp_http_client_fetch_headers(client) >= 0) {
+            status = esp_http_client_get_status_code(client);
+        }
+    }
+    // Drain the response to keep the connection, or drop it after an error
+    if (status < 0 || esp_http_client_flush_response(client, NULL) != ESP_OK) {
+        d1_conn.failures++;
+        esp_http_client_close(client);
+    }
+    
+    if (status == 200) {
+        ESP_LOGI(TAG, "D1: Sent %d readings in one batch (%d bytes)", formatted, total);
+    } else {
+        ESP_LOGW(TAG, "D1: Batch of %d readings failed (HTTP %d)", formatted, status);
+    }
+    return status;
+}
+
+// Adafruit IO throttles at AIO_RATE_LIMIT_PER_MIN requests per minute:
+// block until one more fits in the sliding 60 s window
+static void aio_rate_wait(void) {
+    static int64_t sent_us[AIO_RATE_LIMIT_PER_MIN];  // Ring of recent request times
+    static int next;
+    int64_t oldest = sent_us[next];
+    if (oldest != 0) {
+        int64_t wait_us = oldest + 60 * 1000000LL - esp_timer_get_time();
+        if (wait_us > 0) {
+            ESP_LOGI(AIO_TAG, "Rate limit: waiting %lld ms", (long long)(wait_us / 1000));
+            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000 + 1));
+        }
+    }
+    sent_us[next] = esp_timer_get_time();
+    next = (next + 1) % AIO_RATE_LIMIT_PER_MIN;
+}
+
+// POST a JSON body to an Adafruit IO path over the pooled connection.
+// Returns the HTTP status, or -1 on errors.
+static int aio_post(const char *path, const char *payload, int len) {
+    char url[256];
+    snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/%s", aio_username, path);
+    
+    esp_http_client_handle_t client = cloud_conn_prepare(&aio_conn, url, HTTP_METHOD_POST);
+    if (!client) {
+        return -1;
+    }
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    esp_http_client_set_header(client, "X-AIO-Key", aio_key);
+    esp_http_client_set_post_field(client, payload, len);
+    aio_rate_wait();
+    return cloud_conn_perform(&aio_conn);
+}
+
+// Send one queued reading: a single POST to the device's group
+// (groups/<mac>/data), or one POST per feed if the group doesn't exist yet.
+// Returns the HTTP status of the failing request, or 200.
+static int send_reading_to_aio(const uplink_reading_t *r) {
+    // Feed key: MAC only (never changes even if device renamed)
+    char feed_key[20];
+    snprintf(feed_key, sizeof(feed_key), "%02x%02x%02x%02x%02x%02x",
+             r->addr[0], r->addr[1], r->addr[2], r->addr[3], r->addr[4], r->addr[5]);
+    
+    const char *suffixes[3] = {"-temp", "-hum", "-bat"};
+    uint8_t type_bits[3] = {FIELD_TEMP, FIELD_HUM, FIELD_BAT};
+    char values[3][12];
+    snprintf(values[0], sizeof(values[0]), "%.2f", r->temp_centi / 100.0f);
+    snprintf(values[1], sizeof(values[1]), "%d", r->humidity);
+    snprintf(values[2], sizeof(values[2]), "%d", r->battery_pct);
+    
+    // Backlog replays keep their original time
+    char created_at[40] = "";
+    if (r->time != 0) {
+        time_t t = r->time;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        strftime(created_at, sizeof(created_at), ",\"created_at\":\"%Y-%m-%dT%H:%M:%SZ\"", &tm);
+    }
+    
+    char payload[320];
+    int len = snprintf(payload, sizeof(payload), "{\"feeds\":[");
+    int feeds = 0;
+    for (int t = 0; t < 3; t++) {
+        if ((r->fields & type_bits[t]) && (aio_feed_types & type_bits[t])) {
+            len += snprintf(payload + len, sizeof(payload) - len, "%s{\"key\":\"%s%s\",\"value\":\"%s\"}",
+                            feeds++ ? "," : "", feed_key, suffixes[t], values[t]);
+        }
+    }
+    len += snprintf(payload + len, sizeof(payload) - len, "]%s}", created_at);
+    if (feeds == 0) {
+        return 200;
+    }
+    
+    char path[64];
+    snprintf(path, sizeof(path), "groups/%s/data", feed_key);
+    int status = aio_post(path, payload, len);
+    if (status == 200) {
+        ESP_LOGI(AIO_TAG, "Sent %d values to group %s", feeds, feed_key);
+        return status;
+    }
+    if (status != 404) {
+        ESP_LOGE(AIO_TAG, "Group %s failed: HTTP %d", feed_key, status);
+        return status;
+    }
+    
+    // No group for this device yet ("Create Feeds" maps devices onto groups)
+    ESP_LOGW(AIO_TAG, "No group %s, sending feeds one by one", feed_key);
+    for (int t = 0; t < 3; t++) {
+        if (!(r->fields & type_bits[t]) || !(aio_feed_types & type_bits[t])) continue;
+        len = snprintf(payload, sizeof(payload), "{\"value\":\"%s\"%s}", values[t], created_at);
+        snprintf(path, sizeof(path), "feeds/%s%s/data", feed_key, suffixes[t]);
+        status = aio_post(path, payload, len);
+        if (status != 200) {
+            ESP_LOGE(AIO_TAG, "Feed %s%s failed: HTTP %d", feed_key, suffixes[t], status);
+            return status;
+        }
+    }
+    return 200;
+}
+
+// ============================================
+// UPLINK QUEUE (store-and-forward to the cloud sinks)
+// ============================================
+
+static bool uplink_flash_read(void *ctx, uint32_t offset, void *buf, uint32_t len) {
+    return esp_partition_read((const esp_partition_t *)ctx, offset, buf, len) == ESP_OK;
+}
+
+static bool uplink_flash_write(void *ctx, uint32_t offset, const void *buf, uint32_t len) {
+    return esp_partition_write((const esp_partition_t *)ctx, offset, buf, len) == ESP_OK;
+}
+
+static bool uplink_flash_erase(void *ctx, uint32_t offset) {
+    return esp_partition_erase_range((const esp_partition_t *)ctx, offset, UPLINK_QUEUE_SECTOR_SIZE) == ESP_OK;
+}
+
+// RAM stand-in for the partition (queue survives outages, not reboots)
+static bool uplink_ram_read(void *ctx, uint32_t offset, void *buf, uint32_t len) {
+    memcpy(buf, (uint8_t *)ctx + offset, len);
+    return true;
+}
+
+static bool uplink_ram_write(void *ctx, uint32_t offset, const void *buf, uint32_t len) {
+    memcpy((uint8_t *)ctx + offset, buf, len);
+    return true;
+}
+
+static bool uplink_ram_erase(void *ctx, uint32_t offset) {
+    memset((uint8_t *)ctx + offset, 0xFF, UPLINK_QUEUE_SECTOR_SIZE);
+    return true;
+}
+
+// Store a sink's cursor after a delivered batch, but only every
+// UPLINK_CURSOR_SAVE_BATCHES batches or UPLINK_CURSOR_SAVE_S seconds unless
+// forced, so draining a backlog doesn't write NVS per batch. After a reset
+// at most those readings are sent again.
+static void uplink_save_cursor(uplink_sink_t *sink, bool force) {
+    if (sink->cursor == sink->saved_cursor) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    sink->unsaved_batches++;
+    if (!force && sink->unsaved_batches < UPLINK_CURSOR_SAVE_BATCHES &&
+        now - sink->saved_us < (int64_t)UPLINK_CURSOR_SAVE_S * 1000000) {
+        return;
+    }
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_UPLINK_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_set_u32(nvs, sink->name, sink->cursor);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    sink->saved_cursor = sink->cursor;
+    sink->unsaved_batches = 0;
+    sink->saved_us = now;
+}
+
+static void uplink_load_cursor(uplink_sink_t *sink) {
+    nvs_handle_t nvs;
+    sink->cursor = uplink_queue.next_seq;
+    if (nvs_open(NVS_UPLINK_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        nvs_get_u32(nvs, sink->name, &sink->cursor);
+        nvs_close(nvs);
+    }
+    // A cursor ahead of the queue belongs to an erased queue: start over
+    if (sink->cursor > uplink_queue.next_seq) {
+        sink->cursor = uplink_queue.oldest_seq;
+    }
+    sink->saved_cursor = sink->cursor;
+    sink->saved_us = esp_timer_get_time();
+}
+
+static void report_policy_save(const report_policy_t *policy) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_UPLINK_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_set_blob(nvs, "policy", policy, sizeof(*policy));
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+}
+
+// Stored default policy, if any (else the compiled-in defaults stay)
+static void report_policy_load(report_policy_t *policy) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_UPLINK_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        report_policy_t stored;
+        size_t len = sizeof(stored);
+        if (nvs_get_blob(nvs, "policy", &stored, &len) == ESP_OK && len == sizeof(stored)) {
+            *policy = stored;
+        }
+        nvs_close(nvs);
+    }
+}
+
+// Skip a sink's cursor past records the queue has overwritten
+static void uplink_sink_catch_up(uplink_sink_t *sink) {
+    if (sink->cursor < uplink_queue.oldest_seq) {
+        sink->dropped += uplink_queue.oldest_seq - sink->cursor;
+        sink->cursor = uplink_queue.oldest_seq;
+    }
+}
+
+// After appending: sinks that are switched off don't build up a backlog, and
+// sinks behind the queue's oldest record skip forward
+static void uplink_appended(int queued, const char *what) {
+    if (!aio_enabled) {
+        aio_sink.cursor = uplink_queue.next_seq;
+    }
+    if (!d1_enabled) {
+        d1_sink.cursor = uplink_queue.next_seq;
+    }
+    uplink_sink_catch_up(&aio_sink);
+    uplink_sink_catch_up(&d1_sink);
+    ESP_LOGI(TAG, "Uplink: queued %d %s (%lu waiting for AIO, %lu for D1)", queued, what,
+             (unsigned long)uplink_queue_pending(&uplink_queue, aio_sink.cursor),
+             (unsigned long)uplink_queue_pending(&uplink_queue, d1_sink.cursor));
+}
+
+// Move readings passed on by the reporting policy into the queue
+static void uplink_collect_reports(void) {
+    uplink_reading_t r;
+    int queued = 0;
+    while (xQueueReceive(report_queue, &r, 0) == pdTRUE) {
+        queued += uplink_queue_append(&uplink_queue, &r) != 0;
+    }
+    if (queued > 0) {
+        uplink_appended(queued, "reports");
+    }
+}
+
+// Queue the current reading of every visible sensor ("Send now")
+static void uplink_capture(void) {
+    device_snapshot_t *snaps;
+    int count = device_store_snapshot(&snaps, device_is_visible_sensor);
+    if (count < 0) {
+        ESP_LOGE(AIO_TAG, "Upload skipped: out of memory");
+        return;
+    }
+    uint32_t now = clock_valid() ? (uint32_t)time(NULL) : 0;
+    int queued = 0;
+    for (int i = 0; i < count; i++) {
+        uplink_reading_t r;
+        uplink_reading_from_device(&snaps[i].dev, now, &r);
+        queued += uplink_queue_append(&uplink_queue, &r) != 0;
+    }
+    free(snaps);
+    uplink_appended(queued, "readings");
+}
+
+// Device name for a queued reading, from a snapshot sorted by MAC
+static const char *uplink_name_lookup(const device_snapshot_t *snaps, int count, const uint8_t *addr) {
+    device_snapshot_t key;
+    memcpy(key.dev.addr, addr, 6);
+    const device_snapshot_t *snap = bsearch(&key, snaps, count, sizeof(*snaps), compare_device_addr);
+    return snap ? snap->name : "";
+}
+
+// Transient failures are retried with backoff; other client errors mean the
+// sink will never accept the records, so they are skipped
+static inline bool uplink_status_retry(int status) {
+    return status < 0 || status == 429 || status >= 500;
+}
+
+// Deliver one batch to a sink. Returns false if the sink should back off.
+static bool uplink_drain_batch(uplink_sink_t *sink, uplink_reading_t *batch, const char **names,
+                               const device_snapshot_t *snaps, int snap_count) {
+    uint32_t end;
+    int max = (sink == &d1_sink) ? UPLINK_D1_BATCH : UPLINK_AIO_BATCH;
+    int n = uplink_queue_read(&uplink_queue, sink->cursor, batch, max, &end);
+    
+    // delivered: readings handled (sent or refused), always a prefix of batch
+    int status = 200;
+    int delivered = 0;
+    int rejected = 0;
+    if (sink == &d1_sink) {
+        for (int i = 0; i < n; i++) {
+            names[i] = uplink_name_lookup(snaps, snap_count, batch[i].addr);
+        }
+        status = (n > 0) ? send_readings_to_d1_batch(batch, names, n) : 200;
+        if (status == 200) {
+            delivered = n;
+        } else if (status == 404 || status == 400) {
+            // Worker without /data/batch, or a reading it refuses: one request
+            // per reading, so only the refused ones are skipped
+            for (; delivered < n; delivered++) {
+                status = send_reading_to_d1(&batch[delivered], names[delivered]);
+                if (status != 200 && uplink_status_retry(status)) {
+                    break;
+                }
+                if (status != 200) {
+                    ESP_LOGW(TAG, "Uplink %s: HTTP %d, skipping a rejected reading", sink->name, status);
+                    rejected++;
+                }
+            }
+        }
+    } else {
+        for (; delivered < n; delivered++) {
+            status = send_reading_to_aio(&batch[delivered]);
+            if (status != 200 && uplink_status_retry(status)) {
+                break;
+            }
+            if (status != 200) {
+                ESP_LOGW(TAG, "Uplink %s: HTTP %d, skipping a rejected reading", sink->name, status);
+                rejected++;
+            }
+        }
+    }
+    
+    if (status != 200 && uplink_status_retry(status)) {
+        // Keep the records that failed; the cursor moves past the handled ones
+        if (delivered > 0) {
+            uint32_t partial_end;
+            uplink_queue_read(&uplink_queue, sink->cursor, batch, delivered, &partial_end);
+            sink->cursor = partial_end;
+            sink->sent += delivered - rejected;
+            sink->rejected += rejected;
+        }
+        uplink_save_cursor(sink, true);  // Backing off: store what was delivered
+        sink->failures++;
+        uint32_t backoff = UPLINK_BACKOFF_MIN_S << (sink->failures < 7 ? sink->failures - 1 : 6);
+        if (backoff > UPLINK_BACKOFF_MAX_S) {
+            backoff = UPLINK_BACKOFF_MAX_S;
+        }
+        sink->retry_at_us = esp_timer_get_time() + (int64_t)backoff * 1000000;
+        ESP_LOGW(TAG, "Uplink %s: HTTP %d, retrying in %lu s (%lu waiting)", sink->name, status,
+                 (unsigned long)backoff, (unsigned long)uplink_queue_pending(&uplink_queue, sink->cursor));
+        return false;
+    }
+    if (delivered < n) {
+        // The whole batch refused (e.g. 401): nothing to retry it with
+        ESP_LOGW(TAG, "Uplink %s: HTTP %d, skipping %d rejected readings", sink->name, status, n - delivered);
+        rejected += n - delivered;
+    }
+    sink->rejected += rejected;
+    sink->sent += n - rejected;
+    sink->cursor = end;
+    sink->failures = 0;
+    sink->retry_at_us = 0;
+    sink->last_ok_us = esp_timer_get_time();
+    uplink_save_cursor(sink, uplink_queue_pending(&uplink_queue, sink->cursor) == 0);
+    return true;
+}
+
+// Drain every enabled sink whose backoff has expired (or all, if forced)
+static void uplink_drain(bool force) {
+    bool aio_ready = aio_enabled && strlen(aio_username) > 0 && strlen(aio_key) > 0;
+    bool d1_ready = d1_enabled && strlen(d1_worker_url) > 0 && strlen(d1_token) > 0;
+    if ((!aio_ready || uplink_queue_pending(&uplink_queue, aio_sink.cursor) == 0) &&
+        (!d1_ready || uplink_queue_pending(&uplink_queue, d1_sink.cursor) == 0)) {
+        return;
+    }
+    
+    // Names for D1 come from the current device table
+    device_snapshot_t *snaps = NULL;
+    int snap_count = 0;
+    if (d1_ready) {
+        snap_count = device_store_snapshot(&snaps, device_is_visible);
+        if (snap_count > 0) {
+            qsort(snaps, snap_count, sizeof(*snaps), compare_device_addr);
+        }
+        if (snap_count < 0) {
+            snap_count = 0;
+        }
+    }
+    uplink_reading_t *batch = malloc(UPLINK_D1_BATCH * sizeof(uplink_reading_t));
+    const char **names = malloc(UPLINK_D1_BATCH * sizeof(char *));
+    if (!batch || !names) {
+        free(batch);
+        free(names);
+        free(snaps);
+        return;
+    }
+    
+    int64_t started = esp_timer_get_time();
+    uplink_sink_t *sinks[2] = { &d1_sink, &aio_sink };
+    bool ready[2] = { d1_ready, aio_ready };
+    for (int s = 0; s < 2; s++) {
+        uplink_sink_t *sink = sinks[s];
+        if (!ready[s] || (!force && esp_timer_get_time() < sink->retry_at_us)) {
+            continue;
+        }
+        uplink_sink_catch_up(sink);
+        while (uplink_queue_pending(&uplink_queue, sink->cursor) > 0 &&
+               uplink_drain_batch(sink, batch, names, snaps, snap_count)) {
+        }
+    }
+    free(names);
+    free(batch);
+    free(snaps);
+    
+    uint32_t cycle_ms = (uint32_t)((esp_timer_get_time() - started) / 1000);
+    cloud_conn_end_cycle(&aio_conn, cycle_ms);
+    cloud_conn_end_cycle(&d1_conn, cycle_ms);
+}
+
+// Owns the queue and the cloud connections: queues the readings passed on by
+// the reporting policy and drains the sinks, retrying failed ones after
+// their backoff
+static void uplink_task(void *param) {
+    while (1) {
+        // Sleep until the next report, request or retry
+        int64_t now = esp_timer_get_time();
+        int64_t wait_us = (int64_t)UPLINK_IDLE_WAIT_MS * 1000;
+        uplink_sink_t *sinks[2] = { &aio_sink, &d1_sink };
+        for (int s = 0; s < 2; s++) {
+            if (sinks[s]->retry_at_us > now && sinks[s]->retry_at_us - now < wait_us) {
+                wait_us = sinks[s]->retry_at_us - now;
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_us / 1000 + 1));
+        
+        // Reports of sensors that change together go out in one batch
+        if (uxQueueMessagesWaiting(report_queue) > 0 && !atomic_load(&uplink_force)) {
+            vTaskDelay(pdMS_TO_TICKS(UPLINK_COALESCE_MS));
+        }
+        uplink_collect_reports();
+        if (atomic_exchange(&uplink_capture_pending, false) && (aio_enabled || d1_enabled)) {
+            uplink_capture();
+        }
+        uplink_drain(atomic_exchange(&uplink_force, false));
+    }
+}
+
+// Queue a reading of every sensor and upload ("Send now")
+static void uplink_request(bool force) {
+    atomic_store(&uplink_capture_pending, true);
+    if (force) {
+        atomic_store(&uplink_force, true);
+    }
+    if (uplink_task_handle) {
+        xTaskNotifyGive(uplink_task_handle);
+    }
+}
+
+// Mount the queue (flash partition, or RAM without one) and start the task
+static bool uplink_init(void) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)UPLINK_PARTITION_SUBTYPE,
+                                                           UPLINK_PARTITION_LABEL);
+    uplink_queue_flash_t flash;
+    uint16_t sectors;
+    if (part) {
+        flash = (uplink_queue_flash_t){ (void *)part, uplink_flash_read, uplink_flash_write, uplink_flash_erase };
+        sectors = part->size / UPLINK_QUEUE_SECTOR_SIZE;
+    } else {
+        ESP_LOGW(TAG, "No '%s' partition, upload queue is kept in RAM only", UPLINK_PARTITION_LABEL);
+        sectors = UPLINK_RAM_SECTORS;
+        void *ram = malloc(sectors * UPLINK_QUEUE_SECTOR_SIZE);
+        if (!ram) {
+            return false;
+        }
+        memset(ram, 0xFF, sectors * UPLINK_QUEUE_SECTOR_SIZE);
+        flash = (uplink_queue_flash_t){ ram, uplink_ram_read, uplink_ram_write, uplink_ram_erase };
+    }
+    if (!uplink_queue_mount(&uplink_queue, &flash, sectors)) {
+        ESP_LOGE(TAG, "Upload queue mount failed");
+        return false;
+    }
+    uplink_persistent = (part != NULL);
+    uplink_load_cursor(&aio_sink);
+    uplink_load_cursor(&d1_sink);
+    
+    device_write_begin();
+    report_policy_load(&report_policy);
+    device_write_end();
+    report_queue = xQueueCreate(REPORT_QUEUE_LEN, sizeof(uplink_reading_t));
+    if (!report_queue) {
+        return false;
+    }
+    if (xTaskCreate(uplink_task, "uplink", 8192, NULL, 4, &uplink_task_handle) != pdPASS) {
+        return false;
+    }
+    ESP_LOGI(TAG, "Upload queue: %lu slots, %lu waiting for AIO, %lu for D1",
+             (unsigned long)uplink_queue.capacity,
+             (unsigned long)uplink_queue_pending(&uplink_queue, aio_sink.cursor),
+             (unsigned long)uplink_queue_pending(&uplink_queue, d1_sink.cursor));
+    return true;
+}
+
+static bool aio_update_feed_name(const char* feed_key_full, const char* full_name) {
+    if (!feed_key_full || !full_name || strlen(aio_username) == 0 || strlen(aio_key) == 0) return false;
+
+    char url[256];
+    char payload[256];
+    snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/feeds/%s", aio_username, feed_key_full);
+    snprintf(payload, sizeof(payload), "{\"feed\":{\"name\":\"%s\"}}", full_name);
+
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_PUT,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .timeout_ms = 10000,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
     esp_http_client_set_header(client, "Content-Type", "application/json");
     esp_http_client_set_header(client, "X-AIO-Key", aio_key);
     esp_http_client_set_post_field(client, payload, strlen(payload));
@@ -1165,6 +3388,57 @@ static bool aio_update_feed_name(const char* feed_key_full, const char* full_nam
     return false;
 }
 
+// One-off Adafruit IO request from the web server task. Returns the HTTP
+// status, or -1 on network errors.
+static int aio_simple_request(esp_http_client_method_t method, const char *url, const char *payload) {
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = method,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .timeout_ms = 10000,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    esp_http_client_set_header(client, "X-AIO-Key", aio_key);
+    if (payload) {
+        esp_http_client_set_post_field(client, payload, strlen(payload));
+    }
+    esp_err_t err = esp_http_client_perform(client);
+    int status = esp_http_client_get_status_code(client);
+    esp_http_client_cleanup(client);
+    return (err == ESP_OK) ? status : -1;
+}
+
+// Create the group of a device (key = MAC, name = device name) so its
+// readings can be posted in one request. An existing group is fine.
+static bool aio_ensure_group(const char *group_key, const char *display_name) {
+    char url[160];
+    char payload[128];
+    snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/groups", aio_username);
+    snprintf(payload, sizeof(payload), "{\"key\":\"%s\",\"name\":\"%s\"}", group_key, display_name);
+    int status = aio_simple_request(HTTP_METHOD_POST, url, payload);
+    if (status == 200 || status == 201) {
+        ESP_LOGI(AIO_TAG, "✓ Created group: %s", group_key);
+        return true;
+    }
+    if (status == 422 || status == 409 || status == 400) {
+        return true;  // Already exists
+    }
+    ESP_LOGW(AIO_TAG, "✗ Failed to create group %s (status: %d)", group_key, status);
+    return false;
+}
+
+// Add a feed to a device group; feed keys and existing data stay the same
+static void aio_group_add_feed(const char *group_key, const char *feed_key) {
+    char url[200];
+    snprintf(url, sizeof(url), "https://io.adafruit.com/api/v2/%s/groups/%s/add?feed_key=%s",
+             aio_username, group_key, feed_key);
+    int status = aio_simple_request(HTTP_METHOD_POST, url, NULL);
+    if (status != 200 && status != 201) {
+        ESP_LOGW(AIO_TAG, "✗ Failed to add %s to group %s (status: %d)", feed_key, group_key, status);
+    }
+}
+
 static esp_err_t api_aio_create_feeds_handler(httpd_req_t *req) {
     httpd_resp_set_type(req, "application/json");
     
@@ -1179,13 +3453,25 @@ static esp_err_t api_aio_create_feeds_handler(httpd_req_t *req) {
     int existed = 0;
     int failed = 0;
     
-    for (int i = 0; i < device_count; i++) {
-        if (!devices[i].visible || !devices[i].has_sensor_data) continue;
+    device_snapshot_t *snaps;
+    int count = device_store_snapshot(&snaps, device_is_visible_sensor);
+    if (count < 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        const ble_device_t *dev = &snaps[i].dev;
         
         char feed_key[20];
         snprintf(feed_key, sizeof(feed_key), "%02x%02x%02x%02x%02x%02x",
-                 devices[i].addr[0], devices[i].addr[1], devices[i].addr[2], 
-                 devices[i].addr[3], devices[i].addr[4], devices[i].addr[5]);
+                 dev->addr[0], dev->addr[1], dev->addr[2], 
+                 dev->addr[3], dev->addr[4], dev->addr[5]);
+        
+        // One group per device, so the uploader can send all its feeds at once
+        char group_name[64];
+        sanitize_json_string((strlen(snaps[i].name) > 0) ? snaps[i].name : feed_key, group_name, sizeof(group_name));
+        bool grouped = aio_ensure_group(feed_key, group_name);
         
         // Try each feed type
         const char* suffixes[3] = {"-temp", "-hum", "-bat"};
@@ -1193,14 +3479,14 @@ static esp_err_t api_aio_create_feeds_handler(httpd_req_t *req) {
         uint8_t type_bits[3] = {FIELD_TEMP, FIELD_HUM, FIELD_BAT};
         
         for (int t = 0; t < 3; t++) {
-            if (!(devices[i].field_mask & type_bits[t]) || !(aio_feed_types & type_bits[t])) continue;
+            if (!(dev->field_mask & type_bits[t]) || !(aio_feed_types & type_bits[t])) continue;
             
             char url[256];
             char payload[256];
             char display_name[64];
             char full_name[96];
             char feed_key_full[32];
-            const char* raw_name = (strlen(devices[i].name) > 0) ? devices[i].name : feed_key;
+            const char* raw_name = (strlen(snaps[i].name) > 0) ? snaps[i].name : feed_key;
             sanitize_json_string(raw_name, display_name, sizeof(display_name));
             snprintf(full_name, sizeof(full_name), "%s %s", display_name, names[t]);
             snprintf(feed_key_full, sizeof(feed_key_full), "%s%s", feed_key, suffixes[t]);
@@ -1233,13 +3519,17 @@ static esp_err_t api_aio_create_feeds_handler(httpd_req_t *req) {
                     // 400 = Bad Request (often means already exists in Adafruit IO)
                     existed++;
                     ESP_LOGI(AIO_TAG, "○ Feed already exists: %s%s (status: %d)", feed_key, suffixes[t], status);
-                    if (strlen(devices[i].name) > 0) {
+                    if (strlen(snaps[i].name) > 0) {
                         aio_update_feed_name(feed_key_full, full_name);
                     }
                 } else {
                     failed++;
                     ESP_LOGW(AIO_TAG, "✗ Failed to create feed %s%s (status: %d)", feed_key, suffixes[t], status);
                 }
+                bool exists = (status == 200 || status == 201 || status == 422 || status == 409 || status == 400);
+                if (grouped && exists) {
+                    aio_group_add_feed(feed_key, feed_key_full);
+                }
             } else {
                 failed++;
                 ESP_LOGE(AIO_TAG, "✗ HTTP error creating %s%s: %s", feed_key, suffixes[t], esp_err_to_name(err));
@@ -1247,15 +3537,20 @@ static esp_err_t api_aio_create_feeds_handler(httpd_req_t *req) {
             vTaskDelay(pdMS_TO_TICKS(300));
         }
     }
+    free(snaps);
     
     ESP_LOGI(AIO_TAG, "Feed creation completed: %d created, %d existed, %d failed", created, existed, failed);
     
-    char response[256];
-    snprintf(response, sizeof(response), 
-             "{\"ok\":true,\"created\":%d,\"existed\":%d,\"failed\":%d}", 
-             created, existed, failed);
-    httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_int(&w, "created", created);
+    json_field_int(&w, "existed", existed);
+    json_field_int(&w, "failed", failed);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // API: Delete feeds by type (temp/hum/bat)
@@ -1284,6 +3579,13 @@ static esp_err_t api_aio_delete_feeds_handler(httpd_req_t *req) {
         return ESP_OK;
     }
     
+    device_snapshot_t *snaps;
+    int count = device_store_snapshot(&snaps, device_is_visible);
+    if (count < 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
     int deleted = 0;
     const char* suffixes[3] = {"-temp", "-hum", "-bat"};
     uint8_t type_bits[3] = {FIELD_TEMP, FIELD_HUM, FIELD_BAT};
@@ -1293,14 +3595,14 @@ static esp_err_t api_aio_delete_feeds_handler(httpd_req_t *req) {
         if (!(types_to_delete & type_bits[t])) continue;
         
         // Iterate over all visible devices
-        for (int i = 0; i < device_count; i++) {
-            if (!devices[i].visible) continue;
+        for (int i = 0; i < count; i++) {
+            const ble_device_t *dev = &snaps[i].dev;
             
             // Generate feed key (MAC only)
             char feed_key[24];
             snprintf(feed_key, sizeof(feed_key), "%02x%02x%02x%02x%02x%02x%s",
-                     devices[i].addr[0], devices[i].addr[1], devices[i].addr[2], 
-                     devices[i].addr[3], devices[i].addr[4], devices[i].addr[5],
+                     dev->addr[0], dev->addr[1], dev->addr[2], 
+                     dev->addr[3], dev->addr[4], dev->addr[5],
                      suffixes[t]);
             
             // Delete feed
@@ -1327,10 +3629,16 @@ static esp_err_t api_aio_delete_feeds_handler(httpd_req_t *req) {
         }
     }
     
-    char response[128];
-    snprintf(response, sizeof(response), "{\"ok\":true,\"deleted\":%d}", deleted);
-    httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    free(snaps);
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_int(&w, "deleted", deleted);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // API: Send data now (test)
@@ -1343,8 +3651,8 @@ static esp_err_t api_aio_send_now_handler(httpd_req_t *req) {
         return ESP_OK;
     }
     
-    // Create a task that sends data
-    xTaskCreate(aio_upload_task, "aio_upload", 8192, NULL, 5, NULL);
+    // Queue a reading of every sensor and upload the backlog right away
+    uplink_request(true);
     
     const char* resp = "{\"ok\":true,\"message\":\"Send started\"}";
     httpd_resp_sendstr(req, resp);
@@ -1355,11 +3663,41 @@ static esp_err_t api_aio_send_now_handler(httpd_req_t *req) {
 // WEB UI
 // ============================================
 
-static esp_err_t root_get_handler(httpd_req_t *req) {
-    httpd_resp_set_hdr(req, "Cache-Control", "no-store, no-cache, must-revalidate, max-age=0");
-    httpd_resp_set_hdr(req, "Pragma", "no-cache");
-    httpd_resp_set_hdr(req, "Expires", "0");
+static const web_asset_t *web_asset_find(const char *path) {
+    for (size_t i = 0; i < web_asset_count; i++) {
+        if (strcmp(web_assets[i].path, path) == 0) {
+            return &web_assets[i];
+        }
+    }
+    return NULL;
+}
+
+// Send a gzipped UI file. index.html is revalidated on every load (cheap
+// with the ETag); the files it references carry ?v=<hash> in their URL and
+// are cached for good.
+static esp_err_t web_asset_send(httpd_req_t *req, const web_asset_t *asset) {
+    bool versioned = (strcmp(asset->path, "/index.html") != 0);
+    httpd_resp_set_hdr(req, "Cache-Control", versioned ? "public, max-age=31536000, immutable" : "no-cache");
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    
+    char if_none_match[24];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, asset->etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
     
+    httpd_resp_set_type(req, asset->content_type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char *)asset->data, asset->len);
+}
+
+// UI files other than the page itself (/app.js, /app.css)
+static esp_err_t web_asset_handler(httpd_req_t *req) {
+    return web_asset_send(req, (const web_asset_t *)req->user_ctx);
+}
+
+static esp_err_t root_get_handler(httpd_req_t *req) {
     // Check if request came from AP interface (192.168.4.x)
     int sockfd = httpd_req_to_sockfd(req);
     struct sockaddr_in6 addr;
@@ -1374,6 +3712,7 @@ static esp_err_t root_get_handler(httpd_req_t *req) {
                 // Check if IP is 192.168.4.x (AP network)
                 if (ip_bytes[0] == 192 && ip_bytes[1] == 168 && ip_bytes[2] == 4) {
                     // Request from AP -> show setup page
+                    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
                     httpd_resp_send(req, SETUP_HTML_PAGE, HTTPD_RESP_USE_STRLEN);
                     return ESP_OK;
                 }
@@ -1384,6 +3723,7 @@ static esp_err_t root_get_handler(httpd_req_t *req) {
             // Check if IP is 192.168.4.x (AP network)
             if (ip_bytes[0] == 192 && ip_bytes[1] == 168 && ip_bytes[2] == 4) {
                 // Request from AP -> show setup page
+                httpd_resp_set_hdr(req, "Cache-Control", "no-store");
                 httpd_resp_send(req, SETUP_HTML_PAGE, HTTPD_RESP_USE_STRLEN);
                 return ESP_OK;
             }
@@ -1391,8 +3731,7 @@ static esp_err_t root_get_handler(httpd_req_t *req) {
     }
     
     // Request from STA or unknown -> show full UI
-    httpd_resp_send(req, HTML_PAGE, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return web_asset_send(req, web_asset_find("/index.html"));
 }
 
 // API: Setup WiFi-asetukset
@@ -1469,15 +3808,15 @@ static esp_err_t api_setup_handler(httpd_req_t *req) {
 
 // API: Get WiFi status (for setup page)
 static esp_err_t api_status_handler(httpd_req_t *req) {
-    char resp[128];
-    if (wifi_connected && master_ip[0] != '\0') {
-        snprintf(resp, sizeof(resp), "{\"connected\":true,\"ip\":\"%s\"}", master_ip);
-    } else {
-        snprintf(resp, sizeof(resp), "{\"connected\":false,\"ip\":\"\"}");
-    }
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    bool connected = wifi_connected && master_ip[0] != '\0';
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "connected", connected);
+    json_field_string(&w, "ip", connected ? master_ip : "");
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // API: Set AP password
@@ -1609,34 +3948,32 @@ static esp_err_t api_aio_config_handler(httpd_req_t *req) {
 
 // API: Get Adafruit IO settings
 static esp_err_t api_aio_get_handler(httpd_req_t *req) {
-    httpd_resp_set_type(req, "application/json");
-    
-    char response[512];
-    snprintf(response, sizeof(response), 
-             "{\"ok\":true,\"username\":\"%s\",\"key\":\"%s\",\"enabled\":%s,\"has_key\":%s,\"feedTypes\":%d}",
-             aio_username,
-             aio_key,
-             aio_enabled ? "true" : "false",
-             strlen(aio_key) > 0 ? "true" : "false",
-             aio_feed_types);
-    
-    httpd_resp_sendstr(req, response);
-    return ESP_OK;
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_string(&w, "username", aio_username);
+    json_field_string(&w, "key", aio_key);
+    json_field_bool(&w, "enabled", aio_enabled);
+    json_field_bool(&w, "has_key", strlen(aio_key) > 0);
+    json_field_int(&w, "feedTypes", aio_feed_types);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // API: Get D1 settings
 static esp_err_t api_d1_get_handler(httpd_req_t *req) {
-    httpd_resp_set_type(req, "application/json");
-    
-    char response[512];
-    snprintf(response, sizeof(response), 
-             "{\"ok\":true,\"workerUrl\":\"%s\",\"enabled\":%s,\"hasToken\":%s}",
-             d1_worker_url,
-             d1_enabled ? "true" : "false",
-             strlen(d1_token) > 0 ? "true" : "false");
-    
-    httpd_resp_sendstr(req, response);
-    return ESP_OK;
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_string(&w, "workerUrl", d1_worker_url);
+    json_field_bool(&w, "enabled", d1_enabled);
+    json_field_bool(&w, "hasToken", strlen(d1_token) > 0);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // API: Save D1 settings
@@ -1779,10 +4116,14 @@ static esp_err_t api_scan_settings_handler(httpd_req_t *req) {
     
     if (req->method == HTTP_GET) {
         // Return current settings
-        char response[128];
-        snprintf(response, sizeof(response), "{\"ok\":true,\"masterBleEnabled\":%s}", 
-                 master_ble_enabled ? "true" : "false");
-        httpd_resp_sendstr(req, response);
+        char json_buf[JSON_CHUNK_SIZE];
+        json_writer_t w;
+        json_response_begin(&w, req, json_buf, sizeof(json_buf));
+        json_object_begin(&w);
+        json_field_bool(&w, "ok", true);
+        json_field_bool(&w, "masterBleEnabled", master_ble_enabled);
+        json_object_end(&w);
+        return json_response_end(&w, req);
     } else if (req->method == HTTP_POST) {
         // Save new settings
         char buf[256];
@@ -1799,6 +4140,7 @@ static esp_err_t api_scan_settings_handler(httpd_req_t *req) {
             enabled_str += strlen("\"masterBleEnabled\":");
             while (*enabled_str == ' ') enabled_str++;
             master_ble_enabled = (strncmp(enabled_str, "true", 4) == 0);
+            device_list_shrunk();  // The device list filter changed
             ESP_LOGI(TAG, "⚙️ Master BLE scan: %s", master_ble_enabled ? "ENABLED" : "DISABLED");
             
             // Save to NVS
@@ -1809,245 +4151,1409 @@ static esp_err_t api_scan_settings_handler(httpd_req_t *req) {
                 nvs_close(nvs);
             }
         }
-        
-        httpd_resp_sendstr(req, "{\"ok\":true}");
+        
+        httpd_resp_sendstr(req, "{\"ok\":true}");
+    }
+    
+    return ESP_OK;
+}
+
+// API: Satellite registry, GET /api/satellites
+//
+// {"latencyBucketsMs":[1,2,...],"satellites":[{...}]}: per satellite the
+// load it puts on the hub (adv/s and sensor/s over the last
+// BLE_RATE_INTERVAL_MS, parse failures, upload latency histogram, where
+// latency[n] counts uploads faster than latencyBucketsMs[n] and the last
+// one the rest), the devices it was the last to hear, policy fetches and
+// UDP sequence stats if it sends datagrams.
+static esp_err_t api_satellites_handler(httpd_req_t *req) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    // Devices per receiver: the source that heard each one last. Read
+    // through the seqlock like the other handlers, so ingest never waits.
+    device_key_t *keys;
+    int count = device_store_keys(&keys, NULL);
+    if (count < 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    uint16_t covered[SOURCE_ID_SAT_FIRST + MAX_SATELLITES] = {0};
+    for (int i = 0; i < count; i++) {
+        device_snapshot_t snap;
+        if (device_store_read(keys[i].addr, &snap) && snap.dev.source_id < SOURCE_ID_SAT_FIRST + MAX_SATELLITES) {
+            covered[snap.dev.source_id]++;
+        }
+    }
+    free(keys);
+    
+    sat_udp_peer_t peers[SAT_UDP_MAX_PEERS];
+    taskENTER_CRITICAL(&sat_udp_lock);
+    memcpy(peers, sat_udp_peers, sizeof(peers));
+    taskEXIT_CRITICAL(&sat_udp_lock);
+    
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_key(&w, "latencyBucketsMs");
+    json_array_begin(&w);
+    for (int b = 0; b < SAT_LATENCY_BUCKETS - 1; b++) {
+        json_uint(&w, 1u << b);
+    }
+    json_array_end(&w);
+    
+    json_key(&w, "satellites");
+    json_array_begin(&w);
+    for (int slot = 0; slot < MAX_SATELLITES; slot++) {
+        sat_entry_t entry;
+        taskENTER_CRITICAL(&satellite_lock);
+        entry = satellites.slots[slot];
+        taskEXIT_CRITICAL(&satellite_lock);
+        const sat_entry_t *sat = &entry;
+        struct in_addr addr = { .s_addr = sat->ip };
+        if (addr.s_addr == 0) {
+            continue;
+        }
+        uint8_t id = satellite_source_id(slot);
+        char ip[16];
+        inet_ntoa_r(addr, ip, sizeof(ip));
+        json_object_begin(&w);
+        json_field_string(&w, "ip", ip);
+        json_key(&w, "lastSeenSec");
+        if (sat->last_seen_ms) {
+            json_uint(&w, (now_ms - sat->last_seen_ms) / 1000);
+        } else {
+            json_null(&w);
+        }
+        json_field_float(&w, "advPerSec", sat->adv_rate, 1);
+        json_field_float(&w, "sensorPerSec", sat->sensor_rate, 1);
+        json_field_uint(&w, "received", sat->received);
+        json_field_uint(&w, "sensors", sat->sensors);
+        json_field_uint(&w, "parseFailures", sat->parse_failures);
+        json_field_uint(&w, "devices", covered[id]);
+        json_field_uint(&w, "requests", sat->requests);
+        json_key(&w, "latency");
+        json_array_begin(&w);
+        for (int b = 0; b < SAT_LATENCY_BUCKETS; b++) {
+            json_uint(&w, sat->latency[b]);
+        }
+        json_array_end(&w);
+        
+        json_key(&w, "policy");
+        json_object_begin(&w);
+        json_field_uint(&w, "fetches", sat->policy_fetches);
+        json_key(&w, "ageSec");
+        if (sat->policy_ms) {
+            json_uint(&w, (now_ms - sat->policy_ms) / 1000);
+        } else {
+            json_null(&w);
+        }
+        json_field_bool(&w, "current", sat->policy_current);
+        json_field_uint(&w, "forwarded", sat->forwarded);
+        json_field_uint(&w, "filtered", sat->filtered);
+        json_object_end(&w);
+        
+        json_key(&w, "udp");
+        const sat_udp_peer_t *peer = NULL;
+        for (int i = 0; i < SAT_UDP_MAX_PEERS; i++) {
+            if (peers[i].ip != 0 && peers[i].source_id == id) {
+                peer = &peers[i];
+            }
+        }
+        if (peer) {
+            json_object_begin(&w);
+            json_field_uint(&w, "received", peer->seq.received);
+            json_field_uint(&w, "lost", peer->seq.lost);
+            json_field_uint(&w, "reordered", peer->seq.reordered);
+            json_field_uint(&w, "duplicates", peer->seq.duplicates);
+            json_field_uint(&w, "stale", peer->seq.stale);
+            json_field_uint(&w, "restarts", peer->seq.restarts);
+            json_object_end(&w);
+        } else {
+            json_null(&w);
+        }
+        json_object_end(&w);
+    }
+    json_array_end(&w);
+    json_object_end(&w);
+    return json_response_end(&w, req);
+}
+
+// API: UDP satellite ingest settings (GET or POST). The key is write-only.
+static esp_err_t api_satellite_udp_handler(httpd_req_t *req) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_type(req, "application/json");
+    
+    if (req->method == HTTP_POST) {
+        char buf[256];
+        int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+        if (ret <= 0) {
+            httpd_resp_sendstr(req, "{\"ok\":false,\"error\":\"Empty request\"}");
+            return ESP_OK;
+        }
+        buf[ret] = '\0';
+        
+        // Parse JSON (simple string search): {"enabled":true,"key":"..."}
+        bool enabled = sat_udp_enabled;
+        char *enabled_str = strstr(buf, "\"enabled\":");
+        if (enabled_str) {
+            enabled_str += strlen("\"enabled\":");
+            while (*enabled_str == ' ') enabled_str++;
+            enabled = (strncmp(enabled_str, "true", 4) == 0);
+        }
+        char key[SAT_UDP_KEY_MAX + 2] = {0};
+        char *key_str = strstr(buf, "\"key\":\"");
+        if (key_str) {
+            key_str += strlen("\"key\":\"");
+            char *end = strchr(key_str, '"');
+            size_t len = end ? (size_t)(end - key_str) : 0;
+            if (!end || len > SAT_UDP_KEY_MAX) {
+                httpd_resp_sendstr(req, "{\"ok\":false,\"error\":\"Key must be at most 64 characters\"}");
+                return ESP_OK;
+            }
+            memcpy(key, key_str, len);
+        }
+        if (enabled && !key_str && sat_udp_key_len == 0) {
+            httpd_resp_sendstr(req, "{\"ok\":false,\"error\":\"Set a key to enable UDP ingest\"}");
+            return ESP_OK;
+        }
+        sat_udp_configure(enabled, key_str ? key : NULL);
+        ESP_LOGI(TAG, "⚙️ UDP satellite ingest: %s", enabled ? "ENABLED" : "DISABLED");
+    }
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_bool(&w, "enabled", sat_udp_enabled);
+    json_field_int(&w, "port", SAT_UDP_PORT);
+    json_field_bool(&w, "hasKey", sat_udp_key_len > 0);
+    json_object_end(&w);
+    return json_response_end(&w, req);
+}
+
+// API: Diagnostics (crash logs, memory, boot count)
+static esp_err_t api_diagnostics_handler(httpd_req_t *req) {
+    // Get diagnostics from NVS
+    nvs_handle_t diag_nvs;
+    uint32_t boot_count = 0;
+    uint32_t last_reset = 0;
+    
+    if (nvs_open("diagnostics", NVS_READONLY, &diag_nvs) == ESP_OK) {
+        nvs_get_u32(diag_nvs, "boot_count", &boot_count);
+        nvs_get_u32(diag_nvs, "last_reset", &last_reset);
+        nvs_close(diag_nvs);
+    }
+    
+    // Reset reason strings
+    const char* reset_reasons[] = {
+        "UNKNOWN", "POWERON", "EXT", "SW", "PANIC", "INT_WDT",
+        "TASK_WDT", "WDT", "DEEPSLEEP", "BROWNOUT", "SDIO"
+    };
+    const char* reset_str = (last_reset < 11) ? reset_reasons[last_reset] : "UNKNOWN";
+    
+    // Memory stats
+    uint32_t free_heap = esp_get_free_heap_size();
+    uint32_t min_free_heap = esp_get_minimum_free_heap_size();
+    uint32_t largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    
+    // Uptime
+    uint32_t uptime_sec = (uint32_t)(esp_timer_get_time() / 1000000);
+    
+    // BLE stats (total advertisements received)
+    uint32_t ble_rate = ble_adv_count;
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_uint(&w, "bootCount", boot_count);
+    json_field_string(&w, "lastReset", reset_str);
+    json_field_uint(&w, "uptimeSec", uptime_sec);
+    json_field_uint(&w, "freeHeap", free_heap);
+    json_field_uint(&w, "minFreeHeap", min_free_heap);
+    json_field_uint(&w, "largestBlock", largest_block);
+    json_field_uint(&w, "bleAdvCount", ble_rate);
+    json_field_int(&w, "deviceCount", device_count);
+    json_field_int(&w, "deviceCapacity", MAX_DEVICES);
+    json_field_uint(&w, "deviceEvictions", device_evict_count);
+    json_field_uint(&w, "duplicateReadings", sensor_dup_count);
+    
+    json_key(&w, "ingest");
+    json_object_begin(&w);
+    const char *ring_names[3] = { "local", "satellite", "udp" };
+    adv_ring_t *rings[3] = { &local_adv_ring, &sat_adv_ring, &udp_adv_ring };
+    for (int i = 0; i < 3; i++) {
+        json_key(&w, ring_names[i]);
+        json_object_begin(&w);
+        json_field_uint(&w, "size", adv_ring_capacity(rings[i]));
+        json_field_uint(&w, "queued", adv_ring_count(rings[i]));
+        json_field_uint(&w, "highWater", atomic_load(&rings[i]->high_water));
+        json_field_uint(&w, "dropped", atomic_load(&rings[i]->dropped));
+        json_object_end(&w);
+    }
+    json_object_end(&w);
+    
+    sat_udp_stats_write(&w);
+    
+    json_key(&w, "historyLog");
+    json_object_begin(&w);
+    json_field_uint(&w, "sizeKB", history_log_ready ? history_partition->size / 1024 : 0);
+    json_field_uint(&w, "blocks", history_log_ready ? history_log.blocks : 0);
+    json_field_uint(&w, "oldest", history_log_ready ? history_log_oldest(&history_log) : 0);
+    json_field_bool(&w, "clockSynced", clock_valid());
+    json_object_end(&w);
+    
+    json_key(&w, "cloud");
+    json_object_begin(&w);
+    cloud_conn_stats_write(&w, &aio_conn);
+    cloud_conn_stats_write(&w, &d1_conn);
+    json_object_end(&w);
+    json_object_end(&w);
+    return json_response_end(&w, req);
+}
+
+// One device of /api/devices
+static void device_json_write(json_writer_t *w, const device_snapshot_t *snap, uint32_t now_ms) {
+    const ble_device_t *dev = &snap->dev;
+    char source[32];
+    source_name(dev->source_id, source, sizeof(source));
+    
+    uint32_t age_sec = 0;
+    uint32_t ref_ms = dev->has_sensor_data ? dev->last_sensor_seen : dev->last_seen;
+    if (ref_ms > 0 && now_ms >= ref_ms) {
+        age_sec = (now_ms - ref_ms) / 1000;
+    }
+    
+    json_object_begin(w);
+    json_key(w, "addr");
+    json_stringf(w, "%02X:%02X:%02X:%02X:%02X:%02X",
+        dev->addr[0], dev->addr[1], dev->addr[2],
+        dev->addr[3], dev->addr[4], dev->addr[5]);
+    json_field_string(w, "name", snap->name[0] ? snap->name : "Unknown");
+    json_field_string(w, "advName", snap->adv_name);
+    json_field_int(w, "rssi", dev->rssi);
+    json_field_bool(w, "hasSensor", dev->has_sensor_data);
+    
+    uint16_t available = FIELD_RSSI | FIELD_AGE;  // RSSI and update age always available
+    if (dev->has_sensor_data) {
+        const char *firmware = interned_str(dev->firmware_id);
+        // Determine which fields the device supports
+        if (dev->temperature != 0) available |= FIELD_TEMP;
+        if (dev->humidity != 0) available |= FIELD_HUM;
+        if (dev->battery_pct != 0) available |= FIELD_BAT;
+        if (dev->battery_mv != 0) available |= FIELD_BATMV;
+        
+        json_field_float(w, "temp", dev->temperature, 1);
+        json_field_int(w, "hum", dev->humidity);
+        json_field_int(w, "bat", dev->battery_pct);
+        json_field_int(w, "batMv", dev->battery_mv);
+        json_field_string(w, "firmware", firmware[0] ? firmware : "Unknown");
+    }
+    json_field_string(w, "source", source[0] ? source : "local");
+    json_field_bool(w, "saved", dev->visible);
+    json_field_bool(w, "showMac", dev->show_mac);
+    json_field_bool(w, "showIp", dev->show_ip);
+    json_field_int(w, "fieldMask", dev->field_mask);
+    json_field_int(w, "availableFields", available);
+    json_field_uint(w, "ageSec", age_sec);
+    json_object_end(w);
+}
+
+// Array of the visible (or all) devices in MAC order, only those changed
+// after since_version unless full. Devices are copied out one at a time
+// while streaming, so memory use doesn't grow with the device count.
+// Returns false if out of memory (nothing written).
+static bool devices_json_write(json_writer_t *w, bool show_all, bool full, uint32_t since_version) {
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    device_key_t *keys;
+    int count = device_store_keys(&keys, show_all ? NULL : device_is_visible);
+    if (count < 0) {
+        return false;
+    }
+    json_array_begin(w);
+    for (int k = 0; k < count && !w->failed; k++) {
+        device_snapshot_t snap;
+        if (!device_store_read(keys[k].addr, &snap)) {
+            continue;  // Forgotten meanwhile
+        }
+        const ble_device_t *dev = &snap.dev;
+        if (!full && dev->version <= since_version) {
+            continue;  // Client is up to date
+        }
+        // Skip master devices if master BLE is disabled
+        // (if the source is "local" or empty, it's a master device)
+        if (!master_ble_enabled && (dev->source_id == RX_SOURCE_NONE || dev->source_id == SOURCE_ID_LOCAL)) {
+            continue;
+        }
+        device_json_write(w, &snap, now_ms);
+    }
+    free(keys);
+    json_array_end(w);
+    return true;
+}
+
+// API: Return all VISIBLE devices as JSON (or all if ?all=1)
+//
+// Delta sync: the ETag is the store version, so an unchanged list answers
+// If-None-Match with 304. With ?since=<cursor> (the cursor of an earlier
+// reply) the reply is {"cursor","full","devices"} holding only devices
+// changed since then, or every device with full=true if the client must
+// replace its list (a device was removed or hidden, or the board rebooted).
+// /ws pushes the same messages as they happen.
+static esp_err_t api_devices_handler(httpd_req_t *req) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    // Check if parameter ?all=1
+    bool show_all = false;
+    bool delta = false;
+    char since[DEVICE_CURSOR_LEN] = "";
+    char query[96];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char all_param[8];
+        if (httpd_query_key_value(query, "all", all_param, sizeof(all_param)) == ESP_OK) {
+            show_all = (strcmp(all_param, "1") == 0);
+        }
+        delta = (httpd_query_key_value(query, "since", since, sizeof(since)) == ESP_OK);
+    }
+    
+    // Read the version before the devices: anything changed while streaming
+    // is sent again next time rather than missed
+    uint32_t version = atomic_load(&device_version);
+    char cursor[DEVICE_CURSOR_LEN];
+    device_cursor_format(cursor, sizeof(cursor), device_epoch, version);
+    char etag[DEVICE_ETAG_LEN];
+    device_etag_format(etag, sizeof(etag), device_epoch, version, show_all);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    
+    char if_none_match[DEVICE_ETAG_LEN];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, etag) == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    
+    // Devices changed after since_version, or all of them if full
+    uint32_t since_version = 0;
+    bool full = !(delta && device_cursor_resume(since, device_epoch, atomic_load(&device_removed_version),
+                                                version, &since_version));
+    
+    ESP_LOGD(TAG, "API /api/devices called, devices total: %d, show_all=%d, since=%s",
+             device_count, show_all, delta ? since : "-");
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    if (delta) {
+        json_object_begin(&w);
+        json_field_string(&w, "cursor", cursor);
+        json_field_bool(&w, "full", full);
+        json_key(&w, "devices");
+    }
+    if (!devices_json_write(&w, show_all, full, since_version)) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    if (delta) {
+        json_object_end(&w);
+    }
+    return json_response_end(&w, req);
+}
+
+// ============================================
+// LIVE PUSH (WebSocket /ws)
+// ============================================
+
+// Writer output for one push message: each flushed buffer goes out as a
+// fragment of one text frame, the message ends with an empty final frame
+typedef struct {
+    int fd;
+    bool started;
+} push_send_t;
+
+static bool push_ws_flush(void *ctx, const char *data, size_t len) {
+    push_send_t *ps = ctx;
+    httpd_ws_frame_t frame = {
+        .final = false,
+        .fragmented = true,
+        .type = ps->started ? HTTPD_WS_TYPE_CONTINUE : HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)data,
+        .len = len,
+    };
+    ps->started = true;
+    return httpd_ws_send_data(server, ps->fd, &frame) == ESP_OK;
+}
+
+// Send a client what changed since its cursor (everything if it isn't
+// synced or devices were removed meanwhile). Returns false if the client
+// is gone.
+static bool push_client_send(const push_client_t *c, uint32_t version) {
+    bool full = !c->synced || c->version < atomic_load(&device_removed_version);
+    char cursor[DEVICE_CURSOR_LEN];
+    device_cursor_format(cursor, sizeof(cursor), device_epoch, version);
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    push_send_t ps = { .fd = c->fd, .started = false };
+    json_writer_t w;
+    json_writer_init(&w, json_buf, sizeof(json_buf), push_ws_flush, &ps);
+    json_object_begin(&w);
+    json_field_string(&w, "cursor", cursor);
+    json_field_bool(&w, "full", full);
+    json_key(&w, "devices");
+    if (!devices_json_write(&w, c->show_all, full, c->version)) {
+        json_array_begin(&w);  // Out of memory: retried on the next change
+        json_array_end(&w);
+    }
+    json_object_end(&w);
+    if (!json_writer_finish(&w)) {
+        return false;
+    }
+    httpd_ws_frame_t end = {
+        .final = true,
+        .fragmented = true,
+        .type = HTTPD_WS_TYPE_CONTINUE,
+        .payload = NULL,
+        .len = 0,
+    };
+    return httpd_ws_send_data(server, c->fd, &end) == ESP_OK;
+}
+
+static int push_client_find(int fd) {
+    for (int i = 0; i < atomic_load(&push_client_count); i++) {
+        if (push_clients[i].fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void push_client_remove(int fd) {
+    xSemaphoreTake(push_lock, portMAX_DELAY);
+    int i = push_client_find(fd);
+    if (i >= 0) {
+        int last = atomic_load(&push_client_count) - 1;
+        push_clients[i] = push_clients[last];
+        atomic_store(&push_client_count, last);
+    }
+    xSemaphoreGive(push_lock);
+}
+
+// Fans out device changes: woken by device_touch(), sends each client its
+// delta once its interval has passed since the previous message. Clients
+// are sent to one after another, so a send that doesn't complete within
+// PUSH_SEND_TIMEOUT_MS (socket send timeout, set at the handshake) drops
+// that client rather than holding up the others.
+static void push_task(void *arg) {
+    uint32_t wait_ms = PUSH_INTERVAL_MAX_MS;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+        wait_ms = PUSH_INTERVAL_MAX_MS;
+        
+        push_client_t clients[PUSH_MAX_CLIENTS];
+        xSemaphoreTake(push_lock, portMAX_DELAY);
+        int count = atomic_load(&push_client_count);
+        memcpy(clients, push_clients, count * sizeof(push_client_t));
+        xSemaphoreGive(push_lock);
+        
+        for (int i = 0; i < count; i++) {
+            push_client_t *c = &clients[i];
+            // The session may have closed (and its fd been reused) meanwhile
+            if (httpd_ws_get_fd_info(server, c->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+                push_client_remove(c->fd);
+                continue;
+            }
+            uint32_t version = atomic_load(&device_version);
+            if (c->synced && c->version == version) {
+                continue;
+            }
+            uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+            uint32_t elapsed = now_ms - c->last_send_ms;
+            if (c->synced && elapsed < c->interval_ms) {
+                // Coalesce: send what accumulated once the interval is up
+                if (c->interval_ms - elapsed < wait_ms) {
+                    wait_ms = c->interval_ms - elapsed;
+                }
+                continue;
+            }
+            if (!push_client_send(c, version)) {
+                ESP_LOGI(TAG, "📡 Live client %d gone or too slow", c->fd);
+                push_client_remove(c->fd);
+                httpd_sess_trigger_close(server, c->fd);
+                continue;
+            }
+            xSemaphoreTake(push_lock, portMAX_DELAY);
+            int j = push_client_find(c->fd);
+            if (j >= 0) {
+                push_clients[j].synced = true;
+                push_clients[j].version = version;
+                push_clients[j].last_send_ms = now_ms;
+            }
+            xSemaphoreGive(push_lock);
+        }
+    }
+}
+
+// WebSocket /ws[?all=1][&interval=<ms>]: called once for the handshake
+// (registers the client) and then for each frame the client sends (ignored)
+static esp_err_t ws_handler(httpd_req_t *req) {
+    int fd = httpd_req_to_sockfd(req);
+    if (req->method == HTTP_GET) {
+        bool show_all = false;
+        uint32_t interval_ms = PUSH_INTERVAL_MS;
+        char query[64];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+            char param[8];
+            if (httpd_query_key_value(query, "all", param, sizeof(param)) == ESP_OK) {
+                show_all = (strcmp(param, "1") == 0);
+            }
+            if (httpd_query_key_value(query, "interval", param, sizeof(param)) == ESP_OK) {
+                interval_ms = strtoul(param, NULL, 10);
+                if (interval_ms < PUSH_INTERVAL_MIN_MS) interval_ms = PUSH_INTERVAL_MIN_MS;
+                if (interval_ms > PUSH_INTERVAL_MAX_MS) interval_ms = PUSH_INTERVAL_MAX_MS;
+            }
+        }
+        
+        xSemaphoreTake(push_lock, portMAX_DELAY);
+        int i = push_client_find(fd);  // A stale entry of a reused fd is replaced
+        if (i < 0 && atomic_load(&push_client_count) < PUSH_MAX_CLIENTS) {
+            i = atomic_load(&push_client_count);
+            atomic_store(&push_client_count, i + 1);
+        }
+        if (i >= 0) {
+            push_clients[i] = (push_client_t){
+                .fd = fd,
+                .show_all = show_all,
+                .interval_ms = interval_ms,
+            };
+        }
+        xSemaphoreGive(push_lock);
+        if (i < 0) {
+            ESP_LOGW(TAG, "📡 Live client limit (%d) reached", PUSH_MAX_CLIENTS);
+            return ESP_FAIL;
+        }
+        // The handshake reply is out; from now on only push_task sends here
+        struct timeval send_timeout = { .tv_sec = 0, .tv_usec = PUSH_SEND_TIMEOUT_MS * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+        ESP_LOGI(TAG, "📡 Live client %d connected (all=%d, interval %lu ms)", fd, show_all,
+                 (unsigned long)interval_ms);
+        xTaskNotifyGive(push_task_handle);  // First message: the full list
+        return ESP_OK;
+    }
+    
+    // Nothing is expected from clients: read and drop the frame
+    uint8_t buf[64];
+    httpd_ws_frame_t frame = { .payload = buf };
+    if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (frame.len > sizeof(buf)) {
+        return ESP_FAIL;
+    }
+    return httpd_ws_recv_frame(req, &frame, frame.len);
+}
+
+static void push_init(void) {
+    push_lock = xSemaphoreCreateMutex();
+    xTaskCreate(push_task, "push", 5120, NULL, 4, &push_task_handle);  // JSON_CHUNK_SIZE buffer on the stack
+}
+
+// Streams history points onto a fixed grid of width-second slots, writing
+// null for slots without data. Samples and rollup buckets are merged into
+// the slot they start in; inputs must arrive in time order.
+typedef struct {
+    json_writer_t *w;
+    bool started;
+    bool min_max;         // Points carry min/max as well as the average
+    uint32_t width;       // Grid slot width in seconds
+    uint32_t first_slot;  // Grid slot of the first point
+    uint32_t cur_slot;    // Slot being accumulated
+    uint32_t from_time;   // Inputs before this are outside the requested range
+    uint32_t until_time;  // Inputs from this time on come from another source
+    rollup_acc_t acc;
+} history_emit_t;
+
+// Write out the accumulated slot
+static void history_emit_slot(history_emit_t *em) {
+    json_writer_t *w = em->w;
+    rollup_bucket_t b;
+    rollup_acc_pack(&em->acc, &b);
+    if (b.count == 0) {
+        json_null(w);
+        return;
+    }
+    json_array_begin(w);
+    json_float(w, b.t_avg / 10.0f, 1);
+    json_int(w, b.h_avg);
+    if (em->min_max) {
+        json_float(w, (b.t_avg - b.t_below) / 10.0f, 1);
+        json_float(w, (b.t_avg + b.t_above) / 10.0f, 1);
+        json_int(w, b.h_avg - b.h_below);
+        json_int(w, b.h_avg + b.h_above);
+    }
+    json_array_end(w);
+}
+
+// Move to the slot of time; false if the input is out of range or behind
+static bool history_emit_seek(history_emit_t *em, uint32_t time) {
+    if (time < em->from_time || time >= em->until_time) {
+        return false;
+    }
+    uint32_t slot = time / em->width;
+    if (!em->started) {
+        em->started = true;
+        em->first_slot = slot;
+        em->cur_slot = slot;
+        rollup_acc_reset(&em->acc, slot);
+        return true;
+    }
+    if (slot < em->cur_slot) {
+        return false;  // Already covered
+    }
+    if (slot > em->cur_slot) {
+        history_emit_slot(em);
+        while (++em->cur_slot < slot) {
+            json_null(em->w);
+        }
+        rollup_acc_reset(&em->acc, slot);
+    }
+    return true;
+}
+
+static void history_emit_sample(history_emit_t *em, uint32_t time, const history_sample_t *sample) {
+    if (sample->valid && history_emit_seek(em, time)) {
+        rollup_acc_add(&em->acc, sample->temp, sample->hum);
+    }
+}
+
+static void history_emit_bucket(history_emit_t *em, uint32_t time, const rollup_bucket_t *bucket) {
+    if (bucket->count > 0 && history_emit_seek(em, time)) {
+        rollup_acc_merge(&em->acc, bucket);
+    }
+}
+
+static void history_emit_flash_sample(void *ctx, uint32_t time, const history_sample_t *sample) {
+    history_emit_sample((history_emit_t *)ctx, time, sample);
+}
+
+// Flash blocks of the wanted kind: raw samples for the finest tier, rollups otherwise
+static bool history_emit_flash_block(void *ctx, const history_log_block_t *block,
+                                     const uint8_t *payload, uint16_t len) {
+    history_emit_t *em = (history_emit_t *)ctx;
+    if (!em->min_max && block->kind == HISTORY_LOG_KIND_SAMPLES && block->interval_s == HISTORY_INTERVAL_S) {
+        history_log_decode(block, payload, len, history_emit_flash_sample, ctx);
+    } else if (em->min_max && block->kind == HISTORY_LOG_KIND_ROLLUP) {
+        for (uint16_t k = 0; k < block->count && (k + 1) * sizeof(rollup_bucket_t) <= len; k++) {
+            rollup_bucket_t bucket;
+            memcpy(&bucket, payload + k * sizeof(rollup_bucket_t), sizeof(bucket));
+            history_emit_bucket(em, block->start_time + k * block->interval_s, &bucket);
+        }
+    }
+    return true;
+}
+
+static void uplink_sink_write(json_writer_t *w, const uplink_sink_t *sink, bool enabled) {
+    int64_t now = esp_timer_get_time();
+    uint32_t pending = uplink_queue_pending(&uplink_queue, sink->cursor);
+    
+    json_key(w, sink->name);
+    json_object_begin(w);
+    json_field_bool(w, "enabled", enabled);
+    json_field_uint(w, "cursor", sink->cursor);
+    json_field_uint(w, "pending", pending);
+    
+    // Lag: age of the oldest reading not yet delivered
+    json_key(w, "lagSec");
+    if (pending > 0) {
+        uplink_reading_t r;
+        uint32_t end;
+        if (uplink_queue_read(&uplink_queue, sink->cursor, &r, 1, &end) == 1 && r.time != 0 && clock_valid()) {
+            json_uint(w, (uint32_t)time(NULL) - r.time);
+        } else {
+            json_null(w);
+        }
+    } else {
+        json_uint(w, 0);
+    }
+    json_field_uint(w, "sent", sink->sent);
+    json_field_uint(w, "dropped", sink->dropped);
+    json_field_uint(w, "rejected", sink->rejected);
+    json_field_uint(w, "failures", sink->failures);
+    json_field_uint(w, "retryInSec", sink->retry_at_us > now ? (sink->retry_at_us - now) / 1000000 : 0);
+    json_key(w, "lastOkAgeSec");
+    if (sink->last_ok_us != 0) {
+        json_uint(w, (now - sink->last_ok_us) / 1000000);
+    } else {
+        json_null(w);
+    }
+    json_object_end(w);
+}
+
+// API: Upload queue depth and per-sink delivery state
+static esp_err_t api_uplink_status_handler(httpd_req_t *req) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_key(&w, "queue");
+    json_object_begin(&w);
+    json_field_bool(&w, "persistent", uplink_persistent);
+    json_field_uint(&w, "capacity", uplink_queue.capacity);
+    json_field_uint(&w, "stored", uplink_queue_pending(&uplink_queue, 0));
+    json_field_uint(&w, "oldestSeq", uplink_queue.oldest_seq);
+    json_field_uint(&w, "nextSeq", uplink_queue.next_seq);
+    json_object_end(&w);
+    
+    json_key(&w, "sinks");
+    json_object_begin(&w);
+    uplink_sink_write(&w, &aio_sink, aio_enabled);
+    uplink_sink_write(&w, &d1_sink, d1_enabled);
+    json_object_end(&w);
+    
+    json_key(&w, "reports");
+    json_object_begin(&w);
+    json_field_uint(&w, "first", report_counts[REPORT_FIRST]);
+    json_field_uint(&w, "change", report_counts[REPORT_CHANGE]);
+    json_field_uint(&w, "heartbeat", report_counts[REPORT_HEARTBEAT]);
+    json_field_uint(&w, "deferred", report_deferred);
+    json_object_end(&w);
+    json_object_end(&w);
+    return json_response_end(&w, req);
+}
+
+static bool device_has_report_override(const ble_device_t *dev) {
+    return dev->report_temp_db != REPORT_DEADBAND_DEFAULT || dev->report_hum_db != REPORT_DEADBAND_DEFAULT;
+}
+
+// Deadband override: a number, or null for "use the default"
+static void report_deadband_write(json_writer_t *w, const char *key, uint8_t db, float scale) {
+    json_key(w, key);
+    if (db == REPORT_DEADBAND_DEFAULT) {
+        json_null(w);
+    } else {
+        json_float(w, db * scale, 2);
+    }
+}
+
+// API: Reporting policy, GET /api/uplink/policy
+static esp_err_t api_uplink_policy_get_handler(httpd_req_t *req) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    device_key_t *keys;
+    int count = device_store_keys(&keys, device_has_report_override);
+    if (count < 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    // Only the POST handler changes the policy after startup, and it runs in
+    // this same httpd task: a plain copy is consistent
+    report_policy_t policy = report_policy;
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_key(&w, "default");
+    json_object_begin(&w);
+    json_field_float(&w, "tempDeadband", policy.temp_deadband_centi / 100.0f, 2);
+    json_field_uint(&w, "humDeadband", policy.hum_deadband);
+    json_field_uint(&w, "batteryDeadband", policy.battery_deadband);
+    json_field_uint(&w, "minIntervalSec", policy.min_interval_s);
+    json_field_uint(&w, "maxIntervalSec", policy.max_interval_s);
+    json_object_end(&w);
+    
+    json_key(&w, "devices");
+    json_array_begin(&w);
+    for (int i = 0; i < count; i++) {
+        device_snapshot_t snap;
+        if (!device_store_read(keys[i].addr, &snap)) {
+            continue;
+        }
+        const ble_device_t *dev = &snap.dev;
+        json_object_begin(&w);
+        json_key(&w, "mac");
+        json_stringf(&w, "%02X:%02X:%02X:%02X:%02X:%02X",
+            dev->addr[0], dev->addr[1], dev->addr[2], dev->addr[3], dev->addr[4], dev->addr[5]);
+        json_field_string(&w, "name", snap.name);
+        report_deadband_write(&w, "tempDeadband", dev->report_temp_db, 0.01f);
+        report_deadband_write(&w, "humDeadband", dev->report_hum_db, 1.0f);
+        json_object_end(&w);
+    }
+    free(keys);
+    json_array_end(&w);
+    json_object_end(&w);
+    return json_response_end(&w, req);
+}
+
+// Number after "key": in a flat JSON object. Returns 1 if found, 0 if the
+// key is missing and -1 if it is null or not a number.
+static int json_get_number(const char *json, const char *key, float *out) {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    if (!p) {
+        return 0;
+    }
+    p += strlen(pattern);
+    while (*p == ' ') {
+        p++;
+    }
+    char *end;
+    *out = strtof(p, &end);
+    return (end == p) ? -1 : 1;
+}
+
+// API: Change the reporting policy, POST /api/uplink/policy
+// {"tempDeadband":0.2,"humDeadband":2,"batteryDeadband":5,"minIntervalSec":60,"maxIntervalSec":3600}
+// sets the default (fields left out keep their value). With "mac", only the
+// device's deadbands are set; null returns them to the default.
+static esp_err_t api_uplink_policy_post_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/json");
+    char buf[256];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+    
+    float temp_db, hum_db, bat_db, min_s, max_s;
+    int has_temp = json_get_number(buf, "tempDeadband", &temp_db);
+    int has_hum = json_get_number(buf, "humDeadband", &hum_db);
+    
+    char mac[24] = {0};
+    char *mac_start = strstr(buf, "\"mac\":\"");
+    if (mac_start) {
+        sscanf(mac_start + 7, "%17[^\"]", mac);
+        
+        // Per device: 0.01 °C steps up to 2.54 °C, whole %RH
+        if ((has_temp == 1 && (temp_db < 0 || temp_db > 2.54f)) ||
+            (has_hum == 1 && (hum_db < 0 || hum_db > 100))) {
+            return json_send_error(req, "Deadband out of range");
+        }
+        device_write_begin();
+        int idx = find_device_by_mac_str(mac);
+        if (idx < 0) {
+            device_write_end();
+            return json_send_error(req, "Device not found");
+        }
+        ble_device_t *dev = &devices[idx];
+        if (has_temp) {
+            dev->report_temp_db = (has_temp == 1) ? (uint8_t)lroundf(temp_db * 100.0f) : REPORT_DEADBAND_DEFAULT;
+        }
+        if (has_hum) {
+            dev->report_hum_db = (has_hum == 1) ? (uint8_t)lroundf(hum_db) : REPORT_DEADBAND_DEFAULT;
+        }
+        uint8_t addr[6];
+        memcpy(addr, dev->addr, 6);
+        uint8_t dev_temp_db = dev->report_temp_db;
+        uint8_t dev_hum_db = dev->report_hum_db;
+        device_write_end();
+        
+        save_report_deadbands(addr, dev_temp_db, dev_hum_db);
+        ESP_LOGI(TAG, "Report deadbands for %s: temp=%u, hum=%u", mac, dev_temp_db, dev_hum_db);
+        httpd_resp_sendstr(req, "{\"ok\":true}");
+        return ESP_OK;
+    }
+    
+    int has_bat = json_get_number(buf, "batteryDeadband", &bat_db);
+    int has_min = json_get_number(buf, "minIntervalSec", &min_s);
+    int has_max = json_get_number(buf, "maxIntervalSec", &max_s);
+    if (has_temp < 0 || has_hum < 0 || has_bat < 0 || has_min < 0 || has_max < 0) {
+        return json_send_error(req, "Invalid number");
+    }
+    bool valid = (!has_temp || (temp_db >= 0 && temp_db <= 100)) &&
+                 (!has_hum || (hum_db >= 0 && hum_db <= 100)) &&
+                 (!has_bat || (bat_db >= 0 && bat_db <= 100)) &&
+                 (!has_min || (min_s >= 0 && min_s <= UINT16_MAX)) &&
+                 (!has_max || (max_s >= 0 && max_s <= UINT16_MAX));
+    if (!valid) {
+        return json_send_error(req, "Value out of range");
+    }
+    
+    device_write_begin();
+    report_policy_t policy = report_policy;
+    if (has_temp) {
+        policy.temp_deadband_centi = (uint16_t)lroundf(temp_db * 100.0f);
+    }
+    if (has_hum) {
+        policy.hum_deadband = (uint8_t)lroundf(hum_db);
+    }
+    if (has_bat) {
+        policy.battery_deadband = (uint8_t)lroundf(bat_db);
+    }
+    if (has_min) {
+        policy.min_interval_s = (uint16_t)min_s;
+    }
+    if (has_max) {
+        policy.max_interval_s = (uint16_t)max_s;
+    }
+    if (policy.max_interval_s > 0 && policy.max_interval_s < policy.min_interval_s) {
+        device_write_end();
+        return json_send_error(req, "maxIntervalSec is below minIntervalSec");
+    }
+    report_policy = policy;
+    device_write_end();
+    report_policy_save(&policy);
+    ESP_LOGI(TAG, "Report policy: temp=%u, hum=%u, bat=%u, min=%u s, max=%u s",
+             policy.temp_deadband_centi, policy.hum_deadband, policy.battery_deadband,
+             policy.min_interval_s, policy.max_interval_s);
+    httpd_resp_sendstr(req, "{\"ok\":true}");
+    return ESP_OK;
+}
+
+// API: Sensor history, GET /api/history?mac=AA:BB:CC:DD:EE:FF&hours=24&points=200
+// Picks the finest resolution (1 min, 15 min, 1 h, or merged hours) that
+// fits the point budget. Older data comes from the flash log (once the clock
+// is synced), recent data from RAM. "points" holds one entry per intervalSec
+// slot, oldest first, null where the sensor wasn't heard; the first point is
+// startAgeSec old. Entries are [temp, hum] at 1-min resolution and
+// [temp, hum, tempMin, tempMax, humMin, humMax] for rollups (averages first).
+static esp_err_t api_history_handler(httpd_req_t *req) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    
+    char query[128];
+    char mac_str[20] = {0};
+    int hours = 24;
+    int budget = HISTORY_POINT_BUDGET;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        httpd_query_key_value(query, "mac", mac_str, sizeof(mac_str));
+        char param[8];
+        if (httpd_query_key_value(query, "hours", param, sizeof(param)) == ESP_OK) {
+            hours = atoi(param);
+        }
+        if (httpd_query_key_value(query, "points", param, sizeof(param)) == ESP_OK) {
+            budget = atoi(param);
+        }
+    }
+    uint8_t addr[6];
+    if (sscanf(mac_str, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+               &addr[0], &addr[1], &addr[2], &addr[3], &addr[4], &addr[5]) != 6) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid mac");
+        return ESP_FAIL;
+    }
+    if (hours < 1) {
+        hours = 1;
+    }
+    if (hours > HISTORY_RETENTION_DAYS * 24) {
+        hours = HISTORY_RETENTION_DAYS * 24;
+    }
+    if (budget < 10) {
+        budget = 10;
+    }
+    if (budget > HISTORY_POINT_BUDGET_MAX) {
+        budget = HISTORY_POINT_BUDGET_MAX;
+    }
+    uint32_t range = (uint32_t)hours * 3600;
+    uint32_t merge;
+    int tier = rollup_pick_tier(range, budget, &merge);
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    history_emit_t emit = {
+        .w = &w,
+        .min_max = (tier > 0),
+        .width = (tier > 0 ? rollup_tier_seconds[tier] : HISTORY_INTERVAL_S) * merge,
+    };
+    history_emit_t *em = &emit;
+    
+    // Copy the RAM data of the tier out so the ingest task isn't held up while sending
+    history_series_t series = {0};
+    history_delta_t *slots = NULL;
+    rollup_ring_t ring = {0};
+    rollup_bucket_t *buckets = NULL;
+    rollup_acc_t open = {0};
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+    history_entry_t *e = history_find(addr, false);
+    if (e && tier == 0 && e->series.count > 0) {
+        slots = malloc(HISTORY_SLOTS * sizeof(history_delta_t));
+        if (slots) {
+            series = e->series;
+            memcpy(slots, e->series.slots, HISTORY_SLOTS * sizeof(history_delta_t));
+            series.slots = slots;
+        }
+    } else if (e && tier > 0) {
+        ring = e->rollups[tier - 1];
+        open = e->open[tier - 1];
+        buckets = malloc(ring.capacity * sizeof(rollup_bucket_t));
+        if (buckets) {
+            memcpy(buckets, ring.buckets, ring.capacity * sizeof(rollup_bucket_t));
+        } else {
+            ring.count = 0;
+        }
+        ring.buckets = buckets;
+    }
+    xSemaphoreGive(history_lock);
+    
+    // Grid times are unix times when the clock is valid, uptime otherwise
+    bool use_clock = clock_valid();
+    uint32_t uptime_now = history_uptime_s();
+    uint32_t now_s = use_clock ? (uint32_t)time(NULL) : uptime_now;
+    uint32_t ram_offset = now_s - uptime_now;  // RAM time -> grid time
+    em->from_time = (now_s > range) ? now_s - range : 0;
+    uint32_t ram_first = now_s + 1;
+    if (slots) {
+        ram_first = (series.last_slot - (series.count - 1)) * HISTORY_INTERVAL_S + ram_offset;
+    } else if (ring.count > 0) {
+        ram_first = ring.last_start - (ring.count - 1) * ring.interval + ram_offset;
+    } else if (open.count > 0) {
+        ram_first = open.start + ram_offset;
+    }
+    
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_key(&w, "points");
+    json_array_begin(&w);
+    
+    // Flash log for everything older than the RAM copy
+    if (use_clock && history_log_ready && em->from_time < ram_first) {
+        em->until_time = ram_first;
+        xSemaphoreTake(history_log_lock, portMAX_DELAY);
+        history_log_query(&history_log, addr, em->from_time, ram_first - 1, history_emit_flash_block, em);
+        xSemaphoreGive(history_log_lock);
+    }
+    
+    // RAM data
+    em->until_time = UINT32_MAX;
+    if (slots) {
+        history_cursor_t cursor;
+        history_sample_t sample;
+        history_series_begin(&series, series.count, &cursor);
+        while (history_series_next(&series, &cursor, &sample)) {
+            history_emit_sample(em, sample.slot * HISTORY_INTERVAL_S + ram_offset, &sample);
+        }
+    }
+    for (int age = ring.count - 1; age >= 0; age--) {
+        uint32_t start;
+        const rollup_bucket_t *bucket = rollup_ring_get(&ring, age, &start);
+        history_emit_bucket(em, start + ram_offset, bucket);
+    }
+    if (open.count > 0) {
+        rollup_bucket_t bucket;
+        rollup_acc_pack(&open, &bucket);
+        history_emit_bucket(em, open.start + ram_offset, &bucket);
+    }
+    if (em->started) {
+        history_emit_slot(em);
+    }
+    
+    json_array_end(&w);
+    json_key(&w, "mac");
+    json_stringf(&w, "%02X:%02X:%02X:%02X:%02X:%02X", addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
+    json_field_uint(&w, "intervalSec", em->width);
+    json_field_uint(&w, "startAgeSec", em->started ? now_s - em->first_slot * em->width : 0);
+    json_object_end(&w);
+    free(slots);
+    free(buckets);
+    return json_response_end(&w, req);
+}
+
+// IPv4 address (network byte order) a satellite request came from, the
+// registry key. Taken from the socket peer, never from X-Forwarded-For or
+// another header a client could vary to fill the registry. client_ip gets
+// the address for logs. Returns 0 if the peer is unknown.
+static uint32_t satellite_request_ip(httpd_req_t *req, char *client_ip, size_t size) {
+    struct sockaddr_in6 client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+    struct in_addr ipv4_addr = { .s_addr = 0 };
+    
+    int sockfd = httpd_req_to_sockfd(req);
+    if (getpeername(sockfd, (struct sockaddr *)&client_addr, &addr_len) != 0) {
+        ESP_LOGE(TAG, "getpeername failed");
+        return 0;
+    }
+    if (client_addr.sin6_family == AF_INET) {
+        ipv4_addr = ((struct sockaddr_in *)&client_addr)->sin_addr;
+    } else if (client_addr.sin6_family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&client_addr.sin6_addr)) {
+        memcpy(&ipv4_addr, &client_addr.sin6_addr.s6_addr[12], 4);
+    }
+    inet_ntoa_r(ipv4_addr, client_ip, size);
+    return ipv4_addr.s_addr;
+}
+
+// Account for one upload in the latency histogram of a registered satellite
+static void satellite_request_done(uint32_t ip, int64_t start_us) {
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    taskENTER_CRITICAL(&satellite_lock);
+    int slot = sat_registry_find(&satellites, ip);
+    if (slot >= 0) {
+        sat_registry_request(&satellites, slot, ms);
+    }
+    taskEXIT_CRITICAL(&satellite_lock);
+}
+
+// Edge filter counters a satellite reports on its uploads,
+// ?forwarded=<n>&filtered=<n> (since its boot). Kept only for a satellite
+// the upload registered.
+static void satellite_report_counters(httpd_req_t *req, uint32_t ip) {
+    char query[64];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        return;
+    }
+    char param[12];
+    bool has_forwarded = (httpd_query_key_value(query, "forwarded", param, sizeof(param)) == ESP_OK);
+    uint32_t forwarded = has_forwarded ? strtoul(param, NULL, 10) : 0;
+    bool has_filtered = (httpd_query_key_value(query, "filtered", param, sizeof(param)) == ESP_OK);
+    uint32_t filtered = has_filtered ? strtoul(param, NULL, 10) : 0;
+    if (!has_forwarded && !has_filtered) {
+        return;
+    }
+    taskENTER_CRITICAL(&satellite_lock);
+    int slot = sat_registry_find(&satellites, ip);
+    if (slot >= 0) {
+        if (has_forwarded) {
+            satellites.slots[slot].forwarded = forwarded;
+        }
+        if (has_filtered) {
+            satellites.slots[slot].filtered = filtered;
+        }
+    }
+    taskEXIT_CRITICAL(&satellite_lock);
+}
+
+// Batch of observations, binary (sat_frame.h) or a JSON array (sat_json.h),
+// read and decoded in chunks, so a batch can be any size. One reply for the
+// whole batch: {"status","accepted","dropped","invalid"}.
+static esp_err_t satellite_batch_receive(httpd_req_t *req, const char *client_ip, uint32_t ip, bool binary) {
+    sat_frame_ingest_t in = { .ring = &sat_adv_ring, .ip = ip, .source_id = RX_SOURCE_NONE };
+    
+    union {
+        sat_frame_decoder_t frame;
+        sat_json_decoder_t json;
+    } dec;
+    if (binary) {
+        sat_frame_decoder_init(&dec.frame);
+    } else {
+        sat_json_decoder_init(&dec.json);
+    }
+    uint8_t buf[512];
+    size_t remaining = req->content_len;
+    while (remaining > 0) {
+        int ret = httpd_req_recv(req, (char *)buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        remaining -= ret;
+        bool ok = binary ? sat_frame_decode(&dec.frame, buf, ret, sat_frame_ingest_record, &in) == SAT_FRAME_OK
+                         : sat_json_decode(&dec.json, buf, ret, sat_frame_ingest_record, &in) == SAT_JSON_OK;
+        if (!ok) {
+            break;
+        }
+    }
+    const char *error = NULL;
+    uint32_t invalid = 0;
+    if (binary) {
+        sat_frame_status_t status = sat_frame_decoder_finish(&dec.frame);
+        if (status != SAT_FRAME_OK) {
+            error = sat_frame_status_str(status);
+        }
+    } else {
+        sat_json_status_t status = sat_json_decoder_finish(&dec.json);
+        if (status != SAT_JSON_OK) {
+            error = sat_json_status_str(status);
+        }
+        invalid = dec.json.invalid;
     }
     
-    return ESP_OK;
+    ESP_LOGD(TAG, "🛰️  Batch from %s: %lu accepted, %lu dropped (ingest ring or registry full), %lu invalid",
+             client_ip, (unsigned long)in.accepted, (unsigned long)in.dropped, (unsigned long)invalid);
+    satellite_count_failures(ip, invalid + (error ? 1 : 0));
+    if (error) {
+        ESP_LOGW(TAG, "🛰️  Bad batch from %s: %s", client_ip, error);
+        httpd_resp_set_status(req, HTTPD_400);
+    }
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_string(&w, "status", error ? error : "ok");
+    json_field_uint(&w, "accepted", in.accepted);
+    json_field_uint(&w, "dropped", in.dropped);
+    json_field_uint(&w, "invalid", invalid);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
-// API: Diagnostics (crash logs, memory, boot count)
-static esp_err_t api_diagnostics_handler(httpd_req_t *req) {
-    httpd_resp_set_type(req, "application/json");
-    
-    // Get diagnostics from NVS
-    nvs_handle_t diag_nvs;
-    uint32_t boot_count = 0;
-    uint32_t last_reset = 0;
+static bool satellite_is_binary(httpd_req_t *req) {
+    char content_type[32];
+    return httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type)) == ESP_OK &&
+           strncmp(content_type, SAT_FRAME_CONTENT_TYPE, strlen(SAT_FRAME_CONTENT_TYPE)) == 0;
+}
+
+// API: Batch of satellite observations, POST /api/satellite-batch
+// (JSON array, or binary frames with Content-Type application/x-sat-frame)
+static esp_err_t api_satellite_batch_handler(httpd_req_t *req) {
+    int64_t start_us = esp_timer_get_time();
+    char client_ip[16] = {0};
+    uint32_t ip = satellite_request_ip(req, client_ip, sizeof(client_ip));
+    if (ip == 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    esp_err_t err = satellite_batch_receive(req, client_ip, ip, satellite_is_binary(req));
+    satellite_report_counters(req, ip);
+    satellite_request_done(ip, start_us);
+    return err;
+}
+
+static void sat_policy_save(const sat_policy_t *policy) {
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_set_blob(nvs, "sat_policy", policy, sizeof(*policy));
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+}
+
+// Stored policy, if any (else the compiled-in defaults stay)
+static void sat_policy_load(nvs_handle_t nvs) {
+    sat_policy_t stored;
+    size_t len = sizeof(stored);
+    if (nvs_get_blob(nvs, "sat_policy", &stored, &len) == ESP_OK && len == sizeof(stored)) {
+        sat_policy = stored;
+    }
+}
+
+// API: Edge filtering policy for satellites, GET /api/satellite/policy
+//
+// {"watchAll","watch":["AABBCCDDEEFF",...],"dedupe","minIntervalMs","refreshMs","ttlSec"}
+// The watch list holds the visible devices, the only ones the hub keeps
+// data for; in discovery mode watchAll is true and everything is wanted.
+// The ETag is a hash of the whole reply, so satellites polling every
+// ttlSec with If-None-Match mostly get 304. Satellites apply the policy as
+// sat_policy.h does and report their counters on uploads.
+static esp_err_t api_satellite_policy_get_handler(httpd_req_t *req) {
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    char client_ip[16] = {0};
+    uint32_t ip = satellite_request_ip(req, client_ip, sizeof(client_ip));
     
-    if (nvs_open("diagnostics", NVS_READONLY, &diag_nvs) == ESP_OK) {
-        nvs_get_u32(diag_nvs, "boot_count", &boot_count);
-        nvs_get_u32(diag_nvs, "last_reset", &last_reset);
-        nvs_close(diag_nvs);
+    bool watch_all = allow_new_devices;
+    device_key_t *keys = NULL;
+    int count = 0;
+    if (!watch_all) {
+        count = device_store_keys(&keys, device_is_visible);
+        if (count < 0) {
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
     }
     
-    // Reset reason strings
-    const char* reset_reasons[] = {
-        "UNKNOWN", "POWERON", "EXT", "SW", "PANIC", "INT_WDT",
-        "TASK_WDT", "WDT", "DEEPSLEEP", "BROWNOUT", "SDIO"
-    };
-    const char* reset_str = (last_reset < 11) ? reset_reasons[last_reset] : "UNKNOWN";
+    // Keys are sorted, so the same watch list always hashes the same
+    sat_policy_t policy = sat_policy;
+    uint32_t hash = sat_policy_etag(&policy, watch_all, (const uint8_t *)keys, count);
+    char etag[16];
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)hash);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
     
-    // Memory stats
-    uint32_t free_heap = esp_get_free_heap_size();
-    uint32_t min_free_heap = esp_get_minimum_free_heap_size();
-    uint32_t largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    char if_none_match[16];
+    bool current = (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+                    strcmp(if_none_match, etag) == 0);
     
-    // Uptime
-    uint32_t uptime_sec = (uint32_t)(esp_timer_get_time() / 1000000);
+    // Fetch stats only for satellites already registered by an upload
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    taskENTER_CRITICAL(&satellite_lock);
+    int slot = sat_registry_find(&satellites, ip);
+    if (slot >= 0) {
+        sat_entry_t *stats = &satellites.slots[slot];
+        stats->policy_fetches++;
+        stats->policy_ms = now_ms;
+        stats->policy_current = current;
+    }
+    taskEXIT_CRITICAL(&satellite_lock);
     
-    // BLE stats (total advertisements received)
-    uint32_t ble_rate = ble_adv_count;
+    if (current) {
+        free(keys);
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
     
-    char response[512];
-    snprintf(response, sizeof(response),
-        "{\"bootCount\":%lu,"
-        "\"lastReset\":\"%s\","
-        "\"uptimeSec\":%lu,"
-        "\"freeHeap\":%lu,"
-        "\"minFreeHeap\":%lu,"
-        "\"largestBlock\":%lu,"
-        "\"bleAdvCount\":%lu,"
-        "\"deviceCount\":%d}",
-        boot_count, reset_str, uptime_sec,
-        free_heap, min_free_heap, largest_block,
-        ble_rate, device_count);
-    
-    httpd_resp_send(req, response, strlen(response));
-    return ESP_OK;
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "watchAll", watch_all);
+    json_key(&w, "watch");
+    json_array_begin(&w);
+    for (int i = 0; i < count; i++) {
+        const uint8_t *a = keys[i].addr;
+        json_stringf(&w, "%02X%02X%02X%02X%02X%02X", a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+    free(keys);
+    json_array_end(&w);
+    json_field_bool(&w, "dedupe", policy.dedupe);
+    json_field_uint(&w, "minIntervalMs", policy.min_interval_ms);
+    json_field_uint(&w, "refreshMs", policy.refresh_ms);
+    json_field_uint(&w, "ttlSec", SAT_POLICY_TTL_S);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
-// API: Return all VISIBLE devices as JSON (or all if ?all=1)
-static esp_err_t api_devices_handler(httpd_req_t *req) {
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+// API: Change the edge filtering policy, POST /api/satellite/policy
+// {"dedupe":true,"minIntervalMs":1000,"refreshMs":10000} (fields left out
+// keep their value)
+static esp_err_t api_satellite_policy_post_handler(httpd_req_t *req) {
     httpd_resp_set_type(req, "application/json");
-    
-    // Check if parameter ?all=1
-    bool show_all = false;
-    char query[64];
-    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
-        char all_param[8];
-        if (httpd_query_key_value(query, "all", all_param, sizeof(all_param)) == ESP_OK) {
-            show_all = (strcmp(all_param, "1") == 0);
-        }
-    }
-    
-    ESP_LOGI(TAG, "API /api/devices called, devices total: %d, show_all=%d", device_count, show_all);
-    
-    char *json = malloc(16384);
-    if (!json) {
+    char buf[256];
+    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
+    if (ret <= 0) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
+    buf[ret] = '\0';
     
-    strcpy(json, "[");
-    bool first = true;
+    float min_ms, refresh_ms;
+    int has_min = json_get_number(buf, "minIntervalMs", &min_ms);
+    int has_refresh = json_get_number(buf, "refreshMs", &refresh_ms);
+    if (has_min < 0 || has_refresh < 0) {
+        return json_send_error(req, "Invalid number");
+    }
+    if ((has_min && (min_ms < 0 || min_ms > 3600000)) ||
+        (has_refresh && (refresh_ms < 0 || refresh_ms > 3600000))) {
+        return json_send_error(req, "Value out of range");
+    }
     
-    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-
-    // Collect visible (or all) indices and sort by MAC address
-    int indices[MAX_DEVICES];
-    int count = 0;
-    for (int i = 0; i < device_count; i++) {
-        if (!show_all && !devices[i].visible) {
-            continue;
-        }
-        // Skip master devices if master BLE is disabled
-        if (!master_ble_enabled) {
-            // If the source is "local" or empty, it's a master device
-            if (devices[i].source[0] == '\0' || strcmp(devices[i].source, "local") == 0) {
-                continue;
-            }
-        }
-        indices[count++] = i;
+    sat_policy_t policy = sat_policy;
+    char *dedupe_str = strstr(buf, "\"dedupe\":");
+    if (dedupe_str) {
+        dedupe_str += strlen("\"dedupe\":");
+        while (*dedupe_str == ' ') dedupe_str++;
+        policy.dedupe = (strncmp(dedupe_str, "true", 4) == 0);
     }
-
-    // Simple bubble sort by MAC address (addr)
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            ble_device_t *a = &devices[indices[j]];
-            ble_device_t *b = &devices[indices[j + 1]];
-            if (memcmp(a->addr, b->addr, 6) > 0) {
-                int tmp = indices[j];
-                indices[j] = indices[j + 1];
-                indices[j + 1] = tmp;
-            }
-        }
+    if (has_min) {
+        policy.min_interval_ms = (uint32_t)min_ms;
     }
-    for (int k = 0; k < count; k++) {
-        int i = indices[k];
-        
-        char addr_str[18];
-        snprintf(addr_str, sizeof(addr_str), "%02X:%02X:%02X:%02X:%02X:%02X",
-            devices[i].addr[0], devices[i].addr[1], devices[i].addr[2],
-            devices[i].addr[3], devices[i].addr[4], devices[i].addr[5]);
-        
-        char item[512];
-        uint32_t age_sec = 0;
-        uint32_t ref_ms = devices[i].has_sensor_data ? devices[i].last_sensor_seen : devices[i].last_seen;
-        if (ref_ms > 0 && now_ms >= ref_ms) {
-            age_sec = (now_ms - ref_ms) / 1000;
-        }
-
-        if (devices[i].has_sensor_data) {
-            // Determine which fields the device supports
-            uint16_t available = 0;
-            if (devices[i].temperature != 0) available |= FIELD_TEMP;
-            if (devices[i].humidity != 0) available |= FIELD_HUM;
-            if (devices[i].battery_pct != 0) available |= FIELD_BAT;
-            if (devices[i].battery_mv != 0) available |= FIELD_BATMV;
-            available |= FIELD_RSSI; // RSSI always available
-            available |= FIELD_AGE;  // Update age always available
-            
-            snprintf(item, sizeof(item),
-                "%s{\"addr\":\"%s\",\"name\":\"%s\",\"advName\":\"%s\",\"rssi\":%d,"
-                "\"hasSensor\":true,\"temp\":%.1f,\"hum\":%d,\"bat\":%d,\"batMv\":%d,"
-                "\"firmware\":\"%s\",\"source\":\"%s\","
-                "\"saved\":%s,\"showMac\":%s,\"showIp\":%s,\"fieldMask\":%d,\"availableFields\":%d,\"ageSec\":%lu}",
-                first ? "" : ",",
-                addr_str,
-                devices[i].name[0] ? devices[i].name : "Unknown",
-                devices[i].adv_name[0] ? devices[i].adv_name : "",
-                devices[i].rssi,
-                devices[i].temperature,
-                devices[i].humidity,
-                devices[i].battery_pct,
-                devices[i].battery_mv,
-                devices[i].firmware_type[0] ? devices[i].firmware_type : "Unknown",
-                devices[i].source[0] ? devices[i].source : "local",
-                devices[i].visible ? "true" : "false",
-                devices[i].show_mac ? "true" : "false",
-                devices[i].show_ip ? "true" : "false",
-                devices[i].field_mask,
-                available,
-                (unsigned long)age_sec);
-        } else {
-            snprintf(item, sizeof(item),
-                "%s{\"addr\":\"%s\",\"name\":\"%s\",\"advName\":\"%s\",\"rssi\":%d,"
-                "\"hasSensor\":false,\"source\":\"%s\",\"saved\":%s,\"showMac\":%s,\"showIp\":%s,\"fieldMask\":%d,\"availableFields\":%d,\"ageSec\":%lu}",
-                first ? "" : ",",
-                addr_str,
-                devices[i].name[0] ? devices[i].name : "Unknown",
-                devices[i].adv_name[0] ? devices[i].adv_name : "",
-                devices[i].rssi,
-                devices[i].source[0] ? devices[i].source : "local",
-                devices[i].visible ? "true" : "false",
-                devices[i].show_mac ? "true" : "false",
-                devices[i].show_ip ? "true" : "false",
-                devices[i].field_mask,
-                FIELD_RSSI | FIELD_AGE,
-                (unsigned long)age_sec); // Only RSSI available
-        }
-        strcat(json, item);
-        first = false;
-    }
-    strcat(json, "]");
-    
-    httpd_resp_sendstr(req, json);
-    free(json);
+    if (has_refresh) {
+        policy.refresh_ms = (uint32_t)refresh_ms;
+    }
+    sat_policy = policy;
+    sat_policy_save(&policy);
+    ESP_LOGI(TAG, "Satellite policy: dedupe=%d, min=%lu ms, refresh=%lu ms", policy.dedupe,
+             (unsigned long)policy.min_interval_ms, (unsigned long)policy.refresh_ms);
+    httpd_resp_sendstr(req, "{\"ok\":true}");
     return ESP_OK;
 }
 
-// API: Vastaanota satelliitti-dataa
-static esp_err_t api_satellite_data_handler(httpd_req_t *req) {
+// One JSON object of /api/satellite-data
+static esp_err_t satellite_object_receive(httpd_req_t *req, const char *client_ip, uint32_t ip) {
     char buf[512];
     int ret = httpd_req_recv(req, buf, sizeof(buf)-1);
     if (ret <= 0) {
+        satellite_count_failures(ip, 1);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No data");
         return ESP_FAIL;
     }
     buf[ret] = '\0';
     
-    // Get sender IP address
-    char client_ip[16] = {0};
-    struct sockaddr_in6 client_addr;
-    socklen_t addr_len = sizeof(client_addr);
-    
-    ESP_LOGI(TAG, "🛰️  Getting client IP...");
-    if (httpd_req_get_hdr_value_str(req, "X-Forwarded-For", client_ip, sizeof(client_ip)) == ESP_OK) {
-        ESP_LOGI(TAG, "  X-Forwarded-For: %s", client_ip);
-    } else {
-        ESP_LOGI(TAG, "  No X-Forwarded-For header");
-        // If X-Forwarded-For is missing, use direct connection
-        int sockfd = httpd_req_to_sockfd(req);
-        ESP_LOGI(TAG, "  Socket FD: %d", sockfd);
-        
-        if (getpeername(sockfd, (struct sockaddr *)&client_addr, &addr_len) == 0) {
-            ESP_LOGI(TAG, "  getpeername OK, family: %d (AF_INET=%d, AF_INET6=%d)", 
-                     client_addr.sin6_family, AF_INET, AF_INET6);
-            
-            if (client_addr.sin6_family == AF_INET) {
-                struct sockaddr_in *addr_in = (struct sockaddr_in *)&client_addr;
-                inet_ntoa_r(addr_in->sin_addr, client_ip, sizeof(client_ip));
-                ESP_LOGI(TAG, "  IPv4 address: %s", client_ip);
-            } else if (client_addr.sin6_family == AF_INET6) {
-                // IPv6 address
-                char ipv6_str[INET6_ADDRSTRLEN];
-                inet_ntop(AF_INET6, &client_addr.sin6_addr, ipv6_str, sizeof(ipv6_str));
-                ESP_LOGI(TAG, "  IPv6 address: %s", ipv6_str);
-                // Try to map to IPv4 if it's IPv4-mapped
-                if (IN6_IS_ADDR_V4MAPPED(&client_addr.sin6_addr)) {
-                    struct in_addr ipv4_addr;
-                    memcpy(&ipv4_addr, &client_addr.sin6_addr.s6_addr[12], 4);
-                    inet_ntoa_r(ipv4_addr, client_ip, sizeof(client_ip));
-                    ESP_LOGI(TAG, "  IPv4-mapped: %s", client_ip);
-                }
-            }
-        } else {
-            ESP_LOGE(TAG, "  getpeername FAILED");
-        }
-    }
-    
     ESP_LOGI(TAG, "🛰️  Satellite data from %s (%d bytes)", client_ip, ret);
     
     // Parse JSON: {"mac":"AA:BB:CC:DD:EE:FF","rssi":-65,"data":"0201061AFF..."}
@@ -2101,198 +5607,38 @@ static esp_err_t api_satellite_data_handler(httpd_req_t *req) {
         ESP_LOGI(TAG, "🛰️  SATELLITE: %s, RSSI: %d dBm, hex_len: %d, from: %s",
                  mac_str, rssi, strlen(hex_data), client_ip);
         
-        // Find or add device
-        int idx = -1;
-        for (int i = 0; i < device_count; i++) {
-            if (memcmp(devices[i].addr, mac_addr, 6) == 0) {
-                idx = i;
-                break;
-            }
+        // Convert hex string to bytes
+        uint8_t raw_data[ADV_RING_DATA_MAX];
+        int data_len = strlen(hex_data) / 2;
+        if (data_len > (int)sizeof(raw_data)) {
+            data_len = sizeof(raw_data);
+        }
+        for (int i = 0; i < data_len; i++) {
+            char byte_str[3] = {hex_data[i*2], hex_data[i*2+1], 0};
+            raw_data[i] = (uint8_t)strtol(byte_str, NULL, 16);
         }
         
-        if (idx < 0 && device_count < MAX_DEVICES) {
-            // New device from satellite (default HIDDEN, shown only after selection in scan menu)
-            idx = device_count++;
-            memcpy(devices[idx].addr, mac_addr, 6);
-            devices[idx].visible = load_visibility(mac_addr);
-            devices[idx].show_mac = true;
-            devices[idx].field_mask = FIELD_ALL;
-            devices[idx].adv_name[0] = '\0';
-            load_device_settings(mac_addr, devices[idx].name,
-                               &devices[idx].show_mac,
-                               &devices[idx].show_ip,
-                               &devices[idx].field_mask,
-                               &devices[idx].user_named);
-            if (devices[idx].name[0] == '\0') {
-                snprintf(devices[idx].name, MAX_NAME_LEN, "Sat-%02X%02X", mac_addr[4], mac_addr[5]);
-            }
-            devices[idx].has_sensor_data = false;
-            devices[idx].last_sensor_seen = 0;
-            snprintf(devices[idx].source, sizeof(devices[idx].source), "satellite-%s", client_ip);
-            
-            ESP_LOGI(TAG, "🛰️  New satellite device: %s from %s", mac_str, client_ip);
+        // Carry the JSON name as a trailing Complete Local Name AD structure.
+        // The parser keeps a complete name from the advertisement itself if
+        // there is one, so the JSON name is only a fallback.
+        int name_len = strlen(json_name);
+        if (name_len > (int)sizeof(raw_data) - data_len - 2) {
+            name_len = (int)sizeof(raw_data) - data_len - 2;
+        }
+        if (name_len > 0) {
+            raw_data[data_len++] = name_len + 1;
+            raw_data[data_len++] = BLE_AD_TYPE_NAME_COMPLETE;
+            memcpy(&raw_data[data_len], json_name, name_len);
+            data_len += name_len;
         }
         
-        if (idx >= 0) {
-            sat_adv_count++;
-            
-            // Source = satellite whenever a satellite observation arrives
-            snprintf(devices[idx].source, sizeof(devices[idx].source), "satellite-%s", client_ip);
-            
-            // Always update RSSI and timestamp
-            devices[idx].rssi = rssi;
-            uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            devices[idx].last_seen = now_ms;
-            
-            // Convert hex string to bytes and parse BLE advertisement data
-            uint8_t raw_data[128];
-            int data_len = strlen(hex_data) / 2;
-            for (int i = 0; i < data_len && i < 128; i++) {
-                char byte_str[3] = {hex_data[i*2], hex_data[i*2+1], 0};
-                raw_data[i] = (uint8_t)strtol(byte_str, NULL, 16);
-            }
-            
-            // Parse advertisement fields
-            struct ble_hs_adv_fields fields;
-            int parse_result = ble_hs_adv_parse_fields(&fields, raw_data, data_len);
-            ESP_LOGI(TAG, "  🔍 Parse fields result: %d, data_len: %d", parse_result, data_len);
-            
-            if (parse_result == 0) {
-                // adv_name updates only if the user hasn't set a custom name
-                if (json_name[0] != '\0') {
-                    int copy_len = (strlen(json_name) < MAX_NAME_LEN - 1) ? (int)strlen(json_name) : MAX_NAME_LEN - 1;
-                    if (!devices[idx].user_named) {
-                        memcpy(devices[idx].adv_name, json_name, copy_len);
-                        devices[idx].adv_name[copy_len] = '\0';
-                    }
-                    // Update name if empty, starts with "Sat-", or equals MAC address
-                    bool should_update_name = false;
-                    if (!devices[idx].user_named && devices[idx].name[0] == '\0') {
-                        should_update_name = true;
-                    } else if (!devices[idx].user_named && strncmp(devices[idx].name, "Sat-", 4) == 0) {
-                        should_update_name = true;
-                    } else {
-                        char mac_as_name[18];
-                        snprintf(mac_as_name, sizeof(mac_as_name), "%02X:%02X:%02X:%02X:%02X:%02X",
-                                mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
-                        if (!devices[idx].user_named && strcmp(devices[idx].name, mac_as_name) == 0) {
-                            should_update_name = true;
-                        }
-                    }
-                    if (should_update_name) {
-                        memcpy(devices[idx].name, json_name, copy_len);
-                        devices[idx].name[copy_len] = '\0';
-                        ESP_LOGI(TAG, "  ✏️ Updated name from satellite JSON: %s", devices[idx].name);
-                    }
-                }
-
-                bool has_svc16 = (fields.svc_data_uuid16 != NULL && fields.svc_data_uuid16_len > 0);
-                bool has_mfg = (fields.mfg_data != NULL && fields.mfg_data_len > 0);
-                ESP_LOGI(TAG, "  📦 Payload: svc16=%s len=%d, mfg=%s len=%d",
-                         has_svc16 ? "yes" : "no", fields.svc_data_uuid16_len,
-                         has_mfg ? "yes" : "no", fields.mfg_data_len);
-
-                // Copy device name if user hasn't set custom name
-                if (fields.name != NULL && fields.name_len > 0) {
-                    ESP_LOGI(TAG, "  📛 Device name found: len=%d", fields.name_len);
-                    int copy_len = (fields.name_len < MAX_NAME_LEN - 1) ? fields.name_len : MAX_NAME_LEN - 1;
-                    if (!devices[idx].user_named) {
-                        memcpy(devices[idx].adv_name, fields.name, copy_len);
-                        devices[idx].adv_name[copy_len] = '\0';
-                    }
-                    // Update name if empty, starts with "Sat-", or equals MAC address
-                    bool should_update_name = false;
-                    if (!devices[idx].user_named && devices[idx].name[0] == '\0') {
-                        should_update_name = true;
-                    } else if (!devices[idx].user_named && strncmp(devices[idx].name, "Sat-", 4) == 0) {
-                        should_update_name = true;
-                    } else {
-                        // Tarkista onko nimi vain MAC-osoite muodossa XX:XX:XX:XX:XX:XX
-                        char mac_as_name[18];
-                        snprintf(mac_as_name, sizeof(mac_as_name), "%02X:%02X:%02X:%02X:%02X:%02X",
-                                mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
-                        if (!devices[idx].user_named && strcmp(devices[idx].name, mac_as_name) == 0) {
-                            should_update_name = true;
-                        }
-                    }
-                    if (should_update_name) {
-                        memcpy(devices[idx].name, fields.name, copy_len);
-                        devices[idx].name[copy_len] = '\0';
-                        ESP_LOGI(TAG, "  ✏️ Updated name to: %s", devices[idx].name);
-                    }
-                } else {
-                    ESP_LOGI(TAG, "  📛 No device name in adv/scan response");
-                }
-                
-                // Parse sensor data (pvvx/ATC format UUID 0x181A, MiBeacon UUID 0xFE95, or BTHome v2 UUID 0xFCD2)
-                if (fields.svc_data_uuid16 != NULL && fields.svc_data_uuid16_len >= 13) {
-                    uint16_t uuid = fields.svc_data_uuid16[0] | (fields.svc_data_uuid16[1] << 8);
-                    ESP_LOGI(TAG, "  🔬 Service UUID: 0x%04X, len: %d", uuid, fields.svc_data_uuid16_len);
-                    
-                    if (uuid == 0x181A) {
-                        // pvvx or ATC custom firmware
-                        ble_sensor_data_t sensor_data;
-                        bool parsed = false;
-                        
-                        if (fields.svc_data_uuid16_len >= 17) {
-                            parsed = ble_parse_pvvx_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                            ESP_LOGI(TAG, "  ✅ pvvx parse: %s", parsed ? "SUCCESS" : "FAILED");
-                        } else if (fields.svc_data_uuid16_len >= 15) {
-                            parsed = ble_parse_atc_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                            ESP_LOGI(TAG, "  ✅ ATC parse: %s", parsed ? "SUCCESS" : "FAILED");
-                        }
-                        
-                        if (parsed) {
-                            sat_sensor_count++;
-                            ESP_LOGI(TAG, "  🌡️  Satellite sensor: %.1f°C, %d%%, %d%%", 
-                                     sensor_data.temperature/100.0, sensor_data.humidity/100, sensor_data.battery_pct);
-                            devices[idx].temperature = sensor_data.temperature;
-                            devices[idx].humidity = sensor_data.humidity;
-                            devices[idx].battery_pct = sensor_data.battery_pct;
-                            devices[idx].battery_mv = sensor_data.battery_mv;
-                            strncpy(devices[idx].firmware_type, sensor_data.device_type, sizeof(devices[idx].firmware_type) - 1);
-                            devices[idx].firmware_type[sizeof(devices[idx].firmware_type) - 1] = '\0';
-                            devices[idx].has_sensor_data = true;
-                            devices[idx].last_sensor_seen = now_ms;
-                        }
-                    } else if (uuid == 0xFE95) {
-                        // MiBeacon - Xiaomi original firmware
-                        ble_sensor_data_t sensor_data;
-                        bool parsed = ble_parse_mibeacon_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                        ESP_LOGI(TAG, "  ✅ MiBeacon parse: %s", parsed ? "SUCCESS" : "FAILED");
-                        
-                        if (parsed) {
-                            sat_sensor_count++;
-                            devices[idx].temperature = sensor_data.temperature;
-                            devices[idx].humidity = sensor_data.humidity;
-                            devices[idx].battery_pct = sensor_data.battery_pct;
-                            devices[idx].battery_mv = sensor_data.battery_mv;
-                            strncpy(devices[idx].firmware_type, sensor_data.device_type, sizeof(devices[idx].firmware_type) - 1);
-                            devices[idx].firmware_type[sizeof(devices[idx].firmware_type) - 1] = '\0';
-                            devices[idx].has_sensor_data = true;
-                            devices[idx].last_sensor_seen = now_ms;
-                        }
-                    } else if (uuid == 0xFCD2) {
-                        // BTHome v2
-                        ble_sensor_data_t sensor_data;
-                        bool parsed = ble_parse_bthome_v2_format(fields.svc_data_uuid16, fields.svc_data_uuid16_len, &sensor_data);
-                        ESP_LOGI(TAG, "  ✅ BTHome parse: %s", parsed ? "SUCCESS" : "FAILED");
-                        
-                        if (parsed) {
-                            sat_sensor_count++;
-                            devices[idx].temperature = sensor_data.temperature;
-                            devices[idx].humidity = sensor_data.humidity;
-                            devices[idx].battery_pct = sensor_data.battery_pct;
-                            devices[idx].battery_mv = sensor_data.battery_mv;
-                            strncpy(devices[idx].firmware_type, sensor_data.device_type, sizeof(devices[idx].firmware_type) - 1);
-                            devices[idx].firmware_type[sizeof(devices[idx].firmware_type) - 1] = '\0';
-                            devices[idx].has_sensor_data = true;
-                            devices[idx].last_sensor_seen = now_ms;
-                        }
-                    }
-                }
-            }
+        uint8_t source_id = satellite_claim(ip);
+        if (source_id == RX_SOURCE_NONE ||
+            !ingest_enqueue(&sat_adv_ring, mac_addr, (int8_t)rssi, source_id, 0, raw_data, (uint8_t)data_len)) {
+            ESP_LOGD(TAG, "Satellite ingest ring or registry full, packet dropped");
         }
+    } else {
+        satellite_count_failures(ip, 1);
     }
     
     // Send response
@@ -2301,6 +5647,25 @@ static esp_err_t api_satellite_data_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// API: Vastaanota satelliitti-dataa
+// Content-Type application/x-sat-frame: binary batch (sat_frame.h);
+// anything else: one JSON object
+static esp_err_t api_satellite_data_handler(httpd_req_t *req) {
+    int64_t start_us = esp_timer_get_time();
+    char client_ip[16] = {0};
+    uint32_t ip = satellite_request_ip(req, client_ip, sizeof(client_ip));
+    if (ip == 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    
+    esp_err_t err = satellite_is_binary(req) ? satellite_batch_receive(req, client_ip, ip, true)
+                                             : satellite_object_receive(req, client_ip, ip);
+    satellite_report_counters(req, ip);
+    satellite_request_done(ip, start_us);
+    return err;
+}
+
 // API: Change device visibility
 static esp_err_t api_toggle_visibility_handler(httpd_req_t *req) {
     char content[256];
@@ -2352,19 +5717,24 @@ static esp_err_t api_toggle_visibility_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "API request to set visibility: %s -> visible=%d", addr_str, visible);
     
     // Find device and update its state
-    for (int i = 0; i < device_count; i++) {
-        char dev_addr[18];
-        snprintf(dev_addr, sizeof(dev_addr), "%02X:%02X:%02X:%02X:%02X:%02X",
-            devices[i].addr[0], devices[i].addr[1], devices[i].addr[2],
-            devices[i].addr[3], devices[i].addr[4], devices[i].addr[5]);
-        
-        if (strcmp(dev_addr, addr_str) == 0) {
-            ESP_LOGI(TAG, "Device found at index %d, previous visible=%d", i, devices[i].visible);
-            devices[i].visible = visible ? true : false;
-            save_visibility(devices[i].addr, devices[i].visible);
-            ESP_LOGI(TAG, "✓ Device %d visibility updated -> %d", i, devices[i].visible);
-            break;
+    uint8_t addr[6];
+    device_write_begin();
+    int i = find_device_by_mac_str(addr_str);
+    if (i >= 0) {
+        ESP_LOGI(TAG, "Device found at index %d, previous visible=%d", i, devices[i].visible);
+        if (devices[i].visible && !visible) {
+            device_list_shrunk();
         }
+        devices[i].visible = visible ? true : false;
+        devices[i].persisted = true;
+        device_touch(&devices[i]);
+        memcpy(addr, devices[i].addr, 6);
+    }
+    device_write_end();
+    
+    if (i >= 0) {
+        save_visibility(addr, visible ? true : false);
+        ESP_LOGI(TAG, "✓ Device %d visibility updated -> %d", i, visible ? 1 : 0);
     }
     
     ESP_LOGI(TAG, "Response sent");
@@ -2379,6 +5749,7 @@ static esp_err_t api_clear_visibility_handler(httpd_req_t *req) {
     int cleared_devices = 0;
 
     // Hide all devices; do not remove the list
+    device_write_begin();
     for (int i = 0; i < device_count; i++) {
         if (devices[i].visible) {
             devices[i].visible = false;
@@ -2386,7 +5757,11 @@ static esp_err_t api_clear_visibility_handler(httpd_req_t *req) {
         } else {
             devices[i].visible = false;
         }
+        devices[i].persisted = false;  // NVS keys are removed below
+        device_touch(&devices[i]);
     }
+    device_list_shrunk();
+    device_write_end();
 
     // Remove ALL device-related keys from NVS (visibility + settings)
     nvs_handle_t nvs;
@@ -2432,11 +5807,15 @@ static esp_err_t api_clear_visibility_handler(httpd_req_t *req) {
 
     ESP_LOGI(TAG, "🗑️ Visibility reset: %d devices hidden, %d NVS keys removed", cleared_devices, cleared_nvs);
 
-    char response[128];
-    snprintf(response, sizeof(response), "{\"ok\":true,\"cleared\":%d,\"nvs_cleared\":%d}", cleared_devices, cleared_nvs);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, response);
-    return ESP_OK;
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_int(&w, "cleared", cleared_devices);
+    json_field_int(&w, "nvs_cleared", cleared_nvs);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // API: Forget a specific device (remove from memory and NVS)
@@ -2489,14 +5868,15 @@ static esp_err_t api_forget_device_handler(httpd_req_t *req) {
              target_mac[5], target_mac[4], target_mac[3],
              target_mac[2], target_mac[1], target_mac[0]);
     
-    // Find device in list
-    int found_idx = -1;
-    for (int i = 0; i < device_count; i++) {
-        if (memcmp(devices[i].addr, target_mac, 6) == 0) {
-            found_idx = i;
-            break;
-        }
+    // Find device in list and remove it
+    char removed_name[MAX_NAME_LEN];
+    device_write_begin();
+    int found_idx = device_registry_find(&device_index, target_mac);
+    if (found_idx >= 0) {
+        copy_name(removed_name, device_name(&devices[found_idx]), -1);
+        remove_device(found_idx);
     }
+    device_write_end();
     
     if (found_idx == -1) {
         const char* resp = "{\"ok\":false,\"error\":\"Device not found\"}";
@@ -2513,9 +5893,9 @@ static esp_err_t api_forget_device_handler(httpd_req_t *req) {
             nvs_removed_count++;
         }
         
-        // Remove settings keys (FFEEDDCCBBAA_n, _m, _i, _f, _u)
-        const char* suffixes[] = {"_n", "_m", "_i", "_f", "_u"};
-        for (int i = 0; i < 5; i++) {
+        // Remove settings keys (FFEEDDCCBBAA_n, _m, _i, _f, _u, _d)
+        const char* suffixes[] = {"_n", "_m", "_i", "_f", "_u", "_d"};
+        for (int i = 0; i < 6; i++) {
             char key[24];
             snprintf(key, sizeof(key), "%s%s", nvs_key, suffixes[i]);
             if (nvs_erase_key(nvs, key) == ESP_OK) {
@@ -2527,25 +5907,19 @@ static esp_err_t api_forget_device_handler(httpd_req_t *req) {
         nvs_close(nvs);
     }
     
-    // Remove from device list (shift remaining devices down)
-    char device_name[32];
-    strncpy(device_name, devices[found_idx].name, sizeof(device_name) - 1);
-    device_name[sizeof(device_name) - 1] = '\0';
-    
-    for (int i = found_idx; i < device_count - 1; i++) {
-        memcpy(&devices[i], &devices[i + 1], sizeof(ble_device_t));
-    }
-    device_count--;
-    
     ESP_LOGI(TAG, "🗑️ Forgot device: %s (%s), NVS key: %s, removed: %d", 
-             mac_str, device_name, nvs_key, nvs_removed_count);
-    
-    char response[128];
-    snprintf(response, sizeof(response), 
-             "{\"ok\":true,\"mac\":\"%s\",\"name\":\"%s\",\"nvs_removed\":%d}", 
-             mac_str, device_name, nvs_removed_count);
-    httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+             mac_str, removed_name, nvs_key, nvs_removed_count);
+    
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_string(&w, "mac", mac_str);
+    json_field_string(&w, "name", removed_name);
+    json_field_int(&w, "nvs_removed", nvs_removed_count);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // Identify device "signature" (which fields it has)
@@ -2561,6 +5935,25 @@ static uint16_t get_device_signature(const ble_device_t *dev) {
     return sig;
 }
 
+// Settings of one device, copied out of the write section to be saved to NVS
+typedef struct {
+    uint8_t addr[6];
+    char name[MAX_NAME_LEN];
+    bool show_mac;
+    bool show_ip;
+    bool user_named;
+    uint16_t field_mask;
+} device_settings_save_t;
+
+static void device_settings_copy(device_settings_save_t *out, const ble_device_t *dev) {
+    memcpy(out->addr, dev->addr, 6);
+    copy_name(out->name, device_name(dev), -1);
+    out->show_mac = dev->show_mac;
+    out->show_ip = dev->show_ip;
+    out->user_named = dev->user_named;
+    out->field_mask = dev->field_mask;
+}
+
 static esp_err_t api_update_settings_handler(httpd_req_t *req) {
     char buf[512];
     int ret, remaining = req->content_len;
@@ -2665,35 +6058,36 @@ static esp_err_t api_update_settings_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "Updating device: %s, name='%s', show_mac=%d, show_ip=%d, fields=0x%04X, apply=%d",
              addr_str, name, show_mac, show_ip, field_mask, apply_to_similar);
     
-    // Find device
-    int target_idx = -1;
-    for (int i = 0; i < device_count; i++) {
-        char dev_addr[18];
-        snprintf(dev_addr, sizeof(dev_addr), "%02X:%02X:%02X:%02X:%02X:%02X",
-            devices[i].addr[0], devices[i].addr[1], devices[i].addr[2],
-            devices[i].addr[3], devices[i].addr[4], devices[i].addr[5]);
-        
-        if (strcmp(dev_addr, addr_str) == 0) {
-            target_idx = i;
-            break;
-        }
+    // Changed settings are copied out and saved to NVS after the write section
+    device_settings_save_t *saves = malloc((apply_to_similar ? MAX_DEVICES : 1) * sizeof(device_settings_save_t));
+    if (!saves) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
     }
     
+    // Find device
+    device_write_begin();
+    int target_idx = find_device_by_mac_str(addr_str);
+    
     if (target_idx == -1) {
+        device_write_end();
+        free(saves);
         ESP_LOGW(TAG, "Device not found: %s", addr_str);
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Device not found");
         return ESP_FAIL;
     }
     
     // Update device settings
-    strncpy(devices[target_idx].name, name, MAX_NAME_LEN - 1);
+    set_device_name(&devices[target_idx], name, -1);
+    devices[target_idx].persisted = true;
     devices[target_idx].show_mac = (show_mac != 0);
     devices[target_idx].show_ip = (show_ip != 0);
     devices[target_idx].field_mask = field_mask;
     devices[target_idx].user_named = (name[0] != '\0');
+    device_touch(&devices[target_idx]);
     
-    // Save settings
-    save_device_settings(devices[target_idx].addr, name, devices[target_idx].show_mac, devices[target_idx].show_ip, field_mask, devices[target_idx].user_named);
+    device_settings_copy(&saves[0], &devices[target_idx]);
+    copy_name(saves[0].name, name, -1);  // Saved even if the name pool had no room
     
     // If apply_to_similar is set, find similar devices
     int updated_count = 1;
@@ -2710,19 +6104,31 @@ static esp_err_t api_update_settings_handler(httpd_req_t *req) {
                 devices[i].show_mac = devices[target_idx].show_mac;
                 devices[i].show_ip = devices[target_idx].show_ip;
                 devices[i].field_mask = devices[target_idx].field_mask;
-                save_device_settings(devices[i].addr, devices[i].name, devices[i].show_mac, devices[i].show_ip, field_mask, devices[i].user_named);
-                updated_count++;
+                devices[i].persisted = true;
+                device_touch(&devices[i]);
+                device_settings_copy(&saves[updated_count++], &devices[i]);
                 ESP_LOGI(TAG, "  Updated: %02X:%02X:...", devices[i].addr[0], devices[i].addr[1]);
             }
         }
     }
     
+    device_write_end();
+    
+    for (int i = 0; i < updated_count; i++) {
+        save_device_settings(saves[i].addr, saves[i].name, saves[i].show_mac, saves[i].show_ip, saves[i].field_mask, saves[i].user_named);
+    }
+    free(saves);
+    
     ESP_LOGI(TAG, "Updated %d devices", updated_count);
     
-    char response[128];
-    snprintf(response, sizeof(response), "{\"ok\":true,\"updated\":%d}", updated_count);
-    httpd_resp_sendstr(req, response);
-    return ESP_OK;
+    char json_buf[JSON_CHUNK_SIZE];
+    json_writer_t w;
+    json_response_begin(&w, req, json_buf, sizeof(json_buf));
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_field_int(&w, "updated", updated_count);
+    json_object_end(&w);
+    return json_response_end(&w, req);
 }
 
 // PWA: manifest
@@ -2747,7 +6153,8 @@ static esp_err_t manifest_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
-// PWA: service worker (network-only, no caching)
+// PWA: service worker (network-only, no caching of its own; the HTTP
+// cache still serves the versioned UI files)
 static esp_err_t sw_handler(httpd_req_t *req) {
     httpd_resp_set_hdr(req, "Cache-Control", "no-store");
     httpd_resp_set_type(req, "application/javascript");
@@ -2755,7 +6162,7 @@ static esp_err_t sw_handler(httpd_req_t *req) {
         "self.addEventListener('install',e=>{self.skipWaiting();});"
         "self.addEventListener('activate',e=>{e.waitUntil(self.clients.claim());});"
         "self.addEventListener('fetch',e=>{"
-        "e.respondWith(fetch(e.request,{cache:'no-store'}));"
+        "e.respondWith(fetch(e.request));"
         "});";
     httpd_resp_sendstr(req, sw);
     return ESP_OK;
@@ -2797,7 +6204,7 @@ static esp_err_t icon_png_handler(httpd_req_t *req) {
 
 static void start_webserver(void) {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 31;
+    config.max_uri_handlers = 41 + web_asset_count;
     config.stack_size = 8192;
     
     if (httpd_start(&server, &config) == ESP_OK) {
@@ -2808,6 +6215,19 @@ static void start_webserver(void) {
             .user_ctx = NULL
         };
         httpd_register_uri_handler(server, &root);
+        
+        for (size_t i = 0; i < web_asset_count; i++) {
+            if (strcmp(web_assets[i].path, "/index.html") == 0) {
+                continue;  // Served at /
+            }
+            httpd_uri_t asset = {
+                .uri = web_assets[i].path,
+                .method = HTTP_GET,
+                .handler = web_asset_handler,
+                .user_ctx = (void *)&web_assets[i]
+            };
+            httpd_register_uri_handler(server, &asset);
+        }
 
         httpd_uri_t manifest = {
             .uri = "/manifest.json",
@@ -2857,6 +6277,16 @@ static void start_webserver(void) {
         };
         httpd_register_uri_handler(server, &api_devices);
         
+        push_init();
+        httpd_uri_t ws = {
+            .uri = "/ws",
+            .method = HTTP_GET,
+            .handler = ws_handler,
+            .user_ctx = NULL,
+            .is_websocket = true
+        };
+        httpd_register_uri_handler(server, &ws);
+        
         httpd_uri_t api_diagnostics = {
             .uri = "/api/diagnostics",
             .method = HTTP_GET,
@@ -2865,6 +6295,38 @@ static void start_webserver(void) {
         };
         httpd_register_uri_handler(server, &api_diagnostics);
         
+        httpd_uri_t api_history = {
+            .uri = "/api/history",
+            .method = HTTP_GET,
+            .handler = api_history_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_history);
+        
+        httpd_uri_t api_uplink_status = {
+            .uri = "/api/uplink/status",
+            .method = HTTP_GET,
+            .handler = api_uplink_status_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_uplink_status);
+        
+        httpd_uri_t api_uplink_policy_get = {
+            .uri = "/api/uplink/policy",
+            .method = HTTP_GET,
+            .handler = api_uplink_policy_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_uplink_policy_get);
+        
+        httpd_uri_t api_uplink_policy_post = {
+            .uri = "/api/uplink/policy",
+            .method = HTTP_POST,
+            .handler = api_uplink_policy_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_uplink_policy_post);
+        
         httpd_uri_t api_satellite_data = {
             .uri = "/api/satellite-data",
             .method = HTTP_POST,
@@ -2873,6 +6335,54 @@ static void start_webserver(void) {
         };
         httpd_register_uri_handler(server, &api_satellite_data);
         
+        httpd_uri_t api_satellite_batch = {
+            .uri = "/api/satellite-batch",
+            .method = HTTP_POST,
+            .handler = api_satellite_batch_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_satellite_batch);
+        
+        httpd_uri_t api_satellite_udp_get = {
+            .uri = "/api/satellite-udp",
+            .method = HTTP_GET,
+            .handler = api_satellite_udp_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_satellite_udp_get);
+        
+        httpd_uri_t api_satellite_udp_post = {
+            .uri = "/api/satellite-udp",
+            .method = HTTP_POST,
+            .handler = api_satellite_udp_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_satellite_udp_post);
+        
+        httpd_uri_t api_satellite_policy_get = {
+            .uri = "/api/satellite/policy",
+            .method = HTTP_GET,
+            .handler = api_satellite_policy_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_satellite_policy_get);
+        
+        httpd_uri_t api_satellite_policy_post = {
+            .uri = "/api/satellite/policy",
+            .method = HTTP_POST,
+            .handler = api_satellite_policy_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_satellite_policy_post);
+        
+        httpd_uri_t api_satellites = {
+            .uri = "/api/satellites",
+            .method = HTTP_GET,
+            .handler = api_satellites_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &api_satellites);
+        
         httpd_uri_t api_toggle_visibility = {
             .uri = "/api/toggle-visibility",
             .method = HTTP_POST,
@@ -3137,38 +6647,53 @@ void app_main() {
             master_ble_enabled = (master_ble_val != 0);
             ESP_LOGI(TAG, "📂 Loaded setting: Master BLE scan = %s", master_ble_enabled ? "ENABLED" : "DISABLED");
         }
+        sat_policy_load(nvs);
         nvs_close(nvs);
     }
+    sat_udp_load_config();
     
     // Check BOOT button for WiFi reset
     check_boot_button();
     
+    // Device table + MAC hash index
+    if (!device_store_init()) {
+        ESP_LOGE(TAG, "⚠️ Not enough memory for device table, restarting");
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_restart();
+    }
+    
     // Load saved devices from NVS
     load_all_devices_from_nvs();
     ESP_LOGI(TAG, "Loaded %d saved devices from NVS", device_count);
     
+    // Persisted sensor history (optional partition)
+    history_log_init();
+    
+    // Scan results are applied by the ingest task (before BLE and the web server start)
+    if (!ingest_init()) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_restart();
+    }
+    
     wifi_init();
     start_webserver();
 
     // Start satellite discovery broadcast
     xTaskCreate(discovery_broadcast_task, "discovery_broadcast", 4096, NULL, 4, NULL);
     
+    // UDP satellite ingest (idle until enabled with a key)
+    xTaskCreate(sat_udp_task, "sat_udp", 4096, NULL, 5, NULL);
+    
     // Load Adafruit IO settings
     load_aio_config();
     
     // Load Cloudflare D1 settings
     load_d1_config();
     
-    // Start Adafruit IO timer if settings are configured
-    if (aio_enabled && strlen(aio_username) > 0 && strlen(aio_key) > 0) {
-        esp_timer_create_args_t aio_timer_args = {
-            .callback = aio_timer_callback,
-            .name = "aio_timer"
-        };
-        esp_timer_create(&aio_timer_args, &aio_timer);
-        esp_timer_start_periodic(aio_timer, AIO_SEND_INTERVAL_MS * 1000);  // Microsekunteja
-        ESP_LOGI(AIO_TAG, "Timer started, send every %d min", AIO_SEND_INTERVAL_MS / 60000);
-    }
+    // Upload queue and its task; readings are queued as the reporting
+    // policy passes them, even while offline, and forwarded once the cloud
+    // is reachable
+    uplink_init();
 
     // BLE packet rate logging
     if (ble_rate_timer == NULL) {
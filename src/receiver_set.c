@@ -0,0 +1,107 @@
+#include "receiver_set.h"
+#include <string.h>
+
+int8_t rx_receiver_rssi(const rx_receiver_t *rx) {
+    int sum = 0;
+    for (int i = 0; i < rx->count; i++) {
+        sum += rx->rssi[i];
+    }
+    // Round half away from zero (RSSI is negative)
+    return (int8_t)((sum - rx->count / 2) / rx->count);
+}
+
+static bool rx_fresh(const rx_receiver_t *rx, uint32_t now_ms, uint32_t stale_ms) {
+    // Signed: a satellite packet with an age may be older than the last one
+    return rx->source_id != RX_SOURCE_NONE && (int32_t)(now_ms - rx->last_ms) < (int32_t)stale_ms;
+}
+
+// Slot for a receiver: its own, an empty one, or the least recently heard
+// one other than the chosen receiver
+static rx_receiver_t *rx_slot(rx_set_t *set, uint8_t source_id) {
+    rx_receiver_t *victim = NULL;
+    for (int i = 0; i < RX_SET_SIZE; i++) {
+        rx_receiver_t *rx = &set->rx[i];
+        if (rx->source_id == source_id) {
+            return rx;
+        }
+        if (rx->source_id == RX_SOURCE_NONE) {
+            if (!victim || victim->source_id != RX_SOURCE_NONE) {
+                victim = rx;
+            }
+        } else if (i != set->best && (!victim || (victim->source_id != RX_SOURCE_NONE &&
+                                                  (int32_t)(rx->last_ms - victim->last_ms) < 0))) {
+            victim = rx;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    victim->source_id = source_id;
+    return victim;
+}
+
+uint8_t rx_set_observe(rx_set_t *set, uint8_t source_id, int8_t rssi, uint32_t now_ms,
+                       uint32_t stale_ms, uint8_t hysteresis_db) {
+    rx_receiver_t *rx = rx_slot(set, source_id);
+    if (rx->count > 0 && !rx_fresh(rx, now_ms, stale_ms)) {
+        rx->count = 0;  // Heard again after a gap: old samples don't count
+        rx->next = 0;
+    }
+    rx->rssi[rx->next] = rssi;
+    rx->next = (rx->next + 1) % RX_RSSI_WINDOW;
+    if (rx->count < RX_RSSI_WINDOW) {
+        rx->count++;
+    }
+    if ((int32_t)(now_ms - rx->last_ms) > 0 || rx->count == 1) {
+        rx->last_ms = now_ms;
+    }
+
+    // Strongest fresh receiver other than the chosen one
+    const rx_receiver_t *best = &set->rx[set->best];
+    bool keep = rx_fresh(best, now_ms, stale_ms);
+    int challenger = -1;
+    int challenger_rssi = 0;
+    for (int i = 0; i < RX_SET_SIZE; i++) {
+        const rx_receiver_t *c = &set->rx[i];
+        if ((keep && i == set->best) || !rx_fresh(c, now_ms, stale_ms) || (keep && c->count < 2)) {
+            continue;
+        }
+        int c_rssi = rx_receiver_rssi(c);
+        if (challenger < 0 || c_rssi > challenger_rssi) {
+            challenger = i;
+            challenger_rssi = c_rssi;
+        }
+    }
+
+    if (!keep) {
+        // Nothing chosen yet or it went quiet: the strongest fresh one, at
+        // least the receiver of this packet
+        set->best = (challenger >= 0) ? challenger : (uint8_t)(rx - set->rx);
+    } else if (challenger >= 0 && challenger_rssi >= rx_receiver_rssi(best) + hysteresis_db) {
+        set->best = challenger;
+    }
+    return set->rx[set->best].source_id;
+}
+
+int8_t rx_set_best_rssi(const rx_set_t *set) {
+    const rx_receiver_t *best = &set->rx[set->best];
+    return (best->source_id != RX_SOURCE_NONE && best->count > 0) ? rx_receiver_rssi(best) : 0;
+}
+
+uint8_t rx_set_forget(rx_set_t *set, uint8_t source_id) {
+    for (int i = 0; i < RX_SET_SIZE; i++) {
+        if (set->rx[i].source_id == source_id) {
+            memset(&set->rx[i], 0, sizeof(rx_receiver_t));
+        }
+    }
+    if (set->rx[set->best].source_id == RX_SOURCE_NONE) {
+        // The chosen one went: the most recently heard of the rest
+        for (int i = 0; i < RX_SET_SIZE; i++) {
+            const rx_receiver_t *rx = &set->rx[i];
+            if (rx->source_id != RX_SOURCE_NONE &&
+                (set->rx[set->best].source_id == RX_SOURCE_NONE ||
+                 (int32_t)(rx->last_ms - set->rx[set->best].last_ms) > 0)) {
+                set->best = i;
+            }
+        }
+    }
+    return set->rx[set->best].source_id;
+}
@@ -0,0 +1,57 @@
+#include "report_policy.h"
+#include <stdlib.h>
+
+report_reason_t report_policy_evaluate(const report_policy_t *policy, const report_state_t *state,
+                                       uint32_t now_s, int16_t temp_centi, uint8_t humidity,
+                                       uint8_t battery_pct) {
+    if (state->last_report_s == 0) {
+        return REPORT_FIRST;
+    }
+    uint32_t elapsed = now_s - state->last_report_s;
+    if (elapsed < policy->min_interval_s) {
+        return REPORT_NONE;
+    }
+
+    // A deadband of 0 reports any change; the band edge itself counts as out
+    int temp_delta = abs((int)temp_centi - state->temp_centi);
+    int hum_delta = abs((int)humidity - state->humidity);
+    int bat_delta = abs((int)battery_pct - state->battery_pct);
+    if ((temp_delta > 0 && temp_delta >= policy->temp_deadband_centi) ||
+        (hum_delta > 0 && hum_delta >= policy->hum_deadband) ||
+        (policy->battery_deadband > 0 && bat_delta >= policy->battery_deadband)) {
+        return REPORT_CHANGE;
+    }
+    if (policy->max_interval_s > 0 && elapsed >= policy->max_interval_s) {
+        return REPORT_HEARTBEAT;
+    }
+    return REPORT_NONE;
+}
+
+void report_policy_commit(report_state_t *state, uint32_t now_s, int16_t temp_centi,
+                          uint8_t humidity, uint8_t battery_pct) {
+    state->last_report_s = now_s;
+    state->temp_centi = temp_centi;
+    state->humidity = humidity;
+    state->battery_pct = battery_pct;
+}
+
+report_policy_t report_policy_for_device(const report_policy_t *def, uint8_t temp_deadband_centi,
+                                         uint8_t hum_deadband) {
+    report_policy_t p = *def;
+    if (temp_deadband_centi != REPORT_DEADBAND_DEFAULT) {
+        p.temp_deadband_centi = temp_deadband_centi;
+    }
+    if (hum_deadband != REPORT_DEADBAND_DEFAULT) {
+        p.hum_deadband = hum_deadband;
+    }
+    return p;
+}
+
+const char *report_reason_str(report_reason_t reason) {
+    switch (reason) {
+        case REPORT_FIRST: return "first";
+        case REPORT_CHANGE: return "change";
+        case REPORT_HEARTBEAT: return "heartbeat";
+        default: return "none";
+    }
+}
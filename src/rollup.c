@@ -0,0 +1,143 @@
+#include "rollup.h"
+#include <string.h>
+
+const uint32_t rollup_tier_seconds[ROLLUP_TIER_COUNT] = { 60, 900, 3600 };
+
+static inline uint8_t sat_u8(int32_t v) {
+    return (v < 0) ? 0 : (v > 255) ? 255 : (uint8_t)v;
+}
+
+// Rounded integer division (sums can be negative for temperature)
+static inline int32_t div_round(int32_t sum, int32_t n) {
+    return (sum >= 0) ? (sum + n / 2) / n : (sum - n / 2) / n;
+}
+
+void rollup_acc_reset(rollup_acc_t *acc, uint32_t start) {
+    acc->start = start;
+    acc->t_sum = 0;
+    acc->h_sum = 0;
+    acc->t_min = INT16_MAX;
+    acc->t_max = INT16_MIN;
+    acc->h_min = 255;
+    acc->h_max = 0;
+    acc->count = 0;
+}
+
+void rollup_acc_add(rollup_acc_t *acc, int16_t temp, uint8_t hum) {
+    if (acc->count == UINT16_MAX) {
+        return;
+    }
+    acc->t_sum += temp;
+    acc->h_sum += hum;
+    if (temp < acc->t_min) acc->t_min = temp;
+    if (temp > acc->t_max) acc->t_max = temp;
+    if (hum < acc->h_min) acc->h_min = hum;
+    if (hum > acc->h_max) acc->h_max = hum;
+    acc->count++;
+}
+
+void rollup_acc_merge(rollup_acc_t *acc, const rollup_bucket_t *bucket) {
+    if (bucket->count == 0) {
+        return;
+    }
+    // Saturate: past UINT16_MAX the excess weight doesn't count toward the
+    // average, but min/max still do
+    uint16_t weight = bucket->count;
+    if (weight > UINT16_MAX - acc->count) {
+        weight = UINT16_MAX - acc->count;
+    }
+    int16_t t_min = bucket->t_avg - bucket->t_below;
+    int16_t t_max = bucket->t_avg + bucket->t_above;
+    uint8_t h_min = sat_u8(bucket->h_avg - bucket->h_below);
+    uint8_t h_max = sat_u8(bucket->h_avg + bucket->h_above);
+    acc->t_sum += (int32_t)bucket->t_avg * weight;
+    acc->h_sum += (int32_t)bucket->h_avg * weight;
+    if (t_min < acc->t_min) acc->t_min = t_min;
+    if (t_max > acc->t_max) acc->t_max = t_max;
+    if (h_min < acc->h_min) acc->h_min = h_min;
+    if (h_max > acc->h_max) acc->h_max = h_max;
+    acc->count += weight;
+}
+
+void rollup_acc_pack(const rollup_acc_t *acc, rollup_bucket_t *bucket) {
+    if (acc->count == 0) {
+        memset(bucket, 0, sizeof(*bucket));
+        return;
+    }
+    int32_t t_avg = div_round(acc->t_sum, acc->count);
+    int32_t h_avg = div_round(acc->h_sum, acc->count);
+    bucket->t_avg = (int16_t)t_avg;
+    bucket->t_below = sat_u8(t_avg - acc->t_min);
+    bucket->t_above = sat_u8(acc->t_max - t_avg);
+    bucket->h_avg = sat_u8(h_avg);
+    bucket->h_below = sat_u8(h_avg - acc->h_min);
+    bucket->h_above = sat_u8(acc->h_max - h_avg);
+    bucket->count = acc->count;
+}
+
+static void ring_push(rollup_ring_t *ring, const rollup_bucket_t *bucket, uint32_t start) {
+    if (ring->count > 0) {
+        ring->head = (ring->head + 1) % ring->capacity;
+    }
+    ring->buckets[ring->head] = *bucket;
+    if (ring->count < ring->capacity) {
+        ring->count++;
+    }
+    ring->last_start = start;
+}
+
+void rollup_feed(rollup_ring_t *ring, rollup_acc_t *acc, uint32_t time, int16_t temp, uint8_t hum) {
+    uint32_t start = time - time % ring->interval;
+    if (acc->count > 0 && start > acc->start) {
+        // Close the open bucket, with empty buckets for skipped periods
+        rollup_bucket_t closed;
+        if (ring->count > 0 && acc->start > ring->last_start) {
+            uint32_t skipped = (acc->start - ring->last_start) / ring->interval - 1;
+            if (skipped > ring->capacity) {
+                skipped = ring->capacity;
+            }
+            rollup_bucket_t empty = {0};
+            for (uint32_t i = 0; i < skipped; i++) {
+                ring_push(ring, &empty, acc->start - (skipped - i) * ring->interval);
+            }
+        }
+        rollup_acc_pack(acc, &closed);
+        ring_push(ring, &closed, acc->start);
+    }
+    if (acc->count == 0 || start > acc->start) {
+        rollup_acc_reset(acc, start);
+    }
+    rollup_acc_add(acc, temp, hum);
+}
+
+void rollup_ring_init(rollup_ring_t *ring, rollup_bucket_t *buckets, uint16_t capacity, uint32_t interval) {
+    ring->buckets = buckets;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->count = 0;
+    ring->interval = interval;
+    ring->last_start = 0;
+}
+
+const rollup_bucket_t *rollup_ring_get(const rollup_ring_t *ring, uint16_t age, uint32_t *start) {
+    if (age >= ring->count) {
+        return NULL;
+    }
+    *start = ring->last_start - (uint32_t)age * ring->interval;
+    return &ring->buckets[(ring->head + ring->capacity - age) % ring->capacity];
+}
+
+int rollup_pick_tier(uint32_t range_s, uint32_t max_points, uint32_t *merge) {
+    if (max_points == 0) {
+        max_points = 1;
+    }
+    for (int tier = 0; tier < ROLLUP_TIER_COUNT; tier++) {
+        if (range_s / rollup_tier_seconds[tier] <= max_points) {
+            *merge = 1;
+            return tier;
+        }
+    }
+    uint32_t points = range_s / rollup_tier_seconds[ROLLUP_TIER_COUNT - 1];
+    *merge = (points + max_points - 1) / max_points;
+    return ROLLUP_TIER_COUNT - 1;
+}
@@ -0,0 +1,119 @@
+#include "sat_frame.h"
+#include <string.h>
+
+void sat_frame_decoder_init(sat_frame_decoder_t *d) {
+    d->header_got = 0;
+    d->rec_got = 0;
+    d->status = SAT_FRAME_OK;
+    d->records = 0;
+}
+
+void sat_frame_decoder_init_records(sat_frame_decoder_t *d) {
+    sat_frame_decoder_init(d);
+    d->header_got = SAT_FRAME_HEADER_LEN;
+}
+
+// Decode one whole record (length byte included) and hand it on
+static void sat_frame_emit(sat_frame_decoder_t *d, const uint8_t *r, sat_record_cb_t cb, void *ctx) {
+    sat_record_t rec;
+    memcpy(rec.mac, r + 1, 6);
+    rec.rssi = (int8_t)r[7];
+    rec.age_ms = (uint16_t)(r[8] | (r[9] << 8));
+    rec.ad = r + 1 + SAT_FRAME_RECORD_FIXED;
+    rec.ad_len = r[0] - SAT_FRAME_RECORD_FIXED;
+    d->records++;
+    cb(ctx, &rec);
+}
+
+sat_frame_status_t sat_frame_decode(sat_frame_decoder_t *d, const uint8_t *data, size_t len,
+                                    sat_record_cb_t cb, void *ctx) {
+    if (d->status != SAT_FRAME_OK) {
+        return d->status;
+    }
+
+    // Header
+    while (d->header_got < SAT_FRAME_HEADER_LEN && len > 0) {
+        d->header[d->header_got++] = *data++;
+        len--;
+        if (d->header_got == SAT_FRAME_HEADER_LEN) {
+            if (d->header[0] != SAT_FRAME_MAGIC0 || d->header[1] != SAT_FRAME_MAGIC1) {
+                return d->status = SAT_FRAME_BAD_MAGIC;
+            }
+            if (d->header[2] != SAT_FRAME_VERSION) {
+                return d->status = SAT_FRAME_BAD_VERSION;
+            }
+        }
+    }
+
+    // Finish a record split by the previous chunk
+    if (d->rec_got > 0) {
+        size_t need = (size_t)d->rec_buf[0] + 1 - d->rec_got;
+        size_t take = (len < need) ? len : need;
+        memcpy(d->rec_buf + d->rec_got, data, take);
+        d->rec_got += take;
+        data += take;
+        len -= take;
+        if (take < need) {
+            return SAT_FRAME_OK;
+        }
+        sat_frame_emit(d, d->rec_buf, cb, ctx);
+        d->rec_got = 0;
+    }
+
+    // Whole records in place
+    while (len > 0) {
+        if (data[0] < SAT_FRAME_RECORD_FIXED) {
+            return d->status = SAT_FRAME_BAD_RECORD;
+        }
+        size_t rec_len = (size_t)data[0] + 1;
+        if (rec_len > len) {
+            memcpy(d->rec_buf, data, len);
+            d->rec_got = len;
+            return SAT_FRAME_OK;
+        }
+        sat_frame_emit(d, data, cb, ctx);
+        data += rec_len;
+        len -= rec_len;
+    }
+    return SAT_FRAME_OK;
+}
+
+sat_frame_status_t sat_frame_decoder_finish(sat_frame_decoder_t *d) {
+    if (d->status == SAT_FRAME_OK && (d->header_got < SAT_FRAME_HEADER_LEN || d->rec_got > 0)) {
+        d->status = SAT_FRAME_TRUNCATED;
+    }
+    return d->status;
+}
+
+size_t sat_frame_write_header(uint8_t *buf) {
+    buf[0] = SAT_FRAME_MAGIC0;
+    buf[1] = SAT_FRAME_MAGIC1;
+    buf[2] = SAT_FRAME_VERSION;
+    buf[3] = 0;
+    return SAT_FRAME_HEADER_LEN;
+}
+
+size_t sat_frame_write_record(uint8_t *buf, size_t size, const sat_record_t *rec) {
+    size_t total = 1 + SAT_FRAME_RECORD_FIXED + rec->ad_len;
+    if (total > SAT_FRAME_RECORD_MAX || total > size) {
+        return 0;
+    }
+    buf[0] = (uint8_t)(total - 1);
+    memcpy(buf + 1, rec->mac, 6);
+    buf[7] = (uint8_t)rec->rssi;
+    buf[8] = rec->age_ms & 0xFF;
+    buf[9] = rec->age_ms >> 8;
+    memcpy(buf + 1 + SAT_FRAME_RECORD_FIXED, rec->ad, rec->ad_len);
+    return total;
+}
+
+const char *sat_frame_status_str(sat_frame_status_t status) {
+    switch (status) {
+        case SAT_FRAME_OK: return "ok";
+        case SAT_FRAME_BAD_MAGIC: return "not a satellite frame";
+        case SAT_FRAME_BAD_VERSION: return "unsupported frame version";
+        case SAT_FRAME_BAD_RECORD: return "bad record length";
+        case SAT_FRAME_TRUNCATED: return "truncated";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,306 @@
+#include "sat_json.h"
+#include <string.h>
+#include <stdlib.h>
+
+enum {
+    ST_START,          // Before [
+    ST_FIRST_OBJECT,   // After [: { or ]
+    ST_OBJECT,         // After ,: {
+    ST_FIRST_KEY,      // After {: " or }
+    ST_KEY_START,      // After , in an object: "
+    ST_KEY,            // Inside a key
+    ST_COLON,
+    ST_VALUE,          // After :
+    ST_STRING,         // Inside a string value
+    ST_SCALAR,         // Inside a number or literal
+    ST_AFTER_VALUE,    // , or }
+    ST_AFTER_OBJECT,   // , or ]
+    ST_DONE,           // After ]
+};
+
+enum {
+    FIELD_SKIP,
+    FIELD_MAC,
+    FIELD_RSSI,
+    FIELD_DATA,
+    FIELD_NAME,
+    FIELD_AGE,
+};
+
+static bool is_space(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hex_nibble(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void sat_json_decoder_init(sat_json_decoder_t *d) {
+    memset(d, 0, sizeof(*d));
+    d->state = ST_START;
+    d->status = SAT_JSON_OK;
+}
+
+static void object_begin(sat_json_decoder_t *d) {
+    d->has_mac = false;
+    d->has_data = false;
+    d->bad = false;
+    d->rec.rssi = 0;
+    d->rec.age_ms = 0;
+    d->rec.ad_len = 0;
+    d->name_len = 0;
+}
+
+static void object_end(sat_json_decoder_t *d, sat_record_cb_t cb, void *ctx) {
+    if (!d->has_mac || !d->has_data || d->bad) {
+        d->invalid++;
+        return;
+    }
+    // Name as a trailing Complete Local Name; the parser prefers a name
+    // from the advertisement itself
+    int name_len = d->name_len;
+    if (name_len > SAT_JSON_AD_MAX - d->rec.ad_len - 2) {
+        name_len = SAT_JSON_AD_MAX - d->rec.ad_len - 2;
+    }
+    if (name_len > 0) {
+        d->ad[d->rec.ad_len++] = name_len + 1;
+        d->ad[d->rec.ad_len++] = 0x09;
+        memcpy(&d->ad[d->rec.ad_len], d->name, name_len);
+        d->rec.ad_len += name_len;
+    }
+    d->rec.ad = d->ad;
+    d->records++;
+    cb(ctx, &d->rec);
+}
+
+static void key_end(sat_json_decoder_t *d) {
+    static const struct { const char *key; uint8_t field; } keys[] = {
+        {"mac", FIELD_MAC}, {"rssi", FIELD_RSSI}, {"data", FIELD_DATA},
+        {"name", FIELD_NAME}, {"age", FIELD_AGE},
+    };
+    d->field = FIELD_SKIP;
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (strlen(keys[i].key) == d->token_len && memcmp(keys[i].key, d->token, d->token_len) == 0) {
+            d->field = keys[i].field;
+            return;
+        }
+    }
+}
+
+// "AA:BB:CC:DD:EE:FF"
+static void mac_end(sat_json_decoder_t *d) {
+    if (d->token_len != 17) {
+        d->bad = true;
+        return;
+    }
+    for (int i = 0; i < 6; i++) {
+        int hi = hex_nibble(d->token[i * 3]);
+        int lo = hex_nibble(d->token[i * 3 + 1]);
+        if (hi < 0 || lo < 0 || (i < 5 && d->token[i * 3 + 2] != ':')) {
+            d->bad = true;
+            return;
+        }
+        d->rec.mac[i] = (hi << 4) | lo;
+    }
+    d->has_mac = true;
+}
+
+static void scalar_end(sat_json_decoder_t *d) {
+    d->token[d->token_len] = '\0';
+    if (d->field == FIELD_RSSI) {
+        d->rec.rssi = (int8_t)atoi(d->token);
+    } else if (d->field == FIELD_AGE) {
+        long age = atol(d->token);
+        d->rec.age_ms = (age < 0) ? 0 : (age > 0xFFFF) ? 0xFFFF : (uint16_t)age;
+    }
+}
+
+// One character of a string value (escapes already resolved to the
+// escaped character itself)
+static void string_char(sat_json_decoder_t *d, uint8_t c) {
+    switch (d->field) {
+        case FIELD_MAC:
+            if (d->token_len < SAT_JSON_TOKEN_MAX - 1) {
+                d->token[d->token_len++] = c;
+            }
+            break;
+        case FIELD_DATA: {
+            int n = hex_nibble(c);
+            if (n < 0) {
+                d->bad = true;
+            } else if (d->hex_high < 0) {
+                d->hex_high = n;
+            } else {
+                if (d->rec.ad_len < SAT_JSON_AD_MAX) {
+                    d->ad[d->rec.ad_len++] = (d->hex_high << 4) | n;
+                }
+                d->hex_high = -1;
+            }
+            break;
+        }
+        case FIELD_NAME:
+            if (d->name_len < SAT_JSON_NAME_MAX) {
+                d->name[d->name_len++] = c;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void string_end(sat_json_decoder_t *d) {
+    if (d->field == FIELD_MAC) {
+        mac_end(d);
+    } else if (d->field == FIELD_DATA) {
+        d->has_data = (d->hex_high < 0);
+    }
+}
+
+sat_json_status_t sat_json_decode(sat_json_decoder_t *d, const uint8_t *data, size_t len,
+                                  sat_record_cb_t cb, void *ctx) {
+    for (size_t i = 0; i < len && d->status == SAT_JSON_OK; i++) {
+        uint8_t c = data[i];
+        switch (d->state) {
+            case ST_KEY:
+            case ST_STRING:
+                if (d->escape) {
+                    d->escape = false;
+                } else if (c == '\\') {
+                    d->escape = true;
+                    continue;
+                } else if (c == '"') {
+                    if (d->state == ST_KEY) {
+                        key_end(d);
+                        d->state = ST_COLON;
+                    } else {
+                        string_end(d);
+                        d->state = ST_AFTER_VALUE;
+                    }
+                    continue;
+                }
+                if (d->state == ST_KEY) {
+                    if (d->token_len < SAT_JSON_TOKEN_MAX - 1) {
+                        d->token[d->token_len++] = c;
+                    }
+                } else {
+                    string_char(d, c);
+                }
+                continue;
+
+            case ST_SCALAR:
+                if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' ||
+                    c == '.' || c == 'E') {
+                    if (d->token_len < SAT_JSON_TOKEN_MAX - 1) {
+                        d->token[d->token_len++] = c;
+                    }
+                    continue;
+                }
+                scalar_end(d);
+                d->state = ST_AFTER_VALUE;
+                break;  // The terminator is handled below
+
+            default:
+                break;
+        }
+
+        if (is_space(c)) {
+            continue;
+        }
+        switch (d->state) {
+            case ST_START:
+                d->state = (c == '[') ? ST_FIRST_OBJECT : ST_START;
+                if (c != '[') d->status = SAT_JSON_SYNTAX;
+                break;
+            case ST_FIRST_OBJECT:
+            case ST_OBJECT:
+                if (c == '{') {
+                    object_begin(d);
+                    d->state = ST_FIRST_KEY;
+                } else if (c == ']' && d->state == ST_FIRST_OBJECT) {
+                    d->state = ST_DONE;
+                } else {
+                    d->status = SAT_JSON_SYNTAX;
+                }
+                break;
+            case ST_FIRST_KEY:
+            case ST_KEY_START:
+                if (c == '"') {
+                    d->token_len = 0;
+                    d->state = ST_KEY;
+                } else if (c == '}' && d->state == ST_FIRST_KEY) {
+                    object_end(d, cb, ctx);
+                    d->state = ST_AFTER_OBJECT;
+                } else {
+                    d->status = SAT_JSON_SYNTAX;
+                }
+                break;
+            case ST_COLON:
+                if (c == ':') {
+                    d->state = ST_VALUE;
+                } else {
+                    d->status = SAT_JSON_SYNTAX;
+                }
+                break;
+            case ST_VALUE:
+                d->token_len = 0;
+                if (c == '"') {
+                    d->hex_high = -1;
+                    if (d->field == FIELD_DATA) {
+                        d->rec.ad_len = 0;
+                    } else if (d->field == FIELD_NAME) {
+                        d->name_len = 0;
+                    }
+                    d->state = ST_STRING;
+                } else if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-') {
+                    d->token[d->token_len++] = c;
+                    d->state = ST_SCALAR;
+                } else {
+                    d->status = SAT_JSON_SYNTAX;  // Nested objects/arrays aren't expected
+                }
+                break;
+            case ST_AFTER_VALUE:
+                if (c == ',') {
+                    d->state = ST_KEY_START;
+                } else if (c == '}') {
+                    object_end(d, cb, ctx);
+                    d->state = ST_AFTER_OBJECT;
+                } else {
+                    d->status = SAT_JSON_SYNTAX;
+                }
+                break;
+            case ST_AFTER_OBJECT:
+                if (c == ',') {
+                    d->state = ST_OBJECT;
+                } else if (c == ']') {
+                    d->state = ST_DONE;
+                } else {
+                    d->status = SAT_JSON_SYNTAX;
+                }
+                break;
+            case ST_DONE:
+            default:
+                d->status = SAT_JSON_SYNTAX;
+                break;
+        }
+    }
+    return d->status;
+}
+
+sat_json_status_t sat_json_decoder_finish(sat_json_decoder_t *d) {
+    if (d->status == SAT_JSON_OK && d->state != ST_DONE) {
+        d->status = SAT_JSON_TRUNCATED;
+    }
+    return d->status;
+}
+
+const char *sat_json_status_str(sat_json_status_t status) {
+    switch (status) {
+        case SAT_JSON_OK: return "ok";
+        case SAT_JSON_SYNTAX: return "expected an array of observation objects";
+        case SAT_JSON_TRUNCATED: return "truncated";
+        default: return "unknown";
+    }
+}
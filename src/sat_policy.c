@@ -0,0 +1,64 @@
+#include "sat_policy.h"
+#include <string.h>
+
+#define FNV_OFFSET 2166136261u
+
+static uint32_t fnv1a_update(uint32_t hash, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t sat_policy_etag(const sat_policy_t *policy, bool watch_all, const uint8_t *watch, int count) {
+    uint32_t hash = FNV_OFFSET;
+    hash = fnv1a_update(hash, &watch_all, sizeof(watch_all));
+    hash = fnv1a_update(hash, &policy->dedupe, sizeof(policy->dedupe));
+    hash = fnv1a_update(hash, &policy->min_interval_ms, sizeof(policy->min_interval_ms));
+    hash = fnv1a_update(hash, &policy->refresh_ms, sizeof(policy->refresh_ms));
+    if (count > 0) {
+        hash = fnv1a_update(hash, watch, (size_t)count * 6);
+    }
+    return hash;
+}
+
+bool sat_policy_watches(bool watch_all, const uint8_t *watch, int count, const uint8_t *mac) {
+    if (watch_all) {
+        return true;
+    }
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(&watch[mid * 6], mac, 6);
+        if (cmp == 0) {
+            return true;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+bool sat_policy_forward(const sat_policy_t *policy, sat_filter_state_t *state, const uint8_t *ad,
+                        size_t len, uint32_t now_ms) {
+    uint32_t hash = fnv1a_update(FNV_OFFSET, ad, len);
+    if (state->forwarded) {
+        uint32_t elapsed = now_ms - state->last_ms;
+        if (elapsed < policy->min_interval_ms) {
+            return false;
+        }
+        bool repeat = (hash == state->payload_hash && len == state->payload_len);
+        if (policy->dedupe && repeat && (policy->refresh_ms == 0 || elapsed < policy->refresh_ms)) {
+            return false;
+        }
+    }
+    state->forwarded = true;
+    state->last_ms = now_ms;
+    state->payload_hash = hash;
+    state->payload_len = (uint8_t)len;
+    return true;
+}
@@ -0,0 +1,90 @@
+#include "sat_registry.h"
+#include <string.h>
+
+void sat_registry_init(sat_registry_t *reg, sat_entry_t *slots, int count, uint32_t reuse_idle_ms) {
+    reg->slots = slots;
+    reg->count = count;
+    reg->reuse_idle_ms = reuse_idle_ms;
+    memset(slots, 0, count * sizeof(sat_entry_t));
+}
+
+int sat_registry_find(const sat_registry_t *reg, uint32_t ip) {
+    if (ip == 0) {
+        return -1;
+    }
+    for (int i = 0; i < reg->count; i++) {
+        if (reg->slots[i].ip == ip) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int sat_registry_claim(sat_registry_t *reg, uint32_t ip, uint32_t now_ms, bool *reused) {
+    *reused = false;
+    if (ip == 0) {
+        return -1;
+    }
+    int slot = sat_registry_find(reg, ip);
+    if (slot < 0) {
+        // A free slot, else the one idle longest
+        uint32_t idle_max = 0;
+        for (int i = 0; i < reg->count; i++) {
+            if (reg->slots[i].ip == 0) {
+                slot = i;
+                break;
+            }
+            uint32_t idle = now_ms - reg->slots[i].active_ms;
+            if (slot < 0 || idle > idle_max) {
+                slot = i;
+                idle_max = idle;
+            }
+        }
+        if (slot < 0) {
+            return -1;
+        }
+        if (reg->slots[slot].ip != 0) {
+            if (idle_max < reg->reuse_idle_ms) {
+                return -1;  // All in recent use: the newcomer waits
+            }
+            *reused = true;
+        }
+        memset(&reg->slots[slot], 0, sizeof(sat_entry_t));
+        reg->slots[slot].ip = ip;
+    }
+    reg->slots[slot].active_ms = now_ms;
+    return slot;
+}
+
+void sat_registry_observed(sat_registry_t *reg, int slot, uint32_t now_ms) {
+    reg->slots[slot].received++;
+    reg->slots[slot].last_seen_ms = now_ms;
+}
+
+void sat_registry_sensor(sat_registry_t *reg, int slot) {
+    reg->slots[slot].sensors++;
+}
+
+void sat_registry_request(sat_registry_t *reg, int slot, uint32_t ms) {
+    sat_entry_t *sat = &reg->slots[slot];
+    sat->requests++;
+    sat->latency[sat_latency_bucket(ms)]++;
+}
+
+void sat_registry_update_rates(sat_registry_t *reg, float interval_s) {
+    for (int i = 0; i < reg->count; i++) {
+        sat_entry_t *sat = &reg->slots[i];
+        sat->adv_rate = (sat->received - sat->rate_received) / interval_s;
+        sat->sensor_rate = (sat->sensors - sat->rate_sensors) / interval_s;
+        sat->rate_received = sat->received;
+        sat->rate_sensors = sat->sensors;
+    }
+}
+
+int sat_latency_bucket(uint32_t ms) {
+    int bucket = 0;
+    while (bucket < SAT_LATENCY_BUCKETS - 1 && ms >= (1u << bucket)) {
+        bucket++;
+    }
+    return bucket;
+}
@@ -0,0 +1,87 @@
+#include "sat_udp.h"
+#include <string.h>
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+bool sat_udp_parse(const uint8_t *data, size_t len, sat_udp_datagram_t *out) {
+    if (len < SAT_UDP_HEADER_LEN + SAT_UDP_TAG_LEN ||
+        data[0] != SAT_UDP_MAGIC0 || data[1] != SAT_UDP_MAGIC1 || data[2] != SAT_UDP_VERSION) {
+        return false;
+    }
+    out->sat_id = get_u32(data + 4);
+    out->epoch = get_u32(data + 8);
+    out->seq = get_u32(data + 12);
+    out->records = data + SAT_UDP_HEADER_LEN;
+    out->records_len = len - SAT_UDP_HEADER_LEN - SAT_UDP_TAG_LEN;
+    out->signed_len = len - SAT_UDP_TAG_LEN;
+    out->tag = data + out->signed_len;
+    return true;
+}
+
+size_t sat_udp_write_header(uint8_t *buf, uint32_t sat_id, uint32_t epoch, uint32_t seq) {
+    buf[0] = SAT_UDP_MAGIC0;
+    buf[1] = SAT_UDP_MAGIC1;
+    buf[2] = SAT_UDP_VERSION;
+    buf[3] = 0;
+    put_u32(buf + 4, sat_id);
+    put_u32(buf + 8, epoch);
+    put_u32(buf + 12, seq);
+    return SAT_UDP_HEADER_LEN;
+}
+
+void sat_seq_init(sat_seq_t *s, uint32_t epoch) {
+    memset(s, 0, sizeof(*s));
+    s->epoch = epoch;
+}
+
+sat_seq_result_t sat_seq_accept(sat_seq_t *s, uint32_t epoch, uint32_t seq) {
+    // Epochs only grow (plain comparison: a satellite won't boot 2^32 times)
+    if (epoch < s->epoch) {
+        s->stale++;
+        return SAT_SEQ_STALE;
+    }
+    if (!s->started || epoch > s->epoch) {
+        bool newer = (epoch > s->epoch);
+        if (s->started) {
+            s->restarts++;
+        }
+        s->started = true;
+        s->epoch = epoch;
+        s->highest = seq;
+        s->window = 1;
+        s->received++;
+        return newer ? SAT_SEQ_NEW_EPOCH : SAT_SEQ_NEW;
+    }
+
+    // Serial number arithmetic: works across the 32-bit wrap
+    int32_t ahead = (int32_t)(seq - s->highest);
+    if (ahead > 0) {
+        s->window = (ahead < SAT_UDP_SEQ_WINDOW) ? (s->window << ahead) | 1 : 1;
+        s->lost += ahead - 1;
+        s->highest = seq;
+        s->received++;
+        return SAT_SEQ_NEW;
+    }
+
+    uint32_t behind = (uint32_t)-ahead;
+    if (behind >= SAT_UDP_SEQ_WINDOW || (s->window & (1u << behind))) {
+        s->duplicates++;
+        return SAT_SEQ_DUPLICATE;
+    }
+    s->window |= 1u << behind;
+    if (s->lost > 0) {
+        s->lost--;  // Counted as lost when it was skipped
+    }
+    s->reordered++;
+    s->received++;
+    return SAT_SEQ_REORDERED;
+}
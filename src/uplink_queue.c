@@ -0,0 +1,155 @@
+#include "uplink_queue.h"
+#include <stddef.h>
+#include <string.h>
+
+// On-flash record (little-endian, packed, UPLINK_QUEUE_RECORD_SIZE bytes)
+typedef struct __attribute__((packed)) {
+    uint32_t seq;
+    uplink_reading_t reading;
+    uint32_t crc;       // Over the fields above
+    uint8_t pad[UPLINK_QUEUE_RECORD_SIZE - 8 - sizeof(uplink_reading_t)];
+} queue_record_t;
+
+_Static_assert(sizeof(queue_record_t) == UPLINK_QUEUE_RECORD_SIZE, "record size");
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static inline uint32_t record_crc(const queue_record_t *rec) {
+    return crc32_update(0, (const uint8_t *)rec, offsetof(queue_record_t, crc));
+}
+
+static inline uint32_t slot_offset(uint32_t slot) {
+    return slot * UPLINK_QUEUE_RECORD_SIZE;
+}
+
+static bool slot_erased(const queue_record_t *rec) {
+    const uint8_t *p = (const uint8_t *)rec;
+    for (size_t i = 0; i < sizeof(*rec); i++) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Read a slot; true if it holds a valid record for that slot
+static bool read_slot(const uplink_queue_t *q, uint32_t slot, queue_record_t *rec) {
+    if (!q->flash.read(q->flash.ctx, slot_offset(slot), rec, sizeof(*rec))) {
+        return false;
+    }
+    return rec->seq != 0 && rec->seq != 0xFFFFFFFFu && rec->seq % q->capacity == slot &&
+           rec->crc == record_crc(rec);
+}
+
+static bool format(uplink_queue_t *q) {
+    for (uint16_t s = 0; s < q->sector_count; s++) {
+        if (!q->flash.erase_sector(q->flash.ctx, (uint32_t)s * UPLINK_QUEUE_SECTOR_SIZE)) {
+            return false;
+        }
+    }
+    q->next_seq = 1;
+    q->oldest_seq = 1;
+    return true;
+}
+
+bool uplink_queue_mount(uplink_queue_t *q, const uplink_queue_flash_t *flash, uint16_t sector_count) {
+    if (sector_count < 2) {
+        return false;
+    }
+    q->flash = *flash;
+    q->sector_count = sector_count;
+    q->capacity = (uint32_t)sector_count * UPLINK_QUEUE_RECORDS_PER_SECTOR;
+
+    uint32_t min_seq = 0;
+    uint32_t max_seq = 0;
+    queue_record_t rec;
+    for (uint32_t slot = 0; slot < q->capacity; slot++) {
+        if (!read_slot(q, slot, &rec)) {
+            continue;
+        }
+        if (min_seq == 0 || rec.seq < min_seq) {
+            min_seq = rec.seq;
+        }
+        if (rec.seq > max_seq) {
+            max_seq = rec.seq;
+        }
+    }
+    if (max_seq == 0) {
+        return format(q);
+    }
+
+    // Continue after the newest record, stepping over torn slots that can't
+    // be rewritten without erasing their sector
+    q->next_seq = max_seq + 1;
+    while (q->next_seq % UPLINK_QUEUE_RECORDS_PER_SECTOR != 0) {
+        if (!q->flash.read(q->flash.ctx, slot_offset(q->next_seq % q->capacity), &rec, sizeof(rec))) {
+            return false;
+        }
+        if (slot_erased(&rec)) {
+            break;
+        }
+        q->next_seq++;
+    }
+    q->oldest_seq = min_seq;
+    return true;
+}
+
+uint32_t uplink_queue_append(uplink_queue_t *q, const uplink_reading_t *reading) {
+    uint32_t seq = q->next_seq;
+    uint32_t slot = seq % q->capacity;
+
+    if (slot % UPLINK_QUEUE_RECORDS_PER_SECTOR == 0) {
+        // Entering a sector: erase it, dropping the oldest records
+        if (!q->flash.erase_sector(q->flash.ctx, slot_offset(slot))) {
+            return 0;
+        }
+        uint32_t first_kept = seq + UPLINK_QUEUE_RECORDS_PER_SECTOR;
+        first_kept = (first_kept > q->capacity) ? first_kept - q->capacity : 1;
+        if (q->oldest_seq < first_kept) {
+            q->oldest_seq = first_kept;
+        }
+    }
+
+    queue_record_t rec;
+    memset(&rec, 0xFF, sizeof(rec));
+    rec.seq = seq;
+    rec.reading = *reading;
+    rec.crc = record_crc(&rec);
+    // The slot is used even if the write fails, so a torn record is never rewritten
+    q->next_seq++;
+    if (!q->flash.write(q->flash.ctx, slot_offset(slot), &rec, sizeof(rec))) {
+        return 0;
+    }
+    return seq;
+}
+
+int uplink_queue_read(const uplink_queue_t *q, uint32_t from_seq, uplink_reading_t *out, int max,
+                      uint32_t *end_seq) {
+    uint32_t seq = (from_seq < q->oldest_seq) ? q->oldest_seq : from_seq;
+    int n = 0;
+    queue_record_t rec;
+    while (seq < q->next_seq && n < max) {
+        if (read_slot(q, seq % q->capacity, &rec) && rec.seq == seq) {
+            out[n++] = rec.reading;
+        }
+        seq++;
+    }
+    *end_seq = seq;
+    return n;
+}
+
+uint32_t uplink_queue_pending(const uplink_queue_t *q, uint32_t cursor) {
+    if (cursor < q->oldest_seq) {
+        cursor = q->oldest_seq;
+    }
+    return (cursor < q->next_seq) ? q->next_seq - cursor : 0;
+}
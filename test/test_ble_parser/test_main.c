@@ -0,0 +1,421 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ble_parser.h"
+
+#define FUZZ_ITERATIONS 200000
+#define BENCH_ITERATIONS 2000000
+
+// pvvx custom format, 0x181A, 17 bytes of service data:
+// 21.50 °C, 45.67 %, 2950 mV, 87 %, counter 0x2A
+static const uint8_t PVVX_ADV[] = {
+    0x02, 0x01, 0x06,
+    0x12, 0x16, 0x1A, 0x18, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66,
+    0x66, 0x08, 0xD7, 0x11, 0x86, 0x0B, 0x57, 0x2A, 0x04,
+    0x08, 0x09, 'A', 'T', 'C', '_', 'a', 'b', 'c',
+};
+
+// ATC custom format, 0x181A, 15 bytes: -3.5 °C (big-endian), 60 %, 91 %,
+// 3010 mV, counter 7
+static const uint8_t ATC_ADV[] = {
+    0x10, 0x16, 0x1A, 0x18, 0xA4, 0xC1, 0x38, 0x01, 0x02, 0x03,
+    0xFF, 0xDD, 0x3C, 0x5B, 0x0B, 0xC2, 0x07,
+};
+
+// MiBeacon, 0xFE95, LYWSD03MMC (0x055B), unencrypted, frame 0x33,
+// temperature + humidity object: 23.4 °C, 51.2 %
+static const uint8_t MIBEACON_ADV[] = {
+    0x15, 0x16, 0x95, 0xFE,
+    0x50, 0x20, 0x5B, 0x05, 0x33, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66,
+    0x0D, 0x10, 0x04, 0xEA, 0x00, 0x00, 0x02,
+};
+
+// BTHome v2, 0xFCD2: packet id 9, battery 77 %, 19.87 °C, 40.50 %
+static const uint8_t BTHOME_ADV[] = {
+    0x0E, 0x16, 0xD2, 0xFC, 0x40,
+    0x00, 0x09, 0x01, 0x4D, 0x02, 0xC3, 0x07, 0x03, 0xD2, 0x0F,
+};
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void setUp(void) {
+    rng_state = 1;
+}
+
+void tearDown(void) {
+}
+
+static void test_pvvx(void) {
+    ble_adv_view_t view;
+    ble_sensor_data_t sd = {0};
+    TEST_ASSERT_TRUE(ble_parse_sensor_data(PVVX_ADV, sizeof(PVVX_ADV), &view, &sd));
+    TEST_ASSERT_EQUAL_STRING("pvvx", sd.device_type);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 21.50, sd.temperature);
+    TEST_ASSERT_EQUAL_UINT8(45, sd.humidity);
+    TEST_ASSERT_EQUAL_UINT16(2950, sd.battery_mv);
+    TEST_ASSERT_EQUAL_UINT8(87, sd.battery_pct);
+    TEST_ASSERT_TRUE(sd.has_packet_id);
+    TEST_ASSERT_EQUAL_UINT8(0x2A, sd.packet_id);
+    TEST_ASSERT_EQUAL_INT(7, view.name_len);
+    TEST_ASSERT_TRUE(view.name_complete);
+    TEST_ASSERT_EQUAL_MEMORY("ATC_abc", view.name, 7);
+    TEST_ASSERT_NULL(view.mfg_data);
+    TEST_ASSERT_EQUAL_UINT16(BLE_COMPANY_ID_NONE, view.company_id);
+}
+
+static void test_atc(void) {
+    ble_sensor_data_t sd = {0};
+    TEST_ASSERT_TRUE(ble_parse_sensor_data(ATC_ADV, sizeof(ATC_ADV), NULL, &sd));
+    TEST_ASSERT_EQUAL_STRING("ATC", sd.device_type);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -3.5, sd.temperature);
+    TEST_ASSERT_EQUAL_UINT8(60, sd.humidity);
+    TEST_ASSERT_EQUAL_UINT8(91, sd.battery_pct);
+    TEST_ASSERT_EQUAL_UINT16(3010, sd.battery_mv);
+    TEST_ASSERT_TRUE(sd.has_packet_id);
+    TEST_ASSERT_EQUAL_UINT8(7, sd.packet_id);
+}
+
+// 16 bytes of 0x181A service data is too short for pvvx and falls back to ATC
+static void test_181a_dispatch_by_length(void) {
+    uint8_t svc[17];
+    memcpy(svc, &PVVX_ADV[5], sizeof(svc));
+    ble_sensor_data_t sd = {0};
+    TEST_ASSERT_TRUE(ble_parse_service_data(svc, 17, &sd));
+    TEST_ASSERT_EQUAL_STRING("pvvx", sd.device_type);
+    TEST_ASSERT_TRUE(ble_parse_service_data(svc, 16, &sd));
+    TEST_ASSERT_EQUAL_STRING("ATC", sd.device_type);
+    TEST_ASSERT_FALSE(ble_parse_service_data(svc, 14, &sd));
+}
+
+static void test_mibeacon(void) {
+    ble_sensor_data_t sd = { .battery_pct = 66 };
+    TEST_ASSERT_TRUE(ble_parse_sensor_data(MIBEACON_ADV, sizeof(MIBEACON_ADV), NULL, &sd));
+    TEST_ASSERT_EQUAL_STRING("MiBeacon", sd.device_type);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 23.4, sd.temperature);
+    TEST_ASSERT_EQUAL_UINT8(51, sd.humidity);
+    TEST_ASSERT_EQUAL_UINT8(66, sd.battery_pct);  // Not in this packet: kept
+    TEST_ASSERT_TRUE(sd.has_packet_id);
+    TEST_ASSERT_EQUAL_UINT8(0x33, sd.packet_id);
+}
+
+static void test_mibeacon_rejects_encrypted_and_other_models(void) {
+    uint8_t adv[sizeof(MIBEACON_ADV)];
+    ble_sensor_data_t sd = {0};
+
+    memcpy(adv, MIBEACON_ADV, sizeof(adv));
+    adv[4] |= 0x08;  // Encrypted
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, sizeof(adv), NULL, &sd));
+
+    memcpy(adv, MIBEACON_ADV, sizeof(adv));
+    adv[6] = 0x47;  // Another product id
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, sizeof(adv), NULL, &sd));
+    TEST_ASSERT_FALSE(sd.has_packet_id);
+}
+
+static void test_bthome(void) {
+    ble_sensor_data_t sd = {0};
+    TEST_ASSERT_TRUE(ble_parse_sensor_data(BTHOME_ADV, sizeof(BTHOME_ADV), NULL, &sd));
+    TEST_ASSERT_EQUAL_STRING("BTHome", sd.device_type);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 19.87, sd.temperature);
+    TEST_ASSERT_EQUAL_UINT8(40, sd.humidity);
+    TEST_ASSERT_EQUAL_UINT8(77, sd.battery_pct);
+    TEST_ASSERT_TRUE(sd.has_packet_id);
+    TEST_ASSERT_EQUAL_UINT8(9, sd.packet_id);
+}
+
+static void test_bthome_rejects_encrypted_and_v1(void) {
+    uint8_t adv[sizeof(BTHOME_ADV)];
+    ble_sensor_data_t sd = {0};
+
+    memcpy(adv, BTHOME_ADV, sizeof(adv));
+    adv[4] = 0x41;  // Encrypted
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, sizeof(adv), NULL, &sd));
+
+    memcpy(adv, BTHOME_ADV, sizeof(adv));
+    adv[4] = 0x20;  // Version 1
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, sizeof(adv), NULL, &sd));
+}
+
+// A packet id in a packet that carries no measurement (battery only, or
+// stopped at an unknown object) must not be reported: ingest would drop
+// the next real reading with that id as a duplicate
+static void test_bthome_packet_id_only_on_success(void) {
+    static const uint8_t battery_only[] = {
+        0x08, 0x16, 0xD2, 0xFC, 0x40, 0x00, 0x0A, 0x01, 0x50,
+    };
+    static const uint8_t unknown_object[] = {
+        0x0B, 0x16, 0xD2, 0xFC, 0x40, 0x00, 0x0B, 0x3A, 0x01, 0x02, 0xC3, 0x07,
+    };
+    ble_sensor_data_t sd = {0};
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(battery_only, sizeof(battery_only), NULL, &sd));
+    TEST_ASSERT_FALSE(sd.has_packet_id);
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(unknown_object, sizeof(unknown_object), NULL, &sd));
+    TEST_ASSERT_FALSE(sd.has_packet_id);
+
+    // Truncated measurement after the id
+    uint8_t adv[sizeof(BTHOME_ADV)];
+    memcpy(adv, BTHOME_ADV, sizeof(adv));
+    adv[0] = 0x08;  // Service data ends inside the temperature
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, 9, NULL, &sd));
+    TEST_ASSERT_FALSE(sd.has_packet_id);
+}
+
+static void test_manufacturer_data_view(void) {
+    static const uint8_t adv[] = {
+        0x05, 0xFF, 0x8F, 0x03, 0xAA, 0xBB,
+        0x04, 0x08, 'L', 'Y', 'W',
+    };
+    ble_adv_view_t view;
+    ble_sensor_data_t sd = {0};
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, sizeof(adv), &view, &sd));
+    TEST_ASSERT_EQUAL_UINT16(0x038F, view.company_id);
+    TEST_ASSERT_TRUE(view.mfg_data == &adv[2]);
+    TEST_ASSERT_EQUAL_INT(4, view.mfg_len);
+    TEST_ASSERT_EQUAL_STRING("Xiaomi", ble_get_device_type(view.company_id));
+    TEST_ASSERT_EQUAL_INT(3, view.name_len);
+    TEST_ASSERT_FALSE(view.name_complete);
+}
+
+// A structure running past the end stops the walk; the prefix still counts
+static void test_truncated_structure_keeps_prefix(void) {
+    uint8_t adv[sizeof(PVVX_ADV)];
+    memcpy(adv, PVVX_ADV, sizeof(adv));
+    ble_adv_view_t view;
+    ble_sensor_data_t sd = {0};
+
+    // Cut into the name: sensor data parsed, name dropped
+    TEST_ASSERT_TRUE(ble_parse_sensor_data(adv, sizeof(adv) - 2, &view, &sd));
+    TEST_ASSERT_EQUAL_STRING("pvvx", sd.device_type);
+    TEST_ASSERT_NULL(view.name);
+
+    // Cut into the service data: nothing usable
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, 12, &view, &sd));
+    TEST_ASSERT_FALSE(sd.has_packet_id);
+
+    // Only a length byte left after the flags
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, 4, &view, &sd));
+
+    // Service data length byte larger than the rest of the packet
+    adv[3] = 0x1F;
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, sizeof(adv), &view, &sd));
+}
+
+static void test_zero_length_terminates(void) {
+    uint8_t adv[3 + sizeof(ATC_ADV)] = { 0x02, 0x01, 0x06 };
+    memcpy(&adv[3], ATC_ADV, sizeof(ATC_ADV));
+    ble_sensor_data_t sd = {0};
+    TEST_ASSERT_TRUE(ble_parse_sensor_data(adv, sizeof(adv), NULL, &sd));
+    adv[0] = 0x00;  // Padding before the service data
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, sizeof(adv), NULL, &sd));
+    TEST_ASSERT_FALSE(ble_parse_sensor_data(adv, 0, NULL, &sd));
+}
+
+// Truncating a service data payload inside a format never reads past it
+static void test_truncated_service_data(void) {
+    const uint8_t *svcs[] = { &PVVX_ADV[5], &ATC_ADV[2], &MIBEACON_ADV[2], &BTHOME_ADV[2] };
+    const uint8_t lens[] = { 17, 15, 20, 13 };
+    for (int f = 0; f < 4; f++) {
+        for (uint8_t len = 0; len < lens[f]; len++) {
+            uint8_t *copy = malloc(len ? len : 1);  // Exact size: out-of-bounds reads show up under ASan
+            memcpy(copy, svcs[f], len);
+            ble_sensor_data_t sd = {0};
+            ble_parse_service_data(copy, len, &sd);
+            free(copy);
+        }
+    }
+}
+
+// Random and half-valid packets: no out-of-bounds access, the view stays
+// inside the buffer, and the result matches has_data
+static void test_fuzz(void) {
+    uint8_t buf[31];
+    for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+        uint8_t n = rng() % 32;
+        for (int j = 0; j < n; j++) {
+            buf[j] = (uint8_t)rng();
+        }
+        if (n > 4 && rng() % 2) {
+            buf[0] = (uint8_t)(rng() % n);
+            buf[1] = BLE_AD_TYPE_SVC_DATA_UUID16;
+            static const uint16_t uuids[] = { 0x181A, 0xFE95, 0xFCD2 };
+            uint16_t uuid = uuids[rng() % 3];
+            buf[2] = (uint8_t)uuid;
+            buf[3] = (uint8_t)(uuid >> 8);
+        }
+        uint8_t *copy = malloc(n ? n : 1);
+        memcpy(copy, buf, n);
+        ble_adv_view_t view;
+        ble_sensor_data_t sd = {0};
+        bool ok = ble_parse_sensor_data(copy, n, &view, &sd);
+        TEST_ASSERT_EQUAL(ok, sd.has_data);
+        if (view.name) {
+            TEST_ASSERT_TRUE((const uint8_t *)view.name >= copy &&
+                             (const uint8_t *)view.name + view.name_len <= copy + n);
+        }
+        if (view.mfg_data) {
+            TEST_ASSERT_TRUE(view.mfg_data >= copy && view.mfg_data + view.mfg_len <= copy + n);
+        }
+        free(copy);
+    }
+}
+
+// Stand-in for the previous ingest path: NimBLE's ble_hs_adv_parse_fields
+// cleared a large fields struct, walked every AD structure validating each
+// type, and only then was the service data parsed. NimBLE doesn't build on
+// the host, so this reproduces that work shape (clear + full walk + second
+// pass) for the timing comparison; it is not NimBLE itself.
+typedef struct {
+    uint8_t flags;
+    const uint8_t *uuids16;
+    uint8_t num_uuids16;
+    const uint8_t *name;
+    uint8_t name_len;
+    bool name_is_complete;
+    int8_t tx_pwr_lvl;
+    const uint8_t *svc_data_uuid16;
+    uint8_t svc_data_uuid16_len;
+    const uint8_t *mfg_data;
+    uint8_t mfg_data_len;
+    uint8_t other[96];  // The other AD types ble_hs_adv_fields has room for
+} ref_adv_fields_t;
+
+static bool ref_parse_fields(ref_adv_fields_t *f, const uint8_t *data, uint8_t len) {
+    memset(f, 0, sizeof(*f));
+    uint8_t pos = 0;
+    while (pos < len) {
+        uint8_t field_len = data[pos];
+        if (field_len == 0 || field_len > len - pos - 1) {
+            return false;
+        }
+        uint8_t type = data[pos + 1];
+        const uint8_t *value = &data[pos + 2];
+        uint8_t value_len = field_len - 1;
+        switch (type) {
+            case 0x01:
+                if (value_len != 1) {
+                    return false;
+                }
+                f->flags = value[0];
+                break;
+            case 0x02:
+            case 0x03:
+                if (value_len % 2) {
+                    return false;
+                }
+                f->uuids16 = value;
+                f->num_uuids16 = value_len / 2;
+                break;
+            case BLE_AD_TYPE_NAME_SHORT:
+            case BLE_AD_TYPE_NAME_COMPLETE:
+                f->name = value;
+                f->name_len = value_len;
+                f->name_is_complete = (type == BLE_AD_TYPE_NAME_COMPLETE);
+                break;
+            case 0x0A:
+                if (value_len != 1) {
+                    return false;
+                }
+                f->tx_pwr_lvl = (int8_t)value[0];
+                break;
+            case BLE_AD_TYPE_SVC_DATA_UUID16:
+                if (value_len < 2) {
+                    return false;
+                }
+                f->svc_data_uuid16 = value;
+                f->svc_data_uuid16_len = value_len;
+                break;
+            case BLE_AD_TYPE_MFG_DATA:
+                f->mfg_data = value;
+                f->mfg_data_len = value_len;
+                break;
+            default:
+                break;
+        }
+        pos += field_len + 1;
+    }
+    return true;
+}
+
+static bool ref_parse(const uint8_t *adv, uint8_t len, ble_sensor_data_t *sd) {
+    ref_adv_fields_t fields;
+    sd->has_data = false;
+    if (!ref_parse_fields(&fields, adv, len) || fields.svc_data_uuid16 == NULL) {
+        return false;
+    }
+    return ble_parse_service_data(fields.svc_data_uuid16, fields.svc_data_uuid16_len, sd);
+}
+
+// On well-formed packets both paths decode the same readings
+static void test_matches_reference_path(void) {
+    const uint8_t *advs[] = { PVVX_ADV, ATC_ADV, MIBEACON_ADV, BTHOME_ADV };
+    const uint8_t lens[] = { sizeof(PVVX_ADV), sizeof(ATC_ADV), sizeof(MIBEACON_ADV), sizeof(BTHOME_ADV) };
+    for (int i = 0; i < 4; i++) {
+        ble_sensor_data_t a = {0}, b = {0};
+        TEST_ASSERT_TRUE(ble_parse_sensor_data(advs[i], lens[i], NULL, &a));
+        TEST_ASSERT_TRUE(ref_parse(advs[i], lens[i], &b));
+        TEST_ASSERT_EQUAL_STRING(b.device_type, a.device_type);
+        TEST_ASSERT_EQUAL_FLOAT(b.temperature, a.temperature);
+        TEST_ASSERT_EQUAL_UINT8(b.humidity, a.humidity);
+        TEST_ASSERT_EQUAL_UINT8(b.battery_pct, a.battery_pct);
+        TEST_ASSERT_EQUAL_UINT16(b.battery_mv, a.battery_mv);
+    }
+}
+
+static void test_benchmark_ns_per_packet(void) {
+    const uint8_t *advs[] = { PVVX_ADV, ATC_ADV, MIBEACON_ADV, BTHOME_ADV };
+    const uint8_t lens[] = { sizeof(PVVX_ADV), sizeof(ATC_ADV), sizeof(MIBEACON_ADV), sizeof(BTHOME_ADV) };
+    volatile int sink = 0;
+    ble_adv_view_t view;
+    ble_sensor_data_t sd = {0};
+
+    double t0 = now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += ble_parse_sensor_data(advs[i & 3], lens[i & 3], &view, &sd);
+    }
+    double walker_ns = (now_ns() - t0) / BENCH_ITERATIONS;
+
+    t0 = now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        sink += ref_parse(advs[i & 3], lens[i & 3], &sd);
+    }
+    double ref_ns = (now_ns() - t0) / BENCH_ITERATIONS;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "raw AD walker %.1f ns/packet, fields-struct path (NimBLE stand-in) %.1f ns/packet",
+             walker_ns, ref_ns);
+    TEST_MESSAGE(msg);
+    (void)sink;
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pvvx);
+    RUN_TEST(test_atc);
+    RUN_TEST(test_181a_dispatch_by_length);
+    RUN_TEST(test_mibeacon);
+    RUN_TEST(test_mibeacon_rejects_encrypted_and_other_models);
+    RUN_TEST(test_bthome);
+    RUN_TEST(test_bthome_rejects_encrypted_and_v1);
+    RUN_TEST(test_bthome_packet_id_only_on_success);
+    RUN_TEST(test_manufacturer_data_view);
+    RUN_TEST(test_truncated_structure_keeps_prefix);
+    RUN_TEST(test_zero_length_terminates);
+    RUN_TEST(test_truncated_service_data);
+    RUN_TEST(test_fuzz);
+    RUN_TEST(test_matches_reference_path);
+    RUN_TEST(test_benchmark_ns_per_packet);
+    return UNITY_END();
+}
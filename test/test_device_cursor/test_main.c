@@ -0,0 +1,81 @@
+#include <unity.h>
+#include <string.h>
+#include "device_cursor.h"
+
+#define EPOCH 0x1a2b3c4du
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+static void test_cursor_format(void) {
+    char cursor[DEVICE_CURSOR_LEN];
+    device_cursor_format(cursor, sizeof(cursor), EPOCH, 42);
+    TEST_ASSERT_EQUAL_STRING("1a2b3c4d.42", cursor);
+    device_cursor_format(cursor, sizeof(cursor), 0x1, 0);
+    TEST_ASSERT_EQUAL_STRING("00000001.0", cursor);
+    device_cursor_format(cursor, sizeof(cursor), UINT32_MAX, UINT32_MAX);
+    TEST_ASSERT_EQUAL_STRING("ffffffff.4294967295", cursor);
+}
+
+// The ETag differs between the visible and the full list of one version
+static void test_etag_format(void) {
+    char etag[DEVICE_ETAG_LEN];
+    device_etag_format(etag, sizeof(etag), EPOCH, 42, false);
+    TEST_ASSERT_EQUAL_STRING("\"1a2b3c4d.42\"", etag);
+    device_etag_format(etag, sizeof(etag), EPOCH, 42, true);
+    TEST_ASSERT_EQUAL_STRING("\"1a2b3c4d.42.all\"", etag);
+    device_etag_format(etag, sizeof(etag), UINT32_MAX, UINT32_MAX, true);
+    TEST_ASSERT_EQUAL_STRING("\"ffffffff.4294967295.all\"", etag);
+}
+
+static void test_resume_round_trip(void) {
+    char cursor[DEVICE_CURSOR_LEN];
+    device_cursor_format(cursor, sizeof(cursor), EPOCH, 42);
+    uint32_t since = 0;
+    TEST_ASSERT_TRUE(device_cursor_resume(cursor, EPOCH, 10, 50, &since));
+    TEST_ASSERT_EQUAL_UINT32(42, since);
+}
+
+// Edges: a cursor taken at the removal itself or at the current version
+// can still resume
+static void test_resume_bounds(void) {
+    uint32_t since = 0;
+    TEST_ASSERT_TRUE(device_cursor_resume("1a2b3c4d.10", EPOCH, 10, 50, &since));
+    TEST_ASSERT_EQUAL_UINT32(10, since);
+    TEST_ASSERT_TRUE(device_cursor_resume("1a2b3c4d.50", EPOCH, 10, 50, &since));
+    TEST_ASSERT_EQUAL_UINT32(50, since);
+}
+
+static void test_full_list_needed(void) {
+    uint32_t since = 7;
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4d.9", EPOCH, 10, 50, &since));   // List shrank since
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4d.51", EPOCH, 10, 50, &since));  // Not reached yet
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4e.42", EPOCH, 10, 50, &since));  // Other boot
+    TEST_ASSERT_EQUAL_UINT32(7, since);
+}
+
+static void test_malformed_cursor(void) {
+    uint32_t since = 7;
+    TEST_ASSERT_FALSE(device_cursor_resume("", EPOCH, 0, 50, &since));
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4d", EPOCH, 0, 50, &since));
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4d.", EPOCH, 0, 50, &since));
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4d.42x", EPOCH, 0, 50, &since));
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4d.42.all", EPOCH, 0, 50, &since));
+    TEST_ASSERT_FALSE(device_cursor_resume("zz.42", EPOCH, 0, 50, &since));
+    TEST_ASSERT_FALSE(device_cursor_resume("1a2b3c4d.99999999999", EPOCH, 0, 50, &since));
+    TEST_ASSERT_EQUAL_UINT32(7, since);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cursor_format);
+    RUN_TEST(test_etag_format);
+    RUN_TEST(test_resume_round_trip);
+    RUN_TEST(test_resume_bounds);
+    RUN_TEST(test_full_list_needed);
+    RUN_TEST(test_malformed_cursor);
+    return UNITY_END();
+}
@@ -0,0 +1,242 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "device_registry.h"
+
+#define BENCH_MAX_DEVICES 5000
+#define BENCH_LOOKUPS 200000
+
+static device_registry_slot_t slots[16384];
+static device_registry_t reg;
+
+// Deterministic MACs: a shared vendor OUI and a counter, like a batch of
+// sensors of one model
+static void make_mac(uint8_t *addr, uint32_t n) {
+    addr[0] = 0xA4;
+    addr[1] = 0xC1;
+    addr[2] = 0x38;
+    addr[3] = (uint8_t)(n >> 16);
+    addr[4] = (uint8_t)(n >> 8);
+    addr[5] = (uint8_t)n;
+}
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void setUp(void) {
+    rng_state = 1;
+}
+
+void tearDown(void) {
+}
+
+static void test_init_rejects_bad_sizes(void) {
+    TEST_ASSERT_FALSE(device_registry_init(&reg, slots, 0));
+    TEST_ASSERT_FALSE(device_registry_init(&reg, slots, 1));
+    TEST_ASSERT_FALSE(device_registry_init(&reg, slots, 12));
+    TEST_ASSERT_TRUE(device_registry_init(&reg, slots, 16));
+    TEST_ASSERT_EQUAL_UINT16(0, reg.count);
+}
+
+static void test_insert_and_find(void) {
+    uint8_t addr[6];
+    device_registry_init(&reg, slots, 256);
+    for (int i = 0; i < 100; i++) {
+        make_mac(addr, i);
+        TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, i));
+    }
+    TEST_ASSERT_EQUAL_UINT16(100, reg.count);
+    for (int i = 0; i < 100; i++) {
+        make_mac(addr, i);
+        TEST_ASSERT_EQUAL_INT(i, device_registry_find(&reg, addr));
+    }
+    make_mac(addr, 100);
+    TEST_ASSERT_EQUAL_INT(-1, device_registry_find(&reg, addr));
+}
+
+static void test_insert_existing_updates_index(void) {
+    uint8_t addr[6];
+    device_registry_init(&reg, slots, 16);
+    make_mac(addr, 7);
+    TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, 3));
+    TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, 9));
+    TEST_ASSERT_EQUAL_UINT16(1, reg.count);
+    TEST_ASSERT_EQUAL_INT(9, device_registry_find(&reg, addr));
+}
+
+static void test_insert_rejects_bad_index(void) {
+    uint8_t addr[6];
+    device_registry_init(&reg, slots, 16);
+    make_mac(addr, 1);
+    TEST_ASSERT_FALSE(device_registry_insert(&reg, addr, -1));
+    TEST_ASSERT_FALSE(device_registry_insert(&reg, addr, DEVICE_REGISTRY_EMPTY));
+    TEST_ASSERT_EQUAL_UINT16(0, reg.count);
+}
+
+// One slot always stays empty so a lookup of a missing MAC terminates
+static void test_full_table(void) {
+    uint8_t addr[6];
+    device_registry_init(&reg, slots, 8);
+    for (int i = 0; i < 7; i++) {
+        make_mac(addr, i);
+        TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, i));
+    }
+    make_mac(addr, 7);
+    TEST_ASSERT_FALSE(device_registry_insert(&reg, addr, 7));
+    TEST_ASSERT_EQUAL_INT(-1, device_registry_find(&reg, addr));
+    TEST_ASSERT_FALSE(device_registry_remove(&reg, addr));
+    TEST_ASSERT_EQUAL_UINT16(7, reg.count);
+
+    // Updating an existing entry still works when full
+    make_mac(addr, 3);
+    TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, 42));
+    TEST_ASSERT_EQUAL_INT(42, device_registry_find(&reg, addr));
+
+    // A removal makes room again
+    TEST_ASSERT_TRUE(device_registry_remove(&reg, addr));
+    make_mac(addr, 7);
+    TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, 7));
+    TEST_ASSERT_EQUAL_INT(7, device_registry_find(&reg, addr));
+}
+
+// A full 8-slot table is one cluster that wraps around the end, so every
+// removal has to shift entries back, across the wrap as well
+static void test_backward_shift_delete_full_cluster(void) {
+    uint8_t addr[6];
+    for (int victim = 0; victim < 7; victim++) {
+        device_registry_init(&reg, slots, 8);
+        for (int i = 0; i < 7; i++) {
+            make_mac(addr, i);
+            TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, i));
+        }
+        make_mac(addr, victim);
+        TEST_ASSERT_TRUE(device_registry_remove(&reg, addr));
+        TEST_ASSERT_FALSE(device_registry_remove(&reg, addr));
+        TEST_ASSERT_EQUAL_INT(-1, device_registry_find(&reg, addr));
+        for (int i = 0; i < 7; i++) {
+            make_mac(addr, i);
+            TEST_ASSERT_EQUAL_INT(i == victim ? -1 : i, device_registry_find(&reg, addr));
+        }
+        // No tombstones: the freed slot is empty
+        int empty = 0;
+        for (int s = 0; s < 8; s++) {
+            empty += (slots[s].idx == DEVICE_REGISTRY_EMPTY);
+        }
+        TEST_ASSERT_EQUAL_INT(2, empty);
+    }
+}
+
+// Random inserts and removals against a reference table
+static void test_backward_shift_delete_random(void) {
+    enum { KEYS = 48, OPS = 20000 };
+    int expected[KEYS];
+    uint8_t addr[6];
+    int present = 0;
+    device_registry_init(&reg, slots, 64);
+    for (int k = 0; k < KEYS; k++) {
+        expected[k] = -1;
+    }
+    for (int op = 0; op < OPS; op++) {
+        int k = rng() % KEYS;
+        make_mac(addr, k * 977);
+        if (rng() % 2) {
+            int idx = rng() % 1000;
+            TEST_ASSERT_TRUE(device_registry_insert(&reg, addr, idx));
+            present += (expected[k] < 0);
+            expected[k] = idx;
+        } else {
+            TEST_ASSERT_EQUAL(expected[k] >= 0, device_registry_remove(&reg, addr));
+            present -= (expected[k] >= 0);
+            expected[k] = -1;
+        }
+        TEST_ASSERT_EQUAL_UINT16(present, reg.count);
+        if (op % 64 == 0) {
+            for (int j = 0; j < KEYS; j++) {
+                make_mac(addr, j * 977);
+                TEST_ASSERT_EQUAL_INT(expected[j], device_registry_find(&reg, addr));
+            }
+        }
+    }
+}
+
+static void test_clear(void) {
+    uint8_t addr[6];
+    device_registry_init(&reg, slots, 16);
+    make_mac(addr, 1);
+    device_registry_insert(&reg, addr, 1);
+    device_registry_clear(&reg);
+    TEST_ASSERT_EQUAL_UINT16(0, reg.count);
+    TEST_ASSERT_EQUAL_INT(-1, device_registry_find(&reg, addr));
+}
+
+// Lookup cost at 100/1000/5000 devices, against the linear MAC scan the
+// registry replaced. Table sized as in main.c: at least twice the devices.
+static void test_benchmark_lookup(void) {
+    static uint8_t macs[BENCH_MAX_DEVICES][6];
+    static const int sizes[] = { 100, 1000, 5000 };
+    volatile int sink = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        uint16_t slot_count = 2;
+        while (slot_count < 2 * n) {
+            slot_count *= 2;
+        }
+        TEST_ASSERT_TRUE(device_registry_init(&reg, slots, slot_count));
+        for (int i = 0; i < n; i++) {
+            make_mac(macs[i], rng());
+            TEST_ASSERT_TRUE(device_registry_insert(&reg, macs[i], i));
+        }
+
+        double t0 = now_ns();
+        for (int i = 0; i < BENCH_LOOKUPS; i++) {
+            sink += device_registry_find(&reg, macs[rng() % n]);
+        }
+        double hash_ns = (now_ns() - t0) / BENCH_LOOKUPS;
+
+        int scans = BENCH_LOOKUPS / n * 10;
+        t0 = now_ns();
+        for (int i = 0; i < scans; i++) {
+            const uint8_t *want = macs[rng() % n];
+            for (int j = 0; j < n; j++) {
+                if (memcmp(macs[j], want, 6) == 0) {
+                    sink += j;
+                    break;
+                }
+            }
+        }
+        double scan_ns = (now_ns() - t0) / scans;
+
+        char msg[128];
+        snprintf(msg, sizeof(msg), "%5d devices, %5u slots: registry %.1f ns/lookup, linear scan %.1f ns/lookup",
+                 n, slot_count, hash_ns, scan_ns);
+        TEST_MESSAGE(msg);
+        // Hash lookups stay flat; only a loose bound, timings vary by host
+        TEST_ASSERT_TRUE(hash_ns < 2000.0);
+    }
+    (void)sink;
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_rejects_bad_sizes);
+    RUN_TEST(test_insert_and_find);
+    RUN_TEST(test_insert_existing_updates_index);
+    RUN_TEST(test_insert_rejects_bad_index);
+    RUN_TEST(test_full_table);
+    RUN_TEST(test_backward_shift_delete_full_cluster);
+    RUN_TEST(test_backward_shift_delete_random);
+    RUN_TEST(test_clear);
+    RUN_TEST(test_benchmark_lookup);
+    return UNITY_END();
+}
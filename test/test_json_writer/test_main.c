@@ -0,0 +1,219 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+#include "json_writer.h"
+
+// Output sink: collects everything, optionally fails at the n-th flush
+typedef struct {
+    char data[8192];
+    size_t len;
+    int flushes;
+    int fail_at;      // -1 = never
+    size_t max_flush; // Largest single flush
+} sink_t;
+
+static sink_t sink;
+static char buf[4096];
+static json_writer_t w;
+
+static bool sink_flush(void *ctx, const char *data, size_t len) {
+    sink_t *s = (sink_t *)ctx;
+    if (s->flushes++ == s->fail_at) {
+        return false;
+    }
+    TEST_ASSERT_TRUE(s->len + len < sizeof(s->data));
+    memcpy(s->data + s->len, data, len);
+    s->len += len;
+    s->data[s->len] = '\0';
+    if (len > s->max_flush) {
+        s->max_flush = len;
+    }
+    return true;
+}
+
+static void start(size_t size) {
+    memset(&sink, 0, sizeof(sink));
+    sink.fail_at = -1;
+    json_writer_init(&w, buf, size, sink_flush, &sink);
+}
+
+static const char *finish(void) {
+    TEST_ASSERT_TRUE(json_writer_finish(&w));
+    return sink.data;
+}
+
+void setUp(void) {
+    start(sizeof(buf));
+}
+
+void tearDown(void) {
+}
+
+static void test_empty_containers(void) {
+    json_object_begin(&w);
+    json_key(&w, "a");
+    json_array_begin(&w);
+    json_array_end(&w);
+    json_key(&w, "o");
+    json_object_begin(&w);
+    json_object_end(&w);
+    json_object_end(&w);
+    TEST_ASSERT_EQUAL_STRING("{\"a\":[],\"o\":{}}", finish());
+}
+
+static void test_commas_and_scalars(void) {
+    json_array_begin(&w);
+    json_int(&w, -5);
+    json_uint(&w, 7);
+    json_bool(&w, true);
+    json_bool(&w, false);
+    json_null(&w);
+    json_string(&w, "x");
+    json_raw(&w, "{\"r\":1}");
+    json_stringf(&w, "%02X:%02X", 0xA4, 0xC1);
+    json_array_end(&w);
+    TEST_ASSERT_EQUAL_STRING("[-5,7,true,false,null,\"x\",{\"r\":1},\"A4:C1\"]", finish());
+}
+
+// Commas restart per level: a nested container doesn't inherit the parent's
+static void test_nesting(void) {
+    json_array_begin(&w);
+    for (int i = 0; i < 2; i++) {
+        json_object_begin(&w);
+        json_field_int(&w, "i", i);
+        json_key(&w, "l");
+        json_array_begin(&w);
+        json_array_begin(&w);
+        json_array_end(&w);
+        json_int(&w, i);
+        json_array_end(&w);
+        json_object_end(&w);
+    }
+    json_array_end(&w);
+    TEST_ASSERT_EQUAL_STRING("[{\"i\":0,\"l\":[[],0]},{\"i\":1,\"l\":[[],1]}]", finish());
+}
+
+static void test_integer_limits(void) {
+    json_array_begin(&w);
+    json_int(&w, INT32_MIN);
+    json_int(&w, INT32_MAX);
+    json_uint(&w, UINT32_MAX);
+    json_array_end(&w);
+    TEST_ASSERT_EQUAL_STRING("[-2147483648,2147483647,4294967295]", finish());
+}
+
+static void test_floats(void) {
+    json_object_begin(&w);
+    json_field_float(&w, "t", 22.456, 2);
+    json_field_float(&w, "z", -0.04, 1);
+    json_field_float(&w, "n", NAN, 2);
+    json_field_float(&w, "i", INFINITY, 2);
+    json_field_float(&w, "d", 3.0, 0);
+    json_object_end(&w);
+    TEST_ASSERT_EQUAL_STRING("{\"t\":22.46,\"z\":-0.0,\"n\":null,\"i\":null,\"d\":3}", finish());
+}
+
+static void test_string_escaping(void) {
+    json_string(&w, "a\"b\\c\n\r\t\x01\x1f/\xc3\xa9");
+    TEST_ASSERT_EQUAL_STRING("\"a\\\"b\\\\c\\n\\r\\t\\u0001\\u001f/\xc3\xa9\"", finish());
+}
+
+static void write_document(void) {
+    json_object_begin(&w);
+    json_field_bool(&w, "ok", true);
+    json_key(&w, "devices");
+    json_array_begin(&w);
+    for (int i = 0; i < 20; i++) {
+        json_object_begin(&w);
+        json_key(&w, "mac");
+        json_stringf(&w, "A4:C1:38:00:00:%02X", i);
+        json_field_string(&w, "name", "Living \"room\" sensor\twith a long name");
+        json_field_float(&w, "temperature", 20.0 + i / 10.0, 2);
+        json_field_int(&w, "rssi", -40 - i);
+        json_field_uint(&w, "lastSeen", 1000u * (uint32_t)i);
+        json_object_end(&w);
+    }
+    json_array_end(&w);
+    json_object_end(&w);
+}
+
+// The output is the same whatever the buffer size, and no flush is larger
+// than the buffer
+static void test_buffer_size_invariance(void) {
+    write_document();
+    static char expected[8192];
+    strcpy(expected, finish());
+    TEST_ASSERT_EQUAL_INT(1, sink.flushes);
+
+    const size_t sizes[] = {64, 65, 97, 128, 256, 1000};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        start(sizes[i]);
+        write_document();
+        TEST_ASSERT_EQUAL_STRING(expected, finish());
+        TEST_ASSERT_TRUE(sink.max_flush <= sizes[i]);
+        TEST_ASSERT_TRUE(sink.flushes >= (int)(strlen(expected) / sizes[i]));
+    }
+}
+
+// A string longer than the buffer is streamed through, not cut
+static void test_long_string(void) {
+    start(64);
+    char s[1000];
+    for (int i = 0; i < 999; i++) {
+        s[i] = (i % 50 == 49) ? '"' : (char)('a' + i % 26);
+    }
+    s[999] = '\0';
+    json_string(&w, s);
+    const char *out = finish();
+    TEST_ASSERT_EQUAL_size_t(999 + 19 + 2, strlen(out));
+    TEST_ASSERT_EQUAL_INT('"', out[0]);
+    TEST_ASSERT_EQUAL_INT('"', out[strlen(out) - 1]);
+}
+
+// A formatted value longer than the whole buffer is cut, not overflowed
+static void test_stringf_cut(void) {
+    start(64);
+    json_stringf(&w, "%0100d", 1);
+    TEST_ASSERT_TRUE(json_writer_finish(&w));
+    TEST_ASSERT_EQUAL_size_t(1 + 63 + 1, sink.len);
+}
+
+// After a failed flush (client gone) nothing more is sent
+static void test_flush_failure_drops_output(void) {
+    start(64);
+    sink.fail_at = 1;
+    write_document();
+    TEST_ASSERT_FALSE(json_writer_finish(&w));
+    TEST_ASSERT_EQUAL_size_t(64, sink.len);
+    TEST_ASSERT_EQUAL_INT(2, sink.flushes);
+}
+
+static void test_deep_nesting(void) {
+    for (int i = 0; i < JSON_WRITER_MAX_DEPTH - 1; i++) {
+        json_array_begin(&w);
+        json_int(&w, i);
+    }
+    for (int i = 0; i < JSON_WRITER_MAX_DEPTH - 1; i++) {
+        json_array_end(&w);
+    }
+    json_int(&w, 99);  // Back at the top: a comma again
+    const char *out = finish();
+    TEST_ASSERT_EQUAL_INT(0, strncmp("[0,[1,[2,", out, 9));
+    TEST_ASSERT_EQUAL_STRING("]]],99", out + strlen(out) - 6);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_containers);
+    RUN_TEST(test_commas_and_scalars);
+    RUN_TEST(test_nesting);
+    RUN_TEST(test_integer_limits);
+    RUN_TEST(test_floats);
+    RUN_TEST(test_string_escaping);
+    RUN_TEST(test_buffer_size_invariance);
+    RUN_TEST(test_long_string);
+    RUN_TEST(test_stringf_cut);
+    RUN_TEST(test_flush_failure_drops_output);
+    RUN_TEST(test_deep_nesting);
+    return UNITY_END();
+}
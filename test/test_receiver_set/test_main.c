@@ -0,0 +1,170 @@
+#include <unity.h>
+#include <string.h>
+#include "receiver_set.h"
+
+#define STALE_MS 30000
+#define HYST_DB 6
+
+#define HUB 1
+#define SAT_A 2
+#define SAT_B 3
+#define SAT_C 4
+
+static rx_set_t set;
+
+void setUp(void) {
+    memset(&set, 0, sizeof(set));
+}
+
+void tearDown(void) {
+}
+
+static uint8_t observe(uint8_t source_id, int8_t rssi, uint32_t now_ms) {
+    return rx_set_observe(&set, source_id, rssi, now_ms, STALE_MS, HYST_DB);
+}
+
+static void test_empty_set(void) {
+    TEST_ASSERT_EQUAL_INT8(0, rx_set_best_rssi(&set));
+}
+
+static void test_first_receiver_is_chosen(void) {
+    TEST_ASSERT_EQUAL_UINT8(SAT_A, observe(SAT_A, -80, 1000));
+    TEST_ASSERT_EQUAL_INT8(-80, rx_set_best_rssi(&set));
+}
+
+static void test_average_rounds_half_away_from_zero(void) {
+    observe(HUB, -70, 0);
+    observe(HUB, -71, 100);
+    TEST_ASSERT_EQUAL_INT8(-71, rx_set_best_rssi(&set));  // -70.5
+    observe(HUB, -70, 200);
+    observe(HUB, -70, 300);
+    TEST_ASSERT_EQUAL_INT8(-70, rx_set_best_rssi(&set));  // -70.25
+    // Only the last RX_RSSI_WINDOW samples count
+    for (int i = 0; i < RX_RSSI_WINDOW; i++) {
+        observe(HUB, -50, 400 + i * 100);
+    }
+    TEST_ASSERT_EQUAL_INT8(-50, rx_set_best_rssi(&set));
+}
+
+// Better, but not by the margin: the choice stays
+static void test_within_hysteresis_keeps_choice(void) {
+    observe(HUB, -80, 0);
+    for (uint32_t t = 100; t < 2000; t += 100) {
+        TEST_ASSERT_EQUAL_UINT8(HUB, observe(SAT_A, -80 + HYST_DB - 1, t));
+        TEST_ASSERT_EQUAL_UINT8(HUB, observe(HUB, -80, t + 50));
+    }
+}
+
+static void test_margin_switches_after_two_samples(void) {
+    observe(HUB, -80, 0);
+    // One strong packet is not enough
+    TEST_ASSERT_EQUAL_UINT8(HUB, observe(SAT_A, -60, 100));
+    TEST_ASSERT_EQUAL_UINT8(SAT_A, observe(SAT_A, -60, 200));
+    TEST_ASSERT_EQUAL_INT8(-60, rx_set_best_rssi(&set));
+    // Exactly the margin is enough
+    setUp();
+    observe(HUB, -80, 0);
+    observe(SAT_A, -80 + HYST_DB, 100);
+    TEST_ASSERT_EQUAL_UINT8(SAT_A, observe(SAT_A, -80 + HYST_DB, 200));
+}
+
+// Two receivers of about equal strength with noisy RSSI: no flapping
+static void test_noisy_equal_receivers_do_not_flap(void) {
+    uint32_t rng = 1;
+    observe(HUB, -75, 0);
+    int switches = 0;
+    uint8_t last = HUB;
+    for (uint32_t t = 100; t < 100000; t += 100) {
+        rng = rng * 1103515245u + 12345u;
+        int8_t noise = (int8_t)((rng >> 16) % 7) - 3;
+        uint8_t chosen = observe((t / 100) % 2 ? SAT_A : HUB, (int8_t)(-75 + noise), t);
+        switches += (chosen != last);
+        last = chosen;
+    }
+    TEST_ASSERT_EQUAL_INT(0, switches);
+}
+
+// The chosen receiver went quiet: the strongest fresh one takes over
+// without needing the margin
+static void test_stale_choice_is_replaced(void) {
+    observe(HUB, -60, 0);
+    observe(SAT_A, -85, 1000);
+    observe(SAT_B, -80, 2000);
+    TEST_ASSERT_EQUAL_UINT8(HUB, observe(SAT_B, -80, 3000));
+    TEST_ASSERT_EQUAL_UINT8(SAT_B, observe(SAT_A, -85, STALE_MS + 1000));
+    // Back after a gap: its old -60 samples are gone, -75 is within the margin
+    observe(SAT_B, -80, STALE_MS + 1500);
+    observe(HUB, -75, STALE_MS + 2000);
+    TEST_ASSERT_EQUAL_UINT8(SAT_B, observe(HUB, -75, STALE_MS + 3000));
+    TEST_ASSERT_EQUAL_UINT8(SAT_B, observe(SAT_B, -80, STALE_MS + 4000));
+}
+
+// A fourth receiver takes the least recently heard slot, never the chosen one
+static void test_eviction_spares_chosen(void) {
+    observe(HUB, -50, 0);
+    observe(SAT_A, -90, 1000);
+    observe(SAT_B, -90, 2000);
+    observe(HUB, -50, 500);  // Out-of-order age: last_ms doesn't go back
+    TEST_ASSERT_EQUAL_UINT8(HUB, observe(SAT_C, -90, 3000));
+    bool has_a = false, has_hub = false;
+    for (int i = 0; i < RX_SET_SIZE; i++) {
+        has_a |= set.rx[i].source_id == SAT_A;
+        has_hub |= set.rx[i].source_id == HUB;
+    }
+    TEST_ASSERT_FALSE(has_a);
+    TEST_ASSERT_TRUE(has_hub);
+    // The chosen one is the oldest now and still survives
+    TEST_ASSERT_EQUAL_UINT8(HUB, observe(SAT_A, -90, 4000));
+    has_hub = false;
+    for (int i = 0; i < RX_SET_SIZE; i++) {
+        has_hub |= set.rx[i].source_id == HUB;
+    }
+    TEST_ASSERT_TRUE(has_hub);
+}
+
+// Satellite packets carry an age, so times can go backwards a little
+static void test_late_packet_keeps_last_ms(void) {
+    observe(SAT_A, -70, 10000);
+    observe(SAT_A, -70, 8000);
+    for (int i = 0; i < RX_SET_SIZE; i++) {
+        if (set.rx[i].source_id == SAT_A) {
+            TEST_ASSERT_EQUAL_UINT32(10000, set.rx[i].last_ms);
+            TEST_ASSERT_EQUAL_UINT8(2, set.rx[i].count);
+        }
+    }
+}
+
+// A forgotten receiver leaves the set; the choice falls to the most recently
+// heard one left
+static void test_forget_receiver(void) {
+    observe(SAT_B, -80, 1000);
+    observe(SAT_A, -50, 2000);
+    observe(SAT_A, -50, 2100);
+    observe(HUB, -90, 3000);
+    TEST_ASSERT_EQUAL_UINT8(SAT_A, observe(SAT_A, -50, 2200));
+    TEST_ASSERT_EQUAL_UINT8(SAT_A, rx_set_forget(&set, SAT_B));  // Not chosen: kept choice
+    TEST_ASSERT_EQUAL_UINT8(HUB, rx_set_forget(&set, SAT_A));
+    TEST_ASSERT_EQUAL_INT8(-90, rx_set_best_rssi(&set));
+    for (int i = 0; i < RX_SET_SIZE; i++) {
+        TEST_ASSERT_TRUE(set.rx[i].source_id != SAT_A && set.rx[i].source_id != SAT_B);
+    }
+    TEST_ASSERT_EQUAL_UINT8(RX_SOURCE_NONE, rx_set_forget(&set, HUB));
+    TEST_ASSERT_EQUAL_INT8(0, rx_set_best_rssi(&set));
+    // The set fills again from empty
+    TEST_ASSERT_EQUAL_UINT8(SAT_C, observe(SAT_C, -70, 4000));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_set);
+    RUN_TEST(test_first_receiver_is_chosen);
+    RUN_TEST(test_average_rounds_half_away_from_zero);
+    RUN_TEST(test_within_hysteresis_keeps_choice);
+    RUN_TEST(test_margin_switches_after_two_samples);
+    RUN_TEST(test_noisy_equal_receivers_do_not_flap);
+    RUN_TEST(test_stale_choice_is_replaced);
+    RUN_TEST(test_eviction_spares_chosen);
+    RUN_TEST(test_late_packet_keeps_last_ms);
+    RUN_TEST(test_forget_receiver);
+    return UNITY_END();
+}
@@ -0,0 +1,158 @@
+#include <unity.h>
+#include "report_policy.h"
+
+// Defaults as in main.c: ±0.2 °C, ±2 %RH, ±5 %, 1 min rate limit, 1 h heartbeat
+static const report_policy_t policy = {
+    .temp_deadband_centi = 20,
+    .hum_deadband = 2,
+    .battery_deadband = 5,
+    .min_interval_s = 60,
+    .max_interval_s = 3600,
+};
+
+static report_state_t state;
+
+void setUp(void) {
+    state = (report_state_t){0};
+    report_policy_commit(&state, 1, 2100, 50, 90);
+}
+
+void tearDown(void) {
+}
+
+static void test_first_reading_always_reported(void) {
+    report_state_t fresh = {0};
+    TEST_ASSERT_EQUAL(REPORT_FIRST, report_policy_evaluate(&policy, &fresh, 1, 2100, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_FIRST, report_policy_evaluate(&policy, &fresh, 100000, -4000, 0, 0));
+}
+
+static void test_commit_sets_reference(void) {
+    TEST_ASSERT_EQUAL_UINT32(1, state.last_report_s);
+    TEST_ASSERT_EQUAL_INT16(2100, state.temp_centi);
+    TEST_ASSERT_EQUAL_UINT8(50, state.humidity);
+    TEST_ASSERT_EQUAL_UINT8(90, state.battery_pct);
+}
+
+// Evaluate doesn't change the state: a reading that couldn't be queued is
+// reconsidered with the next one
+static void test_evaluate_leaves_state(void) {
+    report_state_t before = state;
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 100, 2500, 50, 90));
+    TEST_ASSERT_EQUAL_MEMORY(&before, &state, sizeof(state));
+}
+
+static void test_rate_limit(void) {
+    // A big change inside min_interval_s waits
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 60, 3000, 80, 10));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, 3000, 80, 10));
+}
+
+// The band edge itself counts as out, in both directions
+static void test_temperature_deadband(void) {
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 61, 2119, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 61, 2081, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, 2120, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, 2080, 50, 90));
+}
+
+static void test_humidity_deadband(void) {
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 61, 2100, 51, 90));
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 61, 2100, 49, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, 2100, 52, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, 2100, 48, 90));
+}
+
+static void test_battery_deadband(void) {
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 61, 2100, 50, 86));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, 2100, 50, 85));
+
+    // 0: battery changes never trigger a report on their own
+    report_policy_t no_battery = policy;
+    no_battery.battery_deadband = 0;
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&no_battery, &state, 61, 2100, 50, 0));
+}
+
+// A deadband of 0 reports any change, but not an unchanged value
+static void test_zero_deadband_reports_any_change(void) {
+    report_policy_t any = { 0, 0, 0, 0, 0 };
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&any, &state, 2, 2100, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&any, &state, 2, 2101, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&any, &state, 2, 2100, 49, 90));
+}
+
+static void test_heartbeat(void) {
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 3600, 2100, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_HEARTBEAT, report_policy_evaluate(&policy, &state, 3601, 2100, 50, 90));
+    // A change wins over the heartbeat
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 3601, 2200, 50, 90));
+
+    report_policy_t no_heartbeat = policy;
+    no_heartbeat.max_interval_s = 0;
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&no_heartbeat, &state, 1000000, 2100, 50, 90));
+}
+
+// Slow drift is measured from the last reported value, not the last reading
+static void test_drift_accumulates(void) {
+    for (uint32_t t = 61; t < 61 + 19 * 60; t += 60) {
+        TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, t, 2100 + (int16_t)((t - 1) / 60), 50, 90));
+    }
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 1201, 2120, 50, 90));
+    report_policy_commit(&state, 1201, 2120, 50, 90);
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 1300, 2139, 50, 90));
+}
+
+static void test_negative_temperatures(void) {
+    report_policy_commit(&state, 1, -1510, 50, 90);
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 61, -1491, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, -1490, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 61, -1530, 50, 90));
+}
+
+// The monotonic clock may wrap; the difference still works
+static void test_clock_wrap(void) {
+    report_policy_commit(&state, 0xFFFFFFF0u, 2100, 50, 90);
+    TEST_ASSERT_EQUAL(REPORT_NONE, report_policy_evaluate(&policy, &state, 20, 2500, 50, 90));
+    TEST_ASSERT_EQUAL(REPORT_CHANGE, report_policy_evaluate(&policy, &state, 44, 2500, 50, 90));
+}
+
+static void test_device_overrides(void) {
+    report_policy_t p = report_policy_for_device(&policy, 50, REPORT_DEADBAND_DEFAULT);
+    TEST_ASSERT_EQUAL_UINT16(50, p.temp_deadband_centi);
+    TEST_ASSERT_EQUAL_UINT8(2, p.hum_deadband);
+    TEST_ASSERT_EQUAL_UINT8(5, p.battery_deadband);
+    TEST_ASSERT_EQUAL_UINT16(60, p.min_interval_s);
+    TEST_ASSERT_EQUAL_UINT16(3600, p.max_interval_s);
+
+    p = report_policy_for_device(&policy, REPORT_DEADBAND_DEFAULT, 0);
+    TEST_ASSERT_EQUAL_UINT16(20, p.temp_deadband_centi);
+    TEST_ASSERT_EQUAL_UINT8(0, p.hum_deadband);
+
+    p = report_policy_for_device(&policy, REPORT_DEADBAND_DEFAULT, REPORT_DEADBAND_DEFAULT);
+    TEST_ASSERT_EQUAL_MEMORY(&policy, &p, sizeof(p));
+}
+
+static void test_reason_strings(void) {
+    TEST_ASSERT_EQUAL_STRING("none", report_reason_str(REPORT_NONE));
+    TEST_ASSERT_EQUAL_STRING("first", report_reason_str(REPORT_FIRST));
+    TEST_ASSERT_EQUAL_STRING("change", report_reason_str(REPORT_CHANGE));
+    TEST_ASSERT_EQUAL_STRING("heartbeat", report_reason_str(REPORT_HEARTBEAT));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_reading_always_reported);
+    RUN_TEST(test_commit_sets_reference);
+    RUN_TEST(test_evaluate_leaves_state);
+    RUN_TEST(test_rate_limit);
+    RUN_TEST(test_temperature_deadband);
+    RUN_TEST(test_humidity_deadband);
+    RUN_TEST(test_battery_deadband);
+    RUN_TEST(test_zero_deadband_reports_any_change);
+    RUN_TEST(test_heartbeat);
+    RUN_TEST(test_drift_accumulates);
+    RUN_TEST(test_negative_temperatures);
+    RUN_TEST(test_clock_wrap);
+    RUN_TEST(test_device_overrides);
+    RUN_TEST(test_reason_strings);
+    return UNITY_END();
+}
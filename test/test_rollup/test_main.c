@@ -0,0 +1,191 @@
+#include <unity.h>
+#include <string.h>
+#include "rollup.h"
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+static void fill(rollup_acc_t *acc, int n, int16_t temp, uint8_t hum) {
+    for (int i = 0; i < n; i++) {
+        rollup_acc_add(acc, temp, hum);
+    }
+}
+
+static void test_bucket_layout(void) {
+    TEST_ASSERT_EQUAL_size_t(9, sizeof(rollup_bucket_t));
+}
+
+static void test_pack_average_and_spread(void) {
+    rollup_acc_t acc;
+    rollup_acc_reset(&acc, 0);
+    rollup_acc_add(&acc, 200, 40);
+    rollup_acc_add(&acc, 215, 45);
+    rollup_acc_add(&acc, -5, 50);
+    rollup_bucket_t b;
+    rollup_acc_pack(&acc, &b);
+    TEST_ASSERT_EQUAL_INT16(137, b.t_avg);  // 410 / 3, rounded
+    TEST_ASSERT_EQUAL_UINT8(142, b.t_below);
+    TEST_ASSERT_EQUAL_UINT8(78, b.t_above);
+    TEST_ASSERT_EQUAL_UINT8(45, b.h_avg);
+    TEST_ASSERT_EQUAL_UINT8(5, b.h_below);
+    TEST_ASSERT_EQUAL_UINT8(5, b.h_above);
+    TEST_ASSERT_EQUAL_UINT16(3, b.count);
+}
+
+static void test_empty_pack(void) {
+    rollup_acc_t acc;
+    rollup_acc_reset(&acc, 0);
+    rollup_bucket_t b;
+    memset(&b, 0xAA, sizeof(b));
+    rollup_acc_pack(&acc, &b);
+    TEST_ASSERT_EQUAL_UINT16(0, b.count);
+    TEST_ASSERT_EQUAL_INT16(0, b.t_avg);
+}
+
+// A sensor reporting every few seconds puts hundreds of readings into a
+// 15-min bucket: the count must not saturate at 255
+static void test_count_above_255(void) {
+    rollup_acc_t acc;
+    rollup_acc_reset(&acc, 0);
+    fill(&acc, 1000, 215, 40);
+    rollup_bucket_t b;
+    rollup_acc_pack(&acc, &b);
+    TEST_ASSERT_EQUAL_UINT16(1000, b.count);
+}
+
+// Quarters merged into an hour are weighted by their real counts
+static void test_merge_weighted_by_full_count(void) {
+    rollup_acc_t q;
+    rollup_bucket_t busy, quiet;
+    rollup_acc_reset(&q, 0);
+    fill(&q, 400, 200, 40);
+    rollup_acc_pack(&q, &busy);
+    rollup_acc_reset(&q, 900);
+    fill(&q, 100, 300, 60);
+    rollup_acc_pack(&q, &quiet);
+
+    rollup_acc_t hour;
+    rollup_acc_reset(&hour, 0);
+    rollup_acc_merge(&hour, &busy);
+    rollup_acc_merge(&hour, &quiet);
+    rollup_bucket_t b;
+    rollup_acc_pack(&hour, &b);
+    TEST_ASSERT_EQUAL_UINT16(500, b.count);
+    TEST_ASSERT_EQUAL_INT16(220, b.t_avg);  // (400*200 + 100*300) / 500; 228 with a count of 255
+    TEST_ASSERT_EQUAL_UINT8(44, b.h_avg);
+    TEST_ASSERT_EQUAL_UINT8(20, b.t_below);
+    TEST_ASSERT_EQUAL_UINT8(80, b.t_above);
+}
+
+static void test_merge_ignores_empty(void) {
+    rollup_acc_t acc;
+    rollup_acc_reset(&acc, 0);
+    rollup_bucket_t empty = {0};
+    rollup_acc_merge(&acc, &empty);
+    TEST_ASSERT_EQUAL_UINT16(0, acc.count);
+    rollup_bucket_t b;
+    rollup_acc_pack(&acc, &b);
+    TEST_ASSERT_EQUAL_UINT16(0, b.count);
+}
+
+// The count saturates: the excess weight is left out of the average, the
+// extremes still count
+static void test_merge_saturates(void) {
+    rollup_acc_t acc;
+    rollup_acc_reset(&acc, 0);
+    rollup_bucket_t big = { .t_avg = 100, .h_avg = 50, .count = 40000 };
+    rollup_acc_merge(&acc, &big);
+    rollup_bucket_t warm = { .t_avg = 300, .t_below = 10, .t_above = 20, .h_avg = 50, .count = 40000 };
+    rollup_acc_merge(&acc, &warm);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, acc.count);
+    rollup_bucket_t b;
+    rollup_acc_pack(&acc, &b);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, b.count);
+    // 40000 at 10.0 °C and 25535 at 30.0 °C
+    TEST_ASSERT_EQUAL_INT16(178, b.t_avg);
+    TEST_ASSERT_EQUAL_UINT8(78, b.t_below);   // Min 10.0 °C
+    TEST_ASSERT_EQUAL_UINT8(142, b.t_above);  // Max 32.0 °C
+
+    // Once full, a bucket adds only its extremes
+    rollup_bucket_t cold = { .t_avg = 0, .h_avg = 50, .count = 10 };
+    rollup_acc_merge(&acc, &cold);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, acc.count);
+    rollup_acc_pack(&acc, &b);
+    TEST_ASSERT_EQUAL_INT16(178, b.t_avg);
+    TEST_ASSERT_EQUAL_UINT8(178, b.t_below);
+    fill(&acc, 10, 100, 50);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, acc.count);
+}
+
+// min/max are stored as distances, saturating at 25.5 °C
+static void test_spread_saturates(void) {
+    rollup_acc_t acc;
+    rollup_acc_reset(&acc, 0);
+    rollup_acc_add(&acc, -400, 0);
+    rollup_acc_add(&acc, 400, 100);
+    rollup_bucket_t b;
+    rollup_acc_pack(&acc, &b);
+    TEST_ASSERT_EQUAL_INT16(0, b.t_avg);
+    TEST_ASSERT_EQUAL_UINT8(255, b.t_below);
+    TEST_ASSERT_EQUAL_UINT8(255, b.t_above);
+}
+
+// Closing the bucket after a gap first stores empty buckets for the
+// skipped periods
+static void test_feed_with_gap(void) {
+    rollup_bucket_t storage[8];
+    rollup_ring_t ring;
+    rollup_acc_t open;
+    rollup_ring_init(&ring, storage, 8, 60);
+    rollup_acc_reset(&open, 0);
+    for (uint32_t t = 600; t < 660; t += 2) {
+        rollup_feed(&ring, &open, t, 200, 40);
+    }
+    rollup_feed(&ring, &open, 665, 210, 41);
+    rollup_feed(&ring, &open, 905, 220, 42);  // Minutes 720..840 skipped
+    rollup_feed(&ring, &open, 965, 230, 43);
+    TEST_ASSERT_EQUAL_UINT16(6, ring.count);
+    uint32_t start;
+    const rollup_bucket_t *b = rollup_ring_get(&ring, 0, &start);
+    TEST_ASSERT_EQUAL_UINT32(900, start);
+    TEST_ASSERT_EQUAL_UINT16(1, b->count);
+    for (uint16_t age = 1; age <= 3; age++) {
+        b = rollup_ring_get(&ring, age, &start);
+        TEST_ASSERT_EQUAL_UINT32(900 - age * 60, start);
+        TEST_ASSERT_EQUAL_UINT16(0, b->count);
+    }
+    b = rollup_ring_get(&ring, 5, &start);
+    TEST_ASSERT_EQUAL_UINT32(600, start);
+    TEST_ASSERT_EQUAL_UINT16(30, b->count);
+    TEST_ASSERT_NULL(rollup_ring_get(&ring, 6, &start));
+    TEST_ASSERT_EQUAL_UINT32(960, open.start);
+}
+
+static void test_pick_tier(void) {
+    uint32_t merge;
+    TEST_ASSERT_EQUAL_INT(0, rollup_pick_tier(3600, 200, &merge));
+    TEST_ASSERT_EQUAL_UINT32(1, merge);
+    TEST_ASSERT_EQUAL_INT(1, rollup_pick_tier(24 * 3600, 200, &merge));
+    TEST_ASSERT_EQUAL_INT(2, rollup_pick_tier(7 * 24 * 3600, 200, &merge));
+    TEST_ASSERT_EQUAL_UINT32(1, merge);
+    TEST_ASSERT_EQUAL_INT(2, rollup_pick_tier(30 * 24 * 3600, 200, &merge));
+    TEST_ASSERT_EQUAL_UINT32(4, merge);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_layout);
+    RUN_TEST(test_pack_average_and_spread);
+    RUN_TEST(test_empty_pack);
+    RUN_TEST(test_count_above_255);
+    RUN_TEST(test_merge_weighted_by_full_count);
+    RUN_TEST(test_merge_ignores_empty);
+    RUN_TEST(test_merge_saturates);
+    RUN_TEST(test_spread_saturates);
+    RUN_TEST(test_feed_with_gap);
+    RUN_TEST(test_pick_tier);
+    return UNITY_END();
+}
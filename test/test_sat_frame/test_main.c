@@ -0,0 +1,232 @@
+#include <unity.h>
+#include <string.h>
+#include "sat_frame.h"
+
+#define RECORDS 40
+#define MAX_AD (SAT_FRAME_RECORD_MAX - 1 - SAT_FRAME_RECORD_FIXED)
+
+// Records delivered by the decoder, copied out of the callback
+typedef struct {
+    uint8_t mac[6];
+    int8_t rssi;
+    uint16_t age_ms;
+    uint8_t ad[MAX_AD];
+    uint8_t ad_len;
+    const uint8_t *ad_ptr;
+} record_t;
+
+static record_t got[RECORDS + 4];
+static int got_count;
+
+static void collect(void *ctx, const sat_record_t *rec) {
+    (void)ctx;
+    TEST_ASSERT_TRUE(got_count < RECORDS + 4);
+    record_t *r = &got[got_count++];
+    memcpy(r->mac, rec->mac, 6);
+    r->rssi = rec->rssi;
+    r->age_ms = rec->age_ms;
+    memcpy(r->ad, rec->ad, rec->ad_len);
+    r->ad_len = rec->ad_len;
+    r->ad_ptr = rec->ad;
+}
+
+static uint8_t body[RECORDS * SAT_FRAME_RECORD_MAX];
+static size_t body_len;
+static size_t record_end[RECORDS];  // Offset after each record
+
+// Record i: mac[0] = i, ad bytes i + j; lengths vary from empty to the
+// largest record
+static uint8_t ad_len_of(int i) {
+    return (i == RECORDS - 1) ? MAX_AD : (uint8_t)((i * 7) % 64);
+}
+
+static void build_body(bool with_header) {
+    body_len = with_header ? sat_frame_write_header(body) : 0;
+    for (int i = 0; i < RECORDS; i++) {
+        uint8_t ad[MAX_AD];
+        for (int j = 0; j < MAX_AD; j++) {
+            ad[j] = (uint8_t)(i + j);
+        }
+        sat_record_t rec = {
+            .mac = { (uint8_t)i, 0x11, 0x22, 0x33, 0x44, 0x55 },
+            .rssi = (int8_t)(-30 - i),
+            .age_ms = (uint16_t)(i * 1000 + 7),
+            .ad = ad,
+            .ad_len = ad_len_of(i),
+        };
+        size_t n = sat_frame_write_record(body + body_len, sizeof(body) - body_len, &rec);
+        TEST_ASSERT_EQUAL_size_t(1 + SAT_FRAME_RECORD_FIXED + rec.ad_len, n);
+        body_len += n;
+        record_end[i] = body_len;
+    }
+}
+
+static void check_records(int count) {
+    TEST_ASSERT_EQUAL_INT(count, got_count);
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL_UINT8(i, got[i].mac[0]);
+        TEST_ASSERT_EQUAL_UINT8(0x55, got[i].mac[5]);
+        TEST_ASSERT_EQUAL_INT8(-30 - i, got[i].rssi);
+        TEST_ASSERT_EQUAL_UINT16(i * 1000 + 7, got[i].age_ms);
+        TEST_ASSERT_EQUAL_INT(ad_len_of(i), got[i].ad_len);
+        for (int j = 0; j < got[i].ad_len; j++) {
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)(i + j), got[i].ad[j]);
+        }
+    }
+}
+
+static sat_frame_status_t decode(sat_frame_decoder_t *d, const uint8_t *data, size_t len, size_t chunk) {
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        size_t n = (len - pos < chunk) ? len - pos : chunk;
+        sat_frame_status_t status = sat_frame_decode(d, data + pos, n, collect, NULL);
+        if (status != SAT_FRAME_OK) {
+            return status;
+        }
+    }
+    return sat_frame_decoder_finish(d);
+}
+
+void setUp(void) {
+    got_count = 0;
+}
+
+void tearDown(void) {
+}
+
+// Every chunk size from 1 byte to the whole body gives the same records
+static void test_all_chunk_sizes(void) {
+    build_body(true);
+    for (size_t chunk = 1; chunk <= body_len; chunk++) {
+        sat_frame_decoder_t d;
+        sat_frame_decoder_init(&d);
+        got_count = 0;
+        TEST_ASSERT_EQUAL(SAT_FRAME_OK, decode(&d, body, body_len, chunk));
+        TEST_ASSERT_EQUAL_UINT32(RECORDS, d.records);
+        check_records(RECORDS);
+    }
+}
+
+// Records inside one chunk are handed on in place, without a copy
+static void test_whole_body_decodes_in_place(void) {
+    build_body(true);
+    sat_frame_decoder_t d;
+    sat_frame_decoder_init(&d);
+    TEST_ASSERT_EQUAL(SAT_FRAME_OK, decode(&d, body, body_len, body_len));
+    for (int i = 0; i < RECORDS; i++) {
+        TEST_ASSERT_TRUE(got[i].ad_ptr >= body && got[i].ad_ptr < body + body_len);
+    }
+}
+
+// UDP datagrams carry records without the body header
+static void test_records_without_header(void) {
+    build_body(false);
+    sat_frame_decoder_t d;
+    sat_frame_decoder_init_records(&d);
+    TEST_ASSERT_EQUAL(SAT_FRAME_OK, decode(&d, body, body_len, body_len));
+    check_records(RECORDS);
+
+    // An empty datagram is fine without a header
+    sat_frame_decoder_init_records(&d);
+    TEST_ASSERT_EQUAL(SAT_FRAME_OK, sat_frame_decoder_finish(&d));
+}
+
+// A body cut anywhere is truncated unless it ends between records; the
+// records before the cut are delivered either way
+static void test_truncation_at_every_offset(void) {
+    build_body(true);
+    for (size_t cut = 0; cut < body_len; cut++) {
+        int complete = 0;
+        bool boundary = (cut == SAT_FRAME_HEADER_LEN);
+        for (int i = 0; i < RECORDS; i++) {
+            if (record_end[i] <= cut) {
+                complete = i + 1;
+            }
+            boundary |= (record_end[i] == cut);
+        }
+        for (size_t chunk = 1; chunk <= 64; chunk *= 4) {
+            sat_frame_decoder_t d;
+            sat_frame_decoder_init(&d);
+            got_count = 0;
+            TEST_ASSERT_EQUAL(boundary ? SAT_FRAME_OK : SAT_FRAME_TRUNCATED, decode(&d, body, cut, chunk));
+            check_records(complete);
+        }
+    }
+}
+
+static void test_bad_header(void) {
+    static const uint8_t bad_magic[] = { 'S', 'X', 1, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t json[] = { '[', '{', '"', 'm' };
+    static const uint8_t bad_version[] = { 'S', 'F', 2, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (size_t chunk = 1; chunk <= sizeof(bad_magic); chunk++) {
+        sat_frame_decoder_t d;
+        sat_frame_decoder_init(&d);
+        TEST_ASSERT_EQUAL(SAT_FRAME_BAD_MAGIC, decode(&d, bad_magic, sizeof(bad_magic), chunk));
+        sat_frame_decoder_init(&d);
+        TEST_ASSERT_EQUAL(SAT_FRAME_BAD_MAGIC, decode(&d, json, sizeof(json), chunk));
+        sat_frame_decoder_init(&d);
+        TEST_ASSERT_EQUAL(SAT_FRAME_BAD_VERSION, decode(&d, bad_version, sizeof(bad_version), chunk));
+    }
+    TEST_ASSERT_EQUAL_INT(0, got_count);
+}
+
+// A record shorter than its fixed part stops decoding for good
+static void test_bad_record_is_sticky(void) {
+    build_body(true);
+    size_t at = record_end[2];
+    body[at] = SAT_FRAME_RECORD_FIXED - 1;
+    sat_frame_decoder_t d;
+    sat_frame_decoder_init(&d);
+    TEST_ASSERT_EQUAL(SAT_FRAME_BAD_RECORD, sat_frame_decode(&d, body, body_len, collect, NULL));
+    TEST_ASSERT_EQUAL_INT(3, got_count);
+    TEST_ASSERT_EQUAL(SAT_FRAME_BAD_RECORD, sat_frame_decode(&d, body, body_len, collect, NULL));
+    TEST_ASSERT_EQUAL(SAT_FRAME_BAD_RECORD, sat_frame_decoder_finish(&d));
+    TEST_ASSERT_EQUAL_INT(3, got_count);
+}
+
+static void test_empty_and_header_only(void) {
+    sat_frame_decoder_t d;
+    sat_frame_decoder_init(&d);
+    TEST_ASSERT_EQUAL(SAT_FRAME_TRUNCATED, sat_frame_decoder_finish(&d));
+
+    uint8_t header[SAT_FRAME_HEADER_LEN];
+    TEST_ASSERT_EQUAL_size_t(SAT_FRAME_HEADER_LEN, sat_frame_write_header(header));
+    sat_frame_decoder_init(&d);
+    TEST_ASSERT_EQUAL(SAT_FRAME_OK, decode(&d, header, sizeof(header), 1));
+    TEST_ASSERT_EQUAL_UINT32(0, d.records);
+}
+
+static void test_writer_limits(void) {
+    uint8_t ad[MAX_AD + 1] = {0};
+    uint8_t buf[SAT_FRAME_RECORD_MAX + 8];
+    sat_record_t rec = { .rssi = -1, .age_ms = 0xBEEF, .ad = ad, .ad_len = MAX_AD };
+    TEST_ASSERT_EQUAL_size_t(SAT_FRAME_RECORD_MAX, sat_frame_write_record(buf, sizeof(buf), &rec));
+    TEST_ASSERT_EQUAL_UINT8(0xFF, buf[0]);
+    TEST_ASSERT_EQUAL_UINT8(0xFF, buf[7]);    // rssi -1
+    TEST_ASSERT_EQUAL_UINT8(0xEF, buf[8]);    // age_ms, little-endian
+    TEST_ASSERT_EQUAL_UINT8(0xBE, buf[9]);
+    TEST_ASSERT_EQUAL_size_t(0, sat_frame_write_record(buf, SAT_FRAME_RECORD_MAX - 1, &rec));
+    rec.ad_len = 0;
+    TEST_ASSERT_EQUAL_size_t(1 + SAT_FRAME_RECORD_FIXED, sat_frame_write_record(buf, 1 + SAT_FRAME_RECORD_FIXED, &rec));
+    TEST_ASSERT_EQUAL_size_t(0, sat_frame_write_record(buf, SAT_FRAME_RECORD_FIXED, &rec));
+}
+
+static void test_status_strings(void) {
+    for (int s = SAT_FRAME_OK; s <= SAT_FRAME_TRUNCATED; s++) {
+        TEST_ASSERT_NOT_NULL(sat_frame_status_str((sat_frame_status_t)s));
+    }
+    TEST_ASSERT_EQUAL_STRING("truncated", sat_frame_status_str(SAT_FRAME_TRUNCATED));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_all_chunk_sizes);
+    RUN_TEST(test_whole_body_decodes_in_place);
+    RUN_TEST(test_records_without_header);
+    RUN_TEST(test_truncation_at_every_offset);
+    RUN_TEST(test_bad_header);
+    RUN_TEST(test_bad_record_is_sticky);
+    RUN_TEST(test_empty_and_header_only);
+    RUN_TEST(test_writer_limits);
+    RUN_TEST(test_status_strings);
+    return UNITY_END();
+}
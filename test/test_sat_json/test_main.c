@@ -0,0 +1,326 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "sat_json.h"
+
+#define RANDOM_OBSERVATIONS 300
+#define MAX_RECORDS 400
+
+// Records delivered by the decoder, copied out of the callback
+typedef struct {
+    uint8_t mac[6];
+    int8_t rssi;
+    uint16_t age_ms;
+    uint8_t ad[SAT_JSON_AD_MAX];
+    uint8_t ad_len;
+} record_t;
+
+static record_t got[MAX_RECORDS];
+static int got_count;
+
+static void collect(void *ctx, const sat_record_t *rec) {
+    (void)ctx;
+    TEST_ASSERT_TRUE(got_count < MAX_RECORDS);
+    record_t *r = &got[got_count++];
+    memcpy(r->mac, rec->mac, 6);
+    r->rssi = rec->rssi;
+    r->age_ms = rec->age_ms;
+    memcpy(r->ad, rec->ad, rec->ad_len);
+    r->ad_len = rec->ad_len;
+}
+
+static sat_json_decoder_t dec;
+
+// Decode a whole body in chunks of chunk bytes
+static sat_json_status_t decode(const char *body, size_t len, size_t chunk) {
+    got_count = 0;
+    sat_json_decoder_init(&dec);
+    for (size_t pos = 0; pos < len; pos += chunk) {
+        size_t n = (len - pos < chunk) ? len - pos : chunk;
+        if (sat_json_decode(&dec, (const uint8_t *)body + pos, n, collect, NULL) != SAT_JSON_OK) {
+            break;
+        }
+    }
+    return sat_json_decoder_finish(&dec);
+}
+
+static sat_json_status_t decode_str(const char *body) {
+    return decode(body, strlen(body), strlen(body) + 1);
+}
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+void setUp(void) {
+    rng_state = 7;
+    got_count = 0;
+}
+
+void tearDown(void) {
+}
+
+static void test_single_observation(void) {
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(
+        "[{\"mac\":\"A4:C1:38:0a:0B:0c\",\"rssi\":-65,\"data\":\"020106\",\"age\":120}]"));
+    TEST_ASSERT_EQUAL_INT(1, got_count);
+    static const uint8_t mac[] = { 0xA4, 0xC1, 0x38, 0x0A, 0x0B, 0x0C };
+    static const uint8_t ad[] = { 0x02, 0x01, 0x06 };
+    TEST_ASSERT_EQUAL_MEMORY(mac, got[0].mac, 6);
+    TEST_ASSERT_EQUAL_INT8(-65, got[0].rssi);
+    TEST_ASSERT_EQUAL_UINT16(120, got[0].age_ms);
+    TEST_ASSERT_EQUAL_INT(3, got[0].ad_len);
+    TEST_ASSERT_EQUAL_MEMORY(ad, got[0].ad, 3);
+    TEST_ASSERT_EQUAL_UINT32(1, dec.records);
+    TEST_ASSERT_EQUAL_UINT32(0, dec.invalid);
+}
+
+static void test_empty_array_and_whitespace(void) {
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(" [ ] \r\n"));
+    TEST_ASSERT_EQUAL_INT(0, got_count);
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(
+        "[\n  { \"data\" : \"0201\" ,\n \"mac\" : \"00:00:00:00:00:01\" } ,\n  {\"mac\":\"00:00:00:00:00:02\",\"data\":\"\"}\n]"));
+    TEST_ASSERT_EQUAL_INT(2, got_count);
+    TEST_ASSERT_EQUAL_UINT8(2, got[1].mac[5]);
+    TEST_ASSERT_EQUAL_INT(0, got[1].ad_len);
+}
+
+static void test_optional_fields_default(void) {
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(
+        "[{\"mac\":\"00:00:00:00:00:01\",\"rssi\":-70,\"age\":5,\"data\":\"01\"},"
+        "{\"mac\":\"00:00:00:00:00:02\",\"data\":\"02\"}]"));
+    TEST_ASSERT_EQUAL_INT(2, got_count);
+    TEST_ASSERT_EQUAL_INT8(0, got[1].rssi);
+    TEST_ASSERT_EQUAL_UINT16(0, got[1].age_ms);
+}
+
+static void test_unknown_keys_skipped(void) {
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(
+        "[{\"seen\":true,\"mac\":\"00:00:00:00:00:01\",\"x\":null,\"data\":\"01\","
+        "\"note\":\"a \\\"quoted\\\" }] text\",\"f\":-1.5E3,\"ok\":false}]"));
+    TEST_ASSERT_EQUAL_INT(1, got_count);
+    TEST_ASSERT_EQUAL_UINT32(0, dec.invalid);
+}
+
+// The name becomes a trailing Complete Local Name structure
+static void test_name_appended(void) {
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(
+        "[{\"mac\":\"00:00:00:00:00:01\",\"data\":\"020106\",\"name\":\"ATC_\\\"1\\\\\"}]"));
+    static const uint8_t ad[] = { 0x02, 0x01, 0x06, 0x08, 0x09, 'A', 'T', 'C', '_', '"', '1', '\\' };
+    TEST_ASSERT_EQUAL_INT(sizeof(ad), got[0].ad_len);
+    TEST_ASSERT_EQUAL_MEMORY(ad, got[0].ad, sizeof(ad));
+}
+
+static void test_age_clamped(void) {
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(
+        "[{\"mac\":\"00:00:00:00:00:01\",\"data\":\"\",\"age\":700000},"
+        "{\"mac\":\"00:00:00:00:00:02\",\"data\":\"\",\"age\":-4}]"));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, got[0].age_ms);
+    TEST_ASSERT_EQUAL_UINT16(0, got[1].age_ms);
+}
+
+// Bad or missing mac/data skips the object, not the batch
+static void test_invalid_objects_counted(void) {
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(
+        "[{\"data\":\"01\"},"
+        "{\"mac\":\"00:00:00:00:00:01\"},"
+        "{\"mac\":\"00-00-00-00-00-01\",\"data\":\"01\"},"
+        "{\"mac\":\"00:00:00:00:00:0\",\"data\":\"01\"},"
+        "{\"mac\":\"00:00:00:00:00:01\",\"data\":\"0g\"},"
+        "{\"mac\":\"00:00:00:00:00:01\",\"data\":\"012\"},"
+        "{},"
+        "{\"mac\":\"00:00:00:00:00:09\",\"data\":\"01\"}]"));
+    TEST_ASSERT_EQUAL_INT(1, got_count);
+    TEST_ASSERT_EQUAL_UINT8(9, got[0].mac[5]);
+    TEST_ASSERT_EQUAL_UINT32(1, dec.records);
+    TEST_ASSERT_EQUAL_UINT32(7, dec.invalid);
+}
+
+static void test_syntax_errors(void) {
+    static const char *bodies[] = {
+        "{\"mac\":\"00:00:00:00:00:01\"}",
+        "[{\"mac\":{\"a\":1}}]",
+        "[{\"mac\":[1]}]",
+        "[{\"mac\" \"x\"}]",
+        "[{\"mac\":\"x\"},]",
+        "[{\"mac\":\"x\"}}",
+        "[]]",
+        "[1]",
+    };
+    for (size_t i = 0; i < sizeof(bodies) / sizeof(bodies[0]); i++) {
+        TEST_ASSERT_EQUAL(SAT_JSON_SYNTAX, decode_str(bodies[i]));
+    }
+}
+
+static void test_truncated(void) {
+    static const char body[] = "[{\"mac\":\"00:00:00:00:00:01\",\"data\":\"01\"},{\"mac\":\"00:00";
+    TEST_ASSERT_EQUAL(SAT_JSON_TRUNCATED, decode_str(body));
+    TEST_ASSERT_EQUAL_INT(1, got_count);  // Complete objects before the cut still count
+    TEST_ASSERT_EQUAL(SAT_JSON_TRUNCATED, decode_str(""));
+    TEST_ASSERT_EQUAL(SAT_JSON_TRUNCATED, decode_str("["));
+}
+
+// Data longer than the buffer is cut; the name only takes what is left
+static void test_long_data_and_name(void) {
+    char body[600];
+    int n = snprintf(body, sizeof(body), "[{\"mac\":\"00:00:00:00:00:01\",\"data\":\"");
+    for (int i = 0; i < SAT_JSON_AD_MAX + 10; i++) {
+        n += snprintf(body + n, sizeof(body) - n, "%02X", i);
+    }
+    snprintf(body + n, sizeof(body) - n, "\",\"name\":\"abc\"},"
+             "{\"mac\":\"00:00:00:00:00:02\",\"data\":\"\",\"name\":\"0123456789012345678901234567890123456789\"}]");
+    TEST_ASSERT_EQUAL(SAT_JSON_OK, decode_str(body));
+    TEST_ASSERT_EQUAL_INT(2, got_count);
+    TEST_ASSERT_EQUAL_INT(SAT_JSON_AD_MAX, got[0].ad_len);
+    TEST_ASSERT_EQUAL_UINT8(SAT_JSON_AD_MAX - 1, got[0].ad[SAT_JSON_AD_MAX - 1]);
+    TEST_ASSERT_EQUAL_INT(2 + SAT_JSON_NAME_MAX, got[1].ad_len);
+    TEST_ASSERT_EQUAL_UINT8(SAT_JSON_NAME_MAX + 1, got[1].ad[0]);
+}
+
+// Reference check: random observations serialized with random key order,
+// spacing, escapes and extra keys, decoded in random chunk sizes, must come
+// back exactly as the model below says
+typedef struct {
+    uint8_t mac[6];
+    bool has_rssi;
+    int rssi;
+    bool has_age;
+    long age;
+    uint8_t data[62];
+    int data_len;
+    char name[40];
+    int name_len;
+} observation_t;
+
+static observation_t obs[RANDOM_OBSERVATIONS];
+
+static void random_observation(observation_t *o) {
+    static const char name_chars[] = "ATC_LYWSD03MMC-0123456789 \"\\/";
+    for (int i = 0; i < 6; i++) {
+        o->mac[i] = (uint8_t)rng();
+    }
+    o->has_rssi = rng() % 4 != 0;
+    o->rssi = -(int)(rng() % 100) - 20;
+    o->has_age = rng() % 3 != 0;
+    o->age = (rng() % 10 == 0) ? 65535 + (long)(rng() % 10000) : (long)(rng() % 65536);
+    o->data_len = rng() % (sizeof(o->data) + 1);
+    for (int i = 0; i < o->data_len; i++) {
+        o->data[i] = (uint8_t)rng();
+    }
+    o->name_len = (rng() % 2) ? (int)(rng() % sizeof(o->name)) : 0;
+    for (int i = 0; i < o->name_len; i++) {
+        o->name[i] = name_chars[rng() % (sizeof(name_chars) - 1)];
+    }
+}
+
+static const char *space(void) {
+    static const char *spaces[] = { "", "", "", " ", "\n", "\r\n  ", "\t" };
+    return spaces[rng() % (sizeof(spaces) / sizeof(spaces[0]))];
+}
+
+static size_t serialize(char *out, size_t size, const observation_t *list, int count) {
+    size_t n = snprintf(out, size, "%s[", space());
+    for (int k = 0; k < count; k++) {
+        const observation_t *o = &list[k];
+        char fields[6][256];
+        int nf = 0;
+        snprintf(fields[nf++], sizeof(fields[0]), "\"mac\"%s:%s\"%02X:%02x:%02X:%02x:%02X:%02x\"", space(), space(),
+                 o->mac[0], o->mac[1], o->mac[2], o->mac[3], o->mac[4], o->mac[5]);
+        int dn = snprintf(fields[nf], sizeof(fields[0]), "\"data\":\"");
+        for (int i = 0; i < o->data_len; i++) {
+            dn += snprintf(fields[nf] + dn, sizeof(fields[0]) - dn, (rng() % 2) ? "%02x" : "%02X", o->data[i]);
+        }
+        snprintf(fields[nf++] + dn, sizeof(fields[0]) - dn, "\"");
+        if (o->has_rssi) {
+            snprintf(fields[nf++], sizeof(fields[0]), "\"rssi\":%s%d", space(), o->rssi);
+        }
+        if (o->has_age) {
+            snprintf(fields[nf++], sizeof(fields[0]), "\"age\":%ld", o->age);
+        }
+        if (o->name_len > 0) {
+            int nn = snprintf(fields[nf], sizeof(fields[0]), "\"name\":\"");
+            for (int i = 0; i < o->name_len; i++) {
+                char c = o->name[i];
+                nn += snprintf(fields[nf] + nn, sizeof(fields[0]) - nn, (c == '"' || c == '\\') ? "\\%c" : "%c", c);
+            }
+            snprintf(fields[nf++] + nn, sizeof(fields[0]) - nn, "\"");
+        }
+        if (rng() % 3 == 0) {
+            snprintf(fields[nf++], sizeof(fields[0]), "\"firmware\":\"pvvx \\\"x\\\"\",\"n\":%u,\"b\":true", rng() % 100);
+        }
+        // Shuffle the key order
+        for (int i = nf - 1; i > 0; i--) {
+            int j = rng() % (i + 1);
+            char tmp[256];
+            memcpy(tmp, fields[i], sizeof(tmp));
+            memcpy(fields[i], fields[j], sizeof(tmp));
+            memcpy(fields[j], tmp, sizeof(tmp));
+        }
+        n += snprintf(out + n, size - n, "%s%s{", k ? "," : "", space());
+        for (int i = 0; i < nf; i++) {
+            n += snprintf(out + n, size - n, "%s%s%s", i ? "," : "", space(), fields[i]);
+        }
+        n += snprintf(out + n, size - n, "%s}", space());
+    }
+    n += snprintf(out + n, size - n, "%s]%s", space(), space());
+    return n;
+}
+
+static void check_against_model(const observation_t *o, const record_t *r) {
+    TEST_ASSERT_EQUAL_MEMORY(o->mac, r->mac, 6);
+    TEST_ASSERT_EQUAL_INT8(o->has_rssi ? o->rssi : 0, r->rssi);
+    TEST_ASSERT_EQUAL_UINT16(!o->has_age ? 0 : o->age > 0xFFFF ? 0xFFFF : o->age, r->age_ms);
+    uint8_t ad[SAT_JSON_AD_MAX];
+    int ad_len = o->data_len;
+    memcpy(ad, o->data, ad_len);
+    int name_len = o->name_len < SAT_JSON_NAME_MAX ? o->name_len : SAT_JSON_NAME_MAX;
+    if (name_len > SAT_JSON_AD_MAX - ad_len - 2) {
+        name_len = SAT_JSON_AD_MAX - ad_len - 2;
+    }
+    if (name_len > 0) {
+        ad[ad_len++] = name_len + 1;
+        ad[ad_len++] = 0x09;
+        memcpy(&ad[ad_len], o->name, name_len);
+        ad_len += name_len;
+    }
+    TEST_ASSERT_EQUAL_INT(ad_len, r->ad_len);
+    TEST_ASSERT_EQUAL_MEMORY(ad, r->ad, ad_len);
+}
+
+static void test_random_observations_match_model(void) {
+    static char body[RANDOM_OBSERVATIONS * 600];
+    for (int i = 0; i < RANDOM_OBSERVATIONS; i++) {
+        random_observation(&obs[i]);
+    }
+    size_t len = serialize(body, sizeof(body), obs, RANDOM_OBSERVATIONS);
+    TEST_ASSERT_TRUE(len < sizeof(body));
+
+    static const size_t chunks[] = { 1, 2, 3, 7, 64, 1436, 100000 };
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        TEST_ASSERT_EQUAL(SAT_JSON_OK, decode(body, len, chunks[c]));
+        TEST_ASSERT_EQUAL_INT(RANDOM_OBSERVATIONS, got_count);
+        TEST_ASSERT_EQUAL_UINT32(0, dec.invalid);
+        for (int i = 0; i < RANDOM_OBSERVATIONS; i++) {
+            check_against_model(&obs[i], &got[i]);
+        }
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_observation);
+    RUN_TEST(test_empty_array_and_whitespace);
+    RUN_TEST(test_optional_fields_default);
+    RUN_TEST(test_unknown_keys_skipped);
+    RUN_TEST(test_name_appended);
+    RUN_TEST(test_age_clamped);
+    RUN_TEST(test_invalid_objects_counted);
+    RUN_TEST(test_syntax_errors);
+    RUN_TEST(test_truncated);
+    RUN_TEST(test_long_data_and_name);
+    RUN_TEST(test_random_observations_match_model);
+    return UNITY_END();
+}
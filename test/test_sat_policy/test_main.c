@@ -0,0 +1,142 @@
+#include <unity.h>
+#include <string.h>
+#include "sat_policy.h"
+
+// Defaults as in main.c: dedupe, 1 s min interval, 10 s refresh
+static const sat_policy_t policy = {
+    .dedupe = true,
+    .min_interval_ms = 1000,
+    .refresh_ms = 10000,
+};
+
+// Sorted, as device_store_keys returns them
+static const uint8_t watch[3 * 6] = {
+    0x11, 0x22, 0x33, 0x44, 0x55, 0x66,
+    0xA4, 0xC1, 0x38, 0x01, 0x02, 0x03,
+    0xA4, 0xC1, 0x38, 0xFF, 0x00, 0x01,
+};
+
+static const uint8_t adv_a[] = { 0x12, 0x16, 0x1A, 0x18, 0x03, 0x02, 0x01, 0x38, 0xC1, 0xA4, 0x2A, 0x08, 0x42 };
+static const uint8_t adv_b[] = { 0x12, 0x16, 0x1A, 0x18, 0x03, 0x02, 0x01, 0x38, 0xC1, 0xA4, 0x2A, 0x08, 0x43 };
+
+static sat_filter_state_t state;
+
+void setUp(void) {
+    memset(&state, 0, sizeof(state));
+}
+
+void tearDown(void) {
+}
+
+// Known values: satellites compare the tag as sent, so the hash must not
+// change between firmware versions
+static void test_etag_known_values(void) {
+    TEST_ASSERT_EQUAL_HEX32(0xc114f3aa, sat_policy_etag(&policy, false, watch, 2));
+    TEST_ASSERT_EQUAL_HEX32(0x591de513, sat_policy_etag(&policy, true, NULL, 0));
+}
+
+static void test_etag_covers_every_field(void) {
+    uint32_t base = sat_policy_etag(&policy, false, watch, 3);
+    sat_policy_t p = policy;
+    p.dedupe = false;
+    TEST_ASSERT_NOT_EQUAL(base, sat_policy_etag(&p, false, watch, 3));
+    p = policy;
+    p.min_interval_ms++;
+    TEST_ASSERT_NOT_EQUAL(base, sat_policy_etag(&p, false, watch, 3));
+    p = policy;
+    p.refresh_ms++;
+    TEST_ASSERT_NOT_EQUAL(base, sat_policy_etag(&p, false, watch, 3));
+    TEST_ASSERT_NOT_EQUAL(base, sat_policy_etag(&policy, true, watch, 3));
+    TEST_ASSERT_NOT_EQUAL(base, sat_policy_etag(&policy, false, watch, 2));
+    TEST_ASSERT_EQUAL_HEX32(base, sat_policy_etag(&policy, false, watch, 3));
+}
+
+// The list is hashed in order: the hub sorts it so the same devices always
+// give the same tag
+static void test_etag_depends_on_order(void) {
+    uint8_t swapped[3 * 6];
+    memcpy(swapped, &watch[6], 6);
+    memcpy(&swapped[6], watch, 6);
+    memcpy(&swapped[12], &watch[12], 6);
+    TEST_ASSERT_NOT_EQUAL(sat_policy_etag(&policy, false, watch, 3),
+                          sat_policy_etag(&policy, false, swapped, 3));
+}
+
+static void test_watch_list_matching(void) {
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(sat_policy_watches(false, watch, 3, &watch[i * 6]));
+    }
+    const uint8_t before[6] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    const uint8_t between[6] = { 0xA4, 0xC1, 0x38, 0x01, 0x02, 0x04 };
+    const uint8_t after[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    TEST_ASSERT_FALSE(sat_policy_watches(false, watch, 3, before));
+    TEST_ASSERT_FALSE(sat_policy_watches(false, watch, 3, between));
+    TEST_ASSERT_FALSE(sat_policy_watches(false, watch, 3, after));
+    TEST_ASSERT_FALSE(sat_policy_watches(false, watch, 0, watch));
+    TEST_ASSERT_TRUE(sat_policy_watches(true, NULL, 0, after));
+}
+
+static void test_first_advertisement_forwarded(void) {
+    TEST_ASSERT_TRUE(sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 5000));
+    TEST_ASSERT_TRUE(state.forwarded);
+    TEST_ASSERT_EQUAL_UINT32(5000, state.last_ms);
+}
+
+static void test_min_interval(void) {
+    sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 5000);
+    TEST_ASSERT_FALSE(sat_policy_forward(&policy, &state, adv_b, sizeof(adv_b), 5999));
+    TEST_ASSERT_TRUE(sat_policy_forward(&policy, &state, adv_b, sizeof(adv_b), 6000));
+}
+
+// pvvx repeats each frame; the repeat differs from the next frame only in
+// the counter byte at the end
+static void test_whole_payload_dedupe(void) {
+    sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 5000);
+    TEST_ASSERT_FALSE(sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 7000));
+    TEST_ASSERT_TRUE(sat_policy_forward(&policy, &state, adv_b, sizeof(adv_b), 7000));
+    // A shorter payload with the same prefix is not a repeat
+    TEST_ASSERT_TRUE(sat_policy_forward(&policy, &state, adv_b, sizeof(adv_b) - 1, 8000));
+}
+
+static void test_refresh_forwards_unchanged(void) {
+    sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 5000);
+    TEST_ASSERT_FALSE(sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 14999));
+    TEST_ASSERT_TRUE(sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 15000));
+    TEST_ASSERT_EQUAL_UINT32(15000, state.last_ms);
+}
+
+static void test_refresh_zero_never_refreshes(void) {
+    sat_policy_t p = policy;
+    p.refresh_ms = 0;
+    sat_policy_forward(&p, &state, adv_a, sizeof(adv_a), 5000);
+    TEST_ASSERT_FALSE(sat_policy_forward(&p, &state, adv_a, sizeof(adv_a), 5000 + 3600000));
+}
+
+static void test_without_dedupe_repeats_pass(void) {
+    sat_policy_t p = policy;
+    p.dedupe = false;
+    sat_policy_forward(&p, &state, adv_a, sizeof(adv_a), 5000);
+    TEST_ASSERT_TRUE(sat_policy_forward(&p, &state, adv_a, sizeof(adv_a), 6000));
+}
+
+static void test_interval_across_clock_wrap(void) {
+    sat_policy_forward(&policy, &state, adv_a, sizeof(adv_a), 0xFFFFFF00u);
+    TEST_ASSERT_FALSE(sat_policy_forward(&policy, &state, adv_b, sizeof(adv_b), 0x100));
+    TEST_ASSERT_TRUE(sat_policy_forward(&policy, &state, adv_b, sizeof(adv_b), 0x400));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_etag_known_values);
+    RUN_TEST(test_etag_covers_every_field);
+    RUN_TEST(test_etag_depends_on_order);
+    RUN_TEST(test_watch_list_matching);
+    RUN_TEST(test_first_advertisement_forwarded);
+    RUN_TEST(test_min_interval);
+    RUN_TEST(test_whole_payload_dedupe);
+    RUN_TEST(test_refresh_forwards_unchanged);
+    RUN_TEST(test_refresh_zero_never_refreshes);
+    RUN_TEST(test_without_dedupe_repeats_pass);
+    RUN_TEST(test_interval_across_clock_wrap);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+#include <unity.h>
+#include <string.h>
+#include "sat_registry.h"
+
+#define SLOTS 4
+#define REUSE_MS 600000
+
+static sat_entry_t slots[SLOTS];
+static sat_registry_t reg;
+
+// 10.0.0.n in network byte order (the registry only compares them)
+static uint32_t ip(int n) {
+    return 0x0000000Au | ((uint32_t)n << 24);
+}
+
+void setUp(void) {
+    sat_registry_init(&reg, slots, SLOTS, REUSE_MS);
+}
+
+void tearDown(void) {
+}
+
+static int claim(uint32_t addr, uint32_t now_ms) {
+    bool reused;
+    int slot = sat_registry_claim(&reg, addr, now_ms, &reused);
+    TEST_ASSERT_FALSE(reused);
+    return slot;
+}
+
+static void test_empty_registry(void) {
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_find(&reg, ip(1)));
+    for (int i = 0; i < SLOTS; i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, slots[i].ip);
+    }
+}
+
+static void test_claim_and_find(void) {
+    TEST_ASSERT_EQUAL_INT(0, claim(ip(1), 100));
+    TEST_ASSERT_EQUAL_INT(1, claim(ip(2), 200));
+    TEST_ASSERT_EQUAL_INT(0, claim(ip(1), 300));  // Keeps its slot
+    TEST_ASSERT_EQUAL_INT(0, sat_registry_find(&reg, ip(1)));
+    TEST_ASSERT_EQUAL_INT(1, sat_registry_find(&reg, ip(2)));
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_find(&reg, ip(3)));
+    TEST_ASSERT_EQUAL_UINT32(300, slots[0].active_ms);
+}
+
+// Address 0 (unknown peer) never gets a slot
+static void test_zero_address(void) {
+    bool reused = true;
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_claim(&reg, 0, 100, &reused));
+    TEST_ASSERT_FALSE(reused);
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_find(&reg, 0));
+}
+
+// A full registry refuses newcomers while every slot is in recent use
+static void test_full_registry_keeps_active_slots(void) {
+    for (int i = 0; i < SLOTS; i++) {
+        claim(ip(i + 1), 1000 + i);
+    }
+    bool reused = true;
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_claim(&reg, ip(9), 1000 + REUSE_MS - 1, &reused));
+    TEST_ASSERT_FALSE(reused);
+    for (int i = 0; i < SLOTS; i++) {
+        TEST_ASSERT_EQUAL_INT(i, sat_registry_find(&reg, ip(i + 1)));
+    }
+}
+
+// Once idle long enough, the slot idle longest goes to the newcomer with
+// fresh counters
+static void test_idle_slot_is_reused(void) {
+    for (int i = 0; i < SLOTS; i++) {
+        claim(ip(i + 1), 1000);
+    }
+    claim(ip(1), 5000);
+    claim(ip(2), 5000);
+    claim(ip(4), 5000);
+    sat_registry_observed(&reg, 2, 1000);
+    sat_registry_sensor(&reg, 2);
+    slots[2].parse_failures = 7;
+    sat_registry_request(&reg, 2, 3);
+
+    bool reused = false;
+    TEST_ASSERT_EQUAL_INT(2, sat_registry_claim(&reg, ip(9), 1000 + REUSE_MS, &reused));
+    TEST_ASSERT_TRUE(reused);
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_find(&reg, ip(3)));
+    TEST_ASSERT_EQUAL_INT(2, sat_registry_find(&reg, ip(9)));
+    TEST_ASSERT_EQUAL_UINT32(0, slots[2].received);
+    TEST_ASSERT_EQUAL_UINT32(0, slots[2].sensors);
+    TEST_ASSERT_EQUAL_UINT32(0, slots[2].parse_failures);
+    TEST_ASSERT_EQUAL_UINT32(0, slots[2].requests);
+    TEST_ASSERT_EQUAL_UINT32(0, slots[2].last_seen_ms);
+    TEST_ASSERT_EQUAL_UINT32(1000 + REUSE_MS, slots[2].active_ms);
+
+    // The returning address is a newcomer now
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_claim(&reg, ip(3), 1000 + REUSE_MS, &reused));
+}
+
+// Idle time is measured across the millisecond clock wrap
+static void test_reuse_across_clock_wrap(void) {
+    for (int i = 0; i < SLOTS; i++) {
+        claim(ip(i + 1), 0xFFFFFF00u);
+    }
+    bool reused;
+    TEST_ASSERT_EQUAL_INT(-1, sat_registry_claim(&reg, ip(9), 0x100, &reused));
+    TEST_ASSERT_EQUAL_INT(0, sat_registry_claim(&reg, ip(9), REUSE_MS, &reused));
+    TEST_ASSERT_TRUE(reused);
+}
+
+static void test_counters(void) {
+    int slot = claim(ip(1), 100);
+    sat_registry_observed(&reg, slot, 150);
+    sat_registry_observed(&reg, slot, 160);
+    sat_registry_sensor(&reg, slot);
+    TEST_ASSERT_EQUAL_UINT32(2, slots[slot].received);
+    TEST_ASSERT_EQUAL_UINT32(1, slots[slot].sensors);
+    TEST_ASSERT_EQUAL_UINT32(160, slots[slot].last_seen_ms);
+    TEST_ASSERT_EQUAL_UINT32(100, slots[slot].active_ms);  // Only a claim refreshes it
+
+    sat_registry_request(&reg, slot, 0);
+    sat_registry_request(&reg, slot, 5);
+    sat_registry_request(&reg, slot, 100000);
+    TEST_ASSERT_EQUAL_UINT32(3, slots[slot].requests);
+    TEST_ASSERT_EQUAL_UINT32(1, slots[slot].latency[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, slots[slot].latency[3]);
+    TEST_ASSERT_EQUAL_UINT32(1, slots[slot].latency[SAT_LATENCY_BUCKETS - 1]);
+}
+
+static void test_rates(void) {
+    int a = claim(ip(1), 0);
+    int b = claim(ip(2), 0);
+    for (int i = 0; i < 50; i++) {
+        sat_registry_observed(&reg, a, i);
+        if (i % 5 == 0) {
+            sat_registry_sensor(&reg, a);
+        }
+    }
+    sat_registry_update_rates(&reg, 10.0f);
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, slots[a].adv_rate);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, slots[a].sensor_rate);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, slots[b].adv_rate);
+
+    // Rates cover only the interval since the last update
+    sat_registry_observed(&reg, a, 100);
+    sat_registry_update_rates(&reg, 10.0f);
+    TEST_ASSERT_EQUAL_FLOAT(0.1f, slots[a].adv_rate);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, slots[a].sensor_rate);
+}
+
+static void test_latency_buckets(void) {
+    TEST_ASSERT_EQUAL_INT(0, sat_latency_bucket(0));
+    TEST_ASSERT_EQUAL_INT(1, sat_latency_bucket(1));
+    TEST_ASSERT_EQUAL_INT(2, sat_latency_bucket(2));
+    TEST_ASSERT_EQUAL_INT(2, sat_latency_bucket(3));
+    TEST_ASSERT_EQUAL_INT(8, sat_latency_bucket(255));
+    TEST_ASSERT_EQUAL_INT(9, sat_latency_bucket(256));
+    TEST_ASSERT_EQUAL_INT(SAT_LATENCY_BUCKETS - 1, sat_latency_bucket(UINT32_MAX));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_registry);
+    RUN_TEST(test_claim_and_find);
+    RUN_TEST(test_zero_address);
+    RUN_TEST(test_full_registry_keeps_active_slots);
+    RUN_TEST(test_idle_slot_is_reused);
+    RUN_TEST(test_reuse_across_clock_wrap);
+    RUN_TEST(test_counters);
+    RUN_TEST(test_rates);
+    RUN_TEST(test_latency_buckets);
+    return UNITY_END();
+}
@@ -0,0 +1,198 @@
+#include <unity.h>
+#include <string.h>
+#include "sat_udp.h"
+
+static sat_seq_t s;
+
+void setUp(void) {
+    sat_seq_init(&s, 0);
+}
+
+void tearDown(void) {
+}
+
+static size_t make_datagram(uint8_t *buf, uint32_t sat_id, uint32_t epoch, uint32_t seq, size_t records_len) {
+    size_t n = sat_udp_write_header(buf, sat_id, epoch, seq);
+    for (size_t i = 0; i < records_len + SAT_UDP_TAG_LEN; i++) {
+        buf[n++] = (uint8_t)i;
+    }
+    return n;
+}
+
+static void test_parse_header_and_layout(void) {
+    uint8_t buf[64];
+    size_t len = make_datagram(buf, 0xA4C13801u, 0x01020304u, 0xFFFFFFFEu, 20);
+    sat_udp_datagram_t dg;
+    TEST_ASSERT_TRUE(sat_udp_parse(buf, len, &dg));
+    TEST_ASSERT_EQUAL_UINT32(0xA4C13801u, dg.sat_id);
+    TEST_ASSERT_EQUAL_UINT32(0x01020304u, dg.epoch);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFEu, dg.seq);
+    TEST_ASSERT_TRUE(dg.records == buf + SAT_UDP_HEADER_LEN);
+    TEST_ASSERT_EQUAL_size_t(20, dg.records_len);
+    TEST_ASSERT_EQUAL_size_t(len - SAT_UDP_TAG_LEN, dg.signed_len);
+    TEST_ASSERT_TRUE(dg.tag == buf + len - SAT_UDP_TAG_LEN);
+    // Little-endian on the wire, epoch and sat_id under the tag
+    TEST_ASSERT_EQUAL_UINT8(0x01, buf[4]);
+    TEST_ASSERT_EQUAL_UINT8(0x04, buf[8]);
+    TEST_ASSERT_TRUE(dg.signed_len > 12);
+}
+
+static void test_parse_rejects(void) {
+    uint8_t buf[64];
+    sat_udp_datagram_t dg;
+    size_t len = make_datagram(buf, 1, 1, 1, 0);
+    TEST_ASSERT_TRUE(sat_udp_parse(buf, len, &dg));  // No records is fine
+    TEST_ASSERT_EQUAL_size_t(0, dg.records_len);
+    TEST_ASSERT_FALSE(sat_udp_parse(buf, len - 1, &dg));
+    TEST_ASSERT_FALSE(sat_udp_parse(buf, 0, &dg));
+
+    buf[0] = 'X';
+    TEST_ASSERT_FALSE(sat_udp_parse(buf, len, &dg));
+    buf[0] = SAT_UDP_MAGIC0;
+    buf[2] = 1;  // Version 1 (random boot id, no epoch) is not accepted
+    TEST_ASSERT_FALSE(sat_udp_parse(buf, len, &dg));
+}
+
+static void test_in_order(void) {
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 0, 0));
+    for (uint32_t seq = 1; seq < 100; seq++) {
+        TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 0, seq));
+    }
+    TEST_ASSERT_EQUAL_UINT32(100, s.received);
+    TEST_ASSERT_EQUAL_UINT32(0, s.lost);
+    TEST_ASSERT_EQUAL_UINT32(0, s.reordered);
+    TEST_ASSERT_EQUAL_UINT32(0, s.duplicates);
+}
+
+static void test_duplicates_dropped(void) {
+    sat_seq_accept(&s, 0, 10);
+    sat_seq_accept(&s, 0, 11);
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 0, 11));
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 0, 10));
+    TEST_ASSERT_EQUAL_UINT32(2, s.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(2, s.received);
+}
+
+// A late datagram inside the window is used once and no longer counts as lost
+static void test_reorder_within_window(void) {
+    sat_seq_accept(&s, 0, 0);
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 0, 5));
+    TEST_ASSERT_EQUAL_UINT32(4, s.lost);
+    TEST_ASSERT_EQUAL(SAT_SEQ_REORDERED, sat_seq_accept(&s, 0, 3));
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 0, 3));
+    TEST_ASSERT_EQUAL(SAT_SEQ_REORDERED, sat_seq_accept(&s, 0, 1));
+    TEST_ASSERT_EQUAL_UINT32(2, s.lost);
+    TEST_ASSERT_EQUAL_UINT32(2, s.reordered);
+    TEST_ASSERT_EQUAL_UINT32(4, s.received);
+}
+
+// Older than the window: can't tell a replay from a late one, so dropped
+static void test_window_edge(void) {
+    sat_seq_accept(&s, 0, 100);
+    TEST_ASSERT_EQUAL(SAT_SEQ_REORDERED, sat_seq_accept(&s, 0, 100 - (SAT_UDP_SEQ_WINDOW - 1)));
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 0, 100 - SAT_UDP_SEQ_WINDOW));
+    // A jump past the window forgets the old bits
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 0, 100 + SAT_UDP_SEQ_WINDOW));
+    TEST_ASSERT_EQUAL(SAT_SEQ_REORDERED, sat_seq_accept(&s, 0, 101));
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 0, 100));
+}
+
+static void test_seq_wrap(void) {
+    sat_seq_accept(&s, 0, 0xFFFFFFFEu);
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 0, 1));
+    TEST_ASSERT_EQUAL_UINT32(2, s.lost);
+    TEST_ASSERT_EQUAL(SAT_SEQ_REORDERED, sat_seq_accept(&s, 0, 0xFFFFFFFFu));
+    TEST_ASSERT_EQUAL(SAT_SEQ_REORDERED, sat_seq_accept(&s, 0, 0));
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 0, 0xFFFFFFFEu));
+    TEST_ASSERT_EQUAL_UINT32(0, s.lost);
+}
+
+// Every datagram of a shuffled stream is used exactly once, and replaying
+// the whole stream afterwards yields nothing
+static void test_replay_of_accepted_stream(void) {
+    enum { N = 200 };
+    uint32_t order[N];
+    for (uint32_t i = 0; i < N; i++) {
+        order[i] = i;
+    }
+    // Local reordering: swap neighbours within 8
+    uint32_t rng = 12345;
+    for (uint32_t i = 0; i + 8 < N; i++) {
+        rng = rng * 1103515245u + 12345u;
+        uint32_t j = i + (rng >> 16) % 8;
+        uint32_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    int used = 0;
+    for (int i = 0; i < N; i++) {
+        sat_seq_result_t r = sat_seq_accept(&s, 7, order[i]);
+        used += (r == SAT_SEQ_NEW || r == SAT_SEQ_NEW_EPOCH || r == SAT_SEQ_REORDERED);
+    }
+    TEST_ASSERT_EQUAL_INT(N, used);
+    for (int i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 7, order[i]));
+    }
+}
+
+// The first datagram of a satellite never seen before: its epoch is stored
+static void test_first_epoch_is_new(void) {
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW_EPOCH, sat_seq_accept(&s, 3, 0));
+    TEST_ASSERT_EQUAL_UINT32(3, s.epoch);
+    TEST_ASSERT_EQUAL_UINT32(0, s.restarts);
+}
+
+// A satellite reboot: higher epoch, seq starts over
+static void test_new_epoch_restarts_window(void) {
+    sat_seq_accept(&s, 3, 500);
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW_EPOCH, sat_seq_accept(&s, 4, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, s.restarts);
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 4, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, s.lost);
+}
+
+// The bypass this fixes: a datagram captured during an earlier boot must
+// not be taken as a new boot
+static void test_older_epoch_rejected(void) {
+    sat_seq_accept(&s, 3, 0);
+    sat_seq_accept(&s, 3, 1);
+    sat_seq_accept(&s, 4, 0);
+    TEST_ASSERT_EQUAL(SAT_SEQ_STALE, sat_seq_accept(&s, 3, 2));
+    TEST_ASSERT_EQUAL(SAT_SEQ_STALE, sat_seq_accept(&s, 3, 1000));
+    TEST_ASSERT_EQUAL(SAT_SEQ_STALE, sat_seq_accept(&s, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(3, s.stale);
+    TEST_ASSERT_EQUAL_UINT32(4, s.epoch);
+    // The current epoch's state is untouched
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 4, 1));
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 4, 0));
+}
+
+// After a hub reboot the stored epoch is the floor: older ones are stale,
+// the same one continues without being stored again
+static void test_stored_epoch_after_hub_reboot(void) {
+    sat_seq_init(&s, 9);
+    TEST_ASSERT_EQUAL(SAT_SEQ_STALE, sat_seq_accept(&s, 8, 40));
+    TEST_ASSERT_FALSE(s.started);
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW, sat_seq_accept(&s, 9, 40));
+    TEST_ASSERT_EQUAL_UINT32(0, s.restarts);
+    TEST_ASSERT_EQUAL(SAT_SEQ_DUPLICATE, sat_seq_accept(&s, 9, 40));
+    TEST_ASSERT_EQUAL(SAT_SEQ_NEW_EPOCH, sat_seq_accept(&s, 10, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, s.restarts);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_header_and_layout);
+    RUN_TEST(test_parse_rejects);
+    RUN_TEST(test_in_order);
+    RUN_TEST(test_duplicates_dropped);
+    RUN_TEST(test_reorder_within_window);
+    RUN_TEST(test_window_edge);
+    RUN_TEST(test_seq_wrap);
+    RUN_TEST(test_replay_of_accepted_stream);
+    RUN_TEST(test_first_epoch_is_new);
+    RUN_TEST(test_new_epoch_restarts_window);
+    RUN_TEST(test_older_epoch_rejected);
+    RUN_TEST(test_stored_epoch_after_hub_reboot);
+    return UNITY_END();
+}
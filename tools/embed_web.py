@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Minify and gzip the web UI (web/) into a C source for the firmware.
+
+Usage: embed_web.py <web dir> <output .c>
+
+Every file becomes a web_asset_t (include/web_assets.h) holding the gzipped
+bytes and a content-hash ETag. References to other assets in index.html
+('/app.js' etc.) get a ?v=<hash> suffix, so those files can be cached
+forever and a new build is picked up through index.html alone.
+
+Minification is deliberately simple:
+- HTML and CSS: a line break and the indentation after it are removed, so
+  keep whitespace that matters (between words) inside a line.
+- JS: indentation, blank lines and // comment lines are removed; line breaks
+  stay, so automatic semicolon insertion works as in the source.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+}
+
+INDEX = "index.html"
+
+
+def minify(name, text):
+    ext = os.path.splitext(name)[1]
+    if ext in (".html", ".css"):
+        return re.sub(r"\n[ \t]*", "", text)
+    if ext == ".js":
+        lines = (line.strip() for line in text.split("\n"))
+        return "\n".join(l for l in lines if l and not l.startswith("//"))
+    return text
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+
+def c_array(name, data):
+    out = ["static const uint8_t %s[%d] = {" % (name, len(data))]
+    for i in range(0, len(data), 16):
+        out.append("    " + ",".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    out.append("};")
+    return "\n".join(out)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    web_dir, out_path = sys.argv[1], sys.argv[2]
+
+    names = sorted(n for n in os.listdir(web_dir)
+                   if os.path.splitext(n)[1] in CONTENT_TYPES)
+    if INDEX not in names:
+        sys.exit("embed_web: %s/%s missing" % (web_dir, INDEX))
+
+    # Index last: it refers to the hashes of the others
+    names.remove(INDEX)
+    names.append(INDEX)
+
+    assets = []
+    hashes = {}
+    for name in names:
+        with open(os.path.join(web_dir, name), "rb") as f:
+            data = f.read()
+        if os.path.splitext(name)[1] in (".html", ".css", ".js"):
+            text = data.decode("utf-8")
+            if name == INDEX:
+                for other, h in hashes.items():
+                    text = re.sub(r"(['\"])/%s\1" % re.escape(other),
+                                  r"\1/%s?v=%s\1" % (other, h), text)
+            data = minify(name, text).encode("utf-8")
+        h = content_hash(data)
+        hashes[name] = h
+        assets.append((name, data, h))
+
+    src = [
+        "// Generated by tools/embed_web.py from web/, do not edit",
+        "#include \"web_assets.h\"",
+        "",
+    ]
+    table = []
+    raw_total = gz_total = 0
+    for i, (name, data, h) in enumerate(assets):
+        gz = gzip.compress(data, compresslevel=9, mtime=0)
+        raw_total += len(data)
+        gz_total += len(gz)
+        src.append("// %s: %d bytes, %d gzipped" % (name, len(data), len(gz)))
+        src.append(c_array("asset_%d" % i, gz))
+        src.append("")
+        ctype = CONTENT_TYPES[os.path.splitext(name)[1]]
+        table.append("    {\"/%s\", \"%s\", asset_%d, sizeof(asset_%d), \"\\\"%s\\\"\"},"
+                     % (name, ctype, i, i, h))
+
+    src.append("const web_asset_t web_assets[] = {")
+    src.extend(table)
+    src.append("};")
+    src.append("const size_t web_asset_count = %d;" % len(assets))
+    src.append("")
+
+    with open(out_path, "w") as f:
+        f.write("\n".join(src))
+    print("embed_web: %d files, %d bytes, %d gzipped" % (len(assets), raw_total, gz_total))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+"""Replay recorded satellite traffic against a hub (load generator).
+
+Usage:
+  sat_replay.py generate [--count N] [--devices N] [--seed S] > capture.jsonl
+  sat_replay.py replay <capture.jsonl> --hub <ip> [options]
+
+A capture is one JSON value per line: an observation object as satellites
+send it ({"mac","rssi","data", optional "name","age"}), or an array of them
+(one recorded batch). A line may carry "t", seconds since the start of the
+recording; with --speed the replay keeps those gaps (scaled), otherwise it
+sends as fast as --rate and --concurrency allow. "generate" writes a random
+capture of LYWSD03MMC-style pvvx/ATC/BTHome advertisements.
+
+Modes (--mode):
+  single  one POST /api/satellite-data per observation (JSON)
+  batch   POST /api/satellite-batch with --batch observations (JSON array)
+  frame   POST /api/satellite-batch, binary records (include/sat_frame.h)
+  udp     datagrams to UDP port 19799 (include/sat_udp.h), needs --key;
+          --sat-id and --epoch default to a fresh epoch so the hub accepts it
+
+The summary has request latency percentiles, observations per second and
+the hub's accepted/dropped/invalid totals from the replies. Compare with
+GET /api/satellites (per-satellite latency histogram, parse failures) and
+GET /api/diagnostics (ring drops, UDP loss) on the hub.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import hashlib
+import hmac
+import http.client
+import json
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+SAT_FRAME_CONTENT_TYPE = "application/x-sat-frame"
+SAT_UDP_PORT = 19799
+SAT_UDP_MAX_DATAGRAM = 1472
+SAT_UDP_TAG_LEN = 8
+
+
+def load_capture(path):
+    """Read a capture into a list of (t or None, [observations])."""
+    items = []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            value = json.loads(line)
+            if isinstance(value, dict):
+                items.append((value.pop("t", None), [value]))
+            else:
+                t = None
+                for obs in value:
+                    t = obs.pop("t", t)
+                items.append((t, value))
+    return items
+
+
+def generate(args):
+    rng = random.Random(args.seed)
+    macs = ["A4:C1:38:%02X:%02X:%02X" % (rng.randrange(256), rng.randrange(256), rng.randrange(256))
+            for _ in range(args.devices)]
+    counters = [rng.randrange(256) for _ in macs]
+    t = 0.0
+    for _ in range(args.count):
+        i = rng.randrange(len(macs))
+        counters[i] = (counters[i] + 1) & 0xFF
+        mac_le = bytes(int(b, 16) for b in reversed(macs[i].split(":")))
+        temp = rng.randint(-500, 3500)
+        hum = rng.randint(2000, 9000)
+        kind = rng.choice(("pvvx", "atc", "bthome"))
+        if kind == "pvvx":
+            svc = b"\x1a\x18" + mac_le + struct.pack("<hHHBBB", temp, hum, 2900, 80, counters[i], 4)
+        elif kind == "atc":
+            svc = b"\x1a\x18" + mac_le[::-1] + struct.pack(">hBBHB", temp // 10, hum // 100, 80, 2900, counters[i])
+        else:
+            svc = b"\xd2\xfc\x40" + struct.pack("<BBBBBhBH", 0x00, counters[i], 0x01, 80, 0x02, temp, 0x03, hum)
+        ad = b"\x02\x01\x06" + bytes([len(svc) + 1, 0x16]) + svc
+        obs = {"mac": macs[i], "rssi": rng.randint(-95, -40), "data": ad.hex().upper(),
+               "age": rng.randint(0, 2000), "t": round(t, 3)}
+        if rng.random() < 0.1:
+            obs["name"] = "ATC_%s" % macs[i].replace(":", "")[-6:]
+        print(json.dumps(obs, separators=(",", ":")))
+        t += rng.expovariate(args.rate)
+
+
+def frame_record(obs):
+    mac = bytes(int(b, 16) for b in obs["mac"].split(":"))
+    ad = bytes.fromhex(obs["data"])
+    name = obs.get("name", "").encode()[:29]
+    if name:
+        ad += bytes([len(name) + 1, 0x09]) + name
+    age = max(0, min(0xFFFF, int(obs.get("age", 0))))
+    body = mac + struct.pack("<bH", int(obs.get("rssi", 0)), age) + ad
+    return bytes([len(body)]) + body
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = []
+        self.observations = 0
+        self.errors = 0
+        self.totals = {"accepted": 0, "dropped": 0, "invalid": 0}
+
+    def add(self, latency, observations, reply):
+        with self.lock:
+            self.latencies.append(latency)
+            self.observations += observations
+            if reply is None:
+                self.errors += 1
+                return
+            for key in self.totals:
+                self.totals[key] += int(reply.get(key, 0))
+
+
+def http_sender(args, stats):
+    conn = http.client.HTTPConnection(args.hub, args.port, timeout=10)
+
+    def send(observations):
+        if args.mode == "single":
+            path, body, ctype = "/api/satellite-data", json.dumps(observations[0]), "application/json"
+        elif args.mode == "batch":
+            path, body, ctype = "/api/satellite-batch", json.dumps(observations), "application/json"
+        else:
+            body = b"SF\x01\x00" + b"".join(frame_record(o) for o in observations)
+            path, ctype = "/api/satellite-batch", SAT_FRAME_CONTENT_TYPE
+        start = time.perf_counter()
+        reply = None
+        try:
+            conn.request("POST", path, body, {"Content-Type": ctype})
+            resp = conn.getresponse()
+            data = resp.read()
+            if resp.status == 200:
+                reply = json.loads(data) if data else {}
+                if args.mode == "single":
+                    reply.setdefault("accepted", 1)
+        except (OSError, http.client.HTTPException, ValueError):
+            conn.close()
+        stats.add(time.perf_counter() - start, len(observations), reply)
+
+    return send
+
+
+def udp_sender(args, stats):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    key = args.key.encode()
+    state = {"seq": 0}
+    lock = threading.Lock()
+
+    def send(observations):
+        records = b"".join(frame_record(o) for o in observations)
+        with lock:
+            seq = state["seq"]
+            state["seq"] += 1
+        header = b"SU\x02\x00" + struct.pack("<III", args.sat_id, args.epoch, seq)
+        if len(header) + len(records) + SAT_UDP_TAG_LEN > SAT_UDP_MAX_DATAGRAM:
+            raise SystemExit("--batch too large for one datagram")
+        signed = header + records
+        tag = hmac.new(key, signed, hashlib.sha256).digest()[:SAT_UDP_TAG_LEN]
+        start = time.perf_counter()
+        sock.sendto(signed + tag, (args.hub, SAT_UDP_PORT))
+        # No reply: the hub's counters are in /api/diagnostics
+        stats.add(time.perf_counter() - start, len(observations), {"accepted": len(observations)})
+
+    return send
+
+
+def batches(args, items):
+    """Yield (t, observations) regrouped into requests of --batch."""
+    if args.mode == "single":
+        for t, observations in items:
+            for obs in observations:
+                yield t, [obs]
+        return
+    pending, first_t = [], None
+    for t, observations in items:
+        for obs in observations:
+            if not pending:
+                first_t = t
+            pending.append(obs)
+            if len(pending) == args.batch:
+                yield first_t, pending
+                pending = []
+    if pending:
+        yield first_t, pending
+
+
+def replay(args):
+    items = load_capture(args.capture)
+    if args.mode == "udp" and not args.key:
+        raise SystemExit("--mode udp needs --key")
+    work = [b for _ in range(args.repeat) for b in batches(args, items)]
+    stats = Stats()
+    lock = threading.Lock()
+    cursor = {"next": 0}
+    start = time.perf_counter()
+    t0 = next((t for t, _ in work if t is not None), None)
+
+    def worker():
+        send = udp_sender(args, stats) if args.mode == "udp" else http_sender(args, stats)
+        while True:
+            with lock:
+                i = cursor["next"]
+                if i >= len(work):
+                    return
+                cursor["next"] += 1
+            t, observations = work[i]
+            if args.speed and t is not None and t0 is not None:
+                due = (t - t0) / args.speed
+            elif args.rate:
+                due = i / args.rate
+            else:
+                due = 0
+            delay = start + due - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            send(observations)
+
+    threads = [threading.Thread(target=worker) for _ in range(args.concurrency)]
+    for th in threads:
+        th.start()
+    for th in threads:
+        th.join()
+    elapsed = time.perf_counter() - start
+
+    lat = sorted(stats.latencies)
+
+    def pct(p):
+        return lat[min(len(lat) - 1, int(p / 100 * len(lat)))] * 1000 if lat else 0
+
+    print("mode %s: %d requests, %d observations in %.1f s (%.0f obs/s), %d failed"
+          % (args.mode, len(lat), stats.observations, elapsed, stats.observations / elapsed, stats.errors))
+    print("latency ms: p50 %.1f  p95 %.1f  p99 %.1f  max %.1f" % (pct(50), pct(95), pct(99), pct(100)))
+    if args.mode != "udp":
+        print("hub replies: accepted %(accepted)d  dropped %(dropped)d  invalid %(invalid)d" % stats.totals)
+    return 1 if stats.errors else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    gen = sub.add_parser("generate", help="write a random capture to stdout")
+    gen.add_argument("--count", type=int, default=1000)
+    gen.add_argument("--devices", type=int, default=50)
+    gen.add_argument("--rate", type=float, default=20.0, help="mean observations per second in \"t\"")
+    gen.add_argument("--seed", type=int, default=1)
+
+    rep = sub.add_parser("replay", help="send a capture to a hub")
+    rep.add_argument("capture")
+    rep.add_argument("--hub", required=True)
+    rep.add_argument("--port", type=int, default=80)
+    rep.add_argument("--mode", choices=("single", "batch", "frame", "udp"), default="batch")
+    rep.add_argument("--batch", type=int, default=20, help="observations per request or datagram")
+    rep.add_argument("--concurrency", type=int, default=1, help="parallel senders (simulated satellites)")
+    rep.add_argument("--rate", type=float, default=0, help="requests per second, 0 = unpaced")
+    rep.add_argument("--speed", type=float, default=0, help="keep recorded timing, scaled by this factor")
+    rep.add_argument("--repeat", type=int, default=1)
+    rep.add_argument("--key", help="UDP shared key (POST /api/satellite-udp)")
+    rep.add_argument("--sat-id", type=lambda v: int(v, 0), default=0x5A7E0001)
+    rep.add_argument("--epoch", type=int, default=int(time.time()),
+                     help="UDP epoch; must not go down between runs for one --sat-id")
+
+    args = parser.parse_args()
+    if args.command == "generate":
+        generate(args)
+        return 0
+    return replay(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
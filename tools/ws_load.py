@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+"""Load test for the hub's live push (WebSocket /ws).
+
+Usage:
+  ws_load.py --hub <ip> [--clients 4] [--intervals 50,100,250,1000]
+             [--devices 20] [--rate 50] [--duration 10]
+
+Opens --clients WebSocket clients on /ws?all=1&interval=<ms> (intervals
+cycled over the clients) and, while they listen, posts sensor changes for
+--devices simulated devices to /api/satellite-data (one pvvx advertisement
+per request, over one keep-alive connection) at --rate changes per second. Every change carries a
+marker in its battery millivolts, so a client can tell when the change it
+shows was sent.
+
+Per client it reports and checks:
+  - message rate against the client's limit (1000 / interval): no two
+    messages may arrive closer than the interval, minus --jitter ms
+  - coalescing: changes posted per message received, devices per message
+  - delta latency: time from posting a change to receiving the first
+    message that shows it (p50/p95/max); changes overwritten before the
+    next message are coalesced away and not counted
+  - fragmentation: messages go out as a text frame plus continuation
+    frames (push_ws_flush sends one per JSON buffer), reassembled here;
+    at least one multi-fragment message is required
+  - the first message is the full list, later ones deltas, cursors in order
+
+More clients than the hub allows (PUSH_MAX_CLIENTS, 4) are reported as
+rejected. Exit status is 1 if a check fails.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import base64
+import http.client
+import json
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+
+WS_OP_CONTINUE = 0x0
+WS_OP_TEXT = 0x1
+WS_OP_CLOSE = 0x8
+WS_OP_PING = 0x9
+WS_OP_PONG = 0xA
+
+
+class WsClient:
+    """Minimal WebSocket client: handshake, reassembly, ping replies."""
+
+    def __init__(self, host, port, path, timeout=5):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\n"
+                           "Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\n"
+                           "Sec-WebSocket-Version: 13\r\n\r\n" % (path, host, key)).encode())
+        self.buf = b""
+        while b"\r\n\r\n" not in self.buf:
+            data = self.sock.recv(4096)
+            if not data:
+                raise ConnectionError("closed during handshake")
+            self.buf += data
+        head, self.buf = self.buf.split(b"\r\n\r\n", 1)
+        if not head.startswith(b"HTTP/1.1 101"):
+            raise ConnectionError(head.split(b"\r\n", 1)[0].decode(errors="replace"))
+
+        self.parts = []
+
+    def _frame(self):
+        """Next frame (fin, opcode, payload). Nothing is consumed until a
+        whole frame is buffered, so a socket timeout loses no data."""
+        while True:
+            if len(self.buf) >= 2:
+                length = self.buf[1] & 0x7F
+                head = 2
+                if length == 126 and len(self.buf) >= 4:
+                    length, head = struct.unpack(">H", self.buf[2:4])[0], 4
+                elif length == 127 and len(self.buf) >= 10:
+                    length, head = struct.unpack(">Q", self.buf[2:10])[0], 10
+                if (self.buf[1] & 0x7F) < 126 or head > 2:
+                    if len(self.buf) >= head + length:
+                        b0 = self.buf[0]
+                        payload = self.buf[head:head + length]
+                        self.buf = self.buf[head + length:]
+                        return bool(b0 & 0x80), b0 & 0x0F, payload
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError("closed")
+            self.buf += data
+
+    def _send(self, opcode, payload=b""):
+        mask = os.urandom(4)
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self.sock.sendall(bytes([0x80 | opcode, 0x80 | len(payload)]) + mask + masked)
+
+    def recv_message(self):
+        """Next complete text message: (payload, fragment count)."""
+        while True:
+            fin, opcode, payload = self._frame()
+            if opcode == WS_OP_PING:
+                self._send(WS_OP_PONG, payload)
+                continue
+            if opcode == WS_OP_CLOSE:
+                raise ConnectionError("closed by hub")
+            if opcode == WS_OP_TEXT and self.parts:
+                raise ValueError("text frame inside a fragmented message")
+            if opcode == WS_OP_CONTINUE and not self.parts:
+                raise ValueError("continuation frame without a message")
+            self.parts.append(payload)
+            if fin:
+                parts, self.parts = self.parts, []
+                return b"".join(parts), len(parts)
+
+    def close(self):
+        try:
+            self._send(WS_OP_CLOSE, struct.pack(">H", 1000))
+        except OSError:
+            pass
+        self.sock.close()
+
+
+class Changes:
+    """Changes posted so far: (addr, batMv) -> time sent."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.sent = {}
+        self.count = 0
+
+    def add(self, keys, t):
+        with self.lock:
+            for key in keys:
+                self.sent[key] = t
+            self.count += len(keys)
+
+    def sent_at(self, key):
+        with self.lock:
+            return self.sent.get(key)
+
+
+def device_mac(i):
+    return "A4:C1:38:7E:%02X:%02X" % (i >> 8, i & 0xFF)
+
+
+def pvvx_observation(i, counter, marker):
+    mac_le = bytes(int(b, 16) for b in reversed(device_mac(i).split(":")))
+    svc = b"\x1a\x18" + mac_le + struct.pack("<hHHBBB", 2150 + i, 4500, marker, 80, counter & 0xFF, 4)
+    ad = b"\x02\x01\x06" + bytes([len(svc) + 1, 0x16]) + svc
+    return {"mac": device_mac(i), "rssi": -60, "data": ad.hex()}
+
+
+def driver(args, changes, stop):
+    """Post changes round-robin over the devices at --rate per second."""
+    conn = http.client.HTTPConnection(args.hub, args.port, timeout=10)
+    period = 1.0 / args.rate
+    seq = 0
+    next_t = time.perf_counter()
+    while not stop.is_set():
+        i = seq % args.devices
+        marker = 1000 + (seq // args.devices) % 60000
+        body = json.dumps(pvvx_observation(i, seq // args.devices, marker))
+        changes.add([(device_mac(i), marker)], time.time())  # Before sending: the push may beat the reply
+        seq += 1
+        try:
+            conn.request("POST", "/api/satellite-data", body, {"Content-Type": "application/json"})
+            conn.getresponse().read()
+        except (OSError, http.client.HTTPException):
+            conn.close()
+        next_t += period
+        delay = next_t - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+
+
+class ClientRun:
+    def __init__(self, n, interval_ms):
+        self.n = n
+        self.interval_ms = interval_ms
+        self.arrivals = []       # Arrival times
+        self.fragments = []      # Fragments per message
+        self.devices = []        # Devices per message
+        self.latencies = []      # Seconds, per change seen
+        self.errors = []
+        self.rejected = None
+
+    def run(self, args, changes, stop):
+        path = "/ws?all=1&interval=%d" % self.interval_ms
+        try:
+            ws = WsClient(args.hub, args.port, path)
+        except (OSError, ConnectionError) as e:
+            self.rejected = str(e)
+            return
+        ws.sock.settimeout(1.0)
+        seen = set()
+        last_cursor = None
+        try:
+            while not stop.is_set():
+                try:
+                    payload, fragments = ws.recv_message()
+                except socket.timeout:
+                    continue
+                now = time.time()
+                msg = json.loads(payload)
+                if not self.arrivals and not msg.get("full"):
+                    self.errors.append("first message is not the full list")
+                elif self.arrivals and msg.get("full"):
+                    self.errors.append("full list again at message %d" % (len(self.arrivals) + 1))
+                cursor = tuple(int(p, 16) if k == 0 else int(p) for k, p in enumerate(msg["cursor"].split(".")))
+                if last_cursor is not None and cursor <= last_cursor:
+                    self.errors.append("cursor %s not after %s" % (msg["cursor"], last_cursor))
+                last_cursor = cursor
+                self.arrivals.append(now)
+                self.fragments.append(fragments)
+                self.devices.append(len(msg["devices"]))
+                for dev in msg["devices"]:
+                    key = (dev.get("addr"), dev.get("batMv"))
+                    sent = changes.sent_at(key)
+                    if sent is not None and key not in seen:
+                        seen.add(key)
+                        self.latencies.append(now - sent)
+        except (OSError, ConnectionError, ValueError) as e:
+            if not stop.is_set():
+                self.errors.append("connection: %s" % e)
+        finally:
+            ws.close()
+
+    def report(self, args, changes_count):
+        name = "client %d (interval %d ms)" % (self.n, self.interval_ms)
+        if self.rejected:
+            print("%s: rejected: %s" % (name, self.rejected))
+            return []
+        failures = list(self.errors)
+        gaps = [b - a for a, b in zip(self.arrivals, self.arrivals[1:])]
+        floor = (self.interval_ms - args.jitter) / 1000
+        too_close = sum(1 for g in gaps if g < floor)
+        if too_close:
+            failures.append("%d messages closer than %d ms (min gap %.1f ms)"
+                            % (too_close, self.interval_ms, min(gaps) * 1000))
+        multi = sum(1 for f in self.fragments if f > 1)
+        if self.fragments and not multi:
+            failures.append("no fragmented message (push_ws_flush path not exercised)")
+        if len(self.arrivals) < 2:
+            failures.append("no delta messages")
+
+        # Deltas only: the full list arrives before the changes start
+        deltas = self.arrivals[1:]
+        span = deltas[-1] - deltas[0] if len(deltas) > 1 else 0
+        rate = (len(deltas) - 1) / span if span else 0
+        lat = sorted(self.latencies)
+
+        def pct(p):
+            return lat[min(len(lat) - 1, int(p / 100 * len(lat)))] * 1000 if lat else 0
+
+        print("%s: %d messages, %.1f/s (limit %.1f/s), min gap %.1f ms" % (
+            name, len(self.arrivals), rate, 1000 / self.interval_ms, min(gaps) * 1000 if gaps else 0))
+        print("  coalescing: %.1f changes/message, %.1f devices/message" % (
+            changes_count / max(1, len(self.arrivals)), sum(self.devices) / max(1, len(self.devices))))
+        print("  fragments/message: max %d, mean %.1f, %d of %d messages fragmented" % (
+            max(self.fragments, default=0), sum(self.fragments) / max(1, len(self.fragments)),
+            multi, len(self.fragments)))
+        print("  delta latency ms: p50 %.1f  p95 %.1f  max %.1f  (%d changes seen)" % (
+            pct(50), pct(95), pct(100), len(lat)))
+        for f in failures:
+            print("  FAIL: %s" % f)
+        return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--hub", required=True)
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--intervals", default="50,100,250,1000", help="ms, cycled over the clients")
+    parser.add_argument("--devices", type=int, default=20)
+    parser.add_argument("--rate", type=float, default=50, help="device changes per second")
+    parser.add_argument("--duration", type=float, default=10, help="seconds")
+    parser.add_argument("--jitter", type=float, default=15, help="ms of network jitter allowed on gaps")
+    args = parser.parse_args()
+
+    intervals = [int(v) for v in args.intervals.split(",")]
+    changes = Changes()
+    stop = threading.Event()
+    runs = [ClientRun(n, intervals[n % len(intervals)]) for n in range(args.clients)]
+    threads = [threading.Thread(target=r.run, args=(args, changes, stop)) for r in runs]
+    for th in threads:
+        th.start()
+        time.sleep(0.1)  # Connect in order, so the extra clients are the rejected ones
+
+    time.sleep(0.5)  # Initial full lists
+    feeder = threading.Thread(target=driver, args=(args, changes, stop))
+    start = time.perf_counter()
+    feeder.start()
+    time.sleep(args.duration)
+    stop.set()
+    feeder.join()
+    for th in threads:
+        th.join()
+    duration = time.perf_counter() - start
+
+    print("%d changes posted in %.1f s to %d devices" % (changes.count, duration, args.devices))
+    failures = []
+    for r in runs:
+        failures += r.report(args, changes.count)
+    accepted = sum(1 for r in runs if not r.rejected)
+    if accepted == 0:
+        failures.append("no client connected")
+    print("FAILED" if failures else "OK")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
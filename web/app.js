@@ -0,0 +1,526 @@
+let openDeviceSettings=null;
+let controlTimers={};
+let activeControlDevice=null;
+function activateControls(addrClean){
+const card=document.getElementById('card-'+addrClean);
+if(!card||!card.classList.contains('compact'))return;
+if(activeControlDevice&&activeControlDevice!==addrClean){
+const prevCard=document.getElementById('card-'+activeControlDevice);
+if(prevCard){prevCard.classList.remove('active-controls');}
+if(controlTimers[activeControlDevice]){clearTimeout(controlTimers[activeControlDevice]);}
+}
+activeControlDevice=addrClean;
+card.classList.add('active-controls');
+if(controlTimers[addrClean]){clearTimeout(controlTimers[addrClean]);}
+controlTimers[addrClean]=setTimeout(()=>{
+const panel=document.getElementById('settings-'+addrClean);
+if(panel&&panel.classList.contains('open')){return;}
+card.classList.remove('active-controls');
+activeControlDevice=null;
+},10000);
+}
+const compactPref=localStorage.getItem('compactView');
+let compactView=(compactPref===null)?true:(compactPref==='1');
+let expandedDevices={};
+try{expandedDevices=JSON.parse(localStorage.getItem('expandedDevices')||'{}')||{};}catch(e){expandedDevices={};}
+function applyCompactView(){
+const btn=document.getElementById('compactViewBtn');
+if(compactView){document.body.classList.add('compact-view');btn.classList.add('active');}
+else{document.body.classList.remove('compact-view');btn.classList.remove('active');}
+localStorage.setItem('compactView',compactView?'1':'0');}
+function toggleCompactView(){compactView=!compactView;applyCompactView();updateDevices();}
+function toggleDeviceView(addrClean){
+expandedDevices[addrClean]=!expandedDevices[addrClean];
+localStorage.setItem('expandedDevices',JSON.stringify(expandedDevices));
+updateDevices();}
+let discoveryInterval=null;
+async function openDiscovery(){
+document.getElementById('discoveryPage').classList.add('show');
+document.body.classList.add('page-open');
+await startScan();
+updateDiscoveryDevices();
+feedConnect(discoveryFeed,updateDiscoveryDevices);
+discoveryInterval=setInterval(updateDiscoveryDevices,2000);}
+async function closeDiscovery(){
+document.getElementById('discoveryPage').classList.remove('show');
+document.body.classList.remove('page-open');
+if(discoveryInterval){clearInterval(discoveryInterval);discoveryInterval=null;}
+feedClose(discoveryFeed);
+await fetch('/api/stop-scan',{method:'POST'});}
+async function startScan(){
+try{
+const resp=await fetch('/api/start-scan',{method:'POST'});
+const result=await resp.json();
+if(!result.ok){
+alert('Failed to start scan');}
+}catch(e){alert('Error: '+e.message);}}
+async function updateDiscoveryDevices(){
+try{
+const data=await feedFetch(discoveryFeed);
+const container=document.getElementById('discoveryDevices');
+if(data.length===0){container.innerHTML='<div class="no-devices">No devices found</div>';return;}
+let html='';
+data.forEach(d=>{
+const name=d.name||'Unnamed device';
+const addr=d.addr;
+const sourceLabel=(d.source&&d.source!==''&&d.source!=='local')?('Satellite '+d.source.replace('satellite-','')):'Master';
+const isAdded=d.saved;
+html+='<div class="discovery-device">';
+html+='<div class="discovery-info">';
+html+='<h3>'+name+'</h3>';
+html+='<p>'+addr+' • '+sourceLabel;
+if(d.hasSensor)html+=' • 🌡️ '+d.temp.toFixed(1)+'°C • 💧 '+d.hum+'%';
+html+='</p></div>';
+if(isAdded){
+html+='<button class="add-btn added" onclick="removeFromMain(\''+addr+'\');">✓ Added</button>';
+}else{
+html+='<button class="add-btn" onclick="addToMain(\''+addr+'\');">+ Add</button>'; }
+html+='</div>';});
+container.innerHTML=html;
+}catch(err){console.error('Error:',err);}}
+async function addToMain(addr){
+try{
+const resp=await fetch('/api/toggle-visibility',{method:'POST',
+headers:{'Content-Type':'application/x-www-form-urlencoded'},
+body:'addr='+encodeURIComponent(addr)+'&visible=1'});
+const result=await resp.json();
+if(result.ok){
+updateDiscoveryDevices();
+updateDevices();
+}else{alert('Error adding device');}
+}catch(err){console.error('Error:',err);}}
+async function removeFromMain(addr){
+try{
+const resp=await fetch('/api/toggle-visibility',{method:'POST',
+headers:{'Content-Type':'application/x-www-form-urlencoded'},
+body:'addr='+encodeURIComponent(addr)+'&visible=0'});
+const result=await resp.json();
+if(result.ok){
+updateDiscoveryDevices();
+updateDevices();
+}else{alert('Error removing device');}
+}catch(err){console.error('Error:',err);}}
+async function clearAllSelections(){
+if(!confirm('Remove all selections from the main view?'))return;
+try{
+const resp=await fetch('/api/clear-visibility',{method:'POST'});
+const result=await resp.json();
+if(result.ok){
+updateDiscoveryDevices();
+updateDevices();
+}else{alert('Error: failed to clear selections');}
+}catch(err){console.error('Error:',err);alert('Error: failed to clear selections');}}
+function toggleSettings(addr){
+const panel=document.getElementById('settings-'+addr);
+const card=panel?panel.closest('.device-card'):null;
+activateControls(addr);
+if(openDeviceSettings&&openDeviceSettings!==panel){
+openDeviceSettings.classList.remove('open');
+const oldCard=openDeviceSettings.closest('.device-card');
+if(oldCard)oldCard.classList.remove('settings-open');}
+if(panel){
+panel.classList.toggle('open');
+const isOpen=panel.classList.contains('open');
+openDeviceSettings=isOpen?panel:null;
+if(card)card.classList.toggle('settings-open',isOpen);}}
+document.addEventListener('click',(e)=>{
+if(!e.target.closest('.settings-icon')&&!e.target.closest('.settings-panel')){
+if(openDeviceSettings){
+openDeviceSettings.classList.remove('open');
+const card=openDeviceSettings.closest('.device-card');
+if(card)card.classList.remove('settings-open');
+openDeviceSettings=null;}}});
+async function forgetDevice(addrClean,event){
+if(event){event.stopPropagation();}
+if(!confirm('Remove this device? It will be deleted from memory and will reappear if seen again.'))return;
+console.log('Forgetting device:',addrClean);
+if(openDeviceSettings){openDeviceSettings.classList.remove('open');openDeviceSettings=null;}
+try{
+const resp=await fetch('/api/forget-device?mac='+addrClean,{method:'POST'});
+const result=await resp.json();
+console.log('Response:',result);
+if(result.ok){
+setTimeout(()=>{updateDevices();updateDiscoveryDevices();},100);
+}else{
+alert('Error: '+result.error);
+}
+}catch(err){console.error('Error:',err);alert('Error removing device');}}
+async function saveSettings(addr,addrClean,applyToSimilar,event){
+if(event){event.stopPropagation();}
+const name=document.getElementById('name-'+addrClean).value;
+const showMac=document.getElementById('showmac-'+addrClean).checked?1:0;
+const showIp=document.getElementById('showip-'+addrClean).checked?1:0;
+let fieldMask=0;
+document.querySelectorAll('#settings-'+addrClean+' .field-check').forEach(cb=>{
+if(cb.checked){fieldMask|=parseInt(cb.getAttribute('data-bit'));}});
+console.log('Saving:',addr,'name=',name,'showMac=',showMac,'fields=',fieldMask,'apply=',applyToSimilar);
+try{
+const resp=await fetch('/api/update-settings',{method:'POST',
+headers:{'Content-Type':'application/x-www-form-urlencoded'},
+body:'addr='+encodeURIComponent(addr)+'&name='+encodeURIComponent(name)+'&show_mac='+showMac+'&show_ip='+showIp+'&field_mask='+fieldMask+'&apply_to_similar='+(applyToSimilar?1:0)});
+const result=await resp.json();
+console.log('Response:',result);
+if(result.updated>1){
+alert('Settings saved for '+result.updated+' devices!');
+}else{
+alert('Settings saved!');}
+if(openDeviceSettings){openDeviceSettings.classList.remove('open');openDeviceSettings=null;}
+setTimeout(updateDevices,100);
+}catch(err){console.error('Error:',err);alert('Error while saving!');}}
+function newFeed(q){return{q:q,map:{},cursor:null,etag:null,ws:null,retry:null};}
+const mainFeed=newFeed(''),discoveryFeed=newFeed('all=1');
+function feedApply(f,j){
+const now=Date.now();
+if(j.full)f.map={};
+j.devices.forEach(d=>{d.t0=now-(d.ageSec||0)*1000;f.map[d.addr]=d;});
+f.cursor=j.cursor;}
+function feedList(f){
+const now=Date.now();
+return Object.values(f.map).sort((a,b)=>a.addr<b.addr?-1:1).map(d=>{d.ageSec=Math.max(0,Math.floor((now-d.t0)/1000));return d;});}
+async function feedFetch(f){
+if(f.ws&&f.ws.readyState===1)return feedList(f);
+const h={};if(f.etag)h['If-None-Match']=f.etag;
+const res=await fetch('/api/devices?since='+encodeURIComponent(f.cursor||'0')+(f.q?'&'+f.q:''),{headers:h});
+if(res.status!==304){feedApply(f,await res.json());f.etag=res.headers.get('ETag');}
+return feedList(f);}
+function feedConnect(f,onChange){
+const ws=new WebSocket((location.protocol==='https:'?'wss://':'ws://')+location.host+'/ws'+(f.q?'?'+f.q:''));
+ws.onmessage=e=>{feedApply(f,JSON.parse(e.data));onChange();};
+ws.onclose=()=>{if(f.ws===ws){f.ws=null;f.retry=setTimeout(()=>feedConnect(f,onChange),5000);}};
+f.ws=ws;}
+function feedClose(f){clearTimeout(f.retry);if(f.ws){const ws=f.ws;f.ws=null;ws.close();}}
+async function updateDevices(){
+if(openDeviceSettings){console.log('Settings open, skipping update');return;}
+try{
+const data=await feedFetch(mainFeed);
+cachedDevices=data;
+console.log('🔄 Updated cachedDevices:',{count:data.length,sample:data.length>0?{name:data[0].name,addr:data[0].addr,visible:data[0].visible,hasSensor:data[0].hasSensor,saved:data[0].saved}:null,allDevices:data.map(d=>({name:d.name,visible:d.visible,hasSensor:d.hasSensor}))});
+if(data.length===0){document.getElementById('devices').innerHTML=
+'<div class="no-devices">No devices to display</div>';return;}
+let html='';
+data.forEach(d=>{
+const name=d.name||'Unnamed device';
+const advName=d.advName||'';
+const sourceLabel=(d.source&&d.source!==''&&d.source!=='local')?('Satellite '+d.source.replace('satellite-','')):'Master';
+const addrClean=d.addr.replace(/:/g,'');
+const isExpanded=!!expandedDevices[addrClean];
+const useCompact=compactView&&!isExpanded;
+const savedClass=d.saved?'':'unsaved';
+html+='<div class="device-card '+savedClass+' '+(useCompact?'compact':'')+'" id="card-'+addrClean+'"'+(useCompact?' data-addr="'+addrClean+'" onclick="activateControls(this.dataset.addr)"':'')+'>'
++' <div class="device-header">'
++' <div class="device-info">'
++' <div class="device-name">';
+if(!useCompact&&d.source&&d.source!=='local'&&d.source!==''){const satName=d.source.replace('satellite-','');html+='<span style="margin-right:6px;" title="Satellite: '+satName+'">📡</span>';}
+html+=name;
+if(useCompact){
+const age=(typeof d.ageSec==='number')?d.ageSec:0;
+html+=' <span class=\"compact-age\">• '+age+'s</span>';
+}
+if(!useCompact&&d.showIp&&d.source&&d.source.startsWith('satellite-')){
+const satIP=d.source.replace('satellite-','');
+html+=' <span style="display:inline-block;margin-left:8px;padding:2px 8px;background:#6366f1;color:white;border-radius:4px;font-size:11px;font-weight:600;vertical-align:middle;">🛰️ '+satIP+'</span>'; }
+if(!useCompact&&d.firmware&&d.firmware!=='Unknown'){
+html+=' <span style="display:inline-block;margin-left:8px;padding:2px 8px;background:#3b82f6;color:white;border-radius:4px;font-size:11px;font-weight:600;vertical-align:middle;">'+d.firmware+'</span>';}
+html+='</div>';
+if(d.showMac){
+html+=' <div class="device-mac">'+d.addr+'</div>';}
+const age=(typeof d.ageSec==='number')?d.ageSec:0;
+if(!useCompact){
+html+=' <div class="device-meta">Source: '+sourceLabel+' • Update: '+age+'s</div>';
+}
+html+=' </div>'
++' <div class="device-header-actions">';
+if(d.hasSensor&&(d.fieldMask&1)){
+html+=' <button onclick="openChart(\''+name.replace(/'/g,"\\'")+'\',\''+d.addr+'\')" style="padding:6px 10px;background:#3b82f6;color:white;border:none;border-radius:6px;cursor:pointer;font-size:18px;line-height:1;" title="Show temperature history">📊</button>'; }
+html+=' <button class="expand-btn" onclick="toggleDeviceView(\''+addrClean+'\')" title="Compact / expanded">'+(useCompact?'▢':'▣')+'</button>';
+html+=' <button class="settings-icon" onclick="toggleSettings(\''+addrClean+'\')" >⚙️</button>'
++' </div>'
++' <div class="settings-panel" id="settings-'+addrClean+'">';
+html+=' <div style="padding:14px;">'
++' <label style="display:block;margin-bottom:6px;font-weight:600;color:#f1f5f9;font-size:13px;">Name:</label>'
++' <input type="text" id="name-'+addrClean+'" value="'+name+'" style="width:100%;padding:8px;margin-bottom:12px;border:1px solid #475569;border-radius:6px;background:#0f172a;color:#e2e8f0;font-size:14px;" />'
++' <label style="display:block;margin-bottom:6px;font-weight:600;color:#f1f5f9;font-size:13px;">Advertised name:</label>'
++' <input type="text" value="'+advName+'" readonly style="width:100%;padding:8px;margin-bottom:12px;border:1px solid #475569;border-radius:6px;background:#0f172a;color:#94a3b8;font-size:13px;" />'
++' <label style="display:flex;align-items:center;margin-bottom:12px;color:#e2e8f0;cursor:pointer;">'
++' <input type="checkbox" id="showmac-'+addrClean+'" '+(d.showMac?'checked':'')+' style="margin-right:8px;cursor:pointer;" />'
++' <span style="font-size:13px;">Show MAC address</span>'
++' </label>'
++' <label style="display:flex;align-items:center;margin-bottom:12px;color:#e2e8f0;cursor:pointer;">'
++' <input type="checkbox" id="showip-'+addrClean+'" '+(d.showIp?'checked':'')+' style="margin-right:8px;cursor:pointer;" />'
++' <span style="font-size:13px;">Show satellite IP</span>'
++' </label>'
++' <div style="margin-bottom:10px;font-weight:600;color:#f1f5f9;font-size:13px;">Visible fields:</div>';
+const fields=[{bit:1,label:'Temperature'},{bit:2,label:'Humidity'},{bit:4,label:'Battery %'},{bit:8,label:'Voltage'},{bit:16,label:'Signal'}];
+fields.forEach(f=>{
+const available=(d.availableFields&f.bit)!==0;
+const checked=(d.fieldMask&f.bit)!==0;
+if(available){
+html+=' <label style="display:flex;align-items:center;margin-bottom:6px;color:#e2e8f0;cursor:pointer;">'
++' <input type="checkbox" class="field-check" data-bit="'+f.bit+'" '+(checked?'checked':'')+' style="margin-right:8px;cursor:pointer;" />'
++' <span style="font-size:13px;">'+f.label+'</span> </label>';}});
+html+=' <button onclick="saveSettings(\''+d.addr+'\',\''+addrClean+'\',false,event)" style="width:100%;padding:10px;margin-top:14px;background:#3b82f6;color:white;border:none;border-radius:6px;cursor:pointer;font-weight:600;font-size:13px;transition:background 0.2s;" onmouseover="this.style.background=\'#2563eb\'" onmouseout="this.style.background=\'#3b82f6\'">💾 Save</button>'
++' <button onclick="saveSettings(\''+d.addr+'\',\''+addrClean+'\',true,event)" style="width:100%;padding:10px;margin-top:6px;background:#10b981;color:white;border:none;border-radius:6px;cursor:pointer;font-weight:600;font-size:13px;transition:background 0.2s;" onmouseover="this.style.background=\'#059669\'" onmouseout="this.style.background=\'#10b981\'">🔁 Apply to similar</button>'
++' <div class="settings-option danger" onclick="forgetDevice(\''+addrClean+'\',event)" style="margin-top:10px;background:#dc2626;">🗑️ Remove device</div>';
+html+=' </div></div>'
++' </div>';
+if(d.hasSensor&&useCompact){
+let tempText='--';let tempClass='temp-normal';
+if((d.fieldMask&1)&&typeof d.temp==='number'){const t=d.temp;tempText=t.toFixed(1)+'°C';if(t<10)tempClass='temp-cold';else if(t<18)tempClass='temp-cool';else if(t>30)tempClass='temp-hot';else if(t>26)tempClass='temp-warm';}
+let humText='--';if((d.fieldMask&2)&&typeof d.hum==='number'){humText=d.hum+'%';}
+html+=' <div class="compact-row">'
++' <div class="compact-item"><span class="compact-label">Temp</span><span class="'+tempClass+'">'+tempText+'</span></div>'
++' <div class="compact-item"><span class="compact-label">Humidity</span><span>'+humText+'</span></div>'
++' </div>';
+}
+if(d.hasSensor){
+html+=' <div class="sensor-data">';
+if((d.fieldMask&1)&&d.temp){
+let tempClass='temp-normal';
+if(d.temp<10)tempClass='temp-cold';
+else if(d.temp<18)tempClass='temp-cool';
+else if(d.temp>26)tempClass='temp-warm';
+else if(d.temp>30)tempClass='temp-hot';
+html+=' <div class="sensor-value primary">'
++' <div class="sensor-label">🌡️ Temperature</div>'
++' <div class="sensor-number '+tempClass+'">'+d.temp.toFixed(1)+'<span class="sensor-unit">°C</span></div>'
++' </div>';}
+if((d.fieldMask&2)&&d.hum){
+html+=' <div class="sensor-value">'
++' <div class="sensor-label">💧 Humidity</div>'
++' <div class="sensor-number">'+d.hum+'<span class="sensor-unit">%</span></div>'
++' </div>';}
+if((d.fieldMask&4)&&d.bat){
+const batClass=d.bat>50?'high':(d.bat>20?'medium':'low');
+html+=' <div class="sensor-value">'
++' <div class="sensor-label">🔋 Battery</div>'
++' <div class="battery-container">'
++' <div class="battery-bar"><div class="battery-fill '+batClass+'" style="width:'+d.bat+'%"></div></div>'
++' <div class="sensor-number" style="font-size:18px;">'+d.bat+'%</div>'
++' </div>'
++' </div>';}
+if((d.fieldMask&8)&&d.batMv){
+html+=' <div class="sensor-value">'
++' <div class="sensor-label">⚡ Voltage</div>'
++' <div class="sensor-number">'+d.batMv+'<span class="sensor-unit">mV</span></div>'
++' </div>';}
+html+=' </div>';}
+if(d.fieldMask&16){
+let barCount=0,signalClass='';
+if(d.rssi>=-50){barCount=4;signalClass='excellent';}
+else if(d.rssi>=-65){barCount=3;signalClass='good';}
+else if(d.rssi>=-75){barCount=2;signalClass='fair';}
+else{barCount=1;signalClass='poor';}
+html+=' <div class="rssi"><div class="signal-container">'
++' <div class="signal-bars">';
+for(let i=1;i<=4;i++){
+html+='<div class="signal-bar '+(i<=barCount?'active '+signalClass:'inactive')+'"></div>';}
+html+=' </div><span style="font-size:13px;color:#7f8c8d;">'+d.rssi+' dBm</span></div></div>';}
+html+='</div>';});
+const devicesDiv=document.getElementById('devices');
+if(devicesDiv.innerHTML!==html){
+devicesDiv.innerHTML=html;}
+}catch(error){console.error('Error fetching devices:',error);}}
+async function refreshDiagnostics(){
+try{
+const r=await fetch('/api/diagnostics');
+const d=await r.json();
+const uptimeHours=Math.floor(d.uptimeSec/3600);
+const uptimeMins=Math.floor((d.uptimeSec%3600)/60);
+const uptimeSecs=d.uptimeSec%60;
+const resetEmoji=(d.lastReset==='PANIC'||d.lastReset==='INT_WDT'||d.lastReset==='TASK_WDT'||d.lastReset==='WDT')?'⚠️':'✅';
+const resetColor=(d.lastReset==='PANIC'||d.lastReset==='INT_WDT'||d.lastReset==='TASK_WDT'||d.lastReset==='WDT')?'#ef4444':'#10b981';
+const memPercent=Math.round((d.freeHeap/327680)*100);
+document.getElementById('diagnosticsContent').innerHTML=
+'<div><strong>🔄 Boot Count:</strong><br>'+d.bootCount+'</div>'
++'<div><strong>'+resetEmoji+' Last Reset:</strong><br><span style="color:'+resetColor+'">'+d.lastReset+'</span></div>'
++'<div><strong>⏱️ Uptime:</strong><br>'+uptimeHours+'h '+uptimeMins+'m '+uptimeSecs+'s</div>'
++'<div><strong>💾 Free Heap:</strong><br>'+d.freeHeap+' / '+d.minFreeHeap+' bytes ('+memPercent+'%)</div>'
++'<div><strong>📦 Largest Block:</strong><br>'+d.largestBlock+' bytes</div>'
++'<div><strong>📡 BLE Adverts:</strong><br>'+d.bleAdvCount+' total</div>'
++'<div><strong>📱 Devices:</strong><br>'+d.deviceCount+'</div>';
+}catch(error){console.error('Error fetching diagnostics:',error);}}
+let currentChart=null;
+let currentChartName='';
+let currentChartAddr='';
+let cachedDevices=[];
+let touchStartX=0;
+let touchEndX=0;
+function getVisibleDevicesWithSensors(){
+const filtered=cachedDevices.filter(d=>d.saved&&d.hasSensor).sort((a,b)=>a.name.localeCompare(b.name));
+console.log('📱 getVisibleDevicesWithSensors:',{totalCached:cachedDevices.length,filtered:filtered.length,devices:filtered.map(d=>({name:d.name,addr:d.addr}))});
+return filtered;}
+function getCurrentDeviceIndex(){
+const devices=getVisibleDevicesWithSensors();
+const idx=devices.findIndex(d=>d.addr===currentChartAddr);
+console.log('🔍 getCurrentDeviceIndex:',{currentAddr:currentChartAddr,foundIndex:idx});
+return idx;}
+function navigateChart(direction){
+console.log('🔄 navigateChart START:',{direction:direction,currentName:currentChartName,currentAddr:currentChartAddr});
+const devices=getVisibleDevicesWithSensors();
+console.log('📊 Devices available:',devices.length);
+if(devices.length===0){console.warn('⚠️ No devices with sensors');return;}
+let idx=getCurrentDeviceIndex();
+console.log('📍 Current index before navigation:',idx);
+if(idx===-1)idx=0;
+idx+=direction;
+console.log('📍 Index after adding direction:',idx);
+if(idx<0)idx=devices.length-1;
+if(idx>=devices.length)idx=0;
+console.log('📍 Final index after wrap:',idx);
+const device=devices[idx];
+console.log('✅ Navigating to device:',{name:device.name,addr:device.addr});
+const hours=parseInt(document.querySelector('.time-btn.active')?.getAttribute('data-hours')||'24');
+openChart(device.name,device.addr,hours);}
+function handleChartSwipe(){
+const diff=touchStartX-touchEndX;
+console.log('👆 handleChartSwipe:',{startX:touchStartX,endX:touchEndX,diff:diff,threshold:Math.abs(diff)});
+if(Math.abs(diff)>50){
+if(diff>0){console.log('➡️ Swipe right - next');navigateChart(1);}
+else{console.log('⬅️ Swipe left - prev');navigateChart(-1);}}
+else{console.log('❌ Swipe too small, threshold not met');}}
+async function fetchHubHistory(addr,hours){
+try{const r=await fetch(`/api/history?mac=${addr}&hours=${hours}&points=200`);if(!r.ok)return [];
+const h=await r.json();const start=Date.now()-h.startAgeSec*1000;
+return h.points.map((p,i)=>p===null?null:{x:new Date(start+i*h.intervalSec*1000),y:p[0],lo:p[2],hi:p[3]}).filter(p=>p);
+}catch(e){return [];}}
+async function openChart(name,addr,hours=24){
+currentChartName=name;currentChartAddr=addr;
+document.getElementById('chartModal').classList.add('show');
+document.querySelectorAll('.time-btn').forEach(b=>b.classList.remove('active'));
+document.querySelector(`.time-btn[data-hours='${hours}']`)?.classList.add('active');
+document.getElementById('chartTitle').textContent='📊 '+name;
+if(currentChart){try{currentChart.destroy();}catch(e){}currentChart=null;}
+const canvas=document.getElementById('chartCanvas');
+try{
+let temps=await fetchHubHistory(addr,hours);
+if(!temps.length){
+const r=await fetch('/api/aio/config');
+const cfg=await r.json();
+if(!cfg.ok||!cfg.has_key||!cfg.key){alert('No history on the hub yet and Adafruit IO not configured');return;}
+const macClean=addr.replace(/:/g,'').toLowerCase();
+const feedName=macClean+'-temp';
+const url=`https://io.adafruit.com/api/v2/${cfg.username}/feeds/${feedName}/data?start_time=${new Date(Date.now()-hours*3600*1000).toISOString()}`;
+const res=await fetch(url,{headers:{'X-AIO-Key':cfg.key}});
+if(!res.ok){alert('No data available');return;}
+const data=await res.json();
+temps=data.reverse().map(d=>({x:new Date(d.created_at),y:parseFloat(d.value)}));}
+const latestEl=document.getElementById('chartLatest');
+const latest=temps[temps.length-1];
+if(latestEl){
+if(latest&&Number.isFinite(latest.y)){
+const ageMin=Math.max(0,Math.round((Date.now()-latest.x.getTime())/60000));
+const ageText=ageMin<1?'just now':(ageMin<60?ageMin+' min':Math.round(ageMin/60)+' h');
+const timeStr=latest.x.toLocaleString(undefined,{day:'2-digit',month:'2-digit',hour:'2-digit',minute:'2-digit'});
+latestEl.innerHTML=`<span class='label'>Latest</span><span class='value'>${latest.y.toFixed(1)}<span class='unit'>°C</span></span><span class='meta'>${timeStr} • ${ageText} ago</span>`;
+}else{latestEl.innerHTML=`<span class='label'>Latest</span><span class='value'>--</span>`;}}
+const tempValues=temps.map(t=>t.y);
+const avgTemp=tempValues.reduce((a,b)=>a+b,0)/tempValues.length;
+const minY=Math.floor(avgTemp-10);
+const maxY=Math.ceil(avgTemp+10);
+currentChart=new MiniChart(canvas,temps,{color:'#3b82f6',yMin:minY,yMax:maxY,unit:'°C'});
+canvas.ontouchstart=e=>{touchStartX=e.changedTouches[0].screenX;};
+canvas.ontouchend=e=>{touchEndX=e.changedTouches[0].screenX;handleChartSwipe();};
+}catch(e){console.error('Chart error:',e);alert('Error loading data');}}
+function changeTimeRange(hours){openChart(currentChartName,currentChartAddr,hours);}
+function closeChart(){document.getElementById('chartModal').classList.remove('show');if(currentChart){currentChart.destroy();currentChart=null;}}
+async function openSettings(tab='adafruit'){
+const page=document.getElementById('settingsPage');page.classList.add('show');
+document.body.classList.add('page-open');
+switchSettingsTab(tab);
+if(tab==='adafruit'){
+try{const r=await fetch('/api/aio/config');
+if(!r.ok){console.error('Failed to load AIO settings:',r.status);return;}
+const d=await r.json();
+if(d.ok){document.getElementById('aioUser').value=d.username||'';
+document.getElementById('aioEnabled').checked=d.enabled;
+const types=d.feedTypes||3;
+document.getElementById('feedTemp').checked=(types&1)!==0;
+document.getElementById('feedHum').checked=(types&2)!==0;
+document.getElementById('feedBat').checked=(types&4)!==0;
+window.oldFeedTypes=types;}}
+catch(e){console.error('Error loading AIO settings:',e);}}else if(tab==='scan'){
+try{const r=await fetch('/api/scan-settings');
+if(!r.ok){console.error('Failed to load scan settings:',r.status);return;}
+const d=await r.json();
+if(d.ok){document.getElementById('masterBleEnabled').checked=d.masterBleEnabled;}}
+catch(e){console.error('Error loading scan settings:',e);}}}
+function switchSettingsTab(tab){
+document.querySelectorAll('.settings-tab-btn').forEach(b=>b.classList.remove('active'));
+document.querySelectorAll('.settings-tab-content').forEach(c=>c.style.display='none');
+document.querySelector('[data-tab="'+tab+'"]').classList.add('active');
+document.getElementById('tab-'+tab).style.display='block';}
+function closeSettings(){document.getElementById('settingsPage').classList.remove('show');document.body.classList.remove('page-open');}
+async function saveScanSettings(){
+const enabled=document.getElementById('masterBleEnabled').checked;
+try{const r=await fetch('/api/scan-settings',{method:'POST',headers:{'Content-Type':'application/json'},
+body:JSON.stringify({masterBleEnabled:enabled})});
+const d=await r.json();if(d.ok){alert('Scan settings saved!');}else{alert('Error: '+d.error);}}
+catch(e){alert('Error while saving: '+e.message);}}
+async function saveAioSettings(){
+const user=document.getElementById('aioUser').value;
+const key=document.getElementById('aioKey').value;
+const enabled=document.getElementById('aioEnabled').checked;
+if(!user||!key){alert('Enter username and key!');return;}
+const temp=document.getElementById('feedTemp').checked;
+const hum=document.getElementById('feedHum').checked;
+const bat=document.getElementById('feedBat').checked;
+const feedTypes=(temp?1:0)|(hum?2:0)|(bat?4:0);
+try{const r=await fetch('/api/aio/config',{method:'POST',headers:{'Content-Type':'application/json'},
+body:JSON.stringify({username:user,key:key,enabled:enabled,feedTypes:feedTypes})});
+const d=await r.json();if(d.ok){alert('Cloud settings saved!');window.oldFeedTypes=feedTypes;}else{alert('Error: '+d.error);}}
+catch(e){alert('Error while saving: '+e.message);}}
+async function sendAioNow(){
+try{const r=await fetch('/api/aio/send_now',{method:'POST'});
+const d=await r.json();if(d.ok){alert('Send started! Check Adafruit IO in a few seconds.');}else{alert('Error: '+(d.error||'Unknown'));}}
+catch(e){alert('Error: '+e.message);}}
+async function createAioFeeds(){
+const temp=document.getElementById('feedTemp').checked;
+const hum=document.getElementById('feedHum').checked;
+const bat=document.getElementById('feedBat').checked;
+if(!temp&&!hum&&!bat){alert('Select at least one data type first!');return;}
+const feedTypes=(temp?1:0)|(hum?2:0)|(bat?4:0);
+const oldTypes=window.oldFeedTypes||0;
+const removed=oldTypes&(~feedTypes);
+if(removed!==0){
+const names=[];
+if(removed&1)names.push('Temperature');
+if(removed&2)names.push('Humidity');
+if(removed&4)names.push('Battery');
+const msg='⚠️ WARNING!\n\nYou are removing these data types:\n• '+names.join('\n• ')+'\n\nThis DELETES all related feeds and ALL their data permanently!\n\nDo you want to continue?';
+if(!confirm(msg))return;
+try{
+const dr=await fetch('/api/aio/delete_feeds?types='+removed,{method:'DELETE'});
+const dd=await dr.json();
+if(!dd.ok){alert('Feed deletion failed: '+dd.error);return;}
+alert('Deleted '+dd.deleted+' feeds');
+}catch(e){alert('Error while deleting: '+e.message);return;}}
+try{
+const user=document.getElementById('aioUser').value;
+const key=document.getElementById('aioKey').value;
+if(!user||!key){alert('Enter username and AIO Key in Cloud settings first!');return;}
+const r2=await fetch('/api/aio/config',{method:'POST',headers:{'Content-Type':'application/json'},
+body:JSON.stringify({username:user,key:key,enabled:true,feedTypes:feedTypes})});
+const d2=await r2.json();
+if(!d2.ok){alert('Failed to save settings');return;}
+window.oldFeedTypes=feedTypes;
+}catch(e){alert('Error: '+e.message);return;}
+if(!confirm('Create feeds automatically for all visible devices?'))return;
+try{const r=await fetch('/api/aio/create_feeds',{method:'POST'});
+const d=await r.json();if(d.ok){alert('✅ Feed creation completed!\n\n✓ Created: '+d.created+' new feeds\n○ Skipped: '+d.existed+' (already exist)\n✗ Failed: '+d.failed);}else{alert('Error: '+(d.error||'Unknown'));}
+}catch(e){alert('Error: '+e.message);}}
+function updateFeedCount(){
+const temp=document.getElementById('feedTemp').checked;
+const hum=document.getElementById('feedHum').checked;
+const bat=document.getElementById('feedBat').checked;
+const types=(temp?1:0)+(hum?1:0)+(bat?1:0);
+const label=document.getElementById('feedCountEstimate');
+if(types>0){label.textContent='Estimate: '+(5*types)+' feeds for 5 devices';
+label.style.color=types<=2?'#10b981':'#f59e0b';}else{label.textContent='Select data types';
+label.style.color='#94a3b8';}}
+function openAioHelp(){
+document.getElementById('aioHelpModal').classList.add('show');}
+function closeAioHelp(){
+document.getElementById('aioHelpModal').classList.remove('show');}
+applyCompactView();
+setInterval(updateDevices,2000);updateDevices();feedConnect(mainFeed,updateDevices);
+setInterval(refreshDiagnostics,5000);refreshDiagnostics();
@@ -0,0 +1,130 @@
+// Small time-series chart on a canvas for the history view: one line with
+// gaps, an optional min/max band, and time and value axes. Served by the hub
+// like the rest of the UI, so charts work without internet access.
+
+const CHART_TIME_STEPS = [60e3, 5 * 60e3, 15 * 60e3, 30 * 60e3, 3600e3, 2 * 3600e3, 3 * 3600e3,
+	6 * 3600e3, 12 * 3600e3, 86400e3, 2 * 86400e3, 7 * 86400e3];
+const CHART_VALUE_STEPS = [0.5, 1, 2, 5, 10, 20, 50];
+const CHART_PAD = { left: 44, right: 10, top: 10, bottom: 24 };
+
+class MiniChart {
+	// points: [{x: Date, y, lo?, hi?}] in time order
+	// opts: {color, yMin, yMax, unit}
+	constructor(canvas, points, opts) {
+		this.canvas = canvas;
+		this.points = points;
+		this.opts = opts;
+		canvas.style.width = '100%';
+		canvas.style.height = '100%';
+		this.onResize = () => this.draw();
+		window.addEventListener('resize', this.onResize);
+		this.draw();
+	}
+
+	destroy() {
+		window.removeEventListener('resize', this.onResize);
+		const ctx = this.canvas.getContext('2d');
+		ctx.setTransform(1, 0, 0, 1, 0, 0);
+		ctx.clearRect(0, 0, this.canvas.width, this.canvas.height);
+	}
+
+	draw() {
+		const canvas = this.canvas;
+		const o = this.opts;
+		const pts = this.points;
+		const dpr = window.devicePixelRatio || 1;
+		const w = canvas.clientWidth, h = canvas.clientHeight;
+		if (!w || !h) return;
+		canvas.width = Math.round(w * dpr);
+		canvas.height = Math.round(h * dpr);
+		const ctx = canvas.getContext('2d');
+		ctx.setTransform(dpr, 0, 0, dpr, 0, 0);
+		ctx.clearRect(0, 0, w, h);
+
+		const left = CHART_PAD.left, right = w - CHART_PAD.right;
+		const top = CHART_PAD.top, bottom = h - CHART_PAD.bottom;
+		let x0 = pts.length ? pts[0].x.getTime() : Date.now() - 3600e3;
+		let x1 = pts.length ? pts[pts.length - 1].x.getTime() : Date.now();
+		if (x1 - x0 < 60e3) { x0 -= 30 * 60e3; x1 += 30 * 60e3; }
+		const yMin = o.yMin, yMax = o.yMax > o.yMin ? o.yMax : o.yMin + 1;
+		const px = t => left + (t - x0) / (x1 - x0) * (right - left);
+		const py = v => bottom - (v - yMin) / (yMax - yMin) * (bottom - top);
+
+		ctx.font = '11px sans-serif';
+		ctx.lineWidth = 1;
+
+		// Value axis: at most one label per 24 px
+		const yStep = CHART_VALUE_STEPS.find(s => (yMax - yMin) / s <= (bottom - top) / 24) || 100;
+		ctx.textAlign = 'right';
+		ctx.textBaseline = 'middle';
+		for (let v = Math.ceil(yMin / yStep) * yStep; v <= yMax; v += yStep) {
+			const y = Math.round(py(v)) + 0.5;
+			ctx.strokeStyle = 'rgba(148,163,184,0.15)';
+			ctx.beginPath(); ctx.moveTo(left, y); ctx.lineTo(right, y); ctx.stroke();
+			ctx.fillStyle = '#94a3b8';
+			ctx.fillText((yStep < 1 ? v.toFixed(1) : Math.round(v)) + (o.unit || ''), left - 4, y);
+		}
+
+		// Time axis: steps aligned to local time, at most one label per 70 px
+		const span = x1 - x0;
+		const tStep = CHART_TIME_STEPS.find(s => span / s <= (right - left) / 70) || 30 * 86400e3;
+		const tz = -new Date().getTimezoneOffset() * 60e3;
+		const two = n => String(n).padStart(2, '0');
+		ctx.textAlign = 'center';
+		ctx.textBaseline = 'top';
+		for (let t = Math.ceil((x0 + tz) / tStep) * tStep - tz; t <= x1; t += tStep) {
+			const x = Math.round(px(t)) + 0.5;
+			const d = new Date(t);
+			ctx.strokeStyle = 'rgba(148,163,184,0.15)';
+			ctx.beginPath(); ctx.moveTo(x, top); ctx.lineTo(x, bottom); ctx.stroke();
+			ctx.fillStyle = '#94a3b8';
+			ctx.fillText(tStep >= 86400e3 ? two(d.getDate()) + '.' + two(d.getMonth() + 1)
+				: two(d.getHours()) + ':' + two(d.getMinutes()), x, bottom + 6);
+		}
+
+		// Runs of points without gaps (a gap is over 3x the closest spacing)
+		let minGap = Infinity;
+		for (let i = 1; i < pts.length; i++) {
+			const dt = pts[i].x - pts[i - 1].x;
+			if (dt > 0 && dt < minGap) minGap = dt;
+		}
+		const runs = [];
+		let run = [];
+		pts.forEach((p, i) => {
+			if (i > 0 && p.x - pts[i - 1].x > 3 * minGap) { runs.push(run); run = []; }
+			run.push(p);
+		});
+		if (run.length) runs.push(run);
+
+		ctx.save();
+		ctx.beginPath(); ctx.rect(left, top, right - left, bottom - top); ctx.clip();
+		const band = pts.some(p => p.lo !== undefined && p.hi !== undefined);
+		runs.forEach(r => {
+			// Min/max band, or an area under the line
+			ctx.beginPath();
+			if (band) {
+				r.forEach((p, i) => i ? ctx.lineTo(px(p.x), py(p.hi)) : ctx.moveTo(px(p.x), py(p.hi)));
+				for (let i = r.length - 1; i >= 0; i--) ctx.lineTo(px(r[i].x), py(r[i].lo));
+				ctx.fillStyle = 'rgba(59,130,246,0.15)';
+			} else {
+				r.forEach((p, i) => i ? ctx.lineTo(px(p.x), py(p.y)) : ctx.moveTo(px(p.x), py(p.y)));
+				ctx.lineTo(px(r[r.length - 1].x), bottom);
+				ctx.lineTo(px(r[0].x), bottom);
+				ctx.fillStyle = 'rgba(59,130,246,0.1)';
+			}
+			ctx.fill();
+
+			ctx.beginPath();
+			r.forEach((p, i) => i ? ctx.lineTo(px(p.x), py(p.y)) : ctx.moveTo(px(p.x), py(p.y)));
+			ctx.strokeStyle = o.color;
+			ctx.lineWidth = 2;
+			ctx.lineJoin = 'round';
+			ctx.stroke();
+			if (r.length === 1 || pts.length <= 60) {
+				ctx.fillStyle = o.color;
+				r.forEach(p => { ctx.beginPath(); ctx.arc(px(p.x), py(p.y), 2, 0, 2 * Math.PI); ctx.fill(); });
+			}
+		});
+		ctx.restore();
+	}
+}